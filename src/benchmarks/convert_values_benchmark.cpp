@@ -0,0 +1,132 @@
+#include <pointcloud/convert_values.hpp>
+#include <core_library/print.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+/*
+Measures the cost per element of the batch conversions in convert_values.hpp
+compared to converting one value at a time with convert_component.
+
+    convert_values_benchmark [NUM_VALUES] [REPETITIONS]
+
+The values are read from rows of a typical ply vertex (x y z as double plus
+ushort colors) and written into the vertices, like the importers do. Both
+variants are also compared to make sure they produce the same result.
+*/
+
+struct row_t
+{
+  float64_t x, y, z;
+  uint16_t red, green, blue;
+};
+
+struct vertex_t
+{
+  float32_t x, y, z;
+  uint8_t red, green, blue, _padding;
+};
+
+template<typename function_t>
+double best_nanoseconds_per_element(size_t num_values, int repetitions, const function_t& function);
+
+int main(int argc, char** argv)
+{
+  const size_t num_values = argc>1 ? size_t(std::max(1, std::atoi(argv[1]))) : size_t(1) << 22;
+  const int repetitions = argc>2 ? std::max(1, std::atoi(argv[2])) : 10;
+
+  std::mt19937 random_engine(42);
+  std::uniform_real_distribution<float64_t> coordinate_distribution(-1000., 1000.);
+  std::uniform_int_distribution<int> color_distribution(0, 65535);
+
+  std::vector<row_t> rows(num_values);
+  for(row_t& row : rows)
+  {
+    row.x = coordinate_distribution(random_engine);
+    row.y = coordinate_distribution(random_engine);
+    row.z = coordinate_distribution(random_engine);
+    row.red = uint16_t(color_distribution(random_engine));
+    row.green = uint16_t(color_distribution(random_engine));
+    row.blue = uint16_t(color_distribution(random_engine));
+  }
+
+  std::vector<vertex_t> scalar_vertices(num_values);
+  std::vector<vertex_t> batch_vertices(num_values);
+
+  const uint8_t* row_bytes = reinterpret_cast<const uint8_t*>(rows.data());
+  const size_t row_stride = sizeof(row_t);
+  const size_t vertex_stride = sizeof(vertex_t);
+
+  println("float64 -> float32 (strided)");
+  const double scalar_coordinates = best_nanoseconds_per_element(num_values, repetitions, [&](){
+    for(size_t i=0; i<num_values; ++i)
+      convert_component<float64_t, float32_t>::convert_normalized(&rows[i].x, &scalar_vertices[i].x);
+  });
+  const double batch_coordinates = best_nanoseconds_per_element(num_values, repetitions, [&](){
+    convert_components<float64_t, float32_t>::convert_normalized(row_bytes + offsetof(row_t, x), row_stride, &batch_vertices[0].x, vertex_stride, num_values);
+  });
+  println("  scalar: ", scalar_coordinates, " ns/element");
+  println("  batch:  ", batch_coordinates, " ns/element");
+
+  println("uint16 -> uint8 normalized (strided)");
+  const double scalar_colors = best_nanoseconds_per_element(num_values, repetitions, [&](){
+    for(size_t i=0; i<num_values; ++i)
+      convert_component<uint16_t, uint8_t>::convert_normalized(&rows[i].red, &scalar_vertices[i].red);
+  });
+  const double batch_colors = best_nanoseconds_per_element(num_values, repetitions, [&](){
+    convert_components<uint16_t, uint8_t>::convert_normalized(row_bytes + offsetof(row_t, red), row_stride, &batch_vertices[0].red, vertex_stride, num_values);
+  });
+  println("  scalar: ", scalar_colors, " ns/element");
+  println("  batch:  ", batch_colors, " ns/element");
+
+  size_t num_mismatches = 0;
+  for(size_t i=0; i<num_values; ++i)
+    if(scalar_vertices[i].x != batch_vertices[i].x || scalar_vertices[i].red != batch_vertices[i].red)
+      num_mismatches++;
+
+  std::vector<float32_t> values(num_values * 3);
+  std::vector<float32_t> swapped_values(values);
+
+  println("byte swap float32 (contiguous)");
+  const double scalar_swap = best_nanoseconds_per_element(values.size(), repetitions, [&](){
+    for(float32_t& value : values)
+    {
+      uint8_t* bytes = reinterpret_cast<uint8_t*>(&value);
+      std::reverse(bytes, bytes+sizeof(float32_t));
+    }
+  });
+  const double batch_swap = best_nanoseconds_per_element(values.size(), repetitions, [&](){
+    swap_byte_order<sizeof(float32_t)>(swapped_values.data(), sizeof(float32_t), swapped_values.size());
+  });
+  println("  scalar: ", scalar_swap, " ns/element");
+  println("  batch:  ", batch_swap, " ns/element");
+
+  // both were swapped the same (odd or even) number of times
+  if(std::memcmp(values.data(), swapped_values.data(), values.size() * sizeof(float32_t)) != 0)
+    num_mismatches++;
+
+  if(num_mismatches != 0)
+  {
+    println_error(num_mismatches, " mismatches between the scalar and the batch conversion");
+    return -1;
+  }
+
+  return 0;
+}
+
+template<typename function_t>
+double best_nanoseconds_per_element(size_t num_values, int repetitions, const function_t& function)
+{
+  double best_seconds = std::numeric_limits<double>::infinity();
+
+  for(int i=0; i<repetitions; ++i)
+  {
+    const auto begin = std::chrono::steady_clock::now();
+    function();
+    best_seconds = std::min(best_seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+  }
+
+  return best_seconds * 1.e9 / double(num_values);
+}
@@ -0,0 +1,243 @@
+#include <pointcloud/chunk_codec.hpp>
+#include <pointcloud/importer/abstract_importer.hpp>
+#include <core_library/parallel.hpp>
+#include <core_library/print.hpp>
+
+#include <QFileInfo>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+/*
+Measures the compression ratio of chunk_codec and how fast the chunks of a
+point cloud are encoded and decoded, like the PcvdExporter and the PcvdImporter
+do it for compressed pcvd files.
+
+    pcvd_codec_benchmark [FILE|-] [REPETITIONS] [POINTS_PER_CHUNK] [PRECISION]
+
+Without a file (or with "-"), a synthetic scan of a wavy surface with noisy
+coordinates is used. The speeds are given in GB/s of decoded data (vertices and
+user data), so they can be compared with the read speed of the drive. The
+decoded chunks are compared to the original point cloud.
+
+With a precision, the coordinates are quantized before bit-packing them, like
+the PcvdExporter does with a quantization_precision. Then the decoded vertices
+may differ from the original ones by half the precision.
+*/
+
+struct chunks_t
+{
+  size_t points_per_chunk;
+  size_t num_chunks;
+  std::vector<std::vector<uint8_t>> encoded;
+  std::vector<size_t> vertex_data_size;
+  std::vector<uint8_t> quantized_vertices;
+  std::vector<uint8_t> quantized_user_data;
+};
+
+void make_synthetic_scan(PointCloud* pointcloud, size_t num_points);
+template<typename function_t>
+double best_seconds(int repetitions, const function_t& function);
+
+int main(int argc, char** argv)
+{
+  const int repetitions = argc>2 ? std::max(1, std::atoi(argv[2])) : 5;
+  const size_t points_per_chunk = argc>3 ? size_t(std::max(1, std::atoi(argv[3]))) : size_t(1) << 16;
+  const float64_t precision = argc>4 ? std::atof(argv[4]) : 0.;
+
+  QSharedPointer<AbstractPointCloudImporter> importer;
+  PointCloud synthetic_pointcloud;
+  if(argc > 1 && std::string(argv[1]) != "-")
+  {
+    const std::string filename = argv[1];
+    importer = AbstractPointCloudImporter::importerForSuffix(QFileInfo(QString::fromStdString(filename)).suffix(), filename);
+    if(importer == nullptr)
+    {
+      println_error("Unsupported file ", filename);
+      return -1;
+    }
+    importer->import();
+    if(importer->state != AbstractPointCloudImporter::SUCCEEDED)
+    {
+      println_error("Couldn't load ", filename);
+      return -1;
+    }
+  }else
+  {
+    make_synthetic_scan(&synthetic_pointcloud, size_t(1) << 24);
+  }
+
+  const PointCloud& pointcloud = importer != nullptr ? importer->pointcloud : synthetic_pointcloud;
+  const size_t num_points = pointcloud.num_points;
+  const size_t stride = pointcloud.user_data_stride;
+  const double raw_size = double(num_points * (PointCloud::stride + stride));
+
+  const QVector<chunk_codec::column_t> vertex_columns = chunk_codec::vertex_columns();
+  const QVector<chunk_codec::column_t> user_data_columns = chunk_codec::user_data_columns(pointcloud.user_data_offset, pointcloud.user_data_types);
+  QVector<chunk_codec::column_t> quantized_user_data_columns;
+  const bool quantize_user_data = precision > 0 && chunk_codec::user_data_columns_for_quantization(pointcloud.user_data_names, pointcloud.user_data_offset, pointcloud.user_data_types, &quantized_user_data_columns);
+
+  chunks_t chunks;
+  chunks.points_per_chunk = points_per_chunk;
+  chunks.num_chunks = (num_points + points_per_chunk - 1) / points_per_chunk;
+  chunks.encoded.resize(chunks.num_chunks);
+  chunks.vertex_data_size.resize(chunks.num_chunks);
+  chunks.quantized_vertices.resize(chunks.num_chunks);
+  chunks.quantized_user_data.resize(chunks.num_chunks);
+
+  auto num_chunk_points = [&](size_t chunk) {
+    return std::min(points_per_chunk, num_points - chunk*points_per_chunk);
+  };
+
+  auto encode = [&](size_t, size_t begin, size_t end) {
+    for(size_t i=begin; i<end; ++i)
+    {
+      const size_t first_point = i * points_per_chunk;
+      const uint8_t* chunk_vertices = pointcloud.coordinate_color.data() + first_point*PointCloud::stride;
+      const uint8_t* chunk_user_data = pointcloud.user_data.data() + first_point*stride;
+
+      chunks.encoded[i].clear();
+      chunks.quantized_vertices[i] = precision > 0 && chunk_codec::quantize(chunk_vertices, PointCloud::stride, num_chunk_points(i), vertex_columns, precision, true, &chunks.encoded[i]);
+      if(!chunks.quantized_vertices[i])
+        chunk_codec::encode(chunk_vertices, PointCloud::stride, num_chunk_points(i), vertex_columns, &chunks.encoded[i]);
+      chunks.vertex_data_size[i] = chunks.encoded[i].size();
+      chunks.quantized_user_data[i] = quantize_user_data && chunk_codec::quantize(chunk_user_data, stride, num_chunk_points(i), quantized_user_data_columns, precision, true, &chunks.encoded[i]);
+      if(!chunks.quantized_user_data[i])
+        chunk_codec::encode(chunk_user_data, stride, num_chunk_points(i), user_data_columns, &chunks.encoded[i]);
+    }
+  };
+
+  std::vector<uint8_t> vertices(num_points * PointCloud::stride);
+  std::vector<uint8_t> user_data(num_points * stride);
+  auto decode = [&](size_t, size_t begin, size_t end) {
+    for(size_t i=begin; i<end; ++i)
+    {
+      const size_t first_point = i * points_per_chunk;
+      const std::vector<uint8_t>& encoded = chunks.encoded[i];
+      const size_t vertex_data_size = chunks.vertex_data_size[i];
+      uint8_t* chunk_vertices = vertices.data() + first_point*PointCloud::stride;
+      uint8_t* chunk_user_data = user_data.data() + first_point*stride;
+
+      bool succeeded;
+      if(chunks.quantized_vertices[i])
+        succeeded = chunk_codec::dequantize(encoded.data(), vertex_data_size, PointCloud::stride, num_chunk_points(i), vertex_columns, true, chunk_vertices);
+      else
+        succeeded = chunk_codec::decode(encoded.data(), vertex_data_size, PointCloud::stride, num_chunk_points(i), vertex_columns, chunk_vertices);
+      if(chunks.quantized_user_data[i])
+        succeeded = succeeded && chunk_codec::dequantize(encoded.data() + vertex_data_size, encoded.size() - vertex_data_size, stride, num_chunk_points(i), quantized_user_data_columns, true, chunk_user_data);
+      else
+        succeeded = succeeded && chunk_codec::decode(encoded.data() + vertex_data_size, encoded.size() - vertex_data_size, stride, num_chunk_points(i), user_data_columns, chunk_user_data);
+      if(!succeeded)
+      {
+        println_error("Couldn't decode chunk ", i);
+        std::exit(-1);
+      }
+    }
+  };
+
+  const double encode_seconds = best_seconds(repetitions, [&](){
+    parallel_for_ranges(chunks.num_chunks, encode);
+  });
+
+  double encoded_size = 0;
+  for(const std::vector<uint8_t>& encoded : chunks.encoded)
+    encoded_size += double(encoded.size());
+
+  const double decode_seconds_single_thread = best_seconds(repetitions, [&](){
+    decode(0, 0, chunks.num_chunks);
+  });
+  const double decode_seconds = best_seconds(repetitions, [&](){
+    parallel_for_ranges(chunks.num_chunks, decode);
+  });
+
+  println(num_points, " points, ", chunks.num_chunks, " chunks, ", raw_size * 1.e-6, " MB");
+  println("compression ratio: ", raw_size / encoded_size, " (", encoded_size * 1.e-6, " MB)");
+  println("encode (", num_worker_threads(), " threads): ", raw_size / encode_seconds * 1.e-9, " GB/s");
+  println("decode (1 thread): ", raw_size / decode_seconds_single_thread * 1.e-9, " GB/s");
+  println("decode (", num_worker_threads(), " threads): ", raw_size / decode_seconds * 1.e-9, " GB/s");
+
+  if(precision > 0)
+  {
+    const PointCloud::vertex_t* original = reinterpret_cast<const PointCloud::vertex_t*>(pointcloud.coordinate_color.data());
+    const PointCloud::vertex_t* decoded = reinterpret_cast<const PointCloud::vertex_t*>(vertices.data());
+
+    float64_t max_error = 0;
+    for(size_t i=0; i<num_points; ++i)
+      for(int axis=0; axis<3; ++axis)
+        max_error = std::max(max_error, std::abs(float64_t(original[i].coordinate[axis]) - float64_t(decoded[i].coordinate[axis])));
+    println("max coordinate error: ", max_error);
+
+    // the rounding to float32 adds up to half an ulp of the coordinate
+    if(max_error > precision)
+    {
+      println_error("The decoded coordinates differ by more than the precision");
+      return -1;
+    }
+  }else if(std::memcmp(vertices.data(), pointcloud.coordinate_color.data(), vertices.size()) != 0 || std::memcmp(user_data.data(), pointcloud.user_data.data(), user_data.size()) != 0)
+  {
+    println_error("The decoded point cloud differs from the original");
+    return -1;
+  }
+
+  return 0;
+}
+
+// A scanner at the origin sweeping over a wavy surface line by line. The columns are x y z (float32), red green blue (uint8) and intensity (uint16)
+void make_synthetic_scan(PointCloud* pointcloud, size_t num_points)
+{
+  typedef data_type::BASE_TYPE BASE_TYPE;
+
+  pointcloud->set_user_data_format(17, {"x", "y", "z", "red", "green", "blue", "intensity"}, {0, 4, 8, 12, 13, 14, 15}, {BASE_TYPE::FLOAT32, BASE_TYPE::FLOAT32, BASE_TYPE::FLOAT32, BASE_TYPE::UINT8, BASE_TYPE::UINT8, BASE_TYPE::UINT8, BASE_TYPE::UINT16});
+  pointcloud->resize(num_points);
+  pointcloud->aabb = aabb_t::invalid();
+
+  std::mt19937 random_engine(42);
+  std::normal_distribution<float32_t> noise(0.f, 0.001f);
+
+  const size_t points_per_line = 4096;
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(pointcloud->coordinate_color.data());
+  uint8_t* user_data = pointcloud->user_data.data();
+
+  for(size_t i=0; i<num_points; ++i)
+  {
+    const float32_t angle = float32_t(i % points_per_line) / float32_t(points_per_line) * 3.f;
+    const float32_t distance = 5.f + float32_t(i / points_per_line) * 0.01f;
+
+    PointCloud::vertex_t& vertex = vertices[i];
+    vertex.coordinate.x = distance * std::cos(angle) + noise(random_engine);
+    vertex.coordinate.y = distance * std::sin(angle) + noise(random_engine);
+    vertex.coordinate.z = 0.25f * std::sin(vertex.coordinate.x) * std::cos(vertex.coordinate.y) + noise(random_engine);
+    vertex.color = glm::u8vec3(uint8_t(glm::clamp(0.5f + vertex.coordinate.z, 0.f, 1.f) * 255.f), uint8_t(angle * 80.f), uint8_t(128));
+    vertex._padding.clear();
+
+    const uint16_t intensity = uint16_t(glm::clamp(30000.f / distance + noise(random_engine) * 1.e5f, 0.f, 65535.f));
+
+    uint8_t* row = user_data + i * 17;
+    std::memcpy(row, &vertex.coordinate, 12);
+    std::memcpy(row + 12, &vertex.color, 3);
+    std::memcpy(row + 15, &intensity, 2);
+
+    pointcloud->aabb.min_point = glm::min(pointcloud->aabb.min_point, vertex.coordinate);
+    pointcloud->aabb.max_point = glm::max(pointcloud->aabb.max_point, vertex.coordinate);
+  }
+}
+
+template<typename function_t>
+double best_seconds(int repetitions, const function_t& function)
+{
+  double best_seconds = std::numeric_limits<double>::infinity();
+
+  for(int i=0; i<repetitions; ++i)
+  {
+    const auto begin = std::chrono::steady_clock::now();
+    function();
+    best_seconds = std::min(best_seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+  }
+
+  return best_seconds;
+}
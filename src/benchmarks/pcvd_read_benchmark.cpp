@@ -0,0 +1,124 @@
+#include <pointcloud/importer/pcvd_importer.hpp>
+#include <core_library/print.hpp>
+
+#include <QFileInfo>
+
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+Compares the read modes of the PcvdImporter on a cold and on a warm page cache.
+
+    pcvd_read_benchmark <FILE> [REPETITIONS]
+
+For the cold runs, the pages of the file are evicted from the page cache before
+each run (only works for files without dirty pages). The memory mapped runs
+touch every page of the loaded point cloud, so all data is actually read.
+*/
+
+typedef PcvdImporter::READ_MODE READ_MODE;
+
+bool drop_file_from_page_cache(const std::string& filename);
+double load_seconds(const std::string& filename, PcvdImporter::read_mode_t read_mode);
+uint8_t touch_pages(const uint8_t* data, size_t num_bytes);
+
+int main(int argc, char** argv)
+{
+  if(argc < 2)
+  {
+    println_error("Usage: pcvd_read_benchmark <FILE> [REPETITIONS]");
+    return -1;
+  }
+
+  const std::string filename = argv[1];
+  const int repetitions = argc>2 ? std::max(1, std::atoi(argv[2])) : 3;
+  const double file_size = double(QFileInfo(QString::fromStdString(filename)).size());
+
+  const std::pair<PcvdImporter::read_mode_t, const char*> read_modes[] = {
+    {READ_MODE::STREAM, "stream"},
+    {READ_MODE::PARALLEL_READ, "parallel read"},
+    {READ_MODE::MEMORY_MAPPING, "memory mapping"},
+  };
+
+  for(bool cold : {true, false})
+  {
+    if(cold && !drop_file_from_page_cache(filename))
+    {
+      println_error("Can't drop the file from the page cache, skipping the cold runs");
+      continue;
+    }
+
+    for(const auto& read_mode : read_modes)
+    {
+      double best_seconds = std::numeric_limits<double>::infinity();
+      for(int i=0; i<repetitions; ++i)
+      {
+        if(cold)
+          drop_file_from_page_cache(filename);
+        else
+          load_seconds(filename, read_mode.first);
+
+        best_seconds = std::min(best_seconds, load_seconds(filename, read_mode.first));
+      }
+
+      println(cold ? "cold" : "warm", " cache, ", read_mode.second, ": ", best_seconds, "s (", file_size / best_seconds * 1.e-9, " GB/s)");
+    }
+  }
+
+  return 0;
+}
+
+bool drop_file_from_page_cache(const std::string& filename)
+{
+#ifdef Q_OS_LINUX
+  int file_descriptor = ::open(filename.c_str(), O_RDONLY);
+  if(file_descriptor < 0)
+    return false;
+
+  const bool succeeded = ::fdatasync(file_descriptor)==0 && ::posix_fadvise(file_descriptor, 0, 0, POSIX_FADV_DONTNEED)==0;
+  ::close(file_descriptor);
+  return succeeded;
+#else
+  Q_UNUSED(filename);
+  return false;
+#endif
+}
+
+double load_seconds(const std::string& filename, PcvdImporter::read_mode_t read_mode)
+{
+  const auto begin = std::chrono::steady_clock::now();
+
+  PcvdImporter importer(filename);
+  importer.read_mode = read_mode;
+  importer.import();
+
+  if(importer.state != AbstractPointCloudImporter::SUCCEEDED)
+  {
+    println_error("Couldn't load ", filename);
+    std::exit(-1);
+  }
+
+  const PointCloud& pointcloud = importer.pointcloud;
+
+  volatile uint8_t checksum = 0;
+  checksum ^= touch_pages(pointcloud.coordinate_color.data(), pointcloud.num_points * PointCloud::stride);
+  checksum ^= touch_pages(pointcloud.user_data.data(), pointcloud.num_points * pointcloud.user_data_stride);
+  if(pointcloud.has_build_kdtree())
+    checksum ^= touch_pages(reinterpret_cast<const uint8_t*>(pointcloud.kdtree_index.data()), pointcloud.num_points * sizeof(KDTreeIndex::point_index_t));
+
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+uint8_t touch_pages(const uint8_t* data, size_t num_bytes)
+{
+  uint8_t checksum = 0;
+  for(size_t i=0; i<num_bytes; i+=4096)
+    checksum ^= data[i];
+  return checksum;
+}
@@ -0,0 +1,20 @@
+#ifndef CORELIBRARY_CHECKSUM_HPP_
+#define CORELIBRARY_CHECKSUM_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+Fast non-cryptographic 64 bit hash for detecting corrupt data (the XXH64
+algorithm, so the values can be checked with the xxhsum tool). Hashes several
+GB/s per core, so it can be verified while reading from a drive.
+
+Hashing several blocks one after another is done by using the checksum of the
+previous block as the seed of the next one.
+*/
+
+uint64_t checksum64(const void* data, size_t size, uint64_t seed = 0);
+
+#include <core_library/checksum.inl>
+
+#endif // CORELIBRARY_CHECKSUM_HPP_
@@ -0,0 +1,92 @@
+#include <core_library/checksum.hpp>
+
+#include <cstring>
+
+namespace checksum_implementation {
+
+constexpr uint64_t prime_1 = 11400714785074694791ULL;
+constexpr uint64_t prime_2 = 14029467366897019727ULL;
+constexpr uint64_t prime_3 = 1609587929392839161ULL;
+constexpr uint64_t prime_4 = 9650029242287828579ULL;
+constexpr uint64_t prime_5 = 2870177450012600261ULL;
+
+inline uint64_t rotate_left(uint64_t value, int bits)
+{
+  return (value << bits) | (value >> (64-bits));
+}
+
+inline uint64_t read_64(const uint8_t* data)
+{
+  uint64_t value;
+  std::memcpy(&value, data, sizeof(uint64_t));
+  return value;
+}
+
+inline uint32_t read_32(const uint8_t* data)
+{
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(uint32_t));
+  return value;
+}
+
+inline uint64_t round(uint64_t accumulator, uint64_t input)
+{
+  return rotate_left(accumulator + input * prime_2, 31) * prime_1;
+}
+
+inline uint64_t merge_round(uint64_t hash, uint64_t accumulator)
+{
+  return (hash ^ round(0, accumulator)) * prime_1 + prime_4;
+}
+
+} // namespace checksum_implementation
+
+inline uint64_t checksum64(const void* data, size_t size, uint64_t seed)
+{
+  using namespace checksum_implementation;
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  const uint8_t* const end = bytes + size;
+  uint64_t hash;
+
+  if(size >= 32)
+  {
+    uint64_t accumulator[4] = {seed + prime_1 + prime_2, seed + prime_2, seed, seed - prime_1};
+
+    // four independent lanes, so the multiplications overlap
+    for(; bytes + 32 <= end; bytes += 32)
+    {
+      accumulator[0] = round(accumulator[0], read_64(bytes));
+      accumulator[1] = round(accumulator[1], read_64(bytes + 8));
+      accumulator[2] = round(accumulator[2], read_64(bytes + 16));
+      accumulator[3] = round(accumulator[3], read_64(bytes + 24));
+    }
+
+    hash = rotate_left(accumulator[0], 1) + rotate_left(accumulator[1], 7) + rotate_left(accumulator[2], 12) + rotate_left(accumulator[3], 18);
+    for(uint64_t lane : accumulator)
+      hash = merge_round(hash, lane);
+  }else
+  {
+    hash = seed + prime_5;
+  }
+
+  hash += uint64_t(size);
+
+  for(; bytes + 8 <= end; bytes += 8)
+    hash = rotate_left(hash ^ round(0, read_64(bytes)), 27) * prime_1 + prime_4;
+  if(bytes + 4 <= end)
+  {
+    hash = rotate_left(hash ^ (uint64_t(read_32(bytes)) * prime_1), 23) * prime_2 + prime_3;
+    bytes += 4;
+  }
+  for(; bytes < end; ++bytes)
+    hash = rotate_left(hash ^ (uint64_t(*bytes) * prime_5), 11) * prime_1;
+
+  hash ^= hash >> 33;
+  hash *= prime_2;
+  hash ^= hash >> 29;
+  hash *= prime_3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
@@ -0,0 +1,26 @@
+#ifndef CORELIBRARY_PARALLEL_HPP_
+#define CORELIBRARY_PARALLEL_HPP_
+
+#include <cstddef>
+
+/*
+Helper functions for distributing work over all cores.
+
+`parallel_for_ranges(n, function)` splits the range [0, n) into one contiguous
+range per thread and calls `function(thread_index, begin, end)` for each of them.
+The calling thread works on the first range and waits for all other threads.
+If any of the calls throws, the first exception is rethrown in the calling
+thread after all threads finished.
+*/
+
+size_t num_worker_threads();
+
+template<typename function_t>
+void parallel_for_ranges(size_t n, const function_t& function);
+
+template<typename function_t>
+void parallel_for_ranges(size_t n, size_t num_threads, const function_t& function);
+
+#include <core_library/parallel.inl>
+
+#endif // CORELIBRARY_PARALLEL_HPP_
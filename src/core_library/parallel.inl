@@ -0,0 +1,55 @@
+#include <core_library/parallel.hpp>
+
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <exception>
+
+inline size_t num_worker_threads()
+{
+  return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+template<typename function_t>
+void parallel_for_ranges(size_t n, const function_t& function)
+{
+  parallel_for_ranges(n, num_worker_threads(), function);
+}
+
+template<typename function_t>
+void parallel_for_ranges(size_t n, size_t num_threads, const function_t& function)
+{
+  num_threads = std::max<size_t>(1, std::min(num_threads, n));
+
+  std::mutex exception_mutex;
+  std::exception_ptr exception;
+
+  auto process_range = [n, num_threads, &function, &exception_mutex, &exception](size_t thread_index) {
+    const size_t begin = n * thread_index / num_threads;
+    const size_t end = n * (thread_index+1) / num_threads;
+
+    try
+    {
+      function(thread_index, begin, end);
+    }catch(...)
+    {
+      std::lock_guard<std::mutex> lock(exception_mutex);
+      if(!exception)
+        exception = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads-1);
+  for(size_t thread_index=1; thread_index<num_threads; ++thread_index)
+    threads.emplace_back(process_range, thread_index);
+
+  process_range(0);
+
+  for(std::thread& thread : threads)
+    thread.join();
+
+  if(exception)
+    std::rethrow_exception(exception);
+}
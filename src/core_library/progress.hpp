@@ -0,0 +1,54 @@
+#ifndef CORELIBRARY_PROGRESS_HPP_
+#define CORELIBRARY_PROGRESS_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+/*
+Progress and cancellation of a worker thread, shared with the gui thread.
+
+The worker only stores its progress with a relaxed atomic store and checks the
+cancel flag, while the gui polls `value()` with a timer. So the worker never
+has to process events or emit a signal per chunk, which would dominate fast
+loops. All functions can be called from any thread.
+*/
+class Progress final
+{
+public:
+  constexpr static int max_value(){return 65536;}
+
+  void set(int64_t done, int64_t total)
+  {
+    const int value = total > 0 ? int((double(done) / double(total)) * max_value() + 0.5) : 0;
+    _value.store(std::max(0, std::min(max_value(), value)), std::memory_order_relaxed);
+  }
+
+  int value() const
+  {
+    return _value.load(std::memory_order_relaxed);
+  }
+
+  void cancel()
+  {
+    _canceled.store(true, std::memory_order_relaxed);
+  }
+
+  bool is_canceled() const
+  {
+    return _canceled.load(std::memory_order_relaxed) || (_parent != nullptr && _parent->is_canceled());
+  }
+
+  // Canceling the parent cancels this progress, too. Must be set before the worker starts.
+  void set_parent(const Progress* parent)
+  {
+    _parent = parent;
+  }
+
+private:
+  std::atomic<int> _value{0};
+  std::atomic<bool> _canceled{false};
+  const Progress* _parent = nullptr;
+};
+
+#endif // CORELIBRARY_PROGRESS_HPP_
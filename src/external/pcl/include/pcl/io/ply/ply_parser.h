@@ -297,6 +297,7 @@ namespace pcl
           {}
               
           bool parse (const std::string& filename);
+          bool parse (std::istream& istream);
           //inline bool parse (const std::string& filename);
 
         private:
@@ -43,7 +43,11 @@
 bool pcl::io::ply::ply_parser::parse (const std::string& filename)
 {
   std::ifstream istream (filename.c_str (), std::ios::in | std::ios::binary);
+  return (parse (istream));
+}
 
+bool pcl::io::ply::ply_parser::parse (std::istream& istream)
+{
   std::string line;
   line_number_ = 0;
 
@@ -579,11 +583,6 @@ bool pcl::io::ply::ply_parser::parse (const std::string& filename)
   // binary
   else
   {
-    std::streampos data_start = istream.tellg ();
-    istream.close ();
-    istream.open (filename.c_str (), std::ios::in | std::ios::binary);
-    istream.seekg (data_start);
-
     for (std::vector< boost::shared_ptr<element> >::const_iterator element_iterator = elements.begin (); 
          element_iterator != elements.end (); 
          ++element_iterator)
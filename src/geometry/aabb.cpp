@@ -22,6 +22,12 @@ bool aabb_t::contains(glm::vec3 point, float epsilon) const
       && glm::all(glm::lessThanEqual(point, this->max_point + epsilon));
 }
 
+bool aabb_t::intersects(const aabb_t& other) const
+{
+  return glm::all(glm::lessThanEqual(this->min_point, other.max_point))
+      && glm::all(glm::lessThanEqual(other.min_point, this->max_point));
+}
+
 std::pair<aabb_t, aabb_t> aabb_t::split(int split_dimension, glm::vec3 split_point) const
 {
   aabb_t left = *this;
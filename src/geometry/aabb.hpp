@@ -17,6 +17,7 @@ struct aabb_t
   bool is_valid() const{return !is_inf() && !is_nan() && all(greaterThan(max_point, min_point));}
 
   bool contains(glm::vec3 point, float epsilon=1.e-6f) const;
+  bool intersects(const aabb_t& other) const;
 
   std::pair<aabb_t, aabb_t> split(int split_dimension, glm::vec3 split_point) const;
 
@@ -3,39 +3,345 @@
 #include <core_library/print.hpp>
 
 #include <QString>
+#include <QFile>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+
+constexpr size_t Buffer::copy_chunk_size;
+
+// The memory of a buffer, which is either allocated, mapped from a file, viewed or copied from a shared memory
+struct Buffer::storage_t
+{
+  std::vector<uint8_t> bytes;
+
+  std::unique_ptr<QFile> mapped_file;
+  uint8_t* mapped_bytes = nullptr;
+  size_t num_mapped_bytes = 0;
+
+  uint8_t* viewed_bytes = nullptr; // not owned
+  size_t num_viewed_bytes = 0;
+
+  // Uninitialized, so the pages of chunks not copied yet aren't allocated by the system
+  std::unique_ptr<uint8_t[]> copied_bytes;
+  size_t num_copied_bytes = 0;
+
+  // While copying the chunks on demand, the remaining chunks are still read from the shared storage
+  std::shared_ptr<const storage_t> shared_storage;
+  std::vector<bool> copied_chunks;
+  size_t num_missing_chunks = 0;
+
+  ~storage_t();
+
+  uint8_t* data();
+  const uint8_t* data() const;
+  size_t size() const;
+
+  static std::shared_ptr<storage_t> copy_on_demand(std::shared_ptr<const storage_t> shared_storage);
+  void copy_chunks(size_t offset, size_t size, bool overwrite);
+  void copy_missing_chunks();
+};
+
 Buffer::Buffer()
 {
 }
 
-Buffer::Buffer(Buffer&& other) = default;
+Buffer::~Buffer()
+{
+}
+
+Buffer::Buffer(Buffer&& other)
+  : storage(std::move(other.storage)),
+    _revision(other._revision.load(std::memory_order_relaxed))
+{
+  other._revision.fetch_add(1, std::memory_order_relaxed);
+}
 
-Buffer& Buffer::operator=(Buffer&& other) = default;
+// The revision keeps increasing, so a buffer replaced by another one never has the revision of an earlier snapshot.
+// Moving a snapshot into a new buffer keeps the revision of the snapshot.
+Buffer& Buffer::operator=(Buffer&& other)
+{
+  storage = std::move(other.storage);
+  _revision = std::max(_revision.load(std::memory_order_relaxed) + 1, other._revision.load(std::memory_order_relaxed));
+  other._revision.fetch_add(1, std::memory_order_relaxed);
+  return *this;
+}
 
 uint8_t*Buffer::data()
 {
-  return bytes.data();
+  _revision.fetch_add(1, std::memory_order_relaxed);
+
+  if(storage == nullptr)
+    return nullptr;
+
+  detach(0, storage->size(), false);
+  return storage->data();
 }
 
+// Only reads, so other threads may call it while the owning thread writes other parts of the buffer
 const uint8_t*Buffer::data() const
 {
-  return bytes.data();
+  if(storage == nullptr)
+    return nullptr;
+
+  Q_ASSERT(is_complete());
+  return static_cast<const storage_t&>(*storage).data();
+}
+
+const uint8_t*Buffer::const_data() const
+{
+  return data();
+}
+
+uint8_t* Buffer::data(size_t offset, size_t size)
+{
+  _revision.fetch_add(1, std::memory_order_relaxed);
+
+  if(storage == nullptr)
+    return nullptr;
+
+  Q_ASSERT(offset + size <= storage->size());
+
+  detach(offset, size, false);
+  return storage->data() + offset;
+}
+
+uint8_t* Buffer::overwrite(size_t offset, size_t size)
+{
+  _revision.fetch_add(1, std::memory_order_relaxed);
+
+  if(storage == nullptr)
+    return nullptr;
+
+  Q_ASSERT(offset + size <= storage->size());
+
+  detach(offset, size, true);
+  return storage->data() + offset;
+}
+
+Buffer Buffer::snapshot() const
+{
+  // The snapshot is read by other threads, so it must not share the chunks still missing in a partial copy
+  Q_ASSERT(is_complete());
+
+  Buffer snapshot;
+  snapshot.storage = storage;
+  snapshot._revision = _revision.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+size_t Buffer::revision() const
+{
+  return _revision.load(std::memory_order_relaxed);
+}
+
+bool Buffer::is_complete() const
+{
+  return storage == nullptr || storage->num_missing_chunks == 0;
+}
+
+bool Buffer::shares_data_with(const Buffer& other) const
+{
+  return storage == other.storage;
 }
 
 void Buffer::clear()
 {
-  bytes.clear();
+  _revision.fetch_add(1, std::memory_order_relaxed);
+  storage.reset();
 }
 
 void Buffer::resize(size_t size)
 {
-  bytes.resize(size);
+  _revision.fetch_add(1, std::memory_order_relaxed);
+
+  // A viewed memory of the same size is kept, so it gets filled instead of an allocated one
+  if(storage != nullptr && storage->viewed_bytes != nullptr && storage->num_viewed_bytes == size && !is_shared())
+    return;
+  // Same for a copied memory
+  if(storage != nullptr && storage->copied_bytes != nullptr && storage->num_copied_bytes == size && !is_shared())
+  {
+    storage->copy_missing_chunks();
+    return;
+  }
+
+  // A mapped or viewed content is discarded, an allocated content is kept (like std::vector::resize)
+  if(storage == nullptr || is_mapped() || storage->viewed_bytes != nullptr)
+  {
+    storage = std::make_shared<storage_t>();
+  }else if(is_shared() || storage->copied_bytes != nullptr)
+  {
+    // Only the kept part of the content is copied
+    const size_t num_kept_bytes = std::min(size, storage->size());
+    storage->copy_chunks(0, num_kept_bytes, false);
+    const uint8_t* old_bytes = static_cast<const storage_t&>(*storage).data();
+
+    std::shared_ptr<storage_t> new_storage = std::make_shared<storage_t>();
+    new_storage->bytes.assign(old_bytes, old_bytes + num_kept_bytes);
+    storage = std::move(new_storage);
+  }
+
+  storage->bytes.resize(size);
 }
 
 void Buffer::memset(uint32_t value)
 {
-  std::memset(bytes.data(), int(value), bytes.size());
+  if(storage == nullptr)
+    return;
+
+  // The whole content is overwritten, so there's no need to copy the shared memory first
+  std::memset(overwrite(0, storage->size()), int(value), storage->size());
+}
+
+bool Buffer::map_file(const QString& filename, int64_t offset, size_t size)
+{
+  clear();
+
+  if(size == 0)
+    return true;
+
+  std::unique_ptr<QFile> file(new QFile(filename));
+  if(!file->open(QIODevice::ReadOnly))
+    return false;
+  if(offset < 0 || offset + int64_t(size) > file->size())
+    return false;
+
+  // The private mapping allows writing to the buffer (for example when remapping the coordinates by a shader)
+  uint8_t* mapped_region = file->map(offset, qint64(size), QFileDevice::MapPrivateOption);
+  if(mapped_region == nullptr)
+    return false;
+
+  storage = std::make_shared<storage_t>();
+  storage->mapped_file = std::move(file);
+  storage->mapped_bytes = mapped_region;
+  storage->num_mapped_bytes = size;
+
+  return true;
+}
+
+bool Buffer::is_mapped() const
+{
+  return storage != nullptr && storage->mapped_bytes != nullptr;
+}
+
+void Buffer::view(uint8_t* bytes, size_t size)
+{
+  _revision.fetch_add(1, std::memory_order_relaxed);
+
+  storage = std::make_shared<storage_t>();
+  storage->viewed_bytes = bytes;
+  storage->num_viewed_bytes = size;
+}
+
+// Only the owning thread takes snapshots, so the memory can't become shared while it's modified by this thread
+bool Buffer::is_shared() const
+{
+  return storage != nullptr && storage.use_count() > 1;
+}
+
+// Gives the buffer its own copy of the chunks overlapping the given range, if the memory is shared with a snapshot
+void Buffer::detach(size_t offset, size_t size, bool overwrite)
+{
+  if(is_shared())
+    storage = storage_t::copy_on_demand(std::move(storage));
+
+  storage->copy_chunks(offset, size, overwrite);
+}
+
+// ==== Buffer::storage_t ====
+
+Buffer::storage_t::~storage_t()
+{
+  if(mapped_bytes != nullptr)
+    mapped_file->unmap(mapped_bytes);
+}
+
+uint8_t* Buffer::storage_t::data()
+{
+  if(mapped_bytes != nullptr)
+    return mapped_bytes;
+  if(viewed_bytes != nullptr)
+    return viewed_bytes;
+  if(copied_bytes != nullptr)
+    return copied_bytes.get();
+  return bytes.data();
+}
+
+const uint8_t* Buffer::storage_t::data() const
+{
+  if(mapped_bytes != nullptr)
+    return mapped_bytes;
+  if(viewed_bytes != nullptr)
+    return viewed_bytes;
+  if(copied_bytes != nullptr)
+    return copied_bytes.get();
+  return bytes.data();
+}
+
+size_t Buffer::storage_t::size() const
+{
+  if(mapped_bytes != nullptr)
+    return num_mapped_bytes;
+  if(viewed_bytes != nullptr)
+    return num_viewed_bytes;
+  if(copied_bytes != nullptr)
+    return num_copied_bytes;
+  return bytes.size();
+}
+
+// A storage of the same size, whose chunks are copied from the shared storage by copy_chunks
+std::shared_ptr<Buffer::storage_t> Buffer::storage_t::copy_on_demand(std::shared_ptr<const storage_t> shared_storage)
+{
+  std::shared_ptr<storage_t> storage = std::make_shared<storage_t>();
+
+  storage->num_copied_bytes = shared_storage->size();
+  storage->copied_bytes.reset(new uint8_t[storage->num_copied_bytes]);
+  storage->num_missing_chunks = (storage->num_copied_bytes + copy_chunk_size - 1) / copy_chunk_size;
+  storage->copied_chunks.assign(storage->num_missing_chunks, false);
+  storage->shared_storage = std::move(shared_storage);
+
+  if(storage->num_missing_chunks == 0)
+    storage->shared_storage.reset();
+
+  return storage;
+}
+
+// Copies the chunks overlapping the given range, which weren't copied yet. If `overwrite` is set, the chunks covered
+// completely by the range are only marked as copied.
+void Buffer::storage_t::copy_chunks(size_t offset, size_t size, bool overwrite)
+{
+  if(shared_storage == nullptr || size == 0)
+    return;
+
+  const uint8_t* shared_bytes = shared_storage->data();
+  const size_t end = offset + size;
+
+  for(size_t chunk = offset / copy_chunk_size; chunk * copy_chunk_size < end; ++chunk)
+  {
+    if(copied_chunks[chunk])
+      continue;
+
+    const size_t chunk_begin = chunk * copy_chunk_size;
+    const size_t chunk_end = std::min(chunk_begin + copy_chunk_size, num_copied_bytes);
+
+    if(!overwrite || chunk_begin < offset || chunk_end > end)
+      std::memcpy(copied_bytes.get() + chunk_begin, shared_bytes + chunk_begin, chunk_end - chunk_begin);
+
+    copied_chunks[chunk] = true;
+    num_missing_chunks--;
+  }
+
+  // Releases the shared memory as soon as it's not needed anymore
+  if(num_missing_chunks == 0)
+  {
+    shared_storage.reset();
+    copied_chunks = std::vector<bool>();
+  }
+}
+
+void Buffer::storage_t::copy_missing_chunks()
+{
+  copy_chunks(0, size(), false);
 }
 
 namespace data_type
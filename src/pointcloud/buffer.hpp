@@ -3,8 +3,13 @@
 
 #include <core_library/types.hpp>
 #include <vector>
+#include <atomic>
+#include <memory>
 #include <QtGlobal>
 
+class QFile;
+class QString;
+
 namespace data_type {
 
 // The values are directly stored into binary files, so make sure not to change the ids
@@ -54,27 +59,83 @@ BASE_TYPE(float64_t, FLOAT64)
 
 /**
 Buffer for storing the point cloud.
+
+Instead of allocating memory, the buffer can also map a region of a file. The
+mapping is private, so pages are only loaded when accessed and changes to the
+buffer are never written back to the file.
+
+A buffer can also view memory owned by another buffer, which allows filling a
+slice of a large buffer by code writing into a buffer of its own.
+
+The memory is copy-on-write: a snapshot shares the memory with the buffer it
+was taken from. Only when one of them is changed (by calling the non-const
+data(), resize() or memset()) while the memory is shared, the changed buffer
+gets its own copy. So a worker thread can read a consistent snapshot while the
+original buffer is modified, without copying anything up front. Snapshots must
+be taken by the thread owning the buffer. Use const_data() to only read a
+buffer, which may be shared.
+
+The copy is made in chunks of copy_chunk_size bytes: data(offset, size) and
+overwrite(offset, size) only copy the chunks overlapping the given range, and
+overwrite() skips the chunks it covers completely. The const accessors never
+modify the buffer, so other threads may read it while the owning thread writes
+to it. Therefore the remaining chunks of a partial copy must be written or
+copied (by the non-const data()) before reading the buffer or taking a snapshot.
+
+Every non-const accessor increments the revision, so results computed from a
+snapshot can be checked to still fit the buffer (see build_kdtree).
 */
 class Buffer final
 {
 public:
   Buffer();
+  ~Buffer();
   Buffer(Buffer&& other);
   Buffer& operator=(Buffer&& other);
 
   Buffer(const Buffer& buffer) = delete;
   Buffer& operator=(const Buffer& buffer) = delete;
 
-  uint8_t* data();
+  static constexpr size_t copy_chunk_size = 16 * 1024 * 1024;
+
+  uint8_t* data(); // copies the memory first, if it's shared with a snapshot
   const uint8_t* data() const;
+  const uint8_t* const_data() const;
+
+  // Returns data() + offset, but only copies the shared chunks overlapping the range, so only the range may be accessed
+  uint8_t* data(size_t offset, size_t size);
+  // Like data(offset, size) for writing the whole range without reading it, so chunks completely covered by the range aren't copied
+  uint8_t* overwrite(size_t offset, size_t size);
+
+  Buffer snapshot() const;
+  bool shares_data_with(const Buffer& other) const;
+
+  size_t revision() const;
+  bool is_complete() const; // false, while chunks of a partial copy are missing
 
   void clear();
 
   void resize(size_t size);
   void memset(uint32_t value);
 
+  // Replaces the content by a mapping of `size` bytes of the given file starting at `offset`.
+  // Returns false (and leaves the buffer empty), if the region couldn't be mapped.
+  bool map_file(const QString& filename, int64_t offset, size_t size);
+  bool is_mapped() const;
+
+  // Replaces the content by `size` bytes of memory owned by someone else (for example a slice of another buffer),
+  // so writing into this buffer writes into that memory. The memory must stay valid as long as it's viewed.
+  // Resizing the buffer to another size or mapping a file replaces the view by memory of its own.
+  void view(uint8_t* bytes, size_t size);
+
 private:
-  std::vector<uint8_t> bytes;
+  struct storage_t;
+
+  std::shared_ptr<storage_t> storage; // nullptr for an empty buffer
+  std::atomic<size_t> _revision{0}; // importers may call data() on several threads
+
+  bool is_shared() const;
+  void detach(size_t offset, size_t size, bool overwrite);
 };
 
 #include <pointcloud/buffer.inl>
@@ -0,0 +1,469 @@
+#include <pointcloud/chunk_codec.hpp>
+#include <pointcloud/pointcloud.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace chunk_codec {
+
+namespace {
+
+// Maps small differences in both directions to small unsigned values (0, -1, 1, -2, 2, ... -> 0, 1, 2, 3, 4, ...)
+template<typename value_t>
+value_t zigzag(value_t difference)
+{
+  const value_t sign = value_t(value_t(0) - value_t(difference >> (sizeof(value_t)*8-1)));
+  return value_t(value_t(difference << 1) ^ sign);
+}
+
+template<typename value_t>
+value_t unzigzag(value_t value)
+{
+  return value_t(value_t(value >> 1) ^ value_t(value_t(0) - value_t(value & 1)));
+}
+
+unsigned bit_width(uint64_t value)
+{
+  unsigned width = 0;
+  while(width < 64 && (value >> width) != 0)
+    ++width;
+  return width;
+}
+
+template<typename value_t>
+void encode_column(const uint8_t* column, size_t stride, size_t num_rows, std::vector<uint8_t>* encoded)
+{
+  value_t previous = 0;
+  uint64_t differences[block_size];
+
+  for(size_t first_row=0; first_row<num_rows; first_row+=block_size)
+  {
+    const size_t num_block_rows = std::min(block_size, num_rows-first_row);
+
+    uint64_t all_bits = 0;
+    for(size_t i=0; i<num_block_rows; ++i)
+    {
+      value_t value;
+      std::memcpy(&value, column + (first_row+i)*stride, sizeof(value_t));
+      differences[i] = zigzag<value_t>(value_t(value - previous));
+      all_bits |= differences[i];
+      previous = value;
+    }
+
+    const unsigned bits = bit_width(all_bits);
+    encoded->push_back(uint8_t(bits));
+    if(bits == 0)
+      continue;
+
+    uint64_t buffer = 0;
+    unsigned num_buffered_bits = 0;
+    for(size_t i=0; i<num_block_rows; ++i)
+    {
+      buffer |= differences[i] << num_buffered_bits;
+
+      if(num_buffered_bits + bits < 64)
+      {
+        num_buffered_bits += bits;
+        continue;
+      }
+
+      for(unsigned j=0; j<8; ++j)
+        encoded->push_back(uint8_t(buffer >> (j*8)));
+      buffer = num_buffered_bits!=0 ? differences[i] >> (64-num_buffered_bits) : 0;
+      num_buffered_bits = num_buffered_bits + bits - 64;
+    }
+    for(unsigned j=0; j*8<num_buffered_bits; ++j)
+      encoded->push_back(uint8_t(buffer >> (j*8)));
+  }
+}
+
+// `end` excludes the padding, so 64 bits can be read at every position before `end`
+template<typename value_t>
+bool decode_column(const uint8_t** encoded, const uint8_t* end, size_t stride, size_t num_rows, uint8_t* column)
+{
+  const uint8_t* block = *encoded;
+  value_t previous = 0;
+
+  for(size_t first_row=0; first_row<num_rows; first_row+=block_size)
+  {
+    const size_t num_block_rows = std::min(block_size, num_rows-first_row);
+
+    if(block == end)
+      return false;
+    const unsigned bits = *block++;
+    if(bits > sizeof(value_t)*8)
+      return false;
+
+    const size_t num_bytes = (num_block_rows*bits + 7) / 8;
+    if(size_t(end-block) < num_bytes)
+      return false;
+
+    if(bits == 0)
+    {
+      for(size_t i=0; i<num_block_rows; ++i)
+        std::memcpy(column + (first_row+i)*stride, &previous, sizeof(value_t));
+      continue;
+    }
+
+    const uint64_t mask = bits==64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+    for(size_t i=0; i<num_block_rows; ++i)
+    {
+      const size_t bit = i*bits;
+      const unsigned shift = unsigned(bit % 8);
+
+      uint64_t word;
+      std::memcpy(&word, block + bit/8, sizeof(uint64_t));
+      word >>= shift;
+      if(sizeof(value_t)==8 && shift + bits > 64)
+        word |= uint64_t(block[bit/8 + 8]) << (64-shift);
+
+      previous = value_t(previous + unzigzag<value_t>(value_t(word & mask)));
+      std::memcpy(column + (first_row+i)*stride, &previous, sizeof(value_t));
+    }
+
+    block += num_bytes;
+  }
+
+  *encoded = block;
+  return true;
+}
+
+float64_t read_coordinate(const uint8_t* row, const column_t& column)
+{
+  if(column.size == sizeof(float32_t))
+  {
+    float32_t value;
+    std::memcpy(&value, row + column.offset, sizeof(float32_t));
+    return float64_t(value);
+  }
+
+  float64_t value;
+  std::memcpy(&value, row + column.offset, sizeof(float64_t));
+  return value;
+}
+
+template<size_t bytes_per_coordinate, typename float_t>
+void dequantize_column(const uint8_t* quantized, size_t quantized_stride, float64_t origin, float64_t precision, size_t num_rows, uint8_t* column, size_t stride)
+{
+  for(size_t i=0; i<num_rows; ++i)
+  {
+    uint32_t quantized_value = 0;
+    for(size_t j=0; j<bytes_per_coordinate; ++j)
+      quantized_value |= uint32_t(quantized[i*quantized_stride + j]) << (j*8);
+
+    const float_t value = float_t(origin + float64_t(quantized_value) * precision);
+    std::memcpy(column + i*stride, &value, sizeof(float_t));
+  }
+}
+
+template<typename float_t>
+void dequantize_column(const uint8_t* quantized, size_t quantized_stride, size_t bytes_per_coordinate, float64_t origin, float64_t precision, size_t num_rows, uint8_t* column, size_t stride)
+{
+  switch(bytes_per_coordinate)
+  {
+  case 1:
+    dequantize_column<1, float_t>(quantized, quantized_stride, origin, precision, num_rows, column, stride);
+    break;
+  case 2:
+    dequantize_column<2, float_t>(quantized, quantized_stride, origin, precision, num_rows, column, stride);
+    break;
+  case 3:
+    dequantize_column<3, float_t>(quantized, quantized_stride, origin, precision, num_rows, column, stride);
+    break;
+  case 4:
+    dequantize_column<4, float_t>(quantized, quantized_stride, origin, precision, num_rows, column, stride);
+    break;
+  }
+}
+
+void dequantize_column(const uint8_t* quantized, size_t quantized_stride, size_t bytes_per_coordinate, float64_t origin, float64_t precision, size_t num_rows, uint8_t* column, size_t stride, size_t column_size)
+{
+  if(column_size == sizeof(float32_t))
+    dequantize_column<float32_t>(quantized, quantized_stride, bytes_per_coordinate, origin, precision, num_rows, column, stride);
+  else
+    dequantize_column<float64_t>(quantized, quantized_stride, bytes_per_coordinate, origin, precision, num_rows, column, stride);
+}
+
+template<size_t size>
+void copy_column(const uint8_t* source, size_t source_stride, size_t num_rows, uint8_t* target, size_t target_stride)
+{
+  for(size_t i=0; i<num_rows; ++i)
+    std::memcpy(target + i*target_stride, source + i*source_stride, size);
+}
+
+void copy_column(const uint8_t* source, size_t source_stride, size_t num_rows, uint8_t* target, size_t target_stride, size_t size)
+{
+  switch(size)
+  {
+  case 1:
+    copy_column<1>(source, source_stride, num_rows, target, target_stride);
+    break;
+  case 2:
+    copy_column<2>(source, source_stride, num_rows, target, target_stride);
+    break;
+  case 4:
+    copy_column<4>(source, source_stride, num_rows, target, target_stride);
+    break;
+  case 8:
+    copy_column<8>(source, source_stride, num_rows, target, target_stride);
+    break;
+  }
+}
+
+// The layout of the quantized rows: the quantized coordinates followed by the other columns
+QVector<column_t> quantized_columns(const QVector<column_t>& columns, size_t bytes_per_coordinate, size_t* quantized_stride)
+{
+  QVector<column_t> quantized;
+  size_t offset = 0;
+
+  for(int i=0; i<columns.length(); ++i)
+  {
+    const size_t size = i<3 ? bytes_per_coordinate : columns[i].size;
+
+    // three byte coordinates are bit-packed as three byte columns
+    if(size == 3)
+    {
+      for(size_t j=0; j<3; ++j)
+        quantized.append(column_t{offset+j, 1});
+    }else
+    {
+      quantized.append(column_t{offset, size});
+    }
+    offset += size;
+  }
+
+  *quantized_stride = offset;
+  return quantized;
+}
+
+} // namespace
+
+QVector<column_t> vertex_columns()
+{
+  static_assert(sizeof(PointCloud::vertex_t) == 16, "vertex_columns must cover the whole vertex");
+
+  return {{0, 4}, {4, 4}, {8, 4}, {12, 1}, {13, 1}, {14, 1}, {15, 1}};
+}
+
+QVector<column_t> user_data_columns(const QVector<size_t>& offsets, const QVector<data_type::base_type_t>& types)
+{
+  QVector<column_t> columns;
+  for(int i=0; i<types.length(); ++i)
+    columns.append(column_t{offsets[i], data_type::size_of_type(types[i])});
+  return columns;
+}
+
+bool user_data_columns_for_quantization(const QVector<QString>& names, const QVector<size_t>& offsets, const QVector<data_type::base_type_t>& types, QVector<column_t>* columns)
+{
+  const QVector<column_t> user_data = user_data_columns(offsets, types);
+
+  columns->clear();
+  for(QString coordinate : {"x", "y", "z"})
+  {
+    const int i = names.indexOf(coordinate);
+    if(i < 0 || (types[i] != data_type::BASE_TYPE::FLOAT32 && types[i] != data_type::BASE_TYPE::FLOAT64))
+      return false;
+    columns->append(user_data[i]);
+  }
+
+  for(int i=0; i<user_data.length(); ++i)
+    if(names[i] != "x" && names[i] != "y" && names[i] != "z")
+      columns->append(user_data[i]);
+
+  return true;
+}
+
+void encode(const uint8_t* rows, size_t stride, size_t num_rows, const QVector<column_t>& columns, std::vector<uint8_t>* encoded)
+{
+  for(const column_t& column : columns)
+  {
+    switch(column.size)
+    {
+    case 1:
+      encode_column<uint8_t>(rows + column.offset, stride, num_rows, encoded);
+      break;
+    case 2:
+      encode_column<uint16_t>(rows + column.offset, stride, num_rows, encoded);
+      break;
+    case 4:
+      encode_column<uint32_t>(rows + column.offset, stride, num_rows, encoded);
+      break;
+    case 8:
+      encode_column<uint64_t>(rows + column.offset, stride, num_rows, encoded);
+      break;
+    default:
+      Q_UNREACHABLE();
+    }
+  }
+
+  encoded->insert(encoded->end(), padding_size, uint8_t(0));
+}
+
+bool decode(const uint8_t* encoded, size_t encoded_size, size_t stride, size_t num_rows, const QVector<column_t>& columns, uint8_t* rows)
+{
+  if(encoded_size < padding_size)
+    return false;
+
+  const uint8_t* end = encoded + encoded_size - padding_size;
+
+  for(const column_t& column : columns)
+  {
+    if(column.offset + column.size > stride)
+      return false;
+
+    bool succeeded = false;
+    switch(column.size)
+    {
+    case 1:
+      succeeded = decode_column<uint8_t>(&encoded, end, stride, num_rows, rows + column.offset);
+      break;
+    case 2:
+      succeeded = decode_column<uint16_t>(&encoded, end, stride, num_rows, rows + column.offset);
+      break;
+    case 4:
+      succeeded = decode_column<uint32_t>(&encoded, end, stride, num_rows, rows + column.offset);
+      break;
+    case 8:
+      succeeded = decode_column<uint64_t>(&encoded, end, stride, num_rows, rows + column.offset);
+      break;
+    }
+    if(!succeeded)
+      return false;
+  }
+
+  return encoded == end;
+}
+
+bool quantize(const uint8_t* rows, size_t stride, size_t num_rows, const QVector<column_t>& columns, float64_t precision, bool bit_packing, std::vector<uint8_t>* encoded)
+{
+  if(!(precision > 0) || !std::isfinite(precision) || num_rows == 0 || columns.length() < 3)
+    return false;
+  for(int axis=0; axis<3; ++axis)
+    if(columns[axis].size != sizeof(float32_t) && columns[axis].size != sizeof(float64_t))
+      return false;
+
+  quantization_t quantization;
+  float64_t extent = 0;
+  for(int axis=0; axis<3; ++axis)
+  {
+    float64_t min_value = std::numeric_limits<float64_t>::infinity();
+    float64_t max_value = -std::numeric_limits<float64_t>::infinity();
+    for(size_t i=0; i<num_rows; ++i)
+    {
+      const float64_t value = read_coordinate(rows + i*stride, columns[axis]);
+      if(!std::isfinite(value))
+        return false;
+      min_value = std::min(min_value, value);
+      max_value = std::max(max_value, value);
+    }
+
+    quantization.origin[axis] = min_value;
+    extent = std::max(extent, std::round((max_value - min_value) / precision));
+  }
+
+  if(!(extent <= float64_t(std::numeric_limits<uint32_t>::max())))
+    return false;
+
+  const uint64_t max_quantized = uint64_t(extent);
+  quantization.precision = precision;
+  quantization.bytes_per_coordinate = 1;
+  while(quantization.bytes_per_coordinate < 4 && (max_quantized >> (quantization.bytes_per_coordinate*8)) != 0)
+    quantization.bytes_per_coordinate++;
+
+  // The bit-packing drops the unused bits anyway, but packs whole coordinates faster than their single bytes
+  if(bit_packing)
+    quantization.bytes_per_coordinate = 4;
+  quantization.reserved = 0;
+
+  size_t quantized_stride;
+  const QVector<column_t> quantized = quantized_columns(columns, quantization.bytes_per_coordinate, &quantized_stride);
+  const size_t bytes_per_coordinate = quantization.bytes_per_coordinate;
+
+  std::vector<uint8_t> quantized_rows(num_rows * quantized_stride);
+  for(size_t i=0; i<num_rows; ++i)
+  {
+    const uint8_t* row = rows + i*stride;
+    uint8_t* quantized_row = quantized_rows.data() + i*quantized_stride;
+
+    for(int axis=0; axis<3; ++axis)
+    {
+      const float64_t value = std::round((read_coordinate(row, columns[axis]) - quantization.origin[axis]) / precision);
+      const uint32_t quantized_value = uint32_t(std::max(0., std::min(extent, value)));
+      for(size_t j=0; j<bytes_per_coordinate; ++j)
+        quantized_row[size_t(axis)*bytes_per_coordinate + j] = uint8_t(quantized_value >> (j*8));
+    }
+
+    size_t offset = 3*bytes_per_coordinate;
+    for(int j=3; j<columns.length(); ++j)
+    {
+      std::memcpy(quantized_row + offset, row + columns[j].offset, columns[j].size);
+      offset += columns[j].size;
+    }
+  }
+
+  const uint8_t* quantization_bytes = reinterpret_cast<const uint8_t*>(&quantization);
+  encoded->insert(encoded->end(), quantization_bytes, quantization_bytes + sizeof(quantization_t));
+  if(bit_packing)
+    encode(quantized_rows.data(), quantized_stride, num_rows, quantized, encoded);
+  else
+    encoded->insert(encoded->end(), quantized_rows.begin(), quantized_rows.end());
+
+  return true;
+}
+
+bool dequantize(const uint8_t* encoded, size_t encoded_size, size_t stride, size_t num_rows, const QVector<column_t>& columns, bool bit_packing, uint8_t* rows)
+{
+  quantization_t quantization;
+  if(encoded_size < sizeof(quantization_t) || columns.length() < 3)
+    return false;
+  std::memcpy(&quantization, encoded, sizeof(quantization_t));
+  encoded += sizeof(quantization_t);
+  encoded_size -= sizeof(quantization_t);
+
+  if(quantization.bytes_per_coordinate < 1 || quantization.bytes_per_coordinate > 4 || quantization.reserved != 0)
+    return false;
+  if(!std::isfinite(quantization.precision) || !std::isfinite(quantization.origin[0]) || !std::isfinite(quantization.origin[1]) || !std::isfinite(quantization.origin[2]))
+    return false;
+
+  for(int axis=0; axis<3; ++axis)
+    if(columns[axis].size != sizeof(float32_t) && columns[axis].size != sizeof(float64_t))
+      return false;
+  for(const column_t& column : columns)
+    if(column.offset + column.size > stride)
+      return false;
+
+  size_t quantized_stride;
+  const QVector<column_t> quantized = quantized_columns(columns, quantization.bytes_per_coordinate, &quantized_stride);
+  const size_t bytes_per_coordinate = quantization.bytes_per_coordinate;
+
+  // Each thread keeps its buffer for the bit-packed rows of the next chunk
+  thread_local std::vector<uint8_t> unpacked_rows;
+  const uint8_t* quantized_rows = encoded;
+  if(bit_packing)
+  {
+    unpacked_rows.resize(num_rows * quantized_stride);
+    if(!decode(encoded, encoded_size, quantized_stride, num_rows, quantized, unpacked_rows.data()))
+      return false;
+    quantized_rows = unpacked_rows.data();
+  }else if(encoded_size != num_rows * quantized_stride)
+  {
+    return false;
+  }
+
+  // Column by column, so the loops don't depend on the number of bytes and the types
+  for(int axis=0; axis<3; ++axis)
+    dequantize_column(quantized_rows + size_t(axis)*bytes_per_coordinate, quantized_stride, bytes_per_coordinate, quantization.origin[axis], quantization.precision, num_rows, rows + columns[axis].offset, stride, columns[axis].size);
+
+  size_t offset = 3*bytes_per_coordinate;
+  for(int j=3; j<columns.length(); ++j)
+  {
+    copy_column(quantized_rows + offset, quantized_stride, num_rows, rows + columns[j].offset, stride, columns[j].size);
+    offset += columns[j].size;
+  }
+
+  return true;
+}
+
+} // namespace chunk_codec
@@ -0,0 +1,88 @@
+#ifndef POINTCLOUD_CHUNK_CODEC_HPP_
+#define POINTCLOUD_CHUNK_CODEC_HPP_
+
+#include <pointcloud/buffer.hpp>
+
+#include <QString>
+#include <QVector>
+
+#include <vector>
+
+/*
+Encodings of the rows of a pcvd chunk (see pcvd_format::encoding_t).
+
+The lossless bit-packing (see pcvd_format::ENCODING::DELTA_BIT_PACKING): The rows are split into their columns (byte shuffle), so each column is encoded
+separately. The values of a column are interpreted as unsigned integers of the
+size of the column, even floats. Each value is replaced by the zigzag encoded
+difference to its predecessor, which is small for neighboring points of a scan
+(the bit patterns of close floats are close, too). The differences are then
+bit-packed in blocks of block_size values with the bit width of the largest
+difference of the block:
+
+  COLUMN[0]
+    BLOCK[0]    // uint8_t bit width, followed by block_size values with this bit width, LSB first
+    BLOCK[1]
+    ...
+  COLUMN[1]
+  ...
+  PADDING       // padding_size zero bytes, so the decoder can always read 64 bits at once
+
+The first predecessor of each column is zero. The last block of a column may
+have less than block_size values.
+
+For the quantized encodings (see pcvd_format::ENCODING::QUANTIZED), the first
+three columns are the x, y and z coordinates (float32 or float64). They are
+stored as unsigned integers in units of the precision relative to the minimum of
+each coordinate within the chunk, using as few bytes as the extent of the chunk
+allows (1 to 4 bytes per coordinate, always 4 bytes when bit-packed):
+
+  QUANTIZATION  // quantization_t
+  ROWS          // the quantized coordinates followed by the other columns of each row (without gaps), optionally bit-packed like above
+
+Quantizing is lossy, the dequantized coordinates differ by at most half the
+precision (plus the rounding to the column type).
+*/
+namespace chunk_codec {
+
+constexpr size_t block_size = 128;
+constexpr size_t padding_size = 8;
+
+struct column_t
+{
+  size_t offset; // within the row
+  size_t size; // 1, 2, 4 or 8 bytes
+};
+
+// The coordinates, the color components and the padding of PointCloud::vertex_t
+QVector<column_t> vertex_columns();
+
+// The columns of the user data with the given format
+QVector<column_t> user_data_columns(const QVector<size_t>& offsets, const QVector<data_type::base_type_t>& types);
+
+struct quantization_t
+{
+  float64_t origin[3]; // the minimum of each coordinate
+  float64_t precision; // the unit of the quantized coordinates
+  uint32_t bytes_per_coordinate; // 1 to 4 (little endian)
+  uint32_t reserved; // must be zero
+};
+
+// The columns of the user data with the x, y and z properties first. Returns false, if the user data has no float coordinates to quantize.
+bool user_data_columns_for_quantization(const QVector<QString>& names, const QVector<size_t>& offsets, const QVector<data_type::base_type_t>& types, QVector<column_t>* columns);
+
+// Appends the encoded rows to `encoded`
+void encode(const uint8_t* rows, size_t stride, size_t num_rows, const QVector<column_t>& columns, std::vector<uint8_t>* encoded);
+
+// Decodes the rows and returns false, if the encoded data is corrupt. Bytes of the rows not covered by any column are left unchanged.
+bool decode(const uint8_t* encoded, size_t encoded_size, size_t stride, size_t num_rows, const QVector<column_t>& columns, uint8_t* rows);
+
+// Appends the quantization and the quantized rows to `encoded`. The first three columns must be the coordinates.
+// Returns false without appending anything, if a coordinate isn't finite or the extent of the rows is too large for the precision.
+bool quantize(const uint8_t* rows, size_t stride, size_t num_rows, const QVector<column_t>& columns, float64_t precision, bool bit_packing, std::vector<uint8_t>* encoded);
+
+// Dequantizes the rows and returns false, if the encoded data is corrupt
+bool dequantize(const uint8_t* encoded, size_t encoded_size, size_t stride, size_t num_rows, const QVector<column_t>& columns, bool bit_packing, uint8_t* rows);
+
+} // namespace chunk_codec
+
+#endif // POINTCLOUD_CHUNK_CODEC_HPP_
@@ -4,9 +4,21 @@
 #include <core_library/types.hpp>
 #include <type_traits>
 #include <limits>
+#include <algorithm>
+#include <cstring>
 
 #include <glm/glm.hpp>
 
+#if defined(__AVX2__) || defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define CONVERT_VALUES_SSE2 1
+#endif
+
 template<size_t size>
 struct float_type
 {
@@ -117,4 +129,192 @@ struct convert_component<T, T>
   }
 };
 
+/*
+Batch variants of convert_component, converting num_values values from a strided
+source array to a strided target array (the strides are given in bytes).
+
+The conversions used most by the importers are vectorized with SSE2 (always
+available on x86-64) and AVX/AVX2, if the compiler targets them (for example
+with -march=native). All other conversions use the scalar convert_component.
+*/
+template<typename t_in, typename t_out>
+struct convert_components
+{
+  static void convert_normalized(const void* source, size_t source_stride, void* target, size_t target_stride, size_t num_values)
+  {
+    const uint8_t* s = static_cast<const uint8_t*>(source);
+    uint8_t* t = static_cast<uint8_t*>(target);
+
+    for(size_t i=0; i<num_values; ++i)
+      convert_component<t_in, t_out>::convert_normalized(s + i*source_stride, t + i*target_stride);
+  }
+};
+
+template<typename T>
+struct convert_components<T, T>
+{
+  static void convert_normalized(const void* source, size_t source_stride, void* target, size_t target_stride, size_t num_values)
+  {
+    const uint8_t* s = static_cast<const uint8_t*>(source);
+    uint8_t* t = static_cast<uint8_t*>(target);
+
+    if(source_stride == sizeof(T) && target_stride == sizeof(T))
+    {
+      std::memcpy(t, s, num_values * sizeof(T));
+      return;
+    }
+
+    for(size_t i=0; i<num_values; ++i)
+      std::memcpy(t + i*target_stride, s + i*source_stride, sizeof(T));
+  }
+};
+
+// 16 bit colors to 8 bit colors.
+// round(v*255/65535) is computed exactly in 16 bit integer arithmetic as ((v*0xff01 >> 16) + 128) >> 8
+template<>
+struct convert_components<uint16_t, uint8_t>
+{
+  static void convert_normalized(const void* source, size_t source_stride, void* target, size_t target_stride, size_t num_values)
+  {
+    const uint8_t* s = static_cast<const uint8_t*>(source);
+    uint8_t* t = static_cast<uint8_t*>(target);
+
+    size_t i = 0;
+
+#if CONVERT_VALUES_SSE2
+    for(; i+8<=num_values; i+=8)
+    {
+      __m128i v = _mm_setzero_si128();
+      v = _mm_insert_epi16(v, read_value_from_buffer<uint16_t>(s + (i+0)*source_stride), 0);
+      v = _mm_insert_epi16(v, read_value_from_buffer<uint16_t>(s + (i+1)*source_stride), 1);
+      v = _mm_insert_epi16(v, read_value_from_buffer<uint16_t>(s + (i+2)*source_stride), 2);
+      v = _mm_insert_epi16(v, read_value_from_buffer<uint16_t>(s + (i+3)*source_stride), 3);
+      v = _mm_insert_epi16(v, read_value_from_buffer<uint16_t>(s + (i+4)*source_stride), 4);
+      v = _mm_insert_epi16(v, read_value_from_buffer<uint16_t>(s + (i+5)*source_stride), 5);
+      v = _mm_insert_epi16(v, read_value_from_buffer<uint16_t>(s + (i+6)*source_stride), 6);
+      v = _mm_insert_epi16(v, read_value_from_buffer<uint16_t>(s + (i+7)*source_stride), 7);
+
+      v = _mm_srli_epi16(_mm_add_epi16(_mm_mulhi_epu16(v, _mm_set1_epi16(int16_t(0xff01))), _mm_set1_epi16(128)), 8);
+
+      uint8_t converted[16];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(converted), _mm_packus_epi16(v, v));
+      for(size_t j=0; j<8; ++j)
+        t[(i+j)*target_stride] = converted[j];
+    }
+#endif
+
+    for(; i<num_values; ++i)
+    {
+      const uint32_t v = read_value_from_buffer<uint16_t>(s + i*source_stride);
+      t[i*target_stride] = uint8_t((((v*0xff01u) >> 16) + 128) >> 8);
+    }
+  }
+};
+
+// double coordinates to float coordinates
+template<>
+struct convert_components<float64_t, float32_t>
+{
+  static void convert_normalized(const void* source, size_t source_stride, void* target, size_t target_stride, size_t num_values)
+  {
+    const uint8_t* s = static_cast<const uint8_t*>(source);
+    uint8_t* t = static_cast<uint8_t*>(target);
+
+    size_t i = 0;
+
+#if defined(__AVX__)
+    for(; i+4<=num_values; i+=4)
+    {
+      const __m256d v = _mm256_set_pd(read_value_from_buffer<float64_t>(s + (i+3)*source_stride),
+                                      read_value_from_buffer<float64_t>(s + (i+2)*source_stride),
+                                      read_value_from_buffer<float64_t>(s + (i+1)*source_stride),
+                                      read_value_from_buffer<float64_t>(s + (i+0)*source_stride));
+      float32_t converted[4];
+      _mm_storeu_ps(converted, _mm256_cvtpd_ps(v));
+      for(size_t j=0; j<4; ++j)
+        write_value_to_buffer(t + (i+j)*target_stride, converted[j]);
+    }
+#elif CONVERT_VALUES_SSE2
+    for(; i+2<=num_values; i+=2)
+    {
+      __m128d v = _mm_setzero_pd();
+      v = _mm_loadl_pd(v, reinterpret_cast<const double*>(s + (i+0)*source_stride));
+      v = _mm_loadh_pd(v, reinterpret_cast<const double*>(s + (i+1)*source_stride));
+      float32_t converted[4];
+      _mm_storeu_ps(converted, _mm_cvtpd_ps(v));
+      write_value_to_buffer(t + (i+0)*target_stride, converted[0]);
+      write_value_to_buffer(t + (i+1)*target_stride, converted[1]);
+    }
+#endif
+
+    for(; i<num_values; ++i)
+      write_value_to_buffer(t + i*target_stride, float32_t(read_value_from_buffer<float64_t>(s + i*source_stride)));
+  }
+};
+
+/*
+Reverses the byte order of num_values values of value_size bytes (2, 4 or 8), for
+example for reading binary_big_endian ply files on little endian machines.
+Contiguous values (stride == value_size) are swapped with SSE2 or AVX2.
+*/
+template<size_t value_size>
+void swap_byte_order(void* values, size_t stride, size_t num_values)
+{
+  static_assert(value_size==2 || value_size==4 || value_size==8, "unsupported value size");
+
+  uint8_t* v = static_cast<uint8_t*>(values);
+  size_t i = 0;
+
+  if(stride == value_size)
+  {
+#if defined(__AVX2__)
+    const __m256i shuffle = value_size==2 ? _mm256_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14, 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14)
+                          : value_size==4 ? _mm256_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12, 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12)
+                                          : _mm256_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8, 7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+    for(; (i+32/value_size)<=num_values; i+=32/value_size)
+    {
+      __m256i* p = reinterpret_cast<__m256i*>(v + i*value_size);
+      _mm256_storeu_si256(p, _mm256_shuffle_epi8(_mm256_loadu_si256(p), shuffle));
+    }
+#elif CONVERT_VALUES_SSE2
+    for(; (i+16/value_size)<=num_values; i+=16/value_size)
+    {
+      __m128i* p = reinterpret_cast<__m128i*>(v + i*value_size);
+      __m128i x = _mm_loadu_si128(p);
+
+      // first reverse the order of the 16 bit words within each value, then swap the bytes of each word
+      if(value_size == 4)
+        x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(2,3,0,1)), _MM_SHUFFLE(2,3,0,1));
+      else if(value_size == 8)
+        x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(0,1,2,3)), _MM_SHUFFLE(0,1,2,3));
+      x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+
+      _mm_storeu_si128(p, x);
+    }
+#endif
+  }
+
+  for(; i<num_values; ++i)
+  {
+    uint8_t* value = v + i*stride;
+    std::reverse(value, value+value_size);
+  }
+}
+
+inline void swap_byte_order(void* values, size_t value_size, size_t stride, size_t num_values)
+{
+  switch(value_size)
+  {
+  case 2:
+    swap_byte_order<2>(values, stride, num_values);
+    return;
+  case 4:
+    swap_byte_order<4>(values, stride, num_values);
+    return;
+  case 8:
+    swap_byte_order<8>(values, stride, num_values);
+    return;
+  }
+}
+
 #endif // POINTCLOUDVIEWER_CONVERT_VALUES_HPP_
@@ -1,19 +1,22 @@
 #include <pointcloud/exporter/abstract_exporter.hpp>
 #include <pointcloud/exporter/ply_exporter.hpp>
 #include <pointcloud/exporter/pcvd_exporter.hpp>
+#include <pointcloud/exporter/text_exporter.hpp>
 #include <core_library/print.hpp>
 #include <core_library/types.hpp>
 
-#include <QThread>
 #include <QSharedPointer>
-#include <QAbstractEventDispatcher>
 #include <QSettings>
 #include <QFileInfo>
 
 #include <iostream>
 
 #define PLY_FILTER "PLY (*.ply)"
-#define PCVD_FILTER "Pointcoud Viewer Dump (*.pcvd)"
+#define BINARY_PLY_FILTER "Binary PLY (*.ply)"
+#define TEXT_FILTER "Text (*.xyz)"
+#define PCVD_FILTER "Pointcloud Viewer Dump (*.pcvd)"
+#define COMPRESSED_PCVD_FILTER "Compressed Pointcloud Viewer Dump (*.pcvd)"
+#define QUANTIZED_PCVD_FILTER "Quantized and Compressed Pointcloud Viewer Dump (*.pcvd)"
 
 AbstractPointCloudExporter::~AbstractPointCloudExporter()
 {
@@ -23,16 +26,21 @@ QString AbstractPointCloudExporter::addMissingSuffix(QString filepath, QString s
 {
   const QString suffix = QFileInfo(filepath).suffix().toLower();
 
-  if(selectedFilter == PLY_FILTER)
+  if(selectedFilter == PLY_FILTER || selectedFilter == BINARY_PLY_FILTER)
   {
     if(suffix == "ply")
       return filepath;
     return filepath + ".ply";
-  }else if(selectedFilter == PCVD_FILTER)
+  }else if(selectedFilter == PCVD_FILTER || selectedFilter == COMPRESSED_PCVD_FILTER || selectedFilter == QUANTIZED_PCVD_FILTER)
   {
     if(suffix == "pcvd")
       return filepath;
     return filepath + ".pcvd";
+  }else if(selectedFilter == TEXT_FILTER)
+  {
+    if(suffix == "xyz")
+      return filepath;
+    return filepath + ".xyz";
   }
 
   return addMissingSuffix(filepath, PCVD_FILTER);
@@ -42,8 +50,27 @@ QSharedPointer<AbstractPointCloudExporter> AbstractPointCloudExporter::exporterF
 {
   if(selectedFilter == PLY_FILTER)
     return QSharedPointer<AbstractPointCloudExporter>(new PlyExporter(filepath, pointcloud));
+  else if(selectedFilter == BINARY_PLY_FILTER)
+  {
+    PlyExporter* exporter = new PlyExporter(filepath, pointcloud);
+    exporter->binary = true;
+    return QSharedPointer<AbstractPointCloudExporter>(exporter);
+  }else if(selectedFilter == TEXT_FILTER)
+    return QSharedPointer<AbstractPointCloudExporter>(new TextExporter(filepath, pointcloud));
   else if(selectedFilter == PCVD_FILTER)
     return QSharedPointer<AbstractPointCloudExporter>(new PcvdExporter(filepath, pointcloud));
+  else if(selectedFilter == COMPRESSED_PCVD_FILTER)
+  {
+    PcvdExporter* exporter = new PcvdExporter(filepath, pointcloud);
+    exporter->compress = true;
+    return QSharedPointer<AbstractPointCloudExporter>(exporter);
+  }else if(selectedFilter == QUANTIZED_PCVD_FILTER)
+  {
+    PcvdExporter* exporter = new PcvdExporter(filepath, pointcloud);
+    exporter->compress = true;
+    exporter->quantization_precision = QSettings().value("Export/quantizationPrecision", 0.001).toDouble();
+    return QSharedPointer<AbstractPointCloudExporter>(exporter);
+  }
 
   Q_UNREACHABLE();
   return exporterForSuffix(PCVD_FILTER, filepath, pointcloud);
@@ -51,7 +78,7 @@ QSharedPointer<AbstractPointCloudExporter> AbstractPointCloudExporter::exporterF
 
 QString AbstractPointCloudExporter::allSupportedFiletypes()
 {
-  return PCVD_FILTER ";;" PLY_FILTER;
+  return PCVD_FILTER ";;" COMPRESSED_PCVD_FILTER ";;" QUANTIZED_PCVD_FILTER ";;" PLY_FILTER ";;" BINARY_PLY_FILTER ";;" TEXT_FILTER;
 }
 
 void AbstractPointCloudExporter::export_now()
@@ -86,33 +113,12 @@ AbstractPointCloudExporter::AbstractPointCloudExporter(const std::string& output
 {
 }
 
-void AbstractPointCloudExporter::cancel()
-{
-  this->state = CANCELED;
-}
-
 void AbstractPointCloudExporter::handle_written_chunk(int64_t current_progress)
 {
   Q_ASSERT(current_progress <= total_progress);
 
-  auto process_events = [](){
-    QThread* thread = QThread::currentThread();
-    if(thread != nullptr && thread->eventDispatcher() != nullptr)
-      thread->eventDispatcher()->processEvents(QEventLoop::EventLoopExec | QEventLoop::ExcludeUserInputEvents | QEventLoop::ExcludeSocketNotifiers);
-  };
+  progress.set(current_progress, total_progress);
 
-  process_events();
-
-  if(Q_UNLIKELY(this->state == CANCELED))
+  if(Q_UNLIKELY(progress.is_canceled()))
     throw canceled_t();
-
-  float86_t progress = float86_t(current_progress) / float86_t(total_progress);
-  int discrete_progress_value = int(progress * 65536 + float86_t(0.5));
-  discrete_progress_value = glm::clamp(0, 65536, discrete_progress_value);
-
-  update_progress(discrete_progress_value);
-
-  process_events();
-
-  Q_ASSERT(this->state == RUNNING);
 }
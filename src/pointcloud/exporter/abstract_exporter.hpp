@@ -2,6 +2,7 @@
 #define POINTCLOUD_IMPORTER_ABSTRACTEXPORTER_HPP_
 
 #include <pointcloud/pointcloud.hpp>
+#include <core_library/progress.hpp>
 #include <QObject>
 
 /**
@@ -28,10 +29,13 @@ public:
 
   const PointCloud& pointcloud;
 
+  // Polled by the gui thread. Canceling it aborts the export at the next written chunk.
+  Progress progress;
+
   AbstractPointCloudExporter(const std::string& output_file, const PointCloud& pointcloud);
   ~AbstractPointCloudExporter();
 
-  constexpr static int progress_max(){return 65536;}
+  constexpr static int progress_max(){return Progress::max_value();}
 
   static QSharedPointer<AbstractPointCloudExporter> exporterForSuffix(QString suffix, std::string filepath, const PointCloud& pointcloud);
   static QString addMissingSuffix(QString filepath, QString selectedFilter);
@@ -39,10 +43,8 @@ public:
 
 public slots:
   void export_now();
-  void cancel();
 
 signals:
-  void update_progress(int progress);
   void finished();
 
 protected:
@@ -0,0 +1,587 @@
+#include <pointcloud/exporter/ascii_value_formatter.hpp>
+#include <pointcloud/exporter/shortest_float_tables.hpp>
+#include <core_library/parallel.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace ascii_values {
+
+typedef data_type::BASE_TYPE BASE_TYPE;
+using namespace shortest_float_tables;
+
+// A floating point number as decimal: digits * 10^exponent
+struct decimal_t
+{
+  uint64_t digits;
+  int32_t exponent;
+};
+
+template<typename T>
+char* format_digits(char* target, T value);
+template<typename float_t>
+char* format_float_value(char* target, float_t value);
+char* format_decimal(char* target, decimal_t decimal);
+decimal_t shortest_decimal(float32_t value);
+decimal_t shortest_decimal(float64_t value);
+
+// "00" to "99", so two digits are written at once
+const char digit_pairs[] =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+char* format_value(char* target, data_type::base_type_t type, const uint8_t* value)
+{
+  switch(type)
+  {
+  case BASE_TYPE::INT8:
+    return format_integer(target, int32_t(read_value_from_buffer<int8_t>(value)));
+  case BASE_TYPE::INT16:
+    return format_integer(target, int32_t(read_value_from_buffer<int16_t>(value)));
+  case BASE_TYPE::INT32:
+    return format_integer(target, read_value_from_buffer<int32_t>(value));
+  case BASE_TYPE::UINT8:
+    return format_integer(target, uint32_t(read_value_from_buffer<uint8_t>(value)));
+  case BASE_TYPE::UINT16:
+    return format_integer(target, uint32_t(read_value_from_buffer<uint16_t>(value)));
+  case BASE_TYPE::UINT32:
+    return format_integer(target, read_value_from_buffer<uint32_t>(value));
+  case BASE_TYPE::FLOAT32:
+    return format_float(target, read_value_from_buffer<float32_t>(value));
+  case BASE_TYPE::FLOAT64:
+    return format_float(target, read_value_from_buffer<float64_t>(value));
+  }
+
+  Q_UNREACHABLE();
+  return target;
+}
+
+char* format_float(char* target, float32_t value)
+{
+  return format_float_value(target, value);
+}
+
+char* format_float(char* target, float64_t value)
+{
+  return format_float_value(target, value);
+}
+
+char* format_integer(char* target, uint32_t value)
+{
+  return format_digits(target, value);
+}
+
+char* format_integer(char* target, int32_t value)
+{
+  if(value < 0)
+  {
+    *target++ = '-';
+    return format_digits(target, uint32_t(0) - uint32_t(value));
+  }
+  return format_digits(target, uint32_t(value));
+}
+
+void write_rows(std::ostream& stream, const PointCloud& pointcloud, char delimiter, const std::function<void(size_t)>& handle_written_rows)
+{
+  const size_t num_points = pointcloud.num_points;
+  const size_t stride = pointcloud.user_data_stride;
+  const QVector<data_type::base_type_t>& types = pointcloud.user_data_types;
+  const QVector<size_t>& offsets = pointcloud.user_data_offset;
+  const int num_properties = types.length();
+
+  // Each value is followed by a delimiter or the line break
+  const size_t max_row_length = glm::max<size_t>(1, size_t(num_properties) * (max_value_length + 1));
+  const size_t rows_per_block = glm::max<size_t>(1, (size_t(1) << 22) / max_row_length);
+  const size_t num_blocks = (num_points + rows_per_block - 1) / rows_per_block;
+  const size_t batch_size = num_worker_threads() * 2;
+
+  std::vector<std::vector<char>> text(batch_size);
+  std::vector<size_t> text_length(batch_size);
+
+  for(size_t first_block=0; first_block<num_blocks; first_block+=batch_size)
+  {
+    const size_t num_batch_blocks = glm::min(batch_size, num_blocks-first_block);
+
+    parallel_for_ranges(num_batch_blocks, [&](size_t, size_t begin, size_t end){
+      for(size_t i=begin; i<end; ++i)
+      {
+        const size_t first_row = (first_block+i) * rows_per_block;
+        const size_t num_rows = glm::min(rows_per_block, num_points-first_row);
+        const uint8_t* row = pointcloud.user_data.data() + first_row * stride;
+
+        text[i].resize(num_rows * max_row_length);
+        char* target = text[i].data();
+        for(size_t j=0; j<num_rows; ++j, row+=stride)
+        {
+          for(int k=0; k<num_properties; ++k)
+          {
+            if(k != 0)
+              *target++ = delimiter;
+            target = format_value(target, types[k], row + offsets[k]);
+          }
+          *target++ = '\n';
+        }
+        text_length[i] = size_t(target - text[i].data());
+      }
+    });
+
+    for(size_t i=0; i<num_batch_blocks; ++i)
+    {
+      stream.write(text[i].data(), std::streamsize(text_length[i]));
+      handle_written_rows(glm::min(num_points, (first_block+i+1) * rows_per_block));
+    }
+  }
+}
+
+// Writes the decimal digits of an unsigned integer, two at a time
+template<typename T>
+char* format_digits(char* target, T value)
+{
+  char digits[20];
+  char* begin = digits + sizeof(digits);
+
+  while(value >= 100)
+  {
+    const size_t pair = size_t(value % 100);
+    value /= 100;
+    begin -= 2;
+    std::memcpy(begin, digit_pairs + 2*pair, 2);
+  }
+  if(value >= 10)
+  {
+    begin -= 2;
+    std::memcpy(begin, digit_pairs + 2*size_t(value), 2);
+  }else
+  {
+    *--begin = char('0' + value);
+  }
+
+  const size_t length = size_t(digits + sizeof(digits) - begin);
+  std::memcpy(target, begin, length);
+  return target + length;
+}
+
+template<typename float_t>
+char* format_float_value(char* target, float_t value)
+{
+  if(std::isnan(value))
+  {
+    std::memcpy(target, "nan", 3);
+    return target + 3;
+  }
+
+  if(std::signbit(value))
+  {
+    *target++ = '-';
+    value = -value;
+  }
+
+  if(std::isinf(value))
+  {
+    std::memcpy(target, "inf", 3);
+    return target + 3;
+  }
+  if(value == 0)
+  {
+    *target++ = '0';
+    return target;
+  }
+
+  return format_decimal(target, shortest_decimal(value));
+}
+
+// Like JavaScript: without exponent, if the value is within [1e-6, 1e21)
+char* format_decimal(char* target, decimal_t decimal)
+{
+  char digits[20];
+  const int num_digits = int(format_digits(digits, decimal.digits) - digits);
+  const int point = num_digits + decimal.exponent; // the number of digits before the decimal point
+
+  if(point > 0 && point <= 21)
+  {
+    if(decimal.exponent >= 0)
+    {
+      std::memcpy(target, digits, size_t(num_digits));
+      target += num_digits;
+      std::memset(target, '0', size_t(decimal.exponent));
+      target += decimal.exponent;
+    }else
+    {
+      std::memcpy(target, digits, size_t(point));
+      target += point;
+      *target++ = '.';
+      std::memcpy(target, digits + point, size_t(num_digits - point));
+      target += num_digits - point;
+    }
+  }else if(point > -6 && point <= 0)
+  {
+    *target++ = '0';
+    *target++ = '.';
+    std::memset(target, '0', size_t(-point));
+    target += -point;
+    std::memcpy(target, digits, size_t(num_digits));
+    target += num_digits;
+  }else
+  {
+    *target++ = digits[0];
+    if(num_digits > 1)
+    {
+      *target++ = '.';
+      std::memcpy(target, digits + 1, size_t(num_digits - 1));
+      target += num_digits - 1;
+    }
+
+    const int exponent = point - 1;
+    *target++ = 'e';
+    *target++ = exponent < 0 ? '-' : '+';
+    target = format_digits(target, uint32_t(exponent < 0 ? -exponent : exponent));
+  }
+
+  return target;
+}
+
+/*
+Ryu: the shortest decimal within the interval of numbers rounding to the value.
+See Ulf Adams, "Ryu: fast float-to-string conversion", PLDI 2018.
+
+The value is m2 * 2^e2. The bounds of the interval (mm, mv, mp = 4*m2 - 1 or 2,
+4*m2, 4*m2 + 2 in units of 2^(e2-2)) are multiplied by 10^-e10 with the
+precomputed powers of five, then digits are removed as long as the bounds
+differ. The last removed digit decides the rounding.
+*/
+
+inline int32_t pow5bits(int32_t e)
+{
+  return int32_t(((uint32_t(e) * 1217359) >> 19) + 1); // ceil(log2(5^e)) for 0 < e <= 3528
+}
+
+inline uint32_t log10_pow2(int32_t e)
+{
+  return (uint32_t(e) * 78913) >> 18; // floor(log10(2^e)) for 0 <= e <= 1650
+}
+
+inline uint32_t log10_pow5(int32_t e)
+{
+  return (uint32_t(e) * 732923) >> 20; // floor(log10(5^e)) for 0 <= e <= 2620
+}
+
+template<typename T>
+inline bool is_multiple_of_pow5(T value, uint32_t p)
+{
+  uint32_t count = 0;
+  while(value % 5 == 0)
+  {
+    value /= 5;
+    ++count;
+  }
+  return count >= p;
+}
+
+template<typename T>
+inline bool is_multiple_of_pow2(T value, uint32_t p)
+{
+  return (value & ((T(1) << p) - 1)) == 0;
+}
+
+inline uint32_t mul_shift_32(uint32_t m, uint64_t factor, int32_t shift)
+{
+  const uint64_t bits0 = uint64_t(m) * uint32_t(factor);
+  const uint64_t bits1 = uint64_t(m) * uint32_t(factor >> 32);
+  const uint64_t sum = (bits0 >> 32) + bits1;
+  return uint32_t(sum >> (shift - 32));
+}
+
+// Returns the high 64 bits of the 128 bit product
+inline uint64_t multiply_128(uint64_t a, uint64_t b, uint64_t* low)
+{
+#if defined(__SIZEOF_INT128__)
+  const unsigned __int128 product = (unsigned __int128)a * b;
+  *low = uint64_t(product);
+  return uint64_t(product >> 64);
+#else
+  const uint64_t b00 = uint64_t(uint32_t(a)) * uint32_t(b);
+  const uint64_t b01 = uint64_t(uint32_t(a)) * uint32_t(b >> 32);
+  const uint64_t b10 = (a >> 32) * uint32_t(b);
+  const uint64_t b11 = (a >> 32) * (b >> 32);
+  const uint64_t mid1 = b10 + (b00 >> 32);
+  const uint64_t mid2 = b01 + uint32_t(mid1);
+  *low = (mid2 << 32) | uint32_t(b00);
+  return b11 + (mid1 >> 32) + (mid2 >> 32);
+#endif
+}
+
+// (m * factor) >> shift for a 128 bit factor and 64 < shift < 128
+inline uint64_t mul_shift_64(uint64_t m, const uint64_t* factor, int32_t shift)
+{
+  uint64_t low0, low1;
+  const uint64_t high0 = multiply_128(m, factor[0], &low0);
+  uint64_t high1 = multiply_128(m, factor[1], &low1);
+  const uint64_t sum = high0 + low1;
+  if(sum < high0)
+    ++high1;
+
+  const int32_t distance = shift - 64;
+  return (high1 << (64 - distance)) | (sum >> distance);
+}
+
+decimal_t shortest_decimal(float32_t value)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint32_t ieee_mantissa = bits & ((uint32_t(1) << 23) - 1);
+  const uint32_t ieee_exponent = (bits >> 23) & 0xff;
+
+  int32_t e2;
+  uint32_t m2;
+  if(ieee_exponent == 0)
+  {
+    e2 = 1 - 127 - 23 - 2;
+    m2 = ieee_mantissa;
+  }else
+  {
+    e2 = int32_t(ieee_exponent) - 127 - 23 - 2;
+    m2 = (uint32_t(1) << 23) | ieee_mantissa;
+  }
+  const bool accept_bounds = (m2 & 1) == 0;
+
+  const uint32_t mv = 4 * m2;
+  const uint32_t mp = 4 * m2 + 2;
+  const uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+  const uint32_t mm = 4 * m2 - 1 - mm_shift;
+
+  uint32_t vr, vp, vm;
+  int32_t e10;
+  bool vm_is_trailing_zeros = false;
+  bool vr_is_trailing_zeros = false;
+  uint8_t last_removed_digit = 0;
+  if(e2 >= 0)
+  {
+    const uint32_t q = log10_pow2(e2);
+    e10 = int32_t(q);
+    const int32_t k = float32_pow5_inv_bitcount + pow5bits(int32_t(q)) - 1;
+    const int32_t i = -e2 + int32_t(q) + k;
+    vr = mul_shift_32(mv, float32_pow5_inv_split[q], i);
+    vp = mul_shift_32(mp, float32_pow5_inv_split[q], i);
+    vm = mul_shift_32(mm, float32_pow5_inv_split[q], i);
+    if(q != 0 && (vp - 1) / 10 <= vm / 10)
+    {
+      // The digit removed last is needed for rounding, even if no digit is removed below
+      const int32_t l = float32_pow5_inv_bitcount + pow5bits(int32_t(q - 1)) - 1;
+      last_removed_digit = uint8_t(mul_shift_32(mv, float32_pow5_inv_split[q - 1], -e2 + int32_t(q) - 1 + l) % 10);
+    }
+    if(q <= 9)
+    {
+      // Only one of mp, mv and mm can be a multiple of 5
+      if(mv % 5 == 0)
+        vr_is_trailing_zeros = is_multiple_of_pow5(mv, q);
+      else if(accept_bounds)
+        vm_is_trailing_zeros = is_multiple_of_pow5(mm, q);
+      else
+        vp -= is_multiple_of_pow5(mp, q);
+    }
+  }else
+  {
+    const uint32_t q = log10_pow5(-e2);
+    e10 = int32_t(q) + e2;
+    const int32_t i = -e2 - int32_t(q);
+    const int32_t k = pow5bits(i) - float32_pow5_bitcount;
+    int32_t j = int32_t(q) - k;
+    vr = mul_shift_32(mv, float32_pow5_split[i], j);
+    vp = mul_shift_32(mp, float32_pow5_split[i], j);
+    vm = mul_shift_32(mm, float32_pow5_split[i], j);
+    if(q != 0 && (vp - 1) / 10 <= vm / 10)
+    {
+      j = int32_t(q) - 1 - (pow5bits(i + 1) - float32_pow5_bitcount);
+      last_removed_digit = uint8_t(mul_shift_32(mv, float32_pow5_split[i + 1], j) % 10);
+    }
+    if(q <= 1)
+    {
+      // mv = 4 * m2 has at least two trailing zero bits
+      vr_is_trailing_zeros = true;
+      if(accept_bounds)
+        vm_is_trailing_zeros = mm_shift == 1;
+      else
+        --vp;
+    }else if(q < 31)
+    {
+      vr_is_trailing_zeros = is_multiple_of_pow2(mv, q - 1);
+    }
+  }
+
+  int32_t removed = 0;
+  uint32_t output;
+  if(vm_is_trailing_zeros || vr_is_trailing_zeros)
+  {
+    while(vp / 10 > vm / 10)
+    {
+      vm_is_trailing_zeros &= vm % 10 == 0;
+      vr_is_trailing_zeros &= last_removed_digit == 0;
+      last_removed_digit = uint8_t(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    if(vm_is_trailing_zeros)
+    {
+      while(vm % 10 == 0)
+      {
+        vr_is_trailing_zeros &= last_removed_digit == 0;
+        last_removed_digit = uint8_t(vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        ++removed;
+      }
+    }
+    if(vr_is_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0)
+      last_removed_digit = 4; // round half to even
+    output = vr + ((vr == vm && (!accept_bounds || !vm_is_trailing_zeros)) || last_removed_digit >= 5);
+  }else
+  {
+    while(vp / 10 > vm / 10)
+    {
+      last_removed_digit = uint8_t(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    output = vr + (vr == vm || last_removed_digit >= 5);
+  }
+
+  return decimal_t{output, e10 + removed};
+}
+
+decimal_t shortest_decimal(float64_t value)
+{
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint64_t ieee_mantissa = bits & ((uint64_t(1) << 52) - 1);
+  const uint32_t ieee_exponent = uint32_t((bits >> 52) & 0x7ff);
+
+  int32_t e2;
+  uint64_t m2;
+  if(ieee_exponent == 0)
+  {
+    e2 = 1 - 1023 - 52 - 2;
+    m2 = ieee_mantissa;
+  }else
+  {
+    e2 = int32_t(ieee_exponent) - 1023 - 52 - 2;
+    m2 = (uint64_t(1) << 52) | ieee_mantissa;
+  }
+  const bool accept_bounds = (m2 & 1) == 0;
+
+  const uint64_t mv = 4 * m2;
+  const uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+
+  uint64_t vr, vp, vm;
+  int32_t e10;
+  bool vm_is_trailing_zeros = false;
+  bool vr_is_trailing_zeros = false;
+  if(e2 >= 0)
+  {
+    // One more digit than needed, so the last removed digit is known
+    const uint32_t q = log10_pow2(e2) - (e2 > 3);
+    e10 = int32_t(q);
+    const int32_t k = float64_pow5_inv_bitcount + pow5bits(int32_t(q)) - 1;
+    const int32_t i = -e2 + int32_t(q) + k;
+    vr = mul_shift_64(4 * m2, float64_pow5_inv_split[q], i);
+    vp = mul_shift_64(4 * m2 + 2, float64_pow5_inv_split[q], i);
+    vm = mul_shift_64(4 * m2 - 1 - mm_shift, float64_pow5_inv_split[q], i);
+    if(q <= 21)
+    {
+      // Only one of mp, mv and mm can be a multiple of 5
+      if(mv % 5 == 0)
+        vr_is_trailing_zeros = is_multiple_of_pow5(mv, q);
+      else if(accept_bounds)
+        vm_is_trailing_zeros = is_multiple_of_pow5(mv - 1 - mm_shift, q);
+      else
+        vp -= is_multiple_of_pow5(mv + 2, q);
+    }
+  }else
+  {
+    const uint32_t q = log10_pow5(-e2) - (-e2 > 1);
+    e10 = int32_t(q) + e2;
+    const int32_t i = -e2 - int32_t(q);
+    const int32_t k = pow5bits(i) - float64_pow5_bitcount;
+    const int32_t j = int32_t(q) - k;
+    vr = mul_shift_64(4 * m2, float64_pow5_split[i], j);
+    vp = mul_shift_64(4 * m2 + 2, float64_pow5_split[i], j);
+    vm = mul_shift_64(4 * m2 - 1 - mm_shift, float64_pow5_split[i], j);
+    if(q <= 1)
+    {
+      // mv = 4 * m2 has at least two trailing zero bits
+      vr_is_trailing_zeros = true;
+      if(accept_bounds)
+        vm_is_trailing_zeros = mm_shift == 1;
+      else
+        --vp;
+    }else if(q < 63)
+    {
+      vr_is_trailing_zeros = is_multiple_of_pow2(mv, q);
+    }
+  }
+
+  int32_t removed = 0;
+  uint8_t last_removed_digit = 0;
+  uint64_t output;
+  if(vm_is_trailing_zeros || vr_is_trailing_zeros)
+  {
+    while(vp / 10 > vm / 10)
+    {
+      vm_is_trailing_zeros &= vm % 10 == 0;
+      vr_is_trailing_zeros &= last_removed_digit == 0;
+      last_removed_digit = uint8_t(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    if(vm_is_trailing_zeros)
+    {
+      while(vm % 10 == 0)
+      {
+        vr_is_trailing_zeros &= last_removed_digit == 0;
+        last_removed_digit = uint8_t(vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        ++removed;
+      }
+    }
+    if(vr_is_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0)
+      last_removed_digit = 4; // round half to even
+    output = vr + ((vr == vm && (!accept_bounds || !vm_is_trailing_zeros)) || last_removed_digit >= 5);
+  }else
+  {
+    // The common case: two digits at a time first
+    bool round_up = false;
+    if(vp / 100 > vm / 100)
+    {
+      round_up = vr % 100 >= 50;
+      vr /= 100;
+      vp /= 100;
+      vm /= 100;
+      removed += 2;
+    }
+    while(vp / 10 > vm / 10)
+    {
+      round_up = vr % 10 >= 5;
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    output = vr + (vr == vm || round_up);
+  }
+
+  return decimal_t{output, e10 + removed};
+}
+
+} // namespace ascii_values
@@ -0,0 +1,45 @@
+#ifndef POINTCLOUD_EXPORTER_ASCII_VALUE_FORMATTER_HPP_
+#define POINTCLOUD_EXPORTER_ASCII_VALUE_FORMATTER_HPP_
+
+#include <pointcloud/pointcloud.hpp>
+
+#include <QVector>
+
+#include <functional>
+#include <ostream>
+
+namespace ascii_values {
+
+/*
+Locale independent formatting of numbers as text, the counterpart of
+ascii_value_parser.hpp.
+
+Floating point numbers are written with the fewest significant digits, which
+parse back to exactly the same value (using the algorithm Ryu by Ulf Adams).
+Numbers between 1e-6 and 1e21 are written without exponent, all others like
+"1.5e-7" or "2e+21". Integers are written two digits at a time.
+
+The formatting doesn't allocate, doesn't depend on the global locale and
+produces the same text on all platforms, so it can be used by many threads at
+the same time.
+*/
+
+// The maximum number of characters written by format_value
+constexpr size_t max_value_length = 32;
+
+// Writes the value of the given type stored at `value` to `target` and returns the position right after it
+char* format_value(char* target, data_type::base_type_t type, const uint8_t* value);
+
+char* format_float(char* target, float32_t value);
+char* format_float(char* target, float64_t value);
+char* format_integer(char* target, uint32_t value);
+char* format_integer(char* target, int32_t value);
+
+// Writes the rows of the user data as lines of values separated by the delimiter.
+// Blocks of rows are formatted on all cores and written in their order, so the output doesn't depend on the number of threads.
+// `handle_written_rows` is called by the calling thread with the number of rows written so far.
+void write_rows(std::ostream& stream, const PointCloud& pointcloud, char delimiter, const std::function<void(size_t)>& handle_written_rows);
+
+} // namespace ascii_values
+
+#endif // POINTCLOUD_EXPORTER_ASCII_VALUE_FORMATTER_HPP_
@@ -0,0 +1,125 @@
+#include <pointcloud/exporter/parallel_file_writer.hpp>
+#include <core_library/parallel.hpp>
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+bool write_block(int file_descriptor, int64_t offset, size_t num_bytes, const uint8_t* source);
+
+ParallelFileWriter::ParallelFileWriter(const std::string& filename)
+{
+#ifdef Q_OS_UNIX
+  file_descriptor = ::open(filename.c_str(), O_WRONLY | O_CREAT, 0666);
+#else
+  Q_UNUSED(filename);
+#endif
+}
+
+ParallelFileWriter::~ParallelFileWriter()
+{
+#ifdef Q_OS_UNIX
+  if(file_descriptor >= 0)
+    ::close(file_descriptor);
+#endif
+}
+
+bool ParallelFileWriter::is_supported()
+{
+#ifdef Q_OS_UNIX
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool ParallelFileWriter::is_open() const
+{
+  return file_descriptor >= 0;
+}
+
+bool ParallelFileWriter::preallocate(int64_t file_size) const
+{
+#ifdef Q_OS_LINUX
+  // Unlike posix_fallocate, this fails instead of writing zeros on file systems without support
+  return is_open() && ::fallocate(file_descriptor, 0, 0, off_t(file_size)) == 0;
+#else
+  Q_UNUSED(file_size);
+  return false;
+#endif
+}
+
+bool ParallelFileWriter::write(int64_t offset, size_t num_bytes, const uint8_t* source) const
+{
+  if(!is_open())
+    return false;
+
+  if(num_bytes == 0)
+    return true;
+
+  // The block boundaries are aligned within the file, only the first and the last block may be smaller
+  const int64_t first_block_begin = offset / int64_t(block_size) * int64_t(block_size);
+  const int64_t end = offset + int64_t(num_bytes);
+  const size_t num_blocks = size_t((end - first_block_begin + int64_t(block_size) - 1) / int64_t(block_size));
+  const size_t num_threads = std::min(queue_depth, num_blocks);
+
+  std::atomic<size_t> next_block(0);
+  std::atomic<bool> failed(false);
+
+  // Every thread keeps taking the next unwritten block, so there are always up to queue_depth requests in flight
+  parallel_for_ranges(num_threads, num_threads, [&](size_t, size_t, size_t){
+    for(size_t block=next_block++; block<num_blocks && !failed; block=next_block++)
+    {
+      const int64_t block_begin = std::max(offset, first_block_begin + int64_t(block * block_size));
+      const int64_t block_end = std::min(end, first_block_begin + int64_t((block+1) * block_size));
+
+      if(!write_block(file_descriptor, block_begin, size_t(block_end-block_begin), source + (block_begin-offset)))
+        failed = true;
+    }
+  });
+
+  return !failed;
+}
+
+bool ParallelFileWriter::sync() const
+{
+#ifdef Q_OS_UNIX
+  return is_open() && ::fsync(file_descriptor) == 0;
+#else
+  return false;
+#endif
+}
+
+bool write_block(int file_descriptor, int64_t offset, size_t num_bytes, const uint8_t* source)
+{
+#ifdef Q_OS_UNIX
+  while(num_bytes > 0)
+  {
+    const ssize_t written_bytes = ::pwrite(file_descriptor, source, num_bytes, off_t(offset));
+
+    if(written_bytes < 0 && errno == EINTR)
+      continue;
+    if(written_bytes <= 0)
+      return false;
+
+    num_bytes -= size_t(written_bytes);
+    source += written_bytes;
+    offset += written_bytes;
+  }
+
+  return true;
+#else
+  Q_UNUSED(file_descriptor);
+  Q_UNUSED(offset);
+  Q_UNUSED(num_bytes);
+  Q_UNUSED(source);
+  return false;
+#endif
+}
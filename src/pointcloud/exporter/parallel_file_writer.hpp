@@ -0,0 +1,51 @@
+#ifndef POINTCLOUD_EXPORTER_PARALLEL_FILE_WRITER_HPP_
+#define POINTCLOUD_EXPORTER_PARALLEL_FILE_WRITER_HPP_
+
+#include <core_library/types.hpp>
+
+#include <string>
+
+/**
+Writes large regions of a file with many positional writes in flight at the same time.
+
+The counterpart of the ParallelFileReader: A single buffered stream copies
+everything through its buffer on one thread and only has one request in
+flight. This writer splits the region into large blocks (aligned to block_size
+within the file) and lets a pool of threads write them with pwrite directly from
+the source memory. As the regions are written in any order, the size of the
+whole file should be reserved up front with preallocate().
+
+Only available on unix systems (see is_supported()).
+*/
+class ParallelFileWriter final
+{
+public:
+  size_t block_size = size_t(1) << 23;
+  size_t queue_depth = 32; // number of threads and therefore number of requests in flight
+
+  // Opens an existing file or creates a new one, without truncating it
+  ParallelFileWriter(const std::string& filename);
+  ~ParallelFileWriter();
+
+  ParallelFileWriter(const ParallelFileWriter&) = delete;
+  ParallelFileWriter& operator=(const ParallelFileWriter&) = delete;
+
+  static bool is_supported();
+  bool is_open() const;
+
+  // Allocates the space for a file of the given size, so the file system can keep it contiguous.
+  // Returns false, if the file system doesn't support it (fallocate on linux only), which isn't an error.
+  bool preallocate(int64_t file_size) const;
+
+  // Returns false, if a write failed
+  bool write(int64_t offset, size_t num_bytes, const uint8_t* source) const;
+
+  // Waits until the written data of the file is stored on the disk (fsync). This includes the data written to the
+  // same file through other handles, like a std::fstream after flushing it. Returns false, if it failed.
+  bool sync() const;
+
+private:
+  int file_descriptor = -1;
+};
+
+#endif // POINTCLOUD_EXPORTER_PARALLEL_FILE_WRITER_HPP_
@@ -0,0 +1,33 @@
+#include <pointcloud/exporter/pcvd_compaction.hpp>
+#include <pointcloud/exporter/pcvd_exporter.hpp>
+#include <pointcloud/importer/pcvd_importer.hpp>
+
+bool compact_pcvd_file(const std::string& filename, bool rebuild_kd_tree)
+{
+  PcvdImporter importer(filename);
+  importer.read_mode = PcvdImporter::READ_MODE::STREAM; // everything is read anyway, so nothing is mapped
+  importer.import();
+  if(importer.state != AbstractPointCloudImporter::SUCCEEDED)
+    return false;
+
+  PointCloud& pointcloud = importer.pointcloud;
+  if(rebuild_kd_tree)
+  {
+    pointcloud.kdtree_index.clear();
+    pointcloud.build_kd_tree([](size_t, size_t){return true;});
+  }
+
+  // The exporter replaces the file only after writing the new one completely.
+  // It's stored like the original file.
+  PcvdExporter exporter(filename, pointcloud);
+  exporter.save_vertex_data = importer.file_flags & 0b10;
+  exporter.save_shader = importer.file_flags & 0b100;
+  exporter.save_checksums = importer.file_flags & 0b10000;
+  exporter.compress = importer.has_compressed_chunks;
+  exporter.quantization_precision = importer.quantization_precision;
+  if(importer.file_points_per_chunk > 0)
+    exporter.points_per_chunk = importer.file_points_per_chunk;
+  exporter.export_now();
+
+  return exporter.state == AbstractPointCloudExporter::SUCCEEDED;
+}
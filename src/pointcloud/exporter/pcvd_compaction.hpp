@@ -0,0 +1,23 @@
+#ifndef POINTCLOUD_EXPORTER_PCVD_COMPACTION_HPP_
+#define POINTCLOUD_EXPORTER_PCVD_COMPACTION_HPP_
+
+#include <string>
+
+/**
+Rewrites a pcvd file, which was appended to (see PcvdExporter::append), as if it
+was exported at once. This removes the chunk tables left behind by each append
+and stores the chunks in one block per section again, so the file can be mapped.
+
+The file is loaded completely (verifying its checksums) and exported again, which
+writes a temporary file next to it, which then replaces the file. The new file is
+stored like the original one: with the same vertex data, shader, checksums,
+points per chunk, compression and precision of the quantized coordinates.
+
+The kd-tree is only built with rebuild_kd_tree, as this takes much longer than
+rewriting the file. Otherwise a kd-tree still stored in the file is kept.
+
+Returns false, if the file couldn't be loaded or written.
+*/
+bool compact_pcvd_file(const std::string& filename, bool rebuild_kd_tree);
+
+#endif // POINTCLOUD_EXPORTER_PCVD_COMPACTION_HPP_
@@ -1,6 +1,17 @@
 #include <pointcloud/exporter/pcvd_exporter.hpp>
+#include <pointcloud/exporter/parallel_file_writer.hpp>
 #include <pointcloud/pcvd_file_format.hpp>
+#include <pointcloud/chunk_codec.hpp>
+#include <core_library/parallel.hpp>
+
+#include <QFileInfo>
+
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <vector>
+
+void write_padding(std::ostream& stream, uint16_t flags);
 
 PcvdExporter::PcvdExporter(const std::string& output_file, const PointCloud& pointcloud)
   : AbstractPointCloudExporter(output_file, pointcloud)
@@ -9,13 +20,39 @@ PcvdExporter::PcvdExporter(const std::string& output_file, const PointCloud& poi
 
 bool PcvdExporter::export_implementation()
 {
-  std::ofstream stream(output_file, std::ios_base::out | std::ios_base::binary); // a binary stream
+  if(append && QFileInfo(QString::fromStdString(output_file)).exists())
+    return append_implementation();
+
+  // The target may be the file, whose sections are mapped by a loaded point cloud.
+  // Truncating it would pull the pages away under the mapping, but renaming keeps the old file alive until it's unmapped.
+  const std::string partial_file = output_file + ".part";
+  try
+  {
+    write_new_file(partial_file);
+  }catch(...)
+  {
+    std::remove(partial_file.c_str());
+    throw;
+  }
+
+  if(std::rename(partial_file.c_str(), output_file.c_str()) != 0)
+  {
+    std::remove(partial_file.c_str());
+    throw QString("Couldn't replace the file");
+  }
+
+  return true;
+}
+
+void PcvdExporter::write_new_file(const std::string& filename)
+{
+  std::ofstream stream(filename, std::ios_base::out | std::ios_base::binary); // a binary stream
 
   pcvd_format::header_t header;
 
   header.magic_number = pcvd_format::header_t::expected_macic_number();
-  header.file_version_number = 1;
-  header.downwards_compatibility_version_number = 0;
+  header.file_version_number = 3;
+  header.downwards_compatibility_version_number = 3; // older versions don't know about the chunks
 
   header.number_points = pointcloud.num_points;
 
@@ -48,8 +85,9 @@ bool PcvdExporter::export_implementation()
     throw QString("More properties than supported by the file format (property names too long)");
 
   save_kd_tree = save_kd_tree && pointcloud.has_build_kdtree();
+  const bool save_origin = pointcloud.origin != glm::dvec3(0);
 
-  header.flags = (save_kd_tree ? 0b1 : 0) | (save_vertex_data ? 0b10 : 0) | (save_shader ? 0b100 : 0);
+  header.flags = (save_kd_tree ? 0b1 : 0) | (save_vertex_data ? 0b10 : 0) | (save_shader ? 0b100 : 0) | 0b1000 | (save_checksums ? 0b10000 : 0) | (save_origin ? 0b100000 : 0);
 
   header.aabb = pointcloud.aabb;
 
@@ -80,17 +118,31 @@ bool PcvdExporter::export_implementation()
     header.shader_data_size = uint32_t(shader_description.color_expression_length) + uint32_t(shader_description.coordinate_expression_length) + uint32_t(shader_description.node_data_length) + uint32_t(shader_description.used_properties_length);
   }
 
-  std::streamsize header_size = sizeof(pcvd_format::header_t);
+  pcvd_format::chunks_header_t chunks_header;
+  chunks_header.points_per_chunk = glm::max<size_t>(1, points_per_chunk);
+  chunks_header.number_chunks = (pointcloud.num_points + chunks_header.points_per_chunk - 1) / chunks_header.points_per_chunk;
+  chunks_header.chunk_table_offset = 0; // the offsets are only known after writing the sections
+  chunks_header.kd_tree_offset = 0;
+
+  QVector<pcvd_format::chunk_description_t> chunk_descriptions = describe_chunks(header.flags, chunks_header);
+
+  if(chunks_header.points_per_chunk > std::numeric_limits<uint32_t>::max())
+    throw QString("Can't save point cloud (too many points per chunk)");
+
+  std::streamsize header_size = sizeof(pcvd_format::header_t) + sizeof(pcvd_format::chunks_header_t);
   std::streamsize field_headers_size = sizeof(pcvd_format::field_description_t) * header.number_fields;
   std::streamsize field_names_size = header.field_names_total_size;
+  std::streamsize origin_size = save_origin ? std::streamsize(sizeof(pcvd_format::origin_t)) : 0;
   std::streamsize vertex_data_size = save_vertex_data ? std::streamsize(pointcloud.num_points * sizeof(PointCloud::vertex_t)) : 0;
   std::streamsize point_data_size = std::streamsize(pointcloud.num_points * header.point_data_stride);
   std::streamsize kd_tree_size = save_kd_tree ? std::streamsize(pointcloud.num_points * sizeof(size_t)) : 0;
   std::streamsize shader_data_size = save_shader ? std::streamsize(sizeof(pcvd_format::shader_description_t) + header.shader_data_size) : 0;
-  total_progress = header_size + field_headers_size + field_names_size + vertex_data_size + point_data_size + kd_tree_size + shader_data_size;
+  std::streamsize chunk_table_size = std::streamsize(sizeof(pcvd_format::chunk_description_t) * chunks_header.number_chunks);
+  total_progress = header_size + field_headers_size + field_names_size + origin_size + vertex_data_size + point_data_size + kd_tree_size + shader_data_size + chunk_table_size;
   int64_t current_progress = 0;
 
-  stream.write(reinterpret_cast<const char*>(&header), header_size);
+  stream.write(reinterpret_cast<const char*>(&header), sizeof(pcvd_format::header_t));
+  stream.write(reinterpret_cast<const char*>(&chunks_header), sizeof(pcvd_format::chunks_header_t));
   handle_written_chunk(current_progress += header_size);
 
   stream.write(reinterpret_cast<const char*>(field_descriptions.data()), field_headers_size);
@@ -99,24 +151,391 @@ bool PcvdExporter::export_implementation()
   stream.write(joined_field_names.c_str(), field_names_size);
   handle_written_chunk(current_progress += field_names_size);
 
-  if(save_vertex_data)
+  if(save_origin)
   {
-    stream.write(reinterpret_cast<const char*>(pointcloud.coordinate_color.data()), vertex_data_size);
-    handle_written_chunk(current_progress += vertex_data_size);
+    const pcvd_format::origin_t origin = {pointcloud.origin.x, pointcloud.origin.y, pointcloud.origin.z};
+    stream.write(reinterpret_cast<const char*>(&origin), origin_size);
+    handle_written_chunk(current_progress += origin_size);
   }
-  stream.write(reinterpret_cast<const char*>(pointcloud.user_data.data()), point_data_size);
-  handle_written_chunk(current_progress += point_data_size);
+
+  if(save_shader)
+  {
+    stream.write(reinterpret_cast<const char*>(&shader_description), sizeof(shader_description));
+    stream.write(shader_used_properies_bytes.data(), shader_used_properies_bytes.length());
+    stream.write(shader_coordinate_bytes.data(), shader_coordinate_bytes.length());
+    stream.write(shader_color_bytes.data(), shader_color_bytes.length());
+    stream.write(shader_node_bytes.data(), shader_node_bytes.length());
+    handle_written_chunk(current_progress += shader_data_size);
+  }
+
+  if(compress || quantization_precision > 0)
+  {
+    write_encoded_chunks(stream, header.flags, chunks_header, &chunk_descriptions, current_progress);
+    handle_written_chunk(current_progress += vertex_data_size + point_data_size);
+  }else if(parallel_write && ParallelFileWriter::is_supported())
+  {
+    // The remaining sections are written at their offsets behind the small sections written so far
+    const int64_t offset = int64_t(stream.tellp());
+    stream.close();
+    if(!stream)
+      throw QString("Couldn't write the file");
+
+    write_raw_sections_in_parallel(filename, header.flags, offset, current_progress, &chunks_header, &chunk_descriptions);
+    return;
+  }else
+  {
+    write_raw_chunks(stream, header.flags, chunks_header, &chunk_descriptions, current_progress);
+    handle_written_chunk(current_progress += vertex_data_size + point_data_size);
+  }
+
   if(save_kd_tree)
   {
+    write_padding(stream, header.flags);
+    chunks_header.kd_tree_offset = int64_t(stream.tellp());
     stream.write(reinterpret_cast<const char*>(pointcloud.kdtree_index.data()), kd_tree_size);
     handle_written_chunk(current_progress += kd_tree_size);
   }
 
-  stream.write(reinterpret_cast<const char*>(&shader_description), sizeof(shader_description));
-  stream.write(shader_used_properies_bytes.data(), shader_used_properies_bytes.length());
-  stream.write(shader_coordinate_bytes.data(), shader_coordinate_bytes.length());
-  stream.write(shader_color_bytes.data(), shader_color_bytes.length());
-  stream.write(shader_node_bytes.data(), shader_node_bytes.length());
+  chunks_header.chunk_table_offset = int64_t(stream.tellp());
+  stream.write(reinterpret_cast<const char*>(chunk_descriptions.data()), chunk_table_size);
+  handle_written_chunk(current_progress += chunk_table_size);
+
+  stream.seekp(sizeof(pcvd_format::header_t));
+  stream.write(reinterpret_cast<const char*>(&chunks_header), sizeof(pcvd_format::chunks_header_t));
+
+  if(!stream)
+    throw QString("Couldn't write the file");
+}
+
+// Adds the points as new chunks behind the end of the existing file, followed by the new chunk table.
+// The existing data isn't touched until the header is updated with a single write at the end, after syncing the new data.
+bool PcvdExporter::append_implementation()
+{
+  if(pointcloud.num_points == 0)
+    return true;
+
+  std::fstream stream(output_file, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+
+  pcvd_format::header_t header;
+  pcvd_format::chunks_header_t chunks_header;
+  stream.read(reinterpret_cast<char*>(&header), sizeof(pcvd_format::header_t));
+  stream.read(reinterpret_cast<char*>(&chunks_header), sizeof(pcvd_format::chunks_header_t));
+  if(!stream || header.magic_number != pcvd_format::header_t::expected_macic_number())
+    throw QString("Can only append to pcvd files");
+  if(header.file_version_number != 3 || header.downwards_compatibility_version_number > 3 || (header.flags&0xffc0)!=0)
+    throw QString("Can only append to pcvd files of version 3");
+  if(chunks_header.points_per_chunk == 0 || chunks_header.points_per_chunk > std::numeric_limits<uint32_t>::max())
+    throw QString("corrupt header (chunks)");
+
+  // The new points must have exactly the properties of the file
+  QVector<pcvd_format::field_description_t> field_descriptions(header.number_fields);
+  std::string joined_field_names(header.field_names_total_size, '\0');
+  stream.read(reinterpret_cast<char*>(field_descriptions.data()), std::streamsize(sizeof(pcvd_format::field_description_t) * header.number_fields));
+  stream.read(&joined_field_names[0], std::streamsize(joined_field_names.length()));
+  if(!stream)
+    throw QString("Incomplete file!");
+
+  bool same_properties = header.point_data_stride == pointcloud.user_data_stride && header.number_fields == pointcloud.user_data_names.length();
+  size_t name_offset = 0;
+  for(int i=0; i<field_descriptions.length() && same_properties; ++i)
+  {
+    const std::string name = pointcloud.user_data_names[i].toStdString();
+    same_properties = field_descriptions[i].type == pointcloud.user_data_types[i] && joined_field_names.compare(name_offset, field_descriptions[i].name_length, name) == 0;
+    name_offset += field_descriptions[i].name_length;
+  }
+  if(!same_properties)
+    throw QString("Can't append points with other properties than the file");
+
+  // The new vertices must be relative to the same origin as the old ones
+  pcvd_format::origin_t origin = {0, 0, 0};
+  if(header.flags & 0b100000)
+    stream.read(reinterpret_cast<char*>(&origin), sizeof(pcvd_format::origin_t));
+  if(!stream)
+    throw QString("Incomplete file!");
+  if(pointcloud.origin != glm::dvec3(origin.x, origin.y, origin.z))
+    throw QString("Can't append points relative to another origin than the file");
+
+  // The chunk table must lie behind the headers and within the file, before allocating memory for it
+  const int64_t headers_end = int64_t(stream.tellg());
+  stream.seekg(0, std::ios_base::end);
+  const int64_t file_size = int64_t(stream.tellg());
+  if(chunks_header.chunk_table_offset < headers_end || chunks_header.chunk_table_offset > file_size)
+    throw QString("corrupt header (chunk table offset)");
+  if(chunks_header.number_chunks > header.number_points || chunks_header.number_chunks > uint64_t(file_size - chunks_header.chunk_table_offset) / sizeof(pcvd_format::chunk_description_t))
+    throw QString("corrupt header (number of chunks)");
+
+  pcvd_format::chunks_header_t new_chunks_header = chunks_header;
+  new_chunks_header.number_chunks = (pointcloud.num_points + chunks_header.points_per_chunk - 1) / chunks_header.points_per_chunk;
+  if(chunks_header.number_chunks + new_chunks_header.number_chunks > uint64_t(std::numeric_limits<int>::max()))
+    throw QString("Can't append to the file (too many chunks)");
+
+  QVector<pcvd_format::chunk_description_t> chunk_descriptions(int(chunks_header.number_chunks));
+  stream.seekg(chunks_header.chunk_table_offset);
+  stream.read(reinterpret_cast<char*>(chunk_descriptions.data()), std::streamsize(sizeof(pcvd_format::chunk_description_t) * chunks_header.number_chunks));
+  if(!stream)
+    throw QString("Incomplete file!");
+
+  // The new chunks are stored like the existing ones (with or without vertex data and checksums), whatever the options say
+  QVector<pcvd_format::chunk_description_t> new_chunk_descriptions = describe_chunks(header.flags, new_chunks_header);
+
+  const bool with_vertex_data = header.flags & 0b10;
+  std::streamsize vertex_data_size = with_vertex_data ? std::streamsize(pointcloud.num_points * sizeof(PointCloud::vertex_t)) : 0;
+  std::streamsize point_data_size = std::streamsize(pointcloud.num_points * header.point_data_stride);
+  std::streamsize chunk_table_size = std::streamsize(sizeof(pcvd_format::chunk_description_t) * (chunks_header.number_chunks + new_chunks_header.number_chunks));
+  total_progress = vertex_data_size + point_data_size + chunk_table_size;
+  int64_t current_progress = 0;
+
+  stream.seekp(0, std::ios_base::end);
+  if(compress || quantization_precision > 0)
+    write_encoded_chunks(stream, header.flags, new_chunks_header, &new_chunk_descriptions, current_progress);
+  else
+    write_raw_chunks(stream, header.flags, new_chunks_header, &new_chunk_descriptions, current_progress);
+  handle_written_chunk(current_progress += vertex_data_size + point_data_size);
+
+  chunk_descriptions += new_chunk_descriptions;
+  chunks_header.number_chunks = uint64_t(chunk_descriptions.length());
+  chunks_header.chunk_table_offset = int64_t(stream.tellp());
+  stream.write(reinterpret_cast<const char*>(chunk_descriptions.data()), chunk_table_size);
+  handle_written_chunk(current_progress += chunk_table_size);
+
+  // The kd tree doesn't cover the new points, so it's left behind until the file is compacted
+  header.number_points += pointcloud.num_points;
+  header.aabb.min_point = glm::min(header.aabb.min_point, pointcloud.aabb.min_point);
+  header.aabb.max_point = glm::max(header.aabb.max_point, pointcloud.aabb.max_point);
+  header.flags = uint16_t(header.flags & ~0b1);
+  chunks_header.kd_tree_offset = 0;
+
+  // Until here, the file still describes the old points, as only data behind its end was written.
+  // The new data is synced to the disk before the header points to it, so a crash can't leave a header, whose chunks
+  // were never stored. Only on unix systems, elsewhere the data is just flushed.
+  const ParallelFileWriter file_sync(output_file);
+  stream.flush();
+  if(!stream || (ParallelFileWriter::is_supported() && !file_sync.sync()))
+    throw QString("Couldn't write the file");
+
+  stream.seekp(0);
+  char headers[sizeof(pcvd_format::header_t) + sizeof(pcvd_format::chunks_header_t)];
+  std::memcpy(headers, &header, sizeof(pcvd_format::header_t));
+  std::memcpy(headers + sizeof(pcvd_format::header_t), &chunks_header, sizeof(pcvd_format::chunks_header_t));
+  stream.write(headers, sizeof(headers));
+  stream.flush();
+
+  if(!stream || (ParallelFileWriter::is_supported() && !file_sync.sync()))
+    throw QString("Couldn't write the file");
 
   return true;
 }
+
+// Describes the chunks of consecutive points with the aabb of their coordinates.
+// The raw chunks also get their checksum, the encoded chunks only when being encoded.
+QVector<pcvd_format::chunk_description_t> PcvdExporter::describe_chunks(uint16_t flags, const pcvd_format::chunks_header_t& chunks_header) const
+{
+  const bool encoded = compress || quantization_precision > 0;
+  const bool with_vertex_data = flags & 0b10;
+  const bool with_checksums = flags & 0b10000;
+  const size_t stride = pointcloud.user_data_stride;
+
+  QVector<pcvd_format::chunk_description_t> chunk_descriptions(int(chunks_header.number_chunks));
+  const PointCloud::vertex_t* vertices = reinterpret_cast<const PointCloud::vertex_t*>(pointcloud.coordinate_color.data());
+  parallel_for_ranges(size_t(chunk_descriptions.length()), [&](size_t, size_t begin, size_t end){
+    for(size_t i=begin; i<end; ++i)
+    {
+      const size_t first_point = i * chunks_header.points_per_chunk;
+      const size_t num_chunk_points = glm::min<size_t>(chunks_header.points_per_chunk, pointcloud.num_points - first_point);
+
+      pcvd_format::chunk_description_t& chunk = chunk_descriptions[int(i)];
+      chunk.number_points = uint32_t(num_chunk_points);
+      chunk.vertex_data_size = with_vertex_data ? num_chunk_points * sizeof(PointCloud::vertex_t) : 0;
+      chunk.point_data_size = num_chunk_points * stride;
+      chunk.encoding = pcvd_format::ENCODING::RAW; // the encoded chunks decide their encoding when being written
+      chunk.checksum = 0;
+      if(with_checksums && !encoded)
+        chunk.checksum = pcvd_format::chunk_checksum(pointcloud.coordinate_color.data() + first_point * PointCloud::stride, chunk.vertex_data_size, pointcloud.user_data.data() + first_point * stride, chunk.point_data_size);
+
+      chunk.aabb = aabb_t::invalid();
+      for(size_t j=first_point; j<first_point+num_chunk_points; ++j)
+      {
+        chunk.aabb.min_point = glm::min(chunk.aabb.min_point, vertices[j].coordinate);
+        chunk.aabb.max_point = glm::max(chunk.aabb.max_point, vertices[j].coordinate);
+      }
+    }
+  });
+
+  return chunk_descriptions;
+}
+
+// Writes the vertex data and the point data of all chunks in one block per section, in the order of the points
+void PcvdExporter::write_raw_chunks(std::ostream& stream, uint16_t flags, const pcvd_format::chunks_header_t& chunks_header, QVector<pcvd_format::chunk_description_t>* chunks, int64_t progress_begin)
+{
+  const bool with_vertex_data = flags & 0b10;
+  const std::streamsize vertex_data_size = with_vertex_data ? std::streamsize(pointcloud.num_points * sizeof(PointCloud::vertex_t)) : 0;
+  const std::streamsize point_data_size = std::streamsize(pointcloud.num_points * pointcloud.user_data_stride);
+
+  int64_t vertex_data_offset = 0;
+  if(with_vertex_data)
+  {
+    write_padding(stream, flags);
+    vertex_data_offset = int64_t(stream.tellp());
+    stream.write(reinterpret_cast<const char*>(pointcloud.coordinate_color.data()), vertex_data_size);
+    handle_written_chunk(progress_begin + vertex_data_size);
+  }
+  write_padding(stream, flags);
+  const int64_t point_data_offset = int64_t(stream.tellp());
+  stream.write(reinterpret_cast<const char*>(pointcloud.user_data.data()), point_data_size);
+  handle_written_chunk(progress_begin + vertex_data_size + point_data_size);
+
+  for(int i=0; i<chunks->length(); ++i)
+  {
+    const int64_t first_point = int64_t(i) * int64_t(chunks_header.points_per_chunk);
+    (*chunks)[i].vertex_data_offset = with_vertex_data ? vertex_data_offset + first_point * int64_t(sizeof(PointCloud::vertex_t)) : 0;
+    (*chunks)[i].point_data_offset = point_data_offset + first_point * int64_t(pointcloud.user_data_stride);
+  }
+}
+
+// Writes the vertex data, the point data, the kd-tree and the chunk table at their precomputed offsets with many threads.
+// The same layout as written through the stream by write_raw_chunks and export_implementation. The gaps for the padding are
+// never written, so they read as zeros.
+void PcvdExporter::write_raw_sections_in_parallel(const std::string& filename, uint16_t flags, int64_t offset, int64_t progress_begin, pcvd_format::chunks_header_t* chunks_header, QVector<pcvd_format::chunk_description_t>* chunks)
+{
+  const int64_t vertex_data_size = save_vertex_data ? int64_t(pointcloud.num_points * sizeof(PointCloud::vertex_t)) : 0;
+  const int64_t point_data_size = int64_t(pointcloud.num_points * pointcloud.user_data_stride);
+  const int64_t kd_tree_size = save_kd_tree ? int64_t(pointcloud.num_points * sizeof(size_t)) : 0;
+  const int64_t chunk_table_size = int64_t(sizeof(pcvd_format::chunk_description_t) * chunks_header->number_chunks);
+
+  const int64_t vertex_data_offset = save_vertex_data ? pcvd_format::section_offset(offset, flags) : offset;
+  const int64_t point_data_offset = pcvd_format::section_offset(vertex_data_offset + vertex_data_size, flags);
+  const int64_t kd_tree_offset = save_kd_tree ? pcvd_format::section_offset(point_data_offset + point_data_size, flags) : point_data_offset + point_data_size;
+  const int64_t chunk_table_offset = kd_tree_offset + kd_tree_size;
+
+  ParallelFileWriter writer(filename);
+  if(!writer.is_open())
+    throw QString("Couldn't write the file");
+
+  writer.preallocate(chunk_table_offset + chunk_table_size);
+
+  int64_t current_progress = progress_begin;
+
+  // Writes in slices to keep the progress bar moving and allow canceling
+  auto write_section = [this, &writer, &current_progress](int64_t section_offset, int64_t num_bytes, const uint8_t* source) {
+    const int64_t slice_size = int64_t(1) << 28;
+    for(int64_t slice_begin=0; slice_begin<num_bytes; slice_begin+=slice_size)
+    {
+      const int64_t slice_end = glm::min(num_bytes, slice_begin + slice_size);
+      if(!writer.write(section_offset + slice_begin, size_t(slice_end-slice_begin), source + slice_begin))
+        throw QString("Couldn't write the file");
+      handle_written_chunk(current_progress + slice_end);
+    }
+    current_progress += num_bytes;
+  };
+
+  if(save_vertex_data)
+    write_section(vertex_data_offset, vertex_data_size, pointcloud.coordinate_color.data());
+  write_section(point_data_offset, point_data_size, pointcloud.user_data.data());
+  if(save_kd_tree)
+    write_section(kd_tree_offset, kd_tree_size, reinterpret_cast<const uint8_t*>(pointcloud.kdtree_index.data()));
+
+  for(int i=0; i<chunks->length(); ++i)
+  {
+    const int64_t first_point = int64_t(i) * int64_t(chunks_header->points_per_chunk);
+    (*chunks)[i].vertex_data_offset = save_vertex_data ? vertex_data_offset + first_point * int64_t(sizeof(PointCloud::vertex_t)) : 0;
+    (*chunks)[i].point_data_offset = point_data_offset + first_point * int64_t(pointcloud.user_data_stride);
+  }
+  write_section(chunk_table_offset, chunk_table_size, reinterpret_cast<const uint8_t*>(chunks->data()));
+
+  chunks_header->chunk_table_offset = chunk_table_offset;
+  chunks_header->kd_tree_offset = save_kd_tree ? kd_tree_offset : 0;
+  if(!writer.write(sizeof(pcvd_format::header_t), sizeof(pcvd_format::chunks_header_t), reinterpret_cast<const uint8_t*>(chunks_header)))
+    throw QString("Couldn't write the file");
+}
+
+// Encodes batches of chunks in parallel and writes each batch in the order of the chunk table
+void PcvdExporter::write_encoded_chunks(std::ostream& stream, uint16_t flags, const pcvd_format::chunks_header_t& chunks_header, QVector<pcvd_format::chunk_description_t>* chunks, int64_t progress_begin)
+{
+  const bool with_vertex_data = flags & 0b10;
+  const bool with_checksums = flags & 0b10000;
+
+  const QVector<chunk_codec::column_t> vertex_columns = chunk_codec::vertex_columns();
+  const QVector<chunk_codec::column_t> user_data_columns = chunk_codec::user_data_columns(pointcloud.user_data_offset, pointcloud.user_data_types);
+
+  const bool quantize = quantization_precision > 0;
+  QVector<chunk_codec::column_t> quantized_user_data_columns;
+  const bool quantize_user_data = quantize && chunk_codec::user_data_columns_for_quantization(pointcloud.user_data_names, pointcloud.user_data_offset, pointcloud.user_data_types, &quantized_user_data_columns);
+
+  // Appends the rows bit-packed or as they are
+  auto append_rows = [this](const uint8_t* rows, size_t stride, size_t num_rows, const QVector<chunk_codec::column_t>& columns, std::vector<uint8_t>* encoded) {
+    if(compress)
+      chunk_codec::encode(rows, stride, num_rows, columns, encoded);
+    else
+      encoded->insert(encoded->end(), rows, rows + num_rows * stride);
+  };
+
+  const size_t num_chunks = size_t(chunks->length());
+  const size_t batch_size = num_worker_threads() * 4;
+  std::vector<std::vector<uint8_t>> encoded(batch_size);
+
+  pcvd_format::chunk_description_t* chunk_data = chunks->data();
+  int64_t num_written_bytes = 0;
+
+  for(size_t first_chunk=0; first_chunk<num_chunks; first_chunk+=batch_size)
+  {
+    const size_t num_batch_chunks = glm::min(batch_size, num_chunks-first_chunk);
+
+    parallel_for_ranges(num_batch_chunks, [&](size_t, size_t begin, size_t end){
+      for(size_t i=begin; i<end; ++i)
+      {
+        pcvd_format::chunk_description_t& chunk = chunk_data[first_chunk+i];
+        const size_t first_point = (first_chunk+i) * chunks_header.points_per_chunk;
+        const uint8_t* vertices = pointcloud.coordinate_color.data() + first_point * PointCloud::stride;
+        const uint8_t* user_data = pointcloud.user_data.data() + first_point * pointcloud.user_data_stride;
+
+        encoded[i].clear();
+
+        bool quantized = quantize;
+        if(quantized && with_vertex_data)
+          quantized = chunk_codec::quantize(vertices, PointCloud::stride, chunk.number_points, vertex_columns, quantization_precision, compress, &encoded[i]);
+        chunk.vertex_data_size = encoded[i].size();
+        if(quantized && quantize_user_data)
+          quantized = chunk_codec::quantize(user_data, pointcloud.user_data_stride, chunk.number_points, quantized_user_data_columns, quantization_precision, compress, &encoded[i]);
+        else if(quantized)
+          append_rows(user_data, pointcloud.user_data_stride, chunk.number_points, user_data_columns, &encoded[i]);
+
+        if(!quantized)
+        {
+          encoded[i].clear();
+          if(with_vertex_data)
+            append_rows(vertices, PointCloud::stride, chunk.number_points, vertex_columns, &encoded[i]);
+          chunk.vertex_data_size = encoded[i].size();
+          append_rows(user_data, pointcloud.user_data_stride, chunk.number_points, user_data_columns, &encoded[i]);
+        }
+        chunk.point_data_size = encoded[i].size() - chunk.vertex_data_size;
+        chunk.checksum = with_checksums ? pcvd_format::chunk_checksum(encoded[i].data(), chunk.vertex_data_size, encoded[i].data() + chunk.vertex_data_size, chunk.point_data_size) : 0;
+
+        if(quantized)
+          chunk.encoding = compress ? pcvd_format::ENCODING::QUANTIZED_DELTA_BIT_PACKING : pcvd_format::ENCODING::QUANTIZED;
+        else
+          chunk.encoding = compress ? pcvd_format::ENCODING::DELTA_BIT_PACKING : pcvd_format::ENCODING::RAW;
+      }
+    });
+
+    for(size_t i=0; i<num_batch_chunks; ++i)
+    {
+      pcvd_format::chunk_description_t& chunk = chunk_data[first_chunk+i];
+      const int64_t offset = int64_t(stream.tellp());
+
+      chunk.vertex_data_offset = with_vertex_data ? offset : 0;
+      chunk.point_data_offset = offset + int64_t(chunk.vertex_data_size);
+      stream.write(reinterpret_cast<const char*>(encoded[i].data()), std::streamsize(encoded[i].size()));
+
+      num_written_bytes += int64_t(chunk.number_points * ((with_vertex_data ? PointCloud::stride : 0) + pointcloud.user_data_stride));
+      handle_written_chunk(progress_begin + num_written_bytes);
+    }
+  }
+}
+
+// Fills the gap up to the beginning of the next (aligned) section with zeros
+void write_padding(std::ostream& stream, uint16_t flags)
+{
+  const int64_t offset = int64_t(stream.tellp());
+  const std::string padding(size_t(pcvd_format::section_offset(offset, flags) - offset), '\0');
+  stream.write(padding.data(), std::streamsize(padding.size()));
+}
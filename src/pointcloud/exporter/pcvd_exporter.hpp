@@ -2,7 +2,51 @@
 #define POINTCLOUD_WORKERS_EXPORTER_PCVD_HPP_
 
 #include <pointcloud/exporter/abstract_exporter.hpp>
+#include <pointcloud/pcvd_file_format.hpp>
 
+#include <ostream>
+
+/**
+Implementation for saving pcvd files
+
+The points are split into chunks of points_per_chunk consecutive points, whose
+aabbs are stored in the chunk table (see pcvd_file_format.hpp).
+
+With compress, the chunks are encoded losslessly by chunk_codec on all cores.
+Such files are smaller and decode faster than most drives can read, but can't
+be mapped into memory anymore.
+
+With a quantization_precision, the coordinates are stored as integers in units
+of the precision relative to the minimum of their chunk (see
+chunk_codec::quantize), which usually needs 2 or 3 bytes per coordinate instead
+of 4 or 8. Chunks with non-finite coordinates are stored unquantized.
+
+With save_checksums, each chunk stores the checksum of its stored bytes, so the
+PcvdImporter can detect corrupt chunks. The checksums are computed by the same
+threads, which compute the aabbs or encode the chunks.
+
+With parallel_write, the sections of uncompressed files are not copied
+through the stream, but written by many threads with pwrite at their offsets
+(see ParallelFileWriter). All offsets are known up front, so the whole file is
+preallocated first. The encoded chunks are always written through the stream,
+as their size is only known after encoding them.
+
+With append, the points are added as new chunks to an existing pcvd file with
+the same properties and origin, without rewriting its data. The new chunks and
+the new chunk table are written behind the end of the file and synced to the
+disk (on unix systems), then the number of points and the aabb in the header
+are updated with a single write. Until then, the file still describes the old
+points. The vertex data and checksums are stored like in the existing file
+(regardless of save_vertex_data and save_checksums) and points_per_chunk is
+taken from the file.
+The kd-tree of the file is dropped, as it doesn't cover the new points. The left
+behind sections (old chunk tables and kd-tree) are removed by compact_pcvd_file.
+
+Without append, the file is written to a sibling file with the suffix .part,
+which replaces output_file by renaming it only after it was written completely.
+So exporting onto the pcvd file, whose sections a loaded point cloud maps into
+memory, never truncates the mapped pages and an aborted export keeps the old file.
+*/
 class PcvdExporter final : public AbstractPointCloudExporter
 {
 public:
@@ -11,9 +55,28 @@ public:
   bool save_kd_tree = true;
   bool save_vertex_data = true;
   bool save_shader = true;
+  bool save_checksums = true;
+
+  bool compress = false;
+  float64_t quantization_precision = 0; // zero stores the coordinates without loss
+
+  size_t points_per_chunk = size_t(1) << 16;
+
+  bool parallel_write = true; // falls back to the stream on systems without pwrite
+
+  bool append = false; // a file, which doesn't exist yet, is created as usual
 
 protected:
   bool export_implementation() override;
+
+private:
+  void write_new_file(const std::string& filename);
+  bool append_implementation();
+  void write_raw_sections_in_parallel(const std::string& filename, uint16_t flags, int64_t offset, int64_t progress_begin, pcvd_format::chunks_header_t* chunks_header, QVector<pcvd_format::chunk_description_t>* chunks);
+
+  QVector<pcvd_format::chunk_description_t> describe_chunks(uint16_t flags, const pcvd_format::chunks_header_t& chunks_header) const;
+  void write_raw_chunks(std::ostream& stream, uint16_t flags, const pcvd_format::chunks_header_t& chunks_header, QVector<pcvd_format::chunk_description_t>* chunks, int64_t progress_begin);
+  void write_encoded_chunks(std::ostream& stream, uint16_t flags, const pcvd_format::chunks_header_t& chunks_header, QVector<pcvd_format::chunk_description_t>* chunks, int64_t progress_begin);
 };
 
 #endif // POINTCLOUD_WORKERS_EXPORTER_PCVD_HPP_
@@ -1,5 +1,9 @@
 #include <pointcloud/exporter/ply_exporter.hpp>
+#include <pointcloud/exporter/ascii_value_formatter.hpp>
+
+#include <cstring>
 #include <fstream>
+#include <vector>
 
 typedef data_type::BASE_TYPE BASE_TYPE;
 
@@ -12,8 +16,7 @@ PlyExporter::PlyExporter(const std::string& output_file, const PointCloud& point
 
 bool PlyExporter::export_implementation()
 {
-  std::ofstream stream(output_file, std::ios_base::out); // not a binary stream
-  stream << std::fixed;
+  std::ofstream stream(output_file, std::ios_base::out | std::ios_base::binary); // the line breaks are written as they are
 
   if(pointcloud.num_points > std::numeric_limits<int64_t>::max())
   {
@@ -29,29 +32,72 @@ bool PlyExporter::export_implementation()
   const int num_properties = pointcloud.user_data_types.length();
 
   stream << "ply\n";
-  stream << "format ascii 1.0\n";
+  stream << (binary ? "format binary_little_endian 1.0\n" : "format ascii 1.0\n");
   stream << "element vertex " << pointcloud.num_points << "\n";
   for(int i=0; i<num_properties; ++i)
     stream << "property " << format_data_type(pointcloud.user_data_types[i]) << " " << pointcloud.user_data_names[i].toStdString() << "\n";
   stream << "end_header\n";
 
-  const uint8_t* data = pointcloud.user_data.data();
-  const data_type::base_type_t* data_types = pointcloud.user_data_types.data();
-  for(size_t point_index=0; point_index<pointcloud.num_points; ++point_index)
+  if(binary)
   {
-    for(int i=0; i<num_properties; ++i)
-    {
-      if(i != 0)
-        stream << ' ';
+    write_binary_rows(stream);
+  }else
+  {
+    ascii_values::write_rows(stream, pointcloud, ' ', [this](size_t num_written_rows){
+      handle_written_chunk(int64_t(num_written_rows));
+    });
+  }
 
-      data += read_value_from_buffer_to_stream(stream, data_types[i], data);
-    }
-    handle_written_chunk(int64_t(point_index));
+  if(!stream)
+    throw QString("Couldn't write the file");
+
+  return true;
+}
+
+// Writes the rows of the user data in blocks. Like the pcvd files, this assumes a little endian machine.
+// Rows with gaps between their values are packed into a block buffer first.
+void PlyExporter::write_binary_rows(std::ostream& stream)
+{
+  const size_t stride = pointcloud.user_data_stride;
+  const int num_properties = pointcloud.user_data_types.length();
 
-    stream << "\n";
+  size_t packed_stride = 0;
+  bool packed = true;
+  for(int i=0; i<num_properties; ++i)
+  {
+    packed = packed && pointcloud.user_data_offset[i] == packed_stride;
+    packed_stride += data_type::size_of_type(pointcloud.user_data_types[i]);
   }
+  packed = packed && packed_stride == stride;
 
-  return true;
+  const size_t rows_per_block = glm::max<size_t>(1, (size_t(1) << 26) / glm::max<size_t>(1, stride));
+  std::vector<uint8_t> block(packed ? 0 : rows_per_block * packed_stride);
+
+  for(size_t first_row=0; first_row<pointcloud.num_points; first_row+=rows_per_block)
+  {
+    const size_t num_rows = glm::min(rows_per_block, pointcloud.num_points-first_row);
+    const uint8_t* rows = pointcloud.user_data.data() + first_row * stride;
+
+    if(packed)
+    {
+      stream.write(reinterpret_cast<const char*>(rows), std::streamsize(num_rows * stride));
+    }else
+    {
+      uint8_t* packed_row = block.data();
+      for(size_t i=0; i<num_rows; ++i)
+      {
+        for(int j=0; j<num_properties; ++j)
+        {
+          const size_t size = data_type::size_of_type(pointcloud.user_data_types[j]);
+          std::memcpy(packed_row, rows + i * stride + pointcloud.user_data_offset[j], size);
+          packed_row += size;
+        }
+      }
+      stream.write(reinterpret_cast<const char*>(block.data()), std::streamsize(num_rows * packed_stride));
+    }
+
+    handle_written_chunk(int64_t(first_row + num_rows));
+  }
 }
 
 const char* format_data_type(data_type::base_type_t type)
@@ -3,13 +3,29 @@
 
 #include <pointcloud/exporter/abstract_exporter.hpp>
 
+#include <ostream>
+
+/**
+Implementation for saving ply files
+
+By default the values are written as text, formatted on all cores (see
+ascii_values::write_rows). With binary, the file is written in
+the binary_little_endian format, whose rows are the rows of the user data. So
+the user data is written in large blocks as it is, which is limited by the
+speed of the drive only and needs a third of the space.
+*/
 class PlyExporter final : public AbstractPointCloudExporter
 {
 public:
   PlyExporter(const std::string& output_file, const PointCloud& pointcloud);
 
+  bool binary = false;
+
 protected:
   bool export_implementation() override;
+
+private:
+  void write_binary_rows(std::ostream& stream);
 };
 
 #endif // POINTCLOUD_WORKERS_EXPORTER_PLY_HPP_
@@ -0,0 +1,33 @@
+#include <pointcloud/exporter/text_exporter.hpp>
+#include <pointcloud/exporter/ascii_value_formatter.hpp>
+
+#include <fstream>
+
+TextExporter::TextExporter(const std::string& output_file, const PointCloud& pointcloud)
+  : AbstractPointCloudExporter(output_file, pointcloud)
+{
+}
+
+bool TextExporter::export_implementation()
+{
+  std::ofstream stream(output_file, std::ios_base::out | std::ios_base::binary); // the line breaks are written as they are
+
+  if(!stream.is_open())
+    return false;
+
+  total_progress = int64_t(pointcloud.num_points);
+
+  stream << "//";
+  for(int i=0; i<pointcloud.user_data_names.length(); ++i)
+    stream << (i != 0 ? " " : "") << pointcloud.user_data_names[i].toStdString();
+  stream << "\n";
+
+  ascii_values::write_rows(stream, pointcloud, ' ', [this](size_t num_written_rows){
+    handle_written_chunk(int64_t(num_written_rows));
+  });
+
+  if(!stream)
+    throw QString("Couldn't write the file");
+
+  return true;
+}
@@ -0,0 +1,23 @@
+#ifndef POINTCLOUD_WORKERS_EXPORTER_TEXT_HPP_
+#define POINTCLOUD_WORKERS_EXPORTER_TEXT_HPP_
+
+#include <pointcloud/exporter/abstract_exporter.hpp>
+
+/**
+Implementation for saving xyz files (one point per line, the values separated
+by spaces)
+
+The first line is a header with the property names prefixed by "//" (like
+CloudCompare writes it), so the TextImporter restores the property names.
+The rows are formatted on all cores (see ascii_values::write_rows).
+*/
+class TextExporter final : public AbstractPointCloudExporter
+{
+public:
+  TextExporter(const std::string& output_file, const PointCloud& pointcloud);
+
+protected:
+  bool export_implementation() override;
+};
+
+#endif // POINTCLOUD_WORKERS_EXPORTER_TEXT_HPP_
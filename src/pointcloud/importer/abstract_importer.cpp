@@ -1,12 +1,14 @@
 #include <pointcloud/importer/abstract_importer.hpp>
 #include <pointcloud/importer/ply_importer.hpp>
 #include <pointcloud/importer/pcvd_importer.hpp>
+#include <pointcloud/importer/pcd_importer.hpp>
+#include <pointcloud/importer/las_importer.hpp>
+#include <pointcloud/importer/text_importer.hpp>
+#include <pointcloud/importer/decompressing_stream.hpp>
 #include <core_library/print.hpp>
 #include <core_library/types.hpp>
 
-#include <QThread>
 #include <QSharedPointer>
-#include <QAbstractEventDispatcher>
 #include <QSettings>
 
 #include <iostream>
@@ -23,13 +25,38 @@ QSharedPointer<AbstractPointCloudImporter> AbstractPointCloudImporter::importerF
   }else if(suffix == "ply")
   {
     return QSharedPointer<AbstractPointCloudImporter>(new PlyImporter(filepath));
+  }else if(suffix == "pcd")
+  {
+    return QSharedPointer<AbstractPointCloudImporter>(new PcdImporter(filepath));
+  }else if(suffix == "las")
+  {
+    return QSharedPointer<AbstractPointCloudImporter>(new LasImporter(filepath));
+  }else if(suffix == "xyz" || suffix == "csv" || suffix == "txt" || suffix == "pts")
+  {
+    return QSharedPointer<AbstractPointCloudImporter>(new TextImporter(filepath));
+  }else if((suffix == "gz" || suffix == "zst") && QString::fromStdString(filepath).endsWith(".ply." + suffix))
+  {
+    if(!DecompressingStream::is_supported(DecompressingStream::compression_of_file(filepath)))
+      return QSharedPointer<AbstractPointCloudImporter>();
+    return QSharedPointer<AbstractPointCloudImporter>(new PlyImporter(filepath));
   }else
     return QSharedPointer<AbstractPointCloudImporter>();
 }
 
 QString AbstractPointCloudImporter::allSupportedFiletypes()
 {
-  return "All Supported (*.pcvd *.ply);;PCVD (*.pcvd);;PLY (*.ply)";
+  return "All Supported (*.pcvd *.ply *.ply.gz *.ply.zst *.pcd *.las *.xyz *.csv *.txt *.pts);;PCVD (*.pcvd);;PLY (*.ply *.ply.gz *.ply.zst);;PCD (*.pcd);;LAS (*.las);;Text (*.xyz *.csv *.txt *.pts)";
+}
+
+bool AbstractPointCloudImporter::read_format(size_t* num_points)
+{
+  Q_UNUSED(num_points);
+  return false;
+}
+
+size_t AbstractPointCloudImporter::num_available_points() const
+{
+  return _num_available_points.load(std::memory_order_acquire);
 }
 
 void AbstractPointCloudImporter::import()
@@ -63,33 +90,20 @@ AbstractPointCloudImporter::AbstractPointCloudImporter(const std::string& input_
 {
 }
 
-void AbstractPointCloudImporter::cancel()
-{
-  this->state = CANCELED;
-}
-
 void AbstractPointCloudImporter::handle_loaded_chunk(int64_t current_progress)
 {
   Q_ASSERT(current_progress <= total_progress);
 
-  auto process_events = [](){
-    QThread* thread = QThread::currentThread();
-    if(thread != nullptr && thread->eventDispatcher() != nullptr)
-      thread->eventDispatcher()->processEvents(QEventLoop::EventLoopExec | QEventLoop::ExcludeUserInputEvents | QEventLoop::ExcludeSocketNotifiers);
-  };
-
-  process_events();
+  progress.set(current_progress, total_progress);
 
-  if(Q_UNLIKELY(this->state == CANCELED))
+  if(Q_UNLIKELY(progress.is_canceled()))
     throw canceled_t();
+}
 
-  float86_t progress = float86_t(current_progress) / float86_t(total_progress);
-  int discrete_progress_value = int(progress * 65536 + float86_t(0.5));
-  discrete_progress_value = glm::clamp(0, 65536, discrete_progress_value);
-
-  update_progress(discrete_progress_value);
-
-  process_events();
+// The vertices of the first num_points points must not be changed anymore and the vertex buffer must not be reallocated until the import finished
+void AbstractPointCloudImporter::publish_available_points(size_t num_points)
+{
+  Q_ASSERT(num_points <= pointcloud.num_points);
 
-  Q_ASSERT(this->state == RUNNING);
+  _num_available_points.store(num_points, std::memory_order_release);
 }
@@ -2,8 +2,12 @@
 #define POINTCLOUD_IMPORTER_ABSTRACTIMPORTER_HPP_
 
 #include <pointcloud/pointcloud.hpp>
+#include <pointcloud/importer/point_sampler.hpp>
+#include <core_library/progress.hpp>
 #include <QObject>
 
+#include <atomic>
+
 /**
 Parent class for different kinds of PointCloud formats to import.
 */
@@ -29,28 +33,45 @@ public:
 
   PointCloud pointcloud;
 
+  // Only import a sample of the points (see PointSampler)
+  PointSampler::settings_t sampling;
+
+  // Polled by the gui thread. Canceling it aborts the import at the next loaded chunk.
+  Progress progress;
+
   AbstractPointCloudImporter(const std::string& input_file);
   ~AbstractPointCloudImporter();
 
-  constexpr static int progress_max(){return 65536;}
+  constexpr static int progress_max(){return Progress::max_value();}
 
   static QSharedPointer<AbstractPointCloudImporter> importerForSuffix(QString suffix, std::string filepath);
   static QString allSupportedFiletypes();
 
+  // Reads only the header of the file and sets the user data format of the point cloud to the one the import will have,
+  // without loading or allocating any points. Returns false, if the file format doesn't store the number of points and the
+  // properties in its header (the default) or the header couldn't be read.
+  virtual bool read_format(size_t* num_points);
+
+  // Number of points at the beginning of the point cloud, whose vertices are already completely loaded.
+  // Can be called from other threads while importing for showing the point cloud progressively.
+  size_t num_available_points() const;
+
 public slots:
   void import();
-  void cancel();
 
 signals:
-  void update_progress(int progress);
   void finished();
 
 protected:
   int64_t total_progress = 0;
   void handle_loaded_chunk(int64_t progress);
+  void publish_available_points(size_t num_points);
 
 protected slots:
   virtual bool import_implementation() = 0;
+
+private:
+  std::atomic<size_t> _num_available_points{0};
 };
 
 #endif // POINTCLOUD_IMPORTER_ABSTRACTIMPORTER_HPP_
@@ -0,0 +1,317 @@
+#include <pointcloud/importer/ascii_value_parser.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <type_traits>
+
+namespace ascii_values {
+
+typedef data_type::BASE_TYPE BASE_TYPE;
+
+inline bool is_space(char c);
+inline bool is_digit(char c);
+const char* skip_spaces(const char* begin, const char* end);
+const char* end_of_token(const char* begin, const char* end);
+template<typename T>
+const char* parse_integer(const char* begin, const char* end, uint8_t* target);
+template<typename T>
+const char* parse_float(const char* begin, const char* end, uint8_t* target);
+template<typename T>
+const char* parse_float_with_stream(const char* begin, const char* end, uint8_t* target);
+inline bool rounds_to_float_like_exact_value(float64_t value);
+
+const char* parse_value(const char* begin, const char* end, data_type::base_type_t type, uint8_t* target)
+{
+  begin = skip_spaces(begin, end);
+
+  switch(type)
+  {
+  case BASE_TYPE::INT8:
+    return parse_integer<int8_t>(begin, end, target);
+  case BASE_TYPE::INT16:
+    return parse_integer<int16_t>(begin, end, target);
+  case BASE_TYPE::INT32:
+    return parse_integer<int32_t>(begin, end, target);
+  case BASE_TYPE::UINT8:
+    return parse_integer<uint8_t>(begin, end, target);
+  case BASE_TYPE::UINT16:
+    return parse_integer<uint16_t>(begin, end, target);
+  case BASE_TYPE::UINT32:
+    return parse_integer<uint32_t>(begin, end, target);
+  case BASE_TYPE::FLOAT32:
+    return parse_float<float32_t>(begin, end, target);
+  case BASE_TYPE::FLOAT64:
+    return parse_float<float64_t>(begin, end, target);
+  }
+
+  Q_UNREACHABLE();
+  return nullptr;
+}
+
+bool is_blank_line(const char* begin, const char* end)
+{
+  return skip_spaces(begin, end) == end;
+}
+
+size_t count_rows(const char* begin, const char* end)
+{
+  size_t num_rows = 0;
+  while(begin != end)
+  {
+    const char* line_end = static_cast<const char*>(std::memchr(begin, '\n', size_t(end-begin)));
+    if(line_end == nullptr)
+      line_end = end;
+
+    if(!is_blank_line(begin, line_end))
+      ++num_rows;
+
+    begin = line_end==end ? end : line_end+1;
+  }
+  return num_rows;
+}
+
+bool parse_row(const char* begin, const char* end, const QVector<data_type::base_type_t>& types, uint8_t* row)
+{
+  for(data_type::base_type_t type : types)
+  {
+    begin = parse_value(begin, end, type, row);
+    if(Q_UNLIKELY(begin == nullptr))
+      return false;
+    row += data_type::size_of_type(type);
+  }
+
+  return skip_spaces(begin, end) == end;
+}
+
+bool parse_row(const char* begin, const char* end, char delimiter, const QVector<data_type::base_type_t>& types, uint8_t* row)
+{
+  if(delimiter == ' ')
+    return parse_row(begin, end, types, row);
+
+  for(int i=0; i<types.length(); ++i)
+  {
+    const char* value_end = std::find(begin, end, delimiter);
+    if(Q_UNLIKELY(value_end == end && i+1 != types.length()))
+      return false;
+
+    begin = parse_value(begin, value_end, types[i], row);
+    if(Q_UNLIKELY(begin == nullptr || skip_spaces(begin, value_end) != value_end))
+      return false;
+
+    row += data_type::size_of_type(types[i]);
+    begin = value_end == end ? end : value_end + 1;
+  }
+
+  return skip_spaces(begin, end) == end;
+}
+
+inline bool is_space(char c)
+{
+  return c==' ' || c=='\t' || c=='\r' || c=='\n';
+}
+
+inline bool is_digit(char c)
+{
+  return c>='0' && c<='9';
+}
+
+const char* skip_spaces(const char* begin, const char* end)
+{
+  while(begin!=end && is_space(*begin))
+    ++begin;
+  return begin;
+}
+
+const char* end_of_token(const char* begin, const char* end)
+{
+  while(begin!=end && !is_space(*begin))
+    ++begin;
+  return begin;
+}
+
+template<typename T>
+const char* parse_integer(const char* begin, const char* end, uint8_t* target)
+{
+  const char* c = begin;
+
+  bool negative = false;
+  if(c!=end && (*c=='-' || *c=='+'))
+    negative = *(c++)=='-';
+
+  if(c==end || !is_digit(*c))
+    return nullptr;
+
+  // All supported integer types fit into an int64_t, so it's enough to stop accumulating digits after the value got too large
+  int64_t value = 0;
+  while(c!=end && is_digit(*c))
+  {
+    value = value*10 + (*(c++)-'0');
+    if(Q_UNLIKELY(value > int64_t(std::numeric_limits<uint32_t>::max())+1))
+      return nullptr;
+  }
+
+  if(c!=end && !is_space(*c))
+    return nullptr;
+
+  if(negative)
+    value = -value;
+
+  if(value < int64_t(std::numeric_limits<T>::min()) || value > int64_t(std::numeric_limits<T>::max()))
+    return nullptr;
+
+  write_value_to_buffer(target, T(value));
+  return c;
+}
+
+template<typename T>
+const char* parse_float(const char* begin, const char* end, uint8_t* target)
+{
+  // Powers of ten, which can be represented exactly by a double
+  static const float64_t exact_powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const int max_exact_power_of_ten = 22;
+  const uint64_t max_exact_mantissa = uint64_t(1) << 53;
+
+  const char* c = begin;
+
+  bool negative = false;
+  if(c!=end && (*c=='-' || *c=='+'))
+    negative = *(c++)=='-';
+
+  uint64_t mantissa = 0;
+  int num_digits = 0;
+  int num_significant_digits = 0;
+  int exponent = 0;
+
+  while(c!=end && is_digit(*c))
+  {
+    if(mantissa!=0 || *c!='0')
+      ++num_significant_digits;
+    mantissa = mantissa*10 + uint64_t(*(c++)-'0');
+    ++num_digits;
+    if(num_significant_digits > 19)
+      return parse_float_with_stream<T>(begin, end, target);
+  }
+
+  if(c!=end && *c=='.')
+  {
+    ++c;
+    while(c!=end && is_digit(*c))
+    {
+      if(mantissa!=0 || *c!='0')
+        ++num_significant_digits;
+      mantissa = mantissa*10 + uint64_t(*(c++)-'0');
+      ++num_digits;
+      --exponent;
+      if(num_significant_digits > 19)
+        return parse_float_with_stream<T>(begin, end, target);
+    }
+  }
+
+  if(num_digits == 0)
+    return parse_float_with_stream<T>(begin, end, target);
+
+  if(c!=end && (*c=='e' || *c=='E'))
+  {
+    ++c;
+
+    bool negative_exponent = false;
+    if(c!=end && (*c=='-' || *c=='+'))
+      negative_exponent = *(c++)=='-';
+
+    if(c==end || !is_digit(*c))
+      return nullptr;
+
+    int explicit_exponent = 0;
+    while(c!=end && is_digit(*c))
+    {
+      explicit_exponent = explicit_exponent*10 + (*(c++)-'0');
+      if(explicit_exponent > 10000)
+        return parse_float_with_stream<T>(begin, end, target);
+    }
+
+    exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+  }
+
+  if(c!=end && !is_space(*c))
+    return parse_float_with_stream<T>(begin, end, target);
+
+  if(mantissa > max_exact_mantissa || exponent < -max_exact_power_of_ten || exponent > max_exact_power_of_ten)
+    return parse_float_with_stream<T>(begin, end, target);
+
+  // Both the mantissa and the power of ten are exact, so the single multiplication/division is rounded correctly.
+  float64_t value = float64_t(mantissa);
+  if(exponent < 0)
+    value /= exact_powers_of_ten[-exponent];
+  else
+    value *= exact_powers_of_ten[exponent];
+
+  if(std::is_same<T, float32_t>::value && !rounds_to_float_like_exact_value(value))
+    return parse_float_with_stream<T>(begin, end, target);
+
+  write_value_to_buffer(target, T(negative ? -value : value));
+  return c;
+}
+
+/*
+Whether rounding the correctly rounded double to a float gives the same float as
+rounding the exact value.
+
+All points halfway between two floats are doubles. So if the exact value and the
+double were on different sides of such a point, the point would be closer to
+the exact value than the double, unless the double is the halfway point itself.
+Halfway points have only the highest of the 29 mantissa bits not stored by a
+float set. Values out of the range of normalized floats are left to the stream.
+*/
+inline bool rounds_to_float_like_exact_value(float64_t value)
+{
+  if(value == 0)
+    return true;
+  if(value < float64_t(std::numeric_limits<float32_t>::min()) || value > float64_t(std::numeric_limits<float32_t>::max()))
+    return false;
+
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  const uint64_t discarded_bits = bits & ((uint64_t(1) << 29) - 1);
+  return discarded_bits != (uint64_t(1) << 28);
+}
+
+template<typename T>
+const char* parse_float_with_stream(const char* begin, const char* end, uint8_t* target)
+{
+  const char* token_end = end_of_token(begin, end);
+
+  // The streams don't parse nan and inf (written for example by the point cloud library for invalid points)
+  std::string token(begin, token_end);
+  std::transform(token.begin(), token.end(), token.begin(), [](char c){return c>='A' && c<='Z' ? char(c-'A'+'a') : c;});
+  const bool negative = !token.empty() && token[0]=='-';
+  if(!token.empty() && (token[0]=='-' || token[0]=='+'))
+    token.erase(0, 1);
+  if(token=="nan")
+  {
+    write_value_to_buffer(target, negative ? -std::numeric_limits<T>::quiet_NaN() : std::numeric_limits<T>::quiet_NaN());
+    return token_end;
+  }else if(token=="inf" || token=="infinity")
+  {
+    write_value_to_buffer(target, negative ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity());
+    return token_end;
+  }
+
+  std::istringstream stream(std::string(begin, token_end));
+  stream.imbue(std::locale::classic());
+
+  T value;
+  stream >> value;
+
+  if(stream.fail() || stream.peek() != std::istringstream::traits_type::eof())
+    return nullptr;
+
+  write_value_to_buffer(target, value);
+  return token_end;
+}
+
+} // namespace ascii_values
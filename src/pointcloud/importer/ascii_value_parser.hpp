@@ -0,0 +1,46 @@
+#ifndef POINTCLOUD_IMPORTER_ASCII_VALUE_PARSER_HPP_
+#define POINTCLOUD_IMPORTER_ASCII_VALUE_PARSER_HPP_
+
+#include <pointcloud/buffer.hpp>
+
+#include <QVector>
+
+namespace ascii_values {
+
+/*
+Locale independent parsing of numbers stored as text.
+
+The parser doesn't allocate and doesn't depend on the global locale (Qt sets
+the locale of the system, so std::strtod would expect a decimal comma in some
+countries), so it can be used by many threads at the same time.
+
+Common floating point numbers (up to 19 significant digits and small exponents)
+are rounded correctly with a fast path computing the nearest double. For float32
+values, the double is rounded once more, which only differs from rounding the
+exact value, if the double lies exactly halfway between two floats. Such values
+(and all other numbers) are converted with a classic locale stream.
+
+A line is a row of values, unless it's blank (see is_blank_line). Importers
+skip the blank lines, so they count the rows with count_rows.
+*/
+
+// Skips leading spaces/tabs, parses a single value of the given type and stores it at `target`.
+// Returns the position right after the value or nullptr, if the text is not a valid value of the given type.
+const char* parse_value(const char* begin, const char* end, data_type::base_type_t type, uint8_t* target);
+
+// True, if the line is empty or consists only of whitespace (parse_row rejects such lines)
+bool is_blank_line(const char* begin, const char* end);
+
+// The number of lines, which aren't blank
+size_t count_rows(const char* begin, const char* end);
+
+// Parses a line consisting of exactly one value for each of the given types into a tightly packed row.
+bool parse_row(const char* begin, const char* end, const QVector<data_type::base_type_t>& types, uint8_t* row);
+
+// Like parse_row, but the values are separated by the given delimiter (for example ',' or ';') instead of spaces.
+// The delimiter ' ' separates the values by any number of spaces/tabs.
+bool parse_row(const char* begin, const char* end, char delimiter, const QVector<data_type::base_type_t>& types, uint8_t* row);
+
+} // namespace ascii_values
+
+#endif // POINTCLOUD_IMPORTER_ASCII_VALUE_PARSER_HPP_
@@ -0,0 +1,372 @@
+#include <pointcloud/importer/decompressing_stream.hpp>
+
+#include <QtGlobal>
+
+#include <zlib.h>
+
+#ifndef ZSTD_SUPPORT
+#define ZSTD_SUPPORT 0
+#endif
+
+#if ZSTD_SUPPORT
+#include <zstd.h>
+#endif
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+bool ends_with(const std::string& text, const std::string& suffix);
+
+constexpr size_t DecompressingStream::buffer_size;
+constexpr size_t DecompressingStream::num_buffers;
+
+/*
+The decompression thread fills the buffers of the ring in order. The reading
+thread takes the filled buffers in the same order and releases each one, when
+it moves on to the next.
+*/
+class DecompressingStream::stream_buffer_t final : public std::streambuf
+{
+public:
+  stream_buffer_t(const std::string& filename, compression_t compression, size_t buffer_size, size_t num_buffers);
+  ~stream_buffer_t();
+
+  bool has_error() const;
+
+protected:
+  int_type underflow() override;
+  pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode mode) override;
+  pos_type seekpos(pos_type position, std::ios_base::openmode mode) override;
+
+private:
+  std::vector<std::vector<char>> buffers;
+  std::vector<size_t> buffer_sizes;
+
+  mutable std::mutex mutex;
+  std::condition_variable buffer_filled;
+  std::condition_variable buffer_released;
+  size_t num_filled_buffers = 0;
+  size_t num_taken_buffers = 0;
+  size_t num_released_buffers = 0;
+  bool end_of_file = false;
+  bool failed = false;
+  bool stopped = false;
+
+  // position of the begin of the current buffer within the decompressed data
+  int64_t buffer_position = 0;
+
+  std::thread thread;
+
+  void decompress_gzip(const std::string& filename);
+  void decompress_zstd(const std::string& filename);
+  char* wait_for_free_buffer();
+  void submit_buffer(size_t size);
+  void finish(bool failed);
+};
+
+DecompressingStream::compression_t DecompressingStream::compression_of_file(const std::string& filename)
+{
+  if(ends_with(filename, ".gz"))
+    return COMPRESSION::GZIP;
+  if(ends_with(filename, ".zst"))
+    return COMPRESSION::ZSTD;
+  return COMPRESSION::NONE;
+}
+
+bool DecompressingStream::is_supported(compression_t compression)
+{
+  switch(compression)
+  {
+  case COMPRESSION::NONE:
+  case COMPRESSION::GZIP:
+    return true;
+  case COMPRESSION::ZSTD:
+    return ZSTD_SUPPORT;
+  }
+
+  Q_UNREACHABLE();
+  return false;
+}
+
+std::unique_ptr<std::istream> DecompressingStream::open(const std::string& filename)
+{
+  const compression_t compression = compression_of_file(filename);
+
+  if(compression == COMPRESSION::NONE)
+    return std::unique_ptr<std::istream>(new std::ifstream(filename, std::ios_base::in | std::ios_base::binary));
+  else
+    return std::unique_ptr<std::istream>(new DecompressingStream(filename, compression));
+}
+
+DecompressingStream::DecompressingStream(const std::string& filename, compression_t compression)
+  : std::istream(nullptr),
+    stream_buffer(new stream_buffer_t(filename, compression, buffer_size, num_buffers))
+{
+  rdbuf(stream_buffer.get());
+}
+
+DecompressingStream::~DecompressingStream()
+{
+}
+
+bool DecompressingStream::has_error() const
+{
+  return stream_buffer->has_error();
+}
+
+DecompressingStream::stream_buffer_t::stream_buffer_t(const std::string& filename, compression_t compression, size_t buffer_size, size_t num_buffers)
+  : buffers(num_buffers, std::vector<char>(buffer_size)),
+    buffer_sizes(num_buffers, 0)
+{
+  Q_ASSERT(num_buffers >= 2);
+
+  if(!is_supported(compression) || compression == COMPRESSION::NONE)
+  {
+    finish(true);
+    return;
+  }
+
+  thread = std::thread([this, filename, compression](){
+    if(compression == COMPRESSION::GZIP)
+      decompress_gzip(filename);
+    else
+      decompress_zstd(filename);
+  });
+}
+
+DecompressingStream::stream_buffer_t::~stream_buffer_t()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  buffer_released.notify_all();
+
+  if(thread.joinable())
+    thread.join();
+}
+
+bool DecompressingStream::stream_buffer_t::has_error() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return failed;
+}
+
+DecompressingStream::stream_buffer_t::int_type DecompressingStream::stream_buffer_t::underflow()
+{
+  if(gptr() < egptr())
+    return traits_type::to_int_type(*gptr());
+
+  std::unique_lock<std::mutex> lock(mutex);
+
+  // release the buffer read completely
+  if(num_taken_buffers > num_released_buffers)
+  {
+    buffer_position += int64_t(egptr() - eback());
+    ++num_released_buffers;
+    buffer_released.notify_one();
+  }
+
+  buffer_filled.wait(lock, [this](){return num_taken_buffers < num_filled_buffers || end_of_file;});
+
+  if(num_taken_buffers == num_filled_buffers)
+  {
+    setg(nullptr, nullptr, nullptr);
+    return traits_type::eof();
+  }
+
+  const size_t index = num_taken_buffers++ % buffers.size();
+  char* data = buffers[index].data();
+  setg(data, data, data + buffer_sizes[index]);
+
+  return traits_type::to_int_type(*gptr());
+}
+
+DecompressingStream::stream_buffer_t::pos_type DecompressingStream::stream_buffer_t::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode mode)
+{
+  const int64_t current_position = buffer_position + int64_t(gptr() - eback());
+
+  if(direction == std::ios_base::cur)
+    return seekpos(pos_type(current_position + int64_t(offset)), mode);
+  else if(direction == std::ios_base::beg)
+    return seekpos(pos_type(offset), mode);
+  else
+    return pos_type(off_type(-1));
+}
+
+DecompressingStream::stream_buffer_t::pos_type DecompressingStream::stream_buffer_t::seekpos(pos_type position, std::ios_base::openmode mode)
+{
+  if((mode & std::ios_base::in) == 0)
+    return pos_type(off_type(-1));
+
+  int64_t current_position = buffer_position + int64_t(gptr() - eback());
+  const int64_t target_position = int64_t(position);
+
+  if(target_position < current_position)
+    return pos_type(off_type(-1));
+
+  // skip the decompressed data up to the target position
+  while(current_position < target_position)
+  {
+    if(gptr() == egptr() && traits_type::eq_int_type(underflow(), traits_type::eof()))
+      return pos_type(off_type(-1));
+
+    const int64_t num_skipped = std::min<int64_t>(target_position - current_position, int64_t(egptr() - gptr()));
+    gbump(int(num_skipped));
+    current_position += num_skipped;
+  }
+
+  return position;
+}
+
+void DecompressingStream::stream_buffer_t::decompress_gzip(const std::string& filename)
+{
+  gzFile file = gzopen(filename.c_str(), "rb");
+  if(file == nullptr)
+  {
+    finish(true);
+    return;
+  }
+
+  gzbuffer(file, 1 << 18);
+
+  bool succeeded = true;
+  while(char* buffer = wait_for_free_buffer())
+  {
+    const int num_bytes = gzread(file, buffer, unsigned(buffers.front().size()));
+
+    if(num_bytes < 0)
+      succeeded = false;
+    if(num_bytes <= 0)
+      break;
+
+    submit_buffer(size_t(num_bytes));
+  }
+
+  // gzread ends without an error at the end of a truncated file, but remembers it
+  int error = Z_OK;
+  gzerror(file, &error);
+  if(error != Z_OK)
+    succeeded = false;
+
+  gzclose(file);
+  finish(!succeeded);
+}
+
+void DecompressingStream::stream_buffer_t::decompress_zstd(const std::string& filename)
+{
+#if ZSTD_SUPPORT
+  std::ifstream stream(filename, std::ios_base::in | std::ios_base::binary);
+  ZSTD_DStream* context = ZSTD_createDStream();
+
+  if(!stream || context == nullptr)
+  {
+    ZSTD_freeDStream(context);
+    finish(true);
+    return;
+  }
+
+  ZSTD_initDStream(context);
+
+  std::vector<char> compressed(ZSTD_DStreamInSize());
+  ZSTD_inBuffer input = {compressed.data(), 0, 0};
+
+  bool succeeded = true;
+  bool end_of_input = false;
+  bool drained = false;
+  size_t last_result = 0;
+  while(char* buffer = wait_for_free_buffer())
+  {
+    ZSTD_outBuffer output = {buffer, buffers.front().size(), 0};
+
+    while(output.pos < output.size)
+    {
+      if(input.pos == input.size && !end_of_input)
+      {
+        stream.read(compressed.data(), std::streamsize(compressed.size()));
+        input.size = size_t(stream.gcount());
+        input.pos = 0;
+        end_of_input = input.size == 0;
+      }
+
+      // The decoder may still hold decoded bytes after consuming the whole input (if the last output buffer got full),
+      // so it's called with the empty input until the frame is done or it doesn't make progress anymore
+      if(end_of_input && last_result == 0)
+      {
+        drained = true;
+        break;
+      }
+
+      const size_t previous_output_pos = output.pos;
+      last_result = ZSTD_decompressStream(context, &output, &input);
+      if(ZSTD_isError(last_result))
+      {
+        succeeded = false;
+        break;
+      }
+
+      if(end_of_input && output.pos == previous_output_pos)
+      {
+        drained = true;
+        break;
+      }
+    }
+
+    if(output.pos > 0)
+      submit_buffer(output.pos);
+    if(drained || !succeeded)
+      break;
+  }
+
+  // A non zero result after draining the decoder means the last frame is incomplete
+  if(drained && last_result != 0)
+    succeeded = false;
+
+  ZSTD_freeDStream(context);
+  finish(!succeeded);
+#else
+  Q_UNUSED(filename);
+  finish(true);
+#endif
+}
+
+// Returns nullptr, if the reading thread stopped reading
+char* DecompressingStream::stream_buffer_t::wait_for_free_buffer()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+
+  buffer_released.wait(lock, [this](){return num_filled_buffers - num_released_buffers < buffers.size() || stopped;});
+
+  if(stopped)
+    return nullptr;
+
+  return buffers[num_filled_buffers % buffers.size()].data();
+}
+
+void DecompressingStream::stream_buffer_t::submit_buffer(size_t size)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer_sizes[num_filled_buffers % buffers.size()] = size;
+    ++num_filled_buffers;
+  }
+  buffer_filled.notify_one();
+}
+
+void DecompressingStream::stream_buffer_t::finish(bool failed)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->failed = failed;
+    end_of_file = true;
+  }
+  buffer_filled.notify_one();
+}
+
+bool ends_with(const std::string& text, const std::string& suffix)
+{
+  return text.size() >= suffix.size() && text.compare(text.size()-suffix.size(), suffix.size(), suffix) == 0;
+}
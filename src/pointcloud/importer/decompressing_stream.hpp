@@ -0,0 +1,51 @@
+#ifndef POINTCLOUD_IMPORTER_DECOMPRESSING_STREAM_HPP_
+#define POINTCLOUD_IMPORTER_DECOMPRESSING_STREAM_HPP_
+
+#include <istream>
+#include <memory>
+#include <string>
+
+/**
+Input stream decompressing a gzip or zstd compressed file on the fly.
+
+A dedicated thread decompresses the file into a bounded ring of buffers while
+the reading thread consumes them, so decompression and parsing overlap and no
+temporary file is written.
+
+Seeking is only supported forwards (by skipping decompressed data), which is
+enough for jumping to the body of a file after parsing its header.
+*/
+class DecompressingStream final : public std::istream
+{
+public:
+  enum class compression_t
+  {
+    NONE,
+    GZIP,
+    ZSTD,
+  };
+  typedef compression_t COMPRESSION;
+
+  static constexpr size_t buffer_size = size_t(1) << 22;
+  static constexpr size_t num_buffers = 4;
+
+  // Guesses the compression from the suffix (.gz or .zst) of the filename
+  static compression_t compression_of_file(const std::string& filename);
+  static bool is_supported(compression_t compression);
+
+  // Opens compressed files as DecompressingStream and all other files as std::ifstream
+  static std::unique_ptr<std::istream> open(const std::string& filename);
+
+  DecompressingStream(const std::string& filename, compression_t compression);
+  ~DecompressingStream();
+
+  // Whether the decompression failed (for example because of a corrupt file)
+  bool has_error() const;
+
+private:
+  class stream_buffer_t;
+
+  std::unique_ptr<stream_buffer_t> stream_buffer;
+};
+
+#endif // POINTCLOUD_IMPORTER_DECOMPRESSING_STREAM_HPP_
@@ -0,0 +1,275 @@
+#include <pointcloud/importer/las_importer.hpp>
+#include <core_library/print.hpp>
+#include <core_library/parallel.hpp>
+
+#include <QFileInfo>
+
+#include <fstream>
+#include <cstring>
+#include <memory>
+
+typedef las_format::field_t::KIND KIND;
+
+template<typename T>
+T read_record_value(const uint8_t* record);
+
+LasImporter::LasImporter(const std::string& input_file)
+  : AbstractPointCloudImporter(input_file)
+{
+}
+
+bool LasImporter::import_implementation()
+{
+  const QString filename = QFileInfo(QString::fromStdString(input_file)).fileName();
+
+  if(!las_format::read_header(input_file, &header, [&filename](const std::string& message){print_error(QString("Error while parsing las file %0: %1").arg(filename).arg(QString::fromStdString(message)).toStdString());}))
+    return false;
+
+  prepare_pointcloud();
+
+  const size_t num_points = header.num_points;
+  const size_t record_length = header.point_record_length;
+
+  // When sampling, each block is decoded into a temporary buffer and passed to the sampler
+  std::unique_ptr<PointSampler> sampler;
+  std::vector<uint8_t> sampled_user_data;
+  std::vector<PointCloud::vertex_t> sampled_vertices;
+  if(sampling.is_active())
+    sampler.reset(new PointSampler(sampling, pointcloud, num_points));
+  else
+    pointcloud.resize(num_points);
+
+  const size_t points_per_block = glm::max<size_t>(1, (size_t(1) << 24) / record_length);
+
+  // The records are decoded directly from the mapped file. If the file can't be mapped, the blocks are read into a buffer
+  Buffer mapped_records;
+  const bool is_mapped = mapped_records.map_file(QString::fromStdString(input_file), header.point_data_offset, num_points * record_length);
+
+  std::ifstream stream;
+  std::vector<uint8_t> block_records;
+  if(!is_mapped)
+  {
+    stream.open(input_file, std::ios_base::in | std::ios_base::binary);
+    stream.seekg(header.point_data_offset);
+    if(!stream)
+      throw QString("Incomplete file!");
+    block_records.resize(glm::min(points_per_block, num_points) * record_length);
+  }
+
+  auto read_block = [&](size_t first_point, size_t num_block_points) -> const uint8_t* {
+    if(is_mapped)
+      return mapped_records.data() + first_point * record_length;
+
+    const std::streamsize num_bytes = std::streamsize(num_block_points * record_length);
+    stream.read(reinterpret_cast<char*>(block_records.data()), num_bytes);
+    if(stream.gcount() != num_bytes)
+      throw QString("Incomplete file!");
+    return block_records.data();
+  };
+
+  const size_t num_threads = num_worker_threads();
+
+  // All points share the same color shift, so the colors of all records are checked before decoding the first block.
+  // The check stops at the first 16 bit color, so only the records of files with 8 bit colors are read twice.
+  color_shift = color_offset < 0 ? 8 : 0;
+  std::vector<int> thread_color_shift(num_threads);
+  for(size_t first_point=0; first_point<num_points && color_shift==0; first_point+=points_per_block)
+  {
+    const size_t num_block_points = glm::min(points_per_block, num_points-first_point);
+    const uint8_t* records = read_block(first_point, num_block_points);
+
+    parallel_for_ranges(num_block_points, num_threads, [&](size_t thread_index, size_t begin, size_t end){
+      thread_color_shift[thread_index] = detect_color_shift(records + begin*record_length, end-begin);
+    });
+
+    for(size_t i=0; i<glm::min(num_threads, num_block_points); ++i)
+      color_shift = glm::max(color_shift, thread_color_shift[i]);
+  }
+  if(!is_mapped && color_offset >= 0)
+  {
+    stream.clear();
+    stream.seekg(header.point_data_offset);
+  }
+
+  std::vector<aabb_t> chunk_aabb(num_threads);
+
+  uint8_t* user_data = pointcloud.user_data.data();
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(pointcloud.coordinate_color.data());
+
+  for(size_t first_point=0; first_point<num_points; first_point+=points_per_block)
+  {
+    const size_t num_block_points = glm::min(points_per_block, num_points-first_point);
+    const uint8_t* records = read_block(first_point, num_block_points);
+
+    uint8_t* block_user_data;
+    PointCloud::vertex_t* block_vertices;
+    if(!sampler)
+    {
+      block_user_data = user_data + first_point * vertex_data_stride;
+      block_vertices = vertices + first_point;
+    }else
+    {
+      if(sampled_vertices.size() < num_block_points)
+      {
+        sampled_user_data.resize(num_block_points * vertex_data_stride);
+        sampled_vertices.resize(num_block_points);
+        std::memset(static_cast<void*>(sampled_vertices.data()), 0xff, sampled_vertices.size() * sizeof(PointCloud::vertex_t));
+      }
+      block_user_data = sampled_user_data.data();
+      block_vertices = sampled_vertices.data();
+    }
+
+    parallel_for_ranges(num_block_points, num_threads, [&](size_t thread_index, size_t begin, size_t end){
+      chunk_aabb[thread_index] = aabb_t::invalid();
+      decode_records(records + begin*record_length, end-begin, block_user_data + begin*vertex_data_stride, block_vertices + begin, &chunk_aabb[thread_index]);
+    });
+
+    for(size_t i=0; i<glm::min(num_threads, num_block_points); ++i)
+    {
+      pointcloud.aabb.min_point = glm::min(pointcloud.aabb.min_point, chunk_aabb[i].min_point);
+      pointcloud.aabb.max_point = glm::max(pointcloud.aabb.max_point, chunk_aabb[i].max_point);
+    }
+
+    if(sampler)
+      sampler->add_points(block_user_data, block_vertices, num_block_points);
+    else
+      publish_available_points(first_point + num_block_points);
+    handle_loaded_chunk(int64_t(first_point + num_block_points));
+  }
+
+  if(sampler)
+    sampler->finish();
+
+  return true;
+}
+
+bool LasImporter::read_format(size_t* num_points)
+{
+  const QString filename = QFileInfo(QString::fromStdString(input_file)).fileName();
+
+  if(!las_format::read_header(input_file, &header, [&filename](const std::string& message){print_error(QString("Error while parsing las file %0: %1").arg(filename).arg(QString::fromStdString(message)).toStdString());}))
+    return false;
+
+  prepare_pointcloud();
+  *num_points = header.num_points;
+
+  return true;
+}
+
+void LasImporter::prepare_pointcloud()
+{
+  QVector<QString> property_names;
+  QVector<size_t> property_offsets;
+  QVector<data_type::base_type_t> property_types;
+
+  columns.clear();
+  vertex_data_stride = 0;
+  for(const las_format::field_t& field : las_format::fields_of_point_data_format(header.point_data_format))
+  {
+    property_names.append(QString::fromStdString(field.name));
+    property_offsets.append(vertex_data_stride);
+    property_types.append(field.type);
+    columns.push_back(column_t{field, vertex_data_stride});
+    vertex_data_stride += data_type::size_of_type(field.type);
+  }
+
+  color_offset = las_format::color_offset(header.point_data_format);
+
+  if(!use_custom_origin)
+    origin = glm::round((header.min_point + header.max_point) * 0.5);
+  pointcloud.origin = origin;
+
+  pointcloud.aabb = aabb_t::invalid();
+  pointcloud.set_user_data_format(vertex_data_stride, property_names, property_offsets, property_types);
+
+  Q_ASSERT(header.num_points < std::numeric_limits<int64_t>::max());
+  total_progress = int64_t(header.num_points);
+}
+
+// The colors should use the whole 16 bit range, but many files store 8 bit colors. In that case the colors are not shifted.
+// Returns the shift for the given records only, the shift of the file is the maximum over all records.
+int LasImporter::detect_color_shift(const uint8_t* records, size_t num_records) const
+{
+  if(color_offset < 0)
+    return 8;
+
+  const uint8_t* record = records + color_offset;
+  for(size_t i=0; i<num_records; ++i, record+=header.point_record_length)
+    for(size_t channel=0; channel<3; ++channel)
+      if(read_record_value<uint16_t>(record + channel*2) > 255)
+        return 8;
+
+  return 0;
+}
+
+// Decodes the records column by column into the user data and fills the vertices
+void LasImporter::decode_records(const uint8_t* records, size_t num_records, uint8_t* user_data, PointCloud::vertex_t* vertices, aabb_t* aabb) const
+{
+  const size_t record_length = header.point_record_length;
+
+  for(const column_t& column : columns)
+  {
+    const las_format::field_t& field = column.field;
+    const uint8_t* record = records + field.offset;
+    uint8_t* target = user_data + column.target_offset;
+
+    switch(field.kind)
+    {
+    case KIND::VALUE:
+    {
+      const size_t size = data_type::size_of_type(field.type);
+      for(size_t i=0; i<num_records; ++i, record+=record_length, target+=vertex_data_stride)
+        std::memcpy(target, record, size);
+      break;
+    }
+    case KIND::BITS:
+      for(size_t i=0; i<num_records; ++i, record+=record_length, target+=vertex_data_stride)
+        *target = uint8_t((*record >> field.bit_shift) & field.bit_mask);
+      break;
+    case KIND::COORDINATE:
+    {
+      const float64_t scale = header.scale[field.axis];
+      const float64_t offset = header.offset[field.axis];
+      for(size_t i=0; i<num_records; ++i, record+=record_length, target+=vertex_data_stride)
+      {
+        const float64_t value = read_record_value<int32_t>(record) * scale + offset;
+        std::memcpy(target, &value, sizeof(float64_t));
+      }
+      break;
+    }
+    case KIND::UINT64:
+      for(size_t i=0; i<num_records; ++i, record+=record_length, target+=vertex_data_stride)
+      {
+        const float64_t value = float64_t(read_record_value<uint64_t>(record));
+        std::memcpy(target, &value, sizeof(float64_t));
+      }
+      break;
+    }
+  }
+
+  // The coordinates are computed in double precision relative to the origin before rounding them to float
+  const glm::dvec3 origin_offset = header.offset - origin;
+  const uint8_t* record = records;
+  for(size_t i=0; i<num_records; ++i, record+=record_length)
+  {
+    glm::vec3 coordinate;
+    for(int axis=0; axis<3; ++axis)
+      coordinate[axis] = float(read_record_value<int32_t>(record + axis*4) * header.scale[axis] + origin_offset[axis]);
+
+    vertices[i].coordinate = coordinate;
+    aabb->min_point = glm::min(aabb->min_point, coordinate);
+    aabb->max_point = glm::max(aabb->max_point, coordinate);
+
+    if(color_offset >= 0)
+      for(int channel=0; channel<3; ++channel)
+        vertices[i].color[channel] = uint8_t(glm::min<int>(255, read_record_value<uint16_t>(record + color_offset + channel*2) >> color_shift));
+  }
+}
+
+template<typename T>
+T read_record_value(const uint8_t* record)
+{
+  T value;
+  std::memcpy(&value, record, sizeof(T));
+  return value;
+}
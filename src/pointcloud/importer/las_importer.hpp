@@ -0,0 +1,62 @@
+#ifndef POINTCLOUD_WORKERS_IMPORTER_LAS_HPP_
+#define POINTCLOUD_WORKERS_IMPORTER_LAS_HPP_
+
+#include <pointcloud/importer/abstract_importer.hpp>
+#include <pointcloud/las_file_format.hpp>
+
+#include <vector>
+
+/**
+Implementation for loading las files (versions 1.0 to 1.4 with the point data
+record formats 0 to 10)
+
+All standard fields of the point records are stored as columns of the user
+data. The columns x/y/z contain the scaled world space coordinates as float64,
+while the float coordinates of the vertices are relative to `origin` to keep
+their precision for georeferenced data.
+
+The origin is stored as PointCloud::origin, which pcvd files keep, and the
+autogenerated shader subtracts it from the x/y/z columns, so the vertices stay
+relative to it.
+
+The point records are mapped into memory (or read block by block, if mapping
+fails) and each block is decoded on all cores.
+
+The 16 bit colors are shifted to the 8 bit colors of the vertices, unless no
+record of the whole file has a color above 255 (many files store 8 bit colors).
+So the colors of all records are checked before decoding the first block.
+*/
+class LasImporter final : public AbstractPointCloudImporter
+{
+public:
+  // If false, the center of the bounding box stored in the header (rounded to whole units) is used as origin
+  bool use_custom_origin = false;
+  // The vertex coordinates are relative to this origin. Contains the used origin after importing (like PointCloud::origin)
+  glm::dvec3 origin = glm::dvec3(0);
+
+  LasImporter(const std::string& input_file);
+
+  bool read_format(size_t* num_points) override;
+
+protected:
+  bool import_implementation() override;
+
+private:
+  struct column_t
+  {
+    las_format::field_t field;
+    size_t target_offset; // offset of the column within the user data
+  };
+
+  las_format::header_t header;
+  std::vector<column_t> columns;
+  size_t vertex_data_stride = 0;
+  int64_t color_offset = -1;
+  int color_shift = 8;
+
+  void prepare_pointcloud();
+  int detect_color_shift(const uint8_t* records, size_t num_records) const;
+  void decode_records(const uint8_t* records, size_t num_records, uint8_t* user_data, PointCloud::vertex_t* vertices, aabb_t* aabb) const;
+};
+
+#endif // POINTCLOUD_WORKERS_IMPORTER_LAS_HPP_
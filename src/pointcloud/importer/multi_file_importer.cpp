@@ -0,0 +1,467 @@
+#include <pointcloud/importer/multi_file_importer.hpp>
+#include <pointcloud/importer/las_importer.hpp>
+#include <pointcloud/importer/pcvd_importer.hpp>
+#include <pointcloud/las_file_format.hpp>
+#include <core_library/print.hpp>
+#include <core_library/parallel.hpp>
+
+#include <QFileInfo>
+
+#include <atomic>
+#include <cstring>
+#include <limits>
+
+typedef data_type::BASE_TYPE BASE_TYPE;
+
+namespace {
+
+typedef void (*convert_column_t)(const uint8_t* source, size_t source_stride, uint8_t* target, size_t target_stride, size_t num_values);
+
+// The promoted type can represent all values, so a plain cast never loses anything
+template<typename t_in, typename t_out>
+void convert_column(const uint8_t* source, size_t source_stride, uint8_t* target, size_t target_stride, size_t num_values)
+{
+  for(size_t i=0; i<num_values; ++i)
+    write_value_to_buffer(target + i*target_stride, t_out(read_value_from_buffer<t_in>(source + i*source_stride)));
+}
+
+template<typename t_in>
+convert_column_t column_converter(data_type::base_type_t output_type)
+{
+  switch(output_type)
+  {
+  case BASE_TYPE::INT8:
+    return &convert_column<t_in, int8_t>;
+  case BASE_TYPE::INT16:
+    return &convert_column<t_in, int16_t>;
+  case BASE_TYPE::INT32:
+    return &convert_column<t_in, int32_t>;
+  case BASE_TYPE::UINT8:
+    return &convert_column<t_in, uint8_t>;
+  case BASE_TYPE::UINT16:
+    return &convert_column<t_in, uint16_t>;
+  case BASE_TYPE::UINT32:
+    return &convert_column<t_in, uint32_t>;
+  case BASE_TYPE::FLOAT32:
+    return &convert_column<t_in, float32_t>;
+  case BASE_TYPE::FLOAT64:
+    return &convert_column<t_in, float64_t>;
+  }
+
+  Q_UNREACHABLE();
+  return nullptr;
+}
+
+convert_column_t column_converter(data_type::base_type_t input_type, data_type::base_type_t output_type)
+{
+  switch(input_type)
+  {
+  case BASE_TYPE::INT8:
+    return column_converter<int8_t>(output_type);
+  case BASE_TYPE::INT16:
+    return column_converter<int16_t>(output_type);
+  case BASE_TYPE::INT32:
+    return column_converter<int32_t>(output_type);
+  case BASE_TYPE::UINT8:
+    return column_converter<uint8_t>(output_type);
+  case BASE_TYPE::UINT16:
+    return column_converter<uint16_t>(output_type);
+  case BASE_TYPE::UINT32:
+    return column_converter<uint32_t>(output_type);
+  case BASE_TYPE::FLOAT32:
+    return column_converter<float32_t>(output_type);
+  case BASE_TYPE::FLOAT64:
+    return column_converter<float64_t>(output_type);
+  }
+
+  Q_UNREACHABLE();
+  return nullptr;
+}
+
+bool is_float(data_type::base_type_t type)
+{
+  return type == BASE_TYPE::FLOAT32 || type == BASE_TYPE::FLOAT64;
+}
+
+bool is_signed(data_type::base_type_t type)
+{
+  return type == BASE_TYPE::INT8 || type == BASE_TYPE::INT16 || type == BASE_TYPE::INT32;
+}
+
+data_type::base_type_t signed_type_of_size(size_t size)
+{
+  switch(size)
+  {
+  case 1:
+    return BASE_TYPE::INT8;
+  case 2:
+    return BASE_TYPE::INT16;
+  case 4:
+    return BASE_TYPE::INT32;
+  default:
+    return BASE_TYPE::FLOAT64; // there's no 64 bit integer type
+  }
+}
+
+} // anonymous namespace
+
+MultiFileImporter::MultiFileImporter(const QStringList& input_files)
+  : AbstractPointCloudImporter(input_files.isEmpty() ? std::string() : input_files.first().toStdString()),
+    input_files(input_files)
+{
+}
+
+data_type::base_type_t MultiFileImporter::promoted_type(data_type::base_type_t a, data_type::base_type_t b)
+{
+  if(a == b)
+    return a;
+
+  const size_t size_a = data_type::size_of_type(a);
+  const size_t size_b = data_type::size_of_type(b);
+
+  if(is_float(a) || is_float(b))
+  {
+    // float32 represents all 8 and 16 bit integers exactly, but not all 32 bit integers
+    const bool float32_suffices = (a == BASE_TYPE::FLOAT32 || size_a <= 2) && (b == BASE_TYPE::FLOAT32 || size_b <= 2);
+    return float32_suffices ? BASE_TYPE::FLOAT32 : BASE_TYPE::FLOAT64;
+  }
+
+  if(is_signed(a) == is_signed(b))
+    return size_a >= size_b ? a : b;
+
+  // mixed signedness: the signed type must be larger than the unsigned one
+  const size_t signed_size = is_signed(a) ? size_a : size_b;
+  const size_t unsigned_size = is_signed(a) ? size_b : size_a;
+  return signed_type_of_size(signed_size > unsigned_size ? signed_size : unsigned_size*2);
+}
+
+QVector<QSharedPointer<AbstractPointCloudImporter>> MultiFileImporter::create_importers() const
+{
+  QVector<QSharedPointer<AbstractPointCloudImporter>> importers;
+
+  // las files store their coordinates relative to a common origin, so the tiles fit together
+  glm::dvec3 las_min_point(std::numeric_limits<double>::infinity());
+  glm::dvec3 las_max_point(-std::numeric_limits<double>::infinity());
+  bool has_las_files = false;
+
+  for(const QString& filepath : input_files)
+  {
+    const QFileInfo file(filepath);
+    const std::string filepath_std = file.absoluteFilePath().toStdString();
+
+    QSharedPointer<AbstractPointCloudImporter> importer = importerForSuffix(file.suffix().toLower(), filepath_std);
+    if(!importer)
+      throw QString("Unexpected file format of <%0>").arg(file.fileName());
+
+    if(importer.objectCast<LasImporter>())
+    {
+      las_format::header_t header;
+      if(!las_format::read_header(filepath_std, &header, [](const std::string& message){println_error(message);}))
+        throw QString("Couldn't read the header of <%0>").arg(file.fileName());
+
+      las_min_point = glm::min(las_min_point, header.min_point);
+      las_max_point = glm::max(las_max_point, header.max_point);
+      has_las_files = true;
+    }
+
+    importer->sampling = sampling;
+    importers << importer;
+  }
+
+  if(has_las_files)
+    for(const QSharedPointer<AbstractPointCloudImporter>& importer : importers)
+      if(QSharedPointer<LasImporter> las_importer = importer.objectCast<LasImporter>())
+      {
+        las_importer->use_custom_origin = true;
+        las_importer->origin = glm::round((las_min_point + las_max_point) * 0.5);
+      }
+
+  return importers;
+}
+
+bool MultiFileImporter::import_implementation()
+{
+  if(input_files.isEmpty())
+    return false;
+
+  const QVector<QSharedPointer<AbstractPointCloudImporter>> importers = create_importers();
+  const size_t num_files = size_t(importers.length());
+
+  QVector<int64_t> file_sizes;
+  int64_t total_file_size = 0;
+  for(const QString& filepath : input_files)
+  {
+    file_sizes << glm::max<int64_t>(1, QFileInfo(filepath).size());
+    total_file_size += file_sizes.last();
+  }
+
+  // merging is roughly estimated to take a quarter of the time of parsing the files
+  total_progress = total_file_size + total_file_size/4;
+
+  // The importers of the single files are canceled, if this import is canceled or one of them failed
+  Progress files_progress;
+  files_progress.set_parent(&progress);
+  for(const QSharedPointer<AbstractPointCloudImporter>& importer : importers)
+    importer->progress.set_parent(&files_progress);
+
+  // With the sizes of all files known from their headers, each file is imported directly into its slice of the merged point cloud.
+  // Otherwise (or when sampling) all files are imported on their own and merged afterwards.
+  QVector<size_t> first_points;
+  const bool into_slices = !sampling.is_active() && import_into_slices(importers, &first_points);
+
+  uint8_t* vertices = into_slices ? pointcloud.coordinate_color.data() : nullptr;
+  uint8_t* user_data = into_slices ? pointcloud.user_data.data() : nullptr;
+  QVector<aabb_t> file_aabbs(int(num_files), aabb_t::invalid());
+  QVector<glm::dvec3> file_origins(int(num_files), glm::dvec3(0));
+
+  // Each file is already parsed on multiple cores by its importer, so only a few files are parsed at once
+  const size_t num_threads = glm::clamp<size_t>(num_worker_threads() / 4, 1, num_files);
+  std::atomic<size_t> next_file(0);
+  std::atomic<int64_t> imported_file_size(0);
+
+  parallel_for_ranges(num_threads, num_threads, [&](size_t, size_t, size_t) {
+    try
+    {
+      for(size_t i=next_file++; i<num_files && !files_progress.is_canceled(); i=next_file++)
+      {
+        AbstractPointCloudImporter& importer = *importers[int(i)];
+        importer.import();
+
+        if(importer.state == CANCELED)
+          throw canceled_t();
+        if(importer.state != SUCCEEDED)
+          throw QString("Couldn't import the file <%0>").arg(input_files[int(i)]);
+
+        if(importer.pointcloud.num_points > 0)
+          file_aabbs[int(i)] = importer.pointcloud.aabb;
+        file_origins[int(i)] = importer.pointcloud.origin;
+
+        // Only the parts, which couldn't be imported into the slice directly, are copied
+        if(into_slices)
+        {
+          if(importer.pointcloud.num_points != first_points[int(i)+1] - first_points[int(i)])
+            throw QString("The number of points of <%0> differs from its header").arg(input_files[int(i)]);
+          for(const QString& name : importer.pointcloud.user_data_names)
+            if(!pointcloud.user_data_names.contains(name))
+              throw QString("The properties of <%0> differ from its header").arg(input_files[int(i)]);
+          copy_into_slice(importer.pointcloud, first_points[int(i)], vertices, user_data);
+          importer.pointcloud.clear();
+        }
+
+        handle_loaded_chunk(imported_file_size += file_sizes[int(i)]);
+      }
+    }catch(...)
+    {
+      files_progress.cancel();
+      throw;
+    }
+  });
+
+  if(!into_slices)
+    merge(importers, &first_points);
+
+  pointcloud.shader = importers.first()->pointcloud.shader;
+
+  // The las files share their common origin. Otherwise the first file with an origin (for example a pcvd file stored
+  // from a las file) decides it, so files with absolute coordinates don't lose the precision of the others.
+  pointcloud.origin = glm::dvec3(0);
+  for(int f=0; f<importers.length(); ++f)
+    if(importers[f].objectCast<LasImporter>())
+      pointcloud.origin = file_origins[f];
+  for(int f=0; f<importers.length() && pointcloud.origin == glm::dvec3(0); ++f)
+    pointcloud.origin = file_origins[f];
+
+  // The vertices of files with another origin are moved to the merged one
+  pointcloud.aabb = aabb_t::invalid();
+  for(int f=0; f<importers.length(); ++f)
+  {
+    const glm::dvec3 offset = file_origins[f] - pointcloud.origin;
+    if(offset != glm::dvec3(0))
+      shift_slice(first_points[f], first_points[f+1] - first_points[f], offset);
+
+    if(first_points[f] == first_points[f+1])
+      continue;
+    pointcloud.aabb.min_point = glm::min(pointcloud.aabb.min_point, glm::vec3(glm::dvec3(file_aabbs[f].min_point) + offset));
+    pointcloud.aabb.max_point = glm::max(pointcloud.aabb.max_point, glm::vec3(glm::dvec3(file_aabbs[f].max_point) + offset));
+  }
+
+  handle_loaded_chunk(total_progress);
+
+  // The budget of points was only applied to the single files
+  if(sampling.max_num_points != 0 && pointcloud.num_points > sampling.max_num_points)
+  {
+    PointSampler::settings_t budget;
+    budget.max_num_points = sampling.max_num_points;
+    PointSampler::sample_loaded_pointcloud(pointcloud, budget);
+  }
+
+  return true;
+}
+
+// Reads the headers of all files and allocates the merged point cloud for them. Then the buffers of each importer are made
+// views of its slice of the merged buffers, so it loads its points right into them. The user data can only be viewed, if
+// the file has exactly the merged properties. Returns false, if the header of any file doesn't tell its size and properties.
+bool MultiFileImporter::import_into_slices(const QVector<QSharedPointer<AbstractPointCloudImporter>>& importers, QVector<size_t>* first_points)
+{
+  QVector<size_t> num_points;
+  for(const QSharedPointer<AbstractPointCloudImporter>& importer : importers)
+  {
+    size_t file_num_points = 0;
+    if(!importer->read_format(&file_num_points))
+      return false;
+    num_points << file_num_points;
+  }
+
+  allocate_merged_pointcloud(importers, num_points, first_points);
+
+  uint8_t* vertices = pointcloud.coordinate_color.data();
+  uint8_t* user_data = pointcloud.user_data.data();
+  const size_t stride = pointcloud.user_data_stride;
+
+  for(int f=0; f<importers.length(); ++f)
+  {
+    PointCloud& file_pointcloud = importers[f]->pointcloud;
+    const size_t first_point = (*first_points)[f];
+
+    file_pointcloud.coordinate_color.view(vertices + first_point * PointCloud::stride, num_points[f] * PointCloud::stride);
+    if(file_pointcloud.user_data_names == pointcloud.user_data_names && file_pointcloud.user_data_types == pointcloud.user_data_types)
+      file_pointcloud.user_data.view(user_data + first_point * stride, num_points[f] * stride);
+
+    // Sections read instead of mapped are read right into the views
+    if(QSharedPointer<PcvdImporter> pcvd_importer = importers[f].objectCast<PcvdImporter>())
+      pcvd_importer->read_mode = PcvdImporter::READ_MODE::PARALLEL_READ;
+  }
+
+  return true;
+}
+
+// Merges the point clouds of the importers after they were imported on their own
+void MultiFileImporter::merge(const QVector<QSharedPointer<AbstractPointCloudImporter>>& importers, QVector<size_t>* first_points)
+{
+  QVector<size_t> num_points;
+  for(const QSharedPointer<AbstractPointCloudImporter>& importer : importers)
+    num_points << importer->pointcloud.num_points;
+
+  allocate_merged_pointcloud(importers, num_points, first_points);
+
+  uint8_t* vertices = pointcloud.coordinate_color.data();
+  uint8_t* user_data = pointcloud.user_data.data();
+
+  for(int f=0; f<importers.length(); ++f)
+  {
+    copy_into_slice(importers[f]->pointcloud, (*first_points)[f], vertices, user_data);
+    importers[f]->pointcloud.clear();
+  }
+}
+
+// Allocates the merged point cloud with the union of the properties of all importers (see promoted_type).
+// The slice of the points of each importer begins at its first point, the last first point is the total number of points.
+void MultiFileImporter::allocate_merged_pointcloud(const QVector<QSharedPointer<AbstractPointCloudImporter>>& importers, const QVector<size_t>& num_points, QVector<size_t>* first_points)
+{
+  QVector<QString> names;
+  QVector<data_type::base_type_t> types;
+  for(const QSharedPointer<AbstractPointCloudImporter>& importer : importers)
+  {
+    const PointCloud& file_pointcloud = importer->pointcloud;
+    for(int i=0; i<file_pointcloud.user_data_names.length(); ++i)
+    {
+      const int column = names.indexOf(file_pointcloud.user_data_names[i]);
+      if(column < 0)
+      {
+        names << file_pointcloud.user_data_names[i];
+        types << file_pointcloud.user_data_types[i];
+      }else
+      {
+        types[column] = promoted_type(types[column], file_pointcloud.user_data_types[i]);
+      }
+    }
+  }
+
+  QVector<size_t> offsets;
+  size_t stride = 0;
+  for(data_type::base_type_t type : types)
+  {
+    offsets << stride;
+    stride += data_type::size_of_type(type);
+  }
+
+  first_points->clear();
+  size_t total_num_points = 0;
+  for(size_t file_num_points : num_points)
+  {
+    *first_points << total_num_points;
+    total_num_points += file_num_points;
+  }
+  *first_points << total_num_points;
+
+  pointcloud.clear();
+  pointcloud.set_user_data_format(stride, names, offsets, types);
+  pointcloud.resize(total_num_points);
+}
+
+// Copies the vertices and converts the user data of a file into its slice of the merged buffers on all cores.
+// Buffers, which are already views of the slice, are skipped.
+void MultiFileImporter::copy_into_slice(const PointCloud& file_pointcloud, size_t first_point, uint8_t* vertices, uint8_t* user_data) const
+{
+  const size_t num_points = file_pointcloud.num_points;
+  const size_t stride = pointcloud.user_data_stride;
+  const QVector<QString>& names = pointcloud.user_data_names;
+  const QVector<data_type::base_type_t>& types = pointcloud.user_data_types;
+  const QVector<size_t>& offsets = pointcloud.user_data_offset;
+
+  uint8_t* slice_vertices = vertices + first_point * PointCloud::stride;
+  uint8_t* slice_user_data = user_data + first_point * stride;
+
+  const bool copy_vertices = file_pointcloud.coordinate_color.const_data() != slice_vertices;
+  const bool copy_user_data = file_pointcloud.user_data.const_data() != slice_user_data;
+  if(num_points == 0 || (!copy_vertices && !copy_user_data))
+    return;
+
+  // for each merged column the conversion from the column of the file (nullptr, if the file doesn't have the column)
+  QVector<convert_column_t> converters;
+  QVector<size_t> source_offsets;
+  for(int column=0; column<names.length(); ++column)
+  {
+    const int i = file_pointcloud.user_data_names.indexOf(names[column]);
+    converters << (i<0 ? nullptr : column_converter(file_pointcloud.user_data_types[i], types[column]));
+    source_offsets << (i<0 ? 0 : file_pointcloud.user_data_offset[i]);
+  }
+
+  const uint8_t* file_vertices = file_pointcloud.coordinate_color.const_data();
+  const uint8_t* file_user_data = file_pointcloud.user_data.const_data();
+  const size_t file_stride = file_pointcloud.user_data_stride;
+
+  parallel_for_ranges(num_points, [&](size_t, size_t begin, size_t end) {
+    const size_t n = end - begin;
+
+    if(copy_vertices)
+      std::memcpy(slice_vertices + begin * PointCloud::stride, file_vertices + begin * PointCloud::stride, n * PointCloud::stride);
+
+    if(!copy_user_data)
+      return;
+
+    for(int column=0; column<names.length(); ++column)
+    {
+      uint8_t* target = slice_user_data + begin * stride + offsets[column];
+      const size_t size = data_type::size_of_type(types[column]);
+
+      if(converters[column] != nullptr)
+        converters[column](file_user_data + begin * file_stride + source_offsets[column], file_stride, target, stride, n);
+      else
+        for(size_t i=0; i<n; ++i)
+          std::memset(target + i*stride, 0, size);
+    }
+  });
+}
+
+// Adds the offset to the vertices of the slice on all cores. The sum is computed in double precision, as the offset
+// between the origins of two files can be much larger than the coordinates relative to them.
+void MultiFileImporter::shift_slice(size_t first_point, size_t num_points, glm::dvec3 offset)
+{
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(pointcloud.coordinate_color.data(first_point * PointCloud::stride, num_points * PointCloud::stride));
+
+  parallel_for_ranges(num_points, [&](size_t, size_t begin, size_t end) {
+    for(size_t i=begin; i<end; ++i)
+      vertices[i].coordinate = glm::vec3(glm::dvec3(vertices[i].coordinate) + offset);
+  });
+}
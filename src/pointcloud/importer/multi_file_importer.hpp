@@ -0,0 +1,57 @@
+#ifndef POINTCLOUD_WORKERS_IMPORTER_MULTIFILE_HPP_
+#define POINTCLOUD_WORKERS_IMPORTER_MULTIFILE_HPP_
+
+#include <pointcloud/importer/abstract_importer.hpp>
+
+#include <QStringList>
+
+/**
+Imports several files (for example the tiles of a scan) and merges them into a
+single point cloud.
+
+The user data of the merged point cloud contains the union of the properties of
+all files. If the type of a property differs between the files, it's promoted to
+a type able to represent the values of all files (see promoted_type). Properties
+missing in a file are zero for its points.
+
+The files are imported concurrently with their own importers, each thread taking
+the next file as soon as it's done. If the headers of all files tell their number
+of points and properties (see read_format), the merged buffers are allocated up
+front and each importer loads its points directly into its slice of them (see
+Buffer::view), so the points are only stored once. Only the user data of files
+with other properties than the merged ones is converted into the slice right
+after importing the file. Otherwise (and when sampling) all files are imported
+first, then the merged buffers are allocated and all files are converted into
+their slices on all cores.
+
+The vertices of las files are relative to a common origin, which is the rounded
+center of the bounding boxes stored in their headers. It becomes the origin of
+the merged point cloud. Without las files, the origin of the first file having
+one (for example a pcvd file stored from a las file) is used. The vertices of
+all files relative to another origin, like pcvd files with an origin of their
+own and files with absolute coordinates (origin zero), are moved to the merged
+origin after importing them.
+*/
+class MultiFileImporter final : public AbstractPointCloudImporter
+{
+public:
+  MultiFileImporter(const QStringList& input_files);
+
+  // The smallest type able to represent all values of both types
+  static data_type::base_type_t promoted_type(data_type::base_type_t a, data_type::base_type_t b);
+
+protected:
+  bool import_implementation() override;
+
+private:
+  const QStringList input_files;
+
+  QVector<QSharedPointer<AbstractPointCloudImporter>> create_importers() const;
+  bool import_into_slices(const QVector<QSharedPointer<AbstractPointCloudImporter>>& importers, QVector<size_t>* first_points);
+  void merge(const QVector<QSharedPointer<AbstractPointCloudImporter>>& importers, QVector<size_t>* first_points);
+  void allocate_merged_pointcloud(const QVector<QSharedPointer<AbstractPointCloudImporter>>& importers, const QVector<size_t>& num_points, QVector<size_t>* first_points);
+  void copy_into_slice(const PointCloud& file_pointcloud, size_t first_point, uint8_t* vertices, uint8_t* user_data) const;
+  void shift_slice(size_t first_point, size_t num_points, glm::dvec3 offset);
+};
+
+#endif // POINTCLOUD_WORKERS_IMPORTER_MULTIFILE_HPP_
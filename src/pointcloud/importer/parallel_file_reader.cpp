@@ -0,0 +1,148 @@
+#include <pointcloud/importer/parallel_file_reader.hpp>
+
+#include <QtGlobal>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+bool read_block(int file_descriptor, int64_t offset, size_t num_bytes, uint8_t* target);
+
+ParallelFileReader::ParallelFileReader(const std::string& filename)
+{
+#ifdef Q_OS_UNIX
+  file_descriptor = ::open(filename.c_str(), O_RDONLY);
+#else
+  Q_UNUSED(filename);
+#endif
+}
+
+ParallelFileReader::~ParallelFileReader()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  job_started.notify_all();
+
+  for(std::thread& thread : threads)
+    thread.join();
+
+#ifdef Q_OS_UNIX
+  if(file_descriptor >= 0)
+    ::close(file_descriptor);
+#endif
+}
+
+bool ParallelFileReader::is_supported()
+{
+#ifdef Q_OS_UNIX
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool ParallelFileReader::is_open() const
+{
+  return file_descriptor >= 0;
+}
+
+bool ParallelFileReader::read(int64_t offset, size_t num_bytes, uint8_t* target)
+{
+  if(!is_open())
+    return false;
+
+  const size_t num_blocks = (num_bytes + block_size - 1) / block_size;
+
+  if(num_blocks == 0)
+    return true;
+
+  // The calling thread reads blocks as well, so the pool needs one thread less
+  if(threads.empty())
+    for(size_t i=1; i<queue_depth; ++i)
+      threads.emplace_back(&ParallelFileReader::work, this);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job = job_t{offset, num_bytes, target, num_blocks};
+    next_block = 0;
+    failed = false;
+    num_busy_threads = threads.size();
+    ++job_index;
+  }
+  job_started.notify_all();
+
+  read_blocks();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  job_finished.wait(lock, [this](){return num_busy_threads == 0;});
+
+  return !failed;
+}
+
+// Waits for the next read and helps reading its blocks until the reader is destroyed
+void ParallelFileReader::work()
+{
+  size_t last_job_index = 0;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while(true)
+  {
+    job_started.wait(lock, [this, &last_job_index](){return stopped || job_index != last_job_index;});
+    if(stopped)
+      return;
+    last_job_index = job_index;
+
+    lock.unlock();
+    read_blocks();
+    lock.lock();
+
+    if(--num_busy_threads == 0)
+      job_finished.notify_one();
+  }
+}
+
+// Every thread keeps taking the next unread block, so there are always up to queue_depth requests in flight
+void ParallelFileReader::read_blocks()
+{
+  for(size_t block=next_block++; block<job.num_blocks && !failed; block=next_block++)
+  {
+    const size_t block_begin = block * block_size;
+    const size_t block_end = std::min(job.num_bytes, block_begin + block_size);
+
+    if(!read_block(file_descriptor, job.offset + int64_t(block_begin), block_end-block_begin, job.target + block_begin))
+      failed = true;
+  }
+}
+
+bool read_block(int file_descriptor, int64_t offset, size_t num_bytes, uint8_t* target)
+{
+#ifdef Q_OS_UNIX
+  while(num_bytes > 0)
+  {
+    const ssize_t read_bytes = ::pread(file_descriptor, target, num_bytes, off_t(offset));
+
+    if(read_bytes < 0 && errno == EINTR)
+      continue;
+    if(read_bytes <= 0)
+      return false;
+
+    num_bytes -= size_t(read_bytes);
+    target += read_bytes;
+    offset += read_bytes;
+  }
+
+  return true;
+#else
+  Q_UNUSED(file_descriptor);
+  Q_UNUSED(offset);
+  Q_UNUSED(num_bytes);
+  Q_UNUSED(target);
+  return false;
+#endif
+}
@@ -0,0 +1,70 @@
+#ifndef POINTCLOUD_IMPORTER_PARALLEL_FILE_READER_HPP_
+#define POINTCLOUD_IMPORTER_PARALLEL_FILE_READER_HPP_
+
+#include <core_library/types.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+Reads large regions of a file with many positional reads in flight at the same time.
+
+A single buffered stream only has one request in flight, which is far from
+saturating fast NVMe drives on a cold page cache. This reader splits the region
+into large blocks and lets a pool of threads read them with pread directly into
+the target memory. The threads are started by the first read and reused by all
+following reads, so reading a large section slice by slice doesn't start new
+threads for every slice.
+
+Only available on unix systems (see is_supported()).
+*/
+class ParallelFileReader final
+{
+public:
+  size_t block_size = size_t(1) << 23;
+  size_t queue_depth = 32; // number of threads and therefore number of requests in flight (only changeable before the first read)
+
+  ParallelFileReader(const std::string& filename);
+  ~ParallelFileReader();
+
+  ParallelFileReader(const ParallelFileReader&) = delete;
+  ParallelFileReader& operator=(const ParallelFileReader&) = delete;
+
+  static bool is_supported();
+  bool is_open() const;
+
+  // Returns false, if the file ended before all bytes were read or a read failed
+  bool read(int64_t offset, size_t num_bytes, uint8_t* target);
+
+private:
+  struct job_t
+  {
+    int64_t offset;
+    size_t num_bytes;
+    uint8_t* target;
+    size_t num_blocks;
+  };
+
+  int file_descriptor = -1;
+
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable job_started;
+  std::condition_variable job_finished;
+  job_t job;
+  size_t job_index = 0; // incremented by every read, so the threads notice the new job
+  size_t num_busy_threads = 0;
+  bool stopped = false;
+
+  std::atomic<size_t> next_block;
+  std::atomic<bool> failed;
+
+  void work();
+  void read_blocks();
+};
+
+#endif // POINTCLOUD_IMPORTER_PARALLEL_FILE_READER_HPP_
@@ -0,0 +1,415 @@
+#include <pointcloud/importer/pcd_importer.hpp>
+#include <pointcloud/importer/ascii_value_parser.hpp>
+#include <core_library/print.hpp>
+#include <core_library/parallel.hpp>
+
+#include <QFileInfo>
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+PcdImporter::PcdImporter(const std::string& input_file)
+  : AbstractPointCloudImporter(input_file)
+{
+}
+
+bool PcdImporter::import_implementation()
+{
+  const QString filename = QFileInfo(QString::fromStdString(input_file)).fileName();
+
+  pcd_format::header_t header;
+  if(!pcd_format::read_header(input_file, &header, [&filename](std::size_t line, const std::string& message){print_error(QString("Error while parsing pcd file %0 in line %1:%2").arg(filename).arg(line).arg(QString::fromStdString(message)).toStdString());}))
+    return false;
+
+  prepare_pointcloud(header);
+
+  switch(header.data)
+  {
+  case pcd_format::data_t::ASCII:
+    import_ascii(header);
+    break;
+  case pcd_format::data_t::BINARY:
+    import_binary(header);
+    break;
+  case pcd_format::data_t::BINARY_COMPRESSED:
+    import_binary_compressed(header);
+    break;
+  }
+
+  if(sampler)
+    sampler->finish();
+
+  return true;
+}
+
+bool PcdImporter::read_format(size_t* num_points)
+{
+  const QString filename = QFileInfo(QString::fromStdString(input_file)).fileName();
+
+  pcd_format::header_t header;
+  if(!pcd_format::read_header(input_file, &header, [&filename](std::size_t line, const std::string& message){print_error(QString("Error while parsing pcd file %0 in line %1:%2").arg(filename).arg(line).arg(QString::fromStdString(message)).toStdString());}))
+    return false;
+
+  prepare_format(header);
+  *num_points = header.num_points;
+
+  return true;
+}
+
+void PcdImporter::prepare_pointcloud(const pcd_format::header_t& header)
+{
+  num_points = header.num_points;
+  num_loaded_points = 0;
+
+  prepare_format(header);
+
+  // When sampling, the PointSampler allocates only the memory for the selected points
+  if(sampling.is_active())
+    sampler.reset(new PointSampler(sampling, pointcloud, num_points));
+  else
+    pointcloud.resize(num_points);
+
+  decoder.reset(new VertexDecoder(pointcloud));
+
+  Q_ASSERT(num_points < std::numeric_limits<int64_t>::max());
+  total_progress = int64_t(num_points);
+}
+
+// The columns of the user data and where they are stored within a binary point
+void PcdImporter::prepare_format(const pcd_format::header_t& header)
+{
+  file_stride = header.stride();
+
+  vertex_data_stride = 0;
+  columns.clear();
+  value_types.clear();
+  value_is_packed_color.clear();
+
+  QVector<QString> property_names;
+  QVector<size_t> property_offsets;
+  QVector<data_type::base_type_t> property_types;
+
+  auto add_column = [&](const QString& name, data_type::base_type_t type, size_t field_offset, size_t field_size, size_t byte_offset) {
+    property_names.append(name);
+    property_offsets.append(vertex_data_stride);
+    property_types.append(type);
+    columns.push_back(column_t{field_offset, field_size, byte_offset, data_type::size_of_type(type), vertex_data_stride});
+    vertex_data_stride += data_type::size_of_type(type);
+  };
+
+  for(size_t i=0; i<header.fields.size(); ++i)
+  {
+    const pcd_format::field_t& field = header.fields[i];
+    const size_t field_offset = header.offset_of_field(i);
+    const size_t value_size = data_type::size_of_type(field.type);
+    const QString name = QString::fromStdString(field.name);
+    const bool is_packed_color = (field.name == "rgb" || field.name == "rgba") && field.count == 1 && value_size == 4;
+
+    for(size_t j=0; j<field.count; ++j)
+    {
+      value_types.append(field.type);
+      value_is_packed_color.append(is_packed_color);
+    }
+
+    if(field.name == "_")
+      continue;
+
+    if(is_packed_color)
+    {
+      // The color is packed as little endian 0xAARRGGBB
+      add_column("red", data_type::BASE_TYPE::UINT8, field_offset, field.size(), 2);
+      add_column("green", data_type::BASE_TYPE::UINT8, field_offset, field.size(), 1);
+      add_column("blue", data_type::BASE_TYPE::UINT8, field_offset, field.size(), 0);
+      if(field.name == "rgba")
+        add_column("alpha", data_type::BASE_TYPE::UINT8, field_offset, field.size(), 3);
+    }else if(field.count == 1)
+    {
+      add_column(name, field.type, field_offset, field.size(), 0);
+    }else
+    {
+      for(size_t j=0; j<field.count; ++j)
+        add_column(QString("%0_%1").arg(name).arg(j), field.type, field_offset, field.size(), j*value_size);
+    }
+  }
+
+  // Binary points can be read directly into the user data, if no column had to be moved
+  file_rows_are_user_data = vertex_data_stride == file_stride;
+  for(const column_t& column : columns)
+    file_rows_are_user_data = file_rows_are_user_data && column.target_offset == column.field_offset + column.byte_offset;
+
+  pointcloud.aabb = aabb_t::invalid();
+  pointcloud.set_user_data_format(vertex_data_stride, property_names, property_offsets, property_types);
+}
+
+// Returns the rows of the user data, the next block of points has to be stored in
+uint8_t* PcdImporter::begin_block(size_t num_block_points)
+{
+  if(!sampler)
+    return pointcloud.user_data.data() + num_loaded_points * vertex_data_stride;
+
+  // When sampling, each block is stored in a temporary buffer and passed to the sampler
+  if(sampled_vertices.size() < num_block_points)
+  {
+    sampled_user_data.resize(num_block_points * vertex_data_stride);
+    sampled_vertices.resize(num_block_points);
+    std::memset(static_cast<void*>(sampled_vertices.data()), 0xff, sampled_vertices.size() * sizeof(PointCloud::vertex_t));
+  }
+  return sampled_user_data.data();
+}
+
+// Decodes the vertices of the block stored in the rows returned by begin_block
+void PcdImporter::end_block(size_t num_block_points)
+{
+  uint8_t* user_data;
+  PointCloud::vertex_t* vertices;
+  if(!sampler)
+  {
+    user_data = pointcloud.user_data.data() + num_loaded_points * vertex_data_stride;
+    vertices = reinterpret_cast<PointCloud::vertex_t*>(pointcloud.coordinate_color.data()) + num_loaded_points;
+  }else
+  {
+    user_data = sampled_user_data.data();
+    vertices = sampled_vertices.data();
+  }
+
+  decoder->decode(user_data, vertices, num_block_points, &pointcloud.aabb);
+
+  num_loaded_points += num_block_points;
+
+  if(sampler)
+    sampler->add_points(user_data, vertices, num_block_points);
+  else
+    publish_available_points(num_loaded_points);
+  handle_loaded_chunk(int64_t(num_loaded_points));
+}
+
+// Copies the columns of the given binary points into the rows of the user data
+void PcdImporter::scatter_columns(const uint8_t* file_rows, size_t num_block_points, uint8_t* rows) const
+{
+  parallel_for_ranges(num_block_points, [&](size_t, size_t begin, size_t end){
+    for(const column_t& column : columns)
+    {
+      const uint8_t* s = file_rows + column.field_offset + column.byte_offset + begin * file_stride;
+      uint8_t* t = rows + begin * vertex_data_stride + column.target_offset;
+      for(size_t i=begin; i<end; ++i, s+=file_stride, t+=vertex_data_stride)
+        std::memcpy(t, s, column.size);
+    }
+  });
+}
+
+/*
+Copies the values ending within the bytes [first, first+size) of the decompressed
+payload (storing the fields column by column) into the rows of all points.
+
+A value may start before first, its remaining bytes are still stored before data.
+*/
+void PcdImporter::scatter_payload(const uint8_t* data, size_t first, size_t size, uint8_t* rows) const
+{
+  parallel_for_ranges(size, [&](size_t, size_t begin, size_t end){
+    for(const column_t& column : columns)
+    {
+      // the number of values of the column ending at or before the given offset within the payload
+      const size_t column_offset = num_points * column.field_offset + column.byte_offset;
+      auto num_values_before = [&](size_t offset) {
+        return offset < column_offset + column.size ? 0 : glm::min(num_points, (offset - column_offset - column.size) / column.field_size + 1);
+      };
+
+      const size_t first_point = num_values_before(first + begin);
+      const size_t end_point = num_values_before(first + end);
+      if(first_point == end_point)
+        continue;
+
+      const uint8_t* s = data - ptrdiff_t(first) + ptrdiff_t(column_offset + first_point * column.field_size);
+      uint8_t* t = rows + first_point * vertex_data_stride + column.target_offset;
+      for(size_t i=first_point; i<end_point; ++i, s+=column.field_size, t+=vertex_data_stride)
+        std::memcpy(t, s, column.size);
+    }
+  });
+}
+
+void PcdImporter::import_binary(const pcd_format::header_t& header)
+{
+  std::ifstream stream(input_file, std::ios_base::in | std::ios_base::binary);
+  stream.seekg(header.body_offset);
+  if(!stream)
+    throw QString("Incomplete file!");
+
+  const size_t points_per_block = glm::max<size_t>(1, (size_t(1) << 24) / file_stride);
+
+  std::vector<uint8_t> file_rows;
+  if(!file_rows_are_user_data)
+    file_rows.resize(glm::min(points_per_block, num_points) * file_stride);
+
+  while(num_loaded_points < num_points)
+  {
+    const size_t num_block_points = glm::min(points_per_block, num_points - num_loaded_points);
+    const std::streamsize num_bytes = std::streamsize(num_block_points * file_stride);
+
+    uint8_t* rows = begin_block(num_block_points);
+
+    stream.read(reinterpret_cast<char*>(file_rows_are_user_data ? rows : file_rows.data()), num_bytes);
+    if(stream.gcount() != num_bytes)
+      throw QString("Incomplete file!");
+
+    if(!file_rows_are_user_data)
+      scatter_columns(file_rows.data(), num_block_points, rows);
+
+    end_block(num_block_points);
+  }
+}
+
+void PcdImporter::import_binary_compressed(const pcd_format::header_t& header)
+{
+  std::ifstream stream(input_file, std::ios_base::in | std::ios_base::binary);
+  stream.seekg(header.body_offset);
+
+  uint32_t sizes[2];
+  stream.read(reinterpret_cast<char*>(sizes), sizeof(sizes));
+  if(!stream)
+    throw QString("Incomplete file!");
+
+  const size_t compressed_size = sizes[0];
+  const size_t uncompressed_size = sizes[1];
+
+  if(uncompressed_size != num_points * file_stride)
+    throw QString("Invalid size of the compressed data!");
+
+  std::vector<uint8_t> compressed(compressed_size);
+  stream.read(reinterpret_cast<char*>(compressed.data()), std::streamsize(compressed_size));
+  if(stream.gcount() != std::streamsize(compressed_size))
+    throw QString("Incomplete file!");
+
+  // The fields are stored column by column, so no point is complete before the whole payload is decompressed.
+  // Without sampling the payload is scattered directly into the user data, otherwise into a temporary copy of all rows
+  std::vector<uint8_t> sampled_rows;
+  if(sampler)
+    sampled_rows.resize(num_points * vertex_data_stride);
+  uint8_t* const rows = sampler ? sampled_rows.data() : pointcloud.user_data.data();
+
+  const bool decompressed = pcd_format::decompress_lzf(compressed.data(), compressed_size, uncompressed_size, size_t(1) << 24, [this, rows](const uint8_t* data, size_t first, size_t size){
+    scatter_payload(data, first, size, rows);
+  });
+  if(!decompressed)
+    throw QString("Corrupt compressed data!");
+
+  compressed = std::vector<uint8_t>();
+
+  const size_t points_per_block = glm::max<size_t>(1, (size_t(1) << 24) / file_stride);
+
+  while(num_loaded_points < num_points)
+  {
+    const size_t num_block_points = glm::min(points_per_block, num_points - num_loaded_points);
+
+    uint8_t* block = begin_block(num_block_points);
+    if(sampler)
+      std::memcpy(block, rows + num_loaded_points * vertex_data_stride, num_block_points * vertex_data_stride);
+
+    end_block(num_block_points);
+  }
+}
+
+/*
+Parses the points of ascii files on all cores.
+
+Each point is stored in its own line, so the body is read in large blocks,
+whose complete lines are parsed in parallel into binary points and then
+scattered into the rows of the user data.
+*/
+void PcdImporter::import_ascii(const pcd_format::header_t& header)
+{
+  std::ifstream stream(input_file, std::ios_base::in | std::ios_base::binary);
+  stream.seekg(header.body_offset);
+  if(!stream)
+    throw QString("Incomplete file!");
+
+  std::vector<char> block(size_t(1) << 24);
+  std::vector<const char*> line_begin;
+  std::vector<const char*> line_end;
+  std::vector<uint8_t> file_rows;
+
+  size_t num_remaining_bytes = 0;
+
+  while(num_loaded_points < num_points)
+  {
+    if(num_remaining_bytes == block.size())
+      block.resize(block.size() * 2);
+
+    stream.read(block.data() + num_remaining_bytes, std::streamsize(block.size() - num_remaining_bytes));
+    const size_t num_bytes = num_remaining_bytes + size_t(stream.gcount());
+    const bool end_of_file = num_bytes < block.size();
+
+    const char* const block_end = block.data() + num_bytes;
+
+    // Only process complete lines. The incomplete last line will be processed together with the next block
+    line_begin.clear();
+    line_end.clear();
+    const char* begin = block.data();
+    while(line_begin.size() < num_points - num_loaded_points && begin != block_end)
+    {
+      const char* end = static_cast<const char*>(std::memchr(begin, '\n', size_t(block_end - begin)));
+      if(end == nullptr && !end_of_file)
+        break;
+      if(end == nullptr)
+        end = block_end;
+
+      // blank lines don't contain a point
+      if(!ascii_values::is_blank_line(begin, end))
+      {
+        line_begin.push_back(begin);
+        line_end.push_back(end);
+      }
+      begin = end == block_end ? end : end + 1;
+    }
+
+    const size_t num_block_points = line_begin.size();
+
+    // Either the block contains only blank lines or the line doesn't fit into the block
+    if(num_block_points == 0)
+    {
+      if(end_of_file)
+        throw QString("Incomplete file!");
+      num_remaining_bytes = size_t(block_end - begin);
+      std::memmove(block.data(), begin, num_remaining_bytes);
+      continue;
+    }
+
+    file_rows.resize(num_block_points * file_stride);
+    parallel_for_ranges(num_block_points, [&](size_t, size_t first, size_t last){
+      for(size_t i=first; i<last; ++i)
+        if(Q_UNLIKELY(!parse_ascii_point(line_begin[i], line_end[i], file_rows.data() + i*file_stride)))
+          throw QString("Invalid point %0").arg(num_loaded_points + i);
+    });
+
+    scatter_columns(file_rows.data(), num_block_points, begin_block(num_block_points));
+    end_block(num_block_points);
+
+    num_remaining_bytes = size_t(block_end - begin);
+    std::memmove(block.data(), begin, num_remaining_bytes);
+  }
+}
+
+// Parses a line of an ascii file into a binary point
+bool PcdImporter::parse_ascii_point(const char* begin, const char* end, uint8_t* row) const
+{
+  for(int i=0; i<value_types.length(); ++i)
+  {
+    const char* value_end = nullptr;
+
+    // The point cloud library writes packed colors as integers, although their type is float
+    if(value_is_packed_color[i])
+      value_end = ascii_values::parse_value(begin, end, data_type::BASE_TYPE::UINT32, row);
+    if(value_end == nullptr)
+      value_end = ascii_values::parse_value(begin, end, value_types[i], row);
+
+    if(Q_UNLIKELY(value_end == nullptr))
+      return false;
+
+    begin = value_end;
+    row += data_type::size_of_type(value_types[i]);
+  }
+
+  while(begin!=end && (*begin==' ' || *begin=='\t' || *begin=='\r'))
+    ++begin;
+  return begin == end;
+}
@@ -0,0 +1,77 @@
+#ifndef POINTCLOUD_WORKERS_IMPORTER_PCD_HPP_
+#define POINTCLOUD_WORKERS_IMPORTER_PCD_HPP_
+
+#include <pointcloud/importer/abstract_importer.hpp>
+#include <pointcloud/importer/vertex_decoder.hpp>
+#include <pointcloud/pcd_file_format.hpp>
+
+#include <QVector>
+
+#include <memory>
+
+/**
+Implementation for loading pcd files of the point cloud library
+
+Each value of the fields is stored as column of the user data. Fields with
+more than one value per point get one column per value (name_0, name_1, ...),
+padding fields (named "_") are skipped and packed rgb/rgba fields are split
+into red/green/blue(/alpha) columns, so the vertex colors are decoded like for
+ply files.
+
+Binary files are read block by block. The payload of binary_compressed files
+is decompressed through a small window, whose columns are scattered into the
+rows of the user data on all cores, so the decompressed payload is never
+stored as a whole. Ascii files are parsed on all cores block by block.
+*/
+class PcdImporter final : public AbstractPointCloudImporter
+{
+public:
+  PcdImporter(const std::string& input_file);
+
+  bool read_format(size_t* num_points) override;
+
+protected:
+  bool import_implementation() override;
+
+private:
+  // Copy of a single column of the user data from the file
+  struct column_t
+  {
+    size_t field_offset; // offset of the field within a binary point
+    size_t field_size; // size of all values of the field within a binary point
+    size_t byte_offset; // offset of the column within the field
+    size_t size;
+    size_t target_offset; // offset of the column within the user data
+  };
+
+  size_t num_points = 0;
+  size_t file_stride = 0;
+  size_t vertex_data_stride = 0;
+  std::vector<column_t> columns;
+  bool file_rows_are_user_data = false;
+
+  // Types of all values of a point in the order of the file, and whether the value is a packed color (only needed for ascii files)
+  QVector<data_type::base_type_t> value_types;
+  QVector<bool> value_is_packed_color;
+
+  size_t num_loaded_points = 0;
+  std::unique_ptr<VertexDecoder> decoder;
+  std::unique_ptr<PointSampler> sampler;
+  std::vector<uint8_t> sampled_user_data;
+  std::vector<PointCloud::vertex_t> sampled_vertices;
+
+  void prepare_pointcloud(const pcd_format::header_t& header);
+  void prepare_format(const pcd_format::header_t& header);
+
+  uint8_t* begin_block(size_t num_block_points);
+  void end_block(size_t num_block_points);
+  void scatter_columns(const uint8_t* file_rows, size_t num_block_points, uint8_t* rows) const;
+  void scatter_payload(const uint8_t* data, size_t first, size_t size, uint8_t* rows) const;
+
+  void import_binary(const pcd_format::header_t& header);
+  void import_binary_compressed(const pcd_format::header_t& header);
+  void import_ascii(const pcd_format::header_t& header);
+  bool parse_ascii_point(const char* begin, const char* end, uint8_t* row) const;
+};
+
+#endif // POINTCLOUD_WORKERS_IMPORTER_PCD_HPP_
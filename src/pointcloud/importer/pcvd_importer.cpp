@@ -1,12 +1,69 @@
 #include <pointcloud/importer/pcvd_importer.hpp>
+#include <pointcloud/importer/parallel_file_reader.hpp>
+#include <pointcloud/importer/vertex_decoder.hpp>
 #include <pointcloud/pcvd_file_format.hpp>
+#include <pointcloud/chunk_codec.hpp>
+#include <core_library/parallel.hpp>
+#include <core_library/print.hpp>
+
+#include <QFileInfo>
+
+#include <atomic>
+#include <cstring>
 #include <fstream>
+#include <memory>
+
+QVector<pcvd_format::chunk_description_t> read_chunk_table(std::istream& stream, const pcvd_format::header_t& header, const pcvd_format::chunks_header_t& chunks_header, bool has_vertex_data, bool has_checksums, int64_t file_size);
+QVector<pcvd_format::chunk_description_t> chunks_of_sections(const pcvd_format::header_t& header, int64_t vertex_data_offset, int64_t point_data_offset);
+bool are_contiguous(const QVector<pcvd_format::chunk_description_t>& chunks);
+void parse_field_descriptions(const pcvd_format::header_t& header, const QVector<pcvd_format::field_description_t>& field_descriptions, const std::string& joined_field_names, QVector<QString>* field_names, QVector<data_type::base_type_t>* field_types, QVector<size_t>* field_data_offset);
+bool decode_chunk_data(const pcvd_format::chunk_description_t& chunk, const uint8_t* encoded, size_t encoded_size, size_t stride, const QVector<chunk_codec::column_t>& columns, const QVector<chunk_codec::column_t>& quantized_columns, uint8_t* rows);
 
 PcvdImporter::PcvdImporter(const std::string& input_file)
   : AbstractPointCloudImporter(input_file)
 {
 }
 
+bool PcvdImporter::read_format(size_t* num_points)
+{
+  // The columns left in the file are only known after reading the shader
+  if(load_used_properties_only)
+    return false;
+
+  std::ifstream stream(input_file, std::ios_base::in | std::ios_base::binary);
+
+  pcvd_format::header_t header;
+  stream.read(reinterpret_cast<char*>(&header), sizeof(pcvd_format::header_t));
+  if(!stream || header.magic_number != pcvd_format::header_t::expected_macic_number() || header.downwards_compatibility_version_number > 3)
+    return false;
+  if(header.file_version_number >= 3)
+    stream.seekg(sizeof(pcvd_format::chunks_header_t), std::ios_base::cur);
+
+  QVector<pcvd_format::field_description_t> field_descriptions(header.number_fields);
+  std::string joined_field_names(header.field_names_total_size, '\0');
+  stream.read(reinterpret_cast<char*>(field_descriptions.data()), std::streamsize(sizeof(pcvd_format::field_description_t) * header.number_fields));
+  stream.read(&joined_field_names[0], std::streamsize(joined_field_names.length()));
+  if(!stream)
+    return false;
+
+  QVector<QString> field_names;
+  QVector<data_type::base_type_t> field_types;
+  QVector<size_t> field_data_offset;
+  try
+  {
+    parse_field_descriptions(header, field_descriptions, joined_field_names, &field_names, &field_types, &field_data_offset);
+  }catch(QString message)
+  {
+    println_error(message.toStdString());
+    return false;
+  }
+
+  pointcloud.set_user_data_format(header.point_data_stride, field_names, field_data_offset, field_types);
+  *num_points = header.number_points;
+
+  return true;
+}
+
 bool PcvdImporter::import_implementation()
 {
   std::streamsize read_bytes;
@@ -20,6 +77,32 @@ bool PcvdImporter::import_implementation()
     return stream.tellg() - begin;
   };
 
+  // Reads the shader section at the current stream position
+  auto read_shader = [this, &read]() {
+    QByteArray text_data;
+    pcvd_format::shader_description_t shader_description;
+
+    if(read(&shader_description, sizeof(shader_description)) != sizeof(pcvd_format::shader_description_t))
+      throw QString("Incomplete file!");
+    handle_loaded_chunk(current_progress += sizeof(pcvd_format::shader_description_t));
+
+    text_data.resize(shader_description.used_properties_length);
+    read(text_data.data(), shader_description.used_properties_length);
+    pointcloud.shader.used_properties = QString::fromUtf8(text_data).split('\n').toSet();
+
+    text_data.resize(shader_description.coordinate_expression_length);
+    read(text_data.data(), shader_description.coordinate_expression_length);
+    pointcloud.shader.coordinate_expression = QString::fromUtf8(text_data);
+
+    text_data.resize(shader_description.color_expression_length);
+    read(text_data.data(), shader_description.color_expression_length);
+    pointcloud.shader.color_expression = QString::fromUtf8(text_data);
+
+    text_data.resize(shader_description.node_data_length);
+    read(text_data.data(), shader_description.node_data_length);
+    pointcloud.shader.node_data = QString::fromUtf8(text_data);
+  };
+
   pcvd_format::header_t header;
   read_bytes = read(&header, sizeof(pcvd_format::header_t));
   if(read_bytes == 0)
@@ -34,7 +117,7 @@ bool PcvdImporter::import_implementation()
   if(read_bytes != sizeof(pcvd_format::header_t))
     throw QString("Can't load corrupt file");
 
-  if(header.downwards_compatibility_version_number > 1)
+  if(header.downwards_compatibility_version_number > 3)
     throw QString("Incompatible file format version");
 
   if(header.number_points == 0)
@@ -50,6 +133,10 @@ bool PcvdImporter::import_implementation()
     throw QString("corrupt header (invalid flags)");
   if(header.file_version_number == 1 && (header.flags&0xfff8)!=0)
     throw QString("corrupt header (invalid flags)");
+  if(header.file_version_number == 2 && (header.flags&0xfff0)!=0)
+    throw QString("corrupt header (invalid flags)");
+  if(header.file_version_number == 3 && (header.flags&0xffc0)!=0)
+    throw QString("corrupt header (invalid flags)");
   if(header.file_version_number < 1 && header.shader_data_size!=0)
     throw QString("corrupt header (invalid padding)");
   if(header.reserved!=0)
@@ -67,14 +154,31 @@ bool PcvdImporter::import_implementation()
   const bool load_vertex = header.flags & 0b10;
   const bool load_shader = header.flags & 0b100;
 
-  std::streamsize header_size = sizeof(pcvd_format::header_t);
+  // Since file version 3, the points are stored in chunks
+  const bool chunked = header.file_version_number >= 3;
+  const bool has_checksums = chunked && (header.flags & 0b10000);
+  const bool load_origin = chunked && (header.flags & 0b100000);
+  pcvd_format::chunks_header_t chunks_header;
+  if(chunked)
+  {
+    if(read(&chunks_header, sizeof(pcvd_format::chunks_header_t)) != sizeof(pcvd_format::chunks_header_t))
+      throw QString("Incomplete file!");
+    if(chunks_header.number_chunks == 0 || chunks_header.points_per_chunk == 0 || chunks_header.points_per_chunk > std::numeric_limits<uint32_t>::max())
+      throw QString("corrupt header (chunks)");
+    if(chunks_header.number_chunks > header.number_points)
+      throw QString("corrupt header (number of chunks)");
+  }
+
+  std::streamsize header_size = sizeof(pcvd_format::header_t) + (chunked ? sizeof(pcvd_format::chunks_header_t) : 0);
   std::streamsize field_headers_size = sizeof(pcvd_format::field_description_t) * header.number_fields;
   std::streamsize field_names_size = header.field_names_total_size;
+  std::streamsize origin_size = load_origin ? std::streamsize(sizeof(pcvd_format::origin_t)) : 0;
   std::streamsize vertex_data_size = std::streamsize(header.number_points * sizeof(PointCloud::vertex_t));
   std::streamsize point_data_size = std::streamsize(header.number_points * header.point_data_stride);
   std::streamsize kd_tree_size = load_kd_tree ? std::streamsize(header.number_points * sizeof(size_t)) : 0;
   std::streamsize shader_size = load_shader ? std::streamsize(sizeof(pcvd_format::shader_description_t) + header.shader_data_size) : 0;
-  total_progress = header_size + field_headers_size + field_names_size + vertex_data_size + point_data_size + kd_tree_size + shader_size;
+  std::streamsize chunk_table_size = chunked ? std::streamsize(chunks_header.number_chunks * sizeof(pcvd_format::chunk_description_t)) : 0;
+  total_progress = header_size + field_headers_size + field_names_size + origin_size + vertex_data_size + point_data_size + kd_tree_size + shader_size + chunk_table_size;
 
   handle_loaded_chunk(current_progress += header_size);
 
@@ -92,64 +196,266 @@ bool PcvdImporter::import_implementation()
   QVector<QString> field_names;
   QVector<data_type::base_type_t> field_types;
   QVector<size_t> field_data_offset;
-  field_names.reserve(header.number_fields);
-  field_types.reserve(header.number_fields);
-  field_data_offset.reserve(header.number_fields);
-  uint16_t fields_total_stride = 0;
-  uint16_t fields_total_name_length = 0;
-  for(int i=0; i<header.number_fields; ++i)
-  {
-    const uint16_t begin_name = fields_total_name_length;
-    const uint16_t end_name = begin_name + field_descriptions[i].name_length;
+  parse_field_descriptions(header, field_descriptions, joined_field_names, &field_names, &field_types, &field_data_offset);
 
-    if(begin_name == end_name)
-      throw QString("Corrupt property! (empty name)");
-    if(end_name > joined_field_names.length())
-      throw QString("Corrupt property! (buffer overflow)");
+  pointcloud.aabb = header.aabb;
+  pointcloud.user_data_stride = header.point_data_stride;
+  pointcloud.user_data_names = field_names;
+  pointcloud.user_data_offset = field_data_offset;
+  pointcloud.user_data_types = field_types;
+  pointcloud.num_points = header.number_points;
+  pointcloud.is_valid = true;
 
-    const data_type::base_type_t base_type = field_descriptions[i].type;
-    const QString name = QString::fromStdString(std::string(joined_field_names.data() + begin_name, joined_field_names.data() + end_name));
+  handle_loaded_chunk(current_progress += field_headers_size + field_names_size);
 
-    if(!data_type::is_valid(base_type))
-      throw QString("Corrupt property! (invalid type)");
+  if(load_origin)
+  {
+    pcvd_format::origin_t origin;
+    if(read(&origin, origin_size) != origin_size)
+      throw QString("Incomplete file!");
+    pointcloud.origin = glm::dvec3(origin.x, origin.y, origin.z);
+    if(glm::any(glm::isnan(pointcloud.origin)) || glm::any(glm::isinf(pointcloud.origin)))
+      throw QString("corrupt file (invalid origin)");
+    handle_loaded_chunk(current_progress += origin_size);
+  }
 
-    field_names << name;
-    field_types << base_type;
-    field_data_offset << fields_total_stride;
+  // Files before version 3 are handled like files with chunks stored directly after each other
+  QVector<pcvd_format::chunk_description_t> chunks;
+  int64_t kd_tree_offset;
+  int64_t shader_offset;
+  if(chunked)
+  {
+    shader_offset = int64_t(stream.tellg());
+    kd_tree_offset = chunks_header.kd_tree_offset;
 
-    fields_total_stride += data_type::size_of_type(base_type);
-    fields_total_name_length += field_descriptions[i].name_length;
+    stream.seekg(chunks_header.chunk_table_offset);
+    chunks = read_chunk_table(stream, header, chunks_header, load_vertex, has_checksums, QFileInfo(QString::fromStdString(input_file)).size());
+    handle_loaded_chunk(current_progress += chunk_table_size);
+  }else
+  {
+    const int64_t vertex_data_offset = pcvd_format::section_offset(int64_t(stream.tellg()), header.flags);
+    const int64_t point_data_offset = pcvd_format::section_offset(load_vertex ? vertex_data_offset + vertex_data_size : vertex_data_offset, header.flags);
+    kd_tree_offset = pcvd_format::section_offset(point_data_offset + point_data_size, header.flags);
+    shader_offset = load_kd_tree ? kd_tree_offset + kd_tree_size : point_data_offset + point_data_size;
+
+    chunks = chunks_of_sections(header, load_vertex ? vertex_data_offset : 0, point_data_offset);
   }
 
-  if(fields_total_stride != header.point_data_stride)
-    throw QString("Corrupt header! (point data stride mismatch)");
-  if(fields_total_name_length != header.field_names_total_size)
-    throw QString("Corrupt header! (field names length mismatch)");
+  file_flags = header.flags;
+  file_points_per_chunk = chunked ? size_t(chunks_header.points_per_chunk) : 0;
 
-  pointcloud.aabb = header.aabb;
-  pointcloud.user_data_stride = header.point_data_stride;
-  pointcloud.user_data_names = field_names;
-  pointcloud.user_data_offset = field_data_offset;
-  pointcloud.user_data_types = field_types;
-  pointcloud.resize(header.number_points);
+  const pcvd_format::chunk_description_t* quantized_chunk = nullptr;
+  for(const pcvd_format::chunk_description_t& chunk : chunks)
+  {
+    const bool quantized = chunk.encoding == pcvd_format::ENCODING::QUANTIZED || chunk.encoding == pcvd_format::ENCODING::QUANTIZED_DELTA_BIT_PACKING;
+    if(quantized && quantized_chunk == nullptr)
+      quantized_chunk = &chunk;
 
-  handle_loaded_chunk(current_progress += field_headers_size + field_names_size);
+    has_encoded_chunks = has_encoded_chunks || chunk.encoding != pcvd_format::ENCODING::RAW;
+    has_compressed_chunks = has_compressed_chunks || chunk.encoding == pcvd_format::ENCODING::DELTA_BIT_PACKING || chunk.encoding == pcvd_format::ENCODING::QUANTIZED_DELTA_BIT_PACKING;
+  }
 
-  if(load_vertex)
+  // The precision is stored in front of the quantized coordinates of each quantized chunk
+  QVector<chunk_codec::column_t> quantized_columns;
+  if(quantized_chunk != nullptr && (load_vertex || chunk_codec::user_data_columns_for_quantization(field_names, field_data_offset, field_types, &quantized_columns)))
   {
-    read_bytes = read(pointcloud.coordinate_color.data(), vertex_data_size);
-    if(read_bytes != vertex_data_size)
+    const std::streampos position = stream.tellg();
+
+    chunk_codec::quantization_t quantization;
+    stream.seekg(load_vertex ? quantized_chunk->vertex_data_offset : quantized_chunk->point_data_offset);
+    if(read(&quantization, sizeof(chunk_codec::quantization_t)) != sizeof(chunk_codec::quantization_t))
       throw QString("Incomplete file!");
-    handle_loaded_chunk(current_progress += vertex_data_size);
+    quantization_precision = quantization.precision;
+
+    stream.seekg(position);
   }
 
-  read_bytes = read(pointcloud.user_data.data(), point_data_size);
-  if(read_bytes != point_data_size)
-    throw QString("Incomplete file!");
-  handle_loaded_chunk(current_progress += point_data_size);
+  if(verify_only)
+  {
+    if(!has_checksums)
+      throw QString("The file contains no checksums");
+    verify_chunks(chunks);
+    pointcloud.is_valid = false; // nothing was loaded
+    return true;
+  }
+
+  // Contiguous chunks are loaded like a single section, so they can be mapped
+  const bool verify = verify_checksums && has_checksums;
+  const bool contiguous = are_contiguous(chunks);
+
+  // A sample of the points is streamed through the PointSampler. The kd tree can't be used for the sample
+  if(sampling.is_active())
+  {
+    read_sampled_points(chunks, load_vertex, verify);
+    handle_loaded_chunk(current_progress += vertex_data_size + point_data_size + kd_tree_size);
+
+    stream.seekg(shader_offset);
+    if(load_shader)
+      read_shader();
+
+    return true;
+  }
+
+  // The shader is stored behind all other sections, but its used properties decide, which columns to load
+  bool shader_already_loaded = false;
+  QSet<QString> used_properties = {"x", "y", "z", "red", "green", "blue"};
+  if(load_used_properties_only && load_shader)
+  {
+    const std::streampos position = stream.tellg();
+
+    stream.seekg(shader_offset);
+    read_shader();
+    stream.seekg(position);
+
+    shader_already_loaded = true;
+    used_properties.unite(pointcloud.shader.used_properties);
+  }
+
+  // Deferred columns are read from the rows of a single section later, so they need contiguous chunks
+  QVector<int> loaded_columns;
+  for(int i=0; i<header.number_fields; ++i)
+    if(!load_used_properties_only || !contiguous || used_properties.contains(field_names[i]))
+      loaded_columns << i;
+  const bool load_all_columns = loaded_columns.length() == header.number_fields;
+
+  if(!load_all_columns)
+  {
+    PointCloud::DeferredColumns& deferred_columns = pointcloud.deferred_columns;
+    deferred_columns.filename = input_file;
+    deferred_columns.stride = header.point_data_stride;
+
+    size_t stride = 0;
+    QVector<QString> names;
+    QVector<size_t> offset;
+    QVector<data_type::base_type_t> types;
+    for(int i=0; i<header.number_fields; ++i)
+    {
+      if(loaded_columns.contains(i))
+      {
+        names << field_names[i];
+        offset << stride;
+        types << field_types[i];
+        stride += data_type::size_of_type(field_types[i]);
+      }else
+      {
+        deferred_columns.names << field_names[i];
+        deferred_columns.offset << field_data_offset[i];
+        deferred_columns.types << field_types[i];
+      }
+    }
+    pointcloud.set_user_data_format(stride, names, offset, types);
+  }
+
+  const QString filename = QString::fromStdString(input_file);
+
+  // Tries to map the section at the current stream position and moves the stream behind the section on success
+  auto map_section = [this, &stream, &filename](Buffer& buffer, std::streamsize num_bytes, int64_t alignment) -> bool {
+    const int64_t offset = int64_t(stream.tellg());
+
+    if(read_mode != READ_MODE::MEMORY_MAPPING || offset % alignment != 0 || !buffer.map_file(filename, offset, size_t(num_bytes)))
+      return false;
+
+    stream.seekg(offset + num_bytes);
+    return true;
+  };
+
+  std::unique_ptr<ParallelFileReader> parallel_reader;
+  if(read_mode == READ_MODE::PARALLEL_READ && ParallelFileReader::is_supported())
+    parallel_reader.reset(new ParallelFileReader(input_file));
+
+  // Reads the section at the current stream position and moves the stream behind the section
+  auto read_section = [this, &stream, &read, &parallel_reader](uint8_t* target, std::streamsize num_bytes) {
+    if(parallel_reader == nullptr || !parallel_reader->is_open())
+    {
+      if(read(target, num_bytes) != num_bytes)
+        throw QString("Incomplete file!");
+      return;
+    }
+
+    // Read in slices to keep the progress bar moving and allow canceling
+    const int64_t offset = int64_t(stream.tellg());
+    const std::streamsize slice_size = std::streamsize(1) << 28;
+    for(std::streamsize slice_begin=0; slice_begin<num_bytes; slice_begin+=slice_size)
+    {
+      const std::streamsize slice_end = glm::min(num_bytes, slice_begin + slice_size);
+      if(!parallel_reader->read(offset + slice_begin, size_t(slice_end-slice_begin), target + slice_begin))
+        throw QString("Incomplete file!");
+      handle_loaded_chunk(current_progress + slice_end);
+    }
+    stream.seekg(offset + num_bytes);
+  };
+
+  // Verified sections, which are read as a whole, are read chunk by chunk instead, so each chunk is verified by the thread reading it
+  if(!contiguous || (verify && read_mode != READ_MODE::MEMORY_MAPPING && load_all_columns))
+  {
+    read_chunks(chunks, load_vertex, verify);
+    if(load_vertex)
+      publish_available_points(header.number_points);
+    handle_loaded_chunk(current_progress += vertex_data_size + point_data_size);
+  }else
+  {
+    if(load_vertex)
+    {
+      stream.seekg(chunks.first().vertex_data_offset);
+      if(!map_section(pointcloud.coordinate_color, vertex_data_size, int64_t(alignof(PointCloud::vertex_t))))
+      {
+        pointcloud.coordinate_color.resize(size_t(vertex_data_size));
+        read_section(pointcloud.coordinate_color.data(), vertex_data_size);
+      }
+      // Verified points are only shown after verifying them below, so a corrupt file never renders garbage
+      if(!verify)
+        publish_available_points(header.number_points);
+      handle_loaded_chunk(current_progress += vertex_data_size);
+    }
+
+    stream.seekg(chunks.first().point_data_offset);
+    if(!load_all_columns)
+    {
+      PointCloud::DeferredColumns& deferred_columns = pointcloud.deferred_columns;
+      deferred_columns.data_offset = int64_t(stream.tellg());
+      if(!deferred_columns.open(header.number_points))
+        throw QString("Couldn't open the file!");
+
+      // When mapping, the loaded columns are gathered from the mapping kept for the deferred columns
+      const uint8_t* mapped_rows = read_mode == READ_MODE::MEMORY_MAPPING && deferred_columns.rows != nullptr ? deferred_columns.rows->const_data() : nullptr;
+      read_columns(read_section, mapped_rows, loaded_columns, field_data_offset, field_types, header.point_data_stride);
+    }else if(!map_section(pointcloud.user_data, point_data_size, 1))
+    {
+      pointcloud.user_data.resize(size_t(point_data_size));
+      read_section(pointcloud.user_data.data(), point_data_size);
+    }
+    handle_loaded_chunk(current_progress += point_data_size);
+
+    // The mapped (or read) sections are hashed on all cores right after loading them, which reads the pages of mapped sections.
+    // Without all columns loaded, the rows of the file are verified from the mapping of the deferred columns or a temporary one.
+    if(verify)
+    {
+      const std::streamsize verified_size = (load_vertex ? vertex_data_size : 0) + point_data_size;
+      total_progress += verified_size;
+
+      const uint8_t* vertex_section = load_vertex ? pointcloud.coordinate_color.const_data() : nullptr;
+      const PointCloud::DeferredColumns& deferred_columns = pointcloud.deferred_columns;
+
+      Buffer point_section;
+      if(load_all_columns)
+        verify_loaded_chunks(chunks, vertex_section, pointcloud.user_data.const_data());
+      else if(deferred_columns.rows != nullptr)
+        verify_loaded_chunks(chunks, vertex_section, deferred_columns.rows->const_data());
+      else if(point_section.map_file(filename, chunks.first().point_data_offset, size_t(point_data_size)))
+        verify_loaded_chunks(chunks, vertex_section, point_section.const_data());
+      else
+        verify_chunks(chunks);
+      handle_loaded_chunk(current_progress += verified_size);
+
+      if(load_vertex)
+        publish_available_points(header.number_points);
+    }
+  }
 
   if(!load_vertex)
   {
+    pointcloud.coordinate_color.resize(header.number_points * PointCloud::stride);
+
     uint8_t* coordinates = pointcloud.coordinate_color.data();
 
     size_t ui_update = 0;
@@ -173,38 +479,461 @@ bool PcvdImporter::import_implementation()
 
   if(load_kd_tree)
   {
-    read_bytes = read(pointcloud.kdtree_index.alloc_for_loading(header.number_points, header.aabb), kd_tree_size);
-    if(read_bytes != kd_tree_size)
-      throw QString("Incomplete file!");
+    stream.seekg(kd_tree_offset);
+
+    const int64_t offset = int64_t(stream.tellg());
+    if(read_mode == READ_MODE::MEMORY_MAPPING && offset % int64_t(alignof(KDTreeIndex::point_index_t)) == 0 && pointcloud.kdtree_index.map_for_loading(filename, offset, header.number_points, header.aabb))
+    {
+      stream.seekg(offset + kd_tree_size);
+    }else
+    {
+      read_section(reinterpret_cast<uint8_t*>(pointcloud.kdtree_index.alloc_for_loading(header.number_points, header.aabb)), kd_tree_size);
+    }
     handle_loaded_chunk(current_progress += kd_tree_size);
   }
 
-  if(load_shader)
+  if(load_shader && !shader_already_loaded)
   {
-    QByteArray text_data;
-    pcvd_format::shader_description_t shader_description;
+    stream.seekg(shader_offset);
+    read_shader();
+  }
+
+  return true;
+}
+
+// Reads only the given columns of the point data section into the user data.
+// The columns are gathered on all cores from the mapped rows or from blocks read by read_rows at the current stream position.
+void PcvdImporter::read_columns(const std::function<void(uint8_t* target, std::streamsize num_bytes)>& read_rows, const uint8_t* mapped_rows, const QVector<int>& columns, const QVector<size_t>& file_offsets, const QVector<data_type::base_type_t>& types, size_t file_stride)
+{
+  const size_t num_points = pointcloud.num_points;
+  const size_t stride = pointcloud.user_data_stride;
+
+  pointcloud.user_data.resize(num_points * stride);
+
+  // Large blocks keep several requests of the parallel reader in flight
+  const size_t rows_per_block = glm::max<size_t>(1, (size_t(1) << 26) / file_stride);
+  std::vector<uint8_t> block(mapped_rows == nullptr ? glm::min(rows_per_block, num_points) * file_stride : 0);
+
+  const std::streamsize progress_begin = current_progress;
+
+  for(size_t first_row=0; first_row<num_points; first_row+=rows_per_block)
+  {
+    const size_t num_rows = glm::min(rows_per_block, num_points-first_row);
+
+    const uint8_t* source_rows = mapped_rows + first_row * file_stride;
+    if(mapped_rows == nullptr)
+    {
+      current_progress = progress_begin + std::streamsize(first_row * file_stride);
+      read_rows(block.data(), std::streamsize(num_rows * file_stride));
+      source_rows = block.data();
+    }
 
-    read_bytes = read(&shader_description, sizeof(shader_description));
-    if(read_bytes != sizeof(pcvd_format::shader_description_t))
+    uint8_t* target_rows = pointcloud.user_data.data() + first_row * stride;
+    parallel_for_ranges(num_rows, [&](size_t, size_t begin, size_t end){
+      for(size_t i=begin; i<end; ++i)
+      {
+        const uint8_t* source_row = source_rows + i * file_stride;
+        uint8_t* target_row = target_rows + i * stride;
+
+        for(int j=0; j<columns.length(); ++j)
+          std::memcpy(target_row + pointcloud.user_data_offset[j], source_row + file_offsets[columns[j]], data_type::size_of_type(types[columns[j]]));
+      }
+    });
+
+    handle_loaded_chunk(progress_begin + std::streamsize((first_row+num_rows) * file_stride));
+  }
+
+  current_progress = progress_begin;
+}
+
+// Reads the chunks in parallel directly into their rows of the vertices and the user data.
+// Encoded chunks are decoded (and dequantized) by the reading thread after verifying them.
+void PcvdImporter::read_chunks(const QVector<pcvd_format::chunk_description_t>& chunks, bool load_vertex, bool verify)
+{
+  const size_t num_points = pointcloud.num_points;
+  const size_t stride = pointcloud.user_data_stride;
+
+  if(load_vertex)
+    pointcloud.coordinate_color.resize(num_points * PointCloud::stride);
+  pointcloud.user_data.resize(num_points * stride);
+
+  std::vector<size_t> first_point(size_t(chunks.length()) + 1, 0);
+  for(int i=0; i<chunks.length(); ++i)
+    first_point[size_t(i)+1] = first_point[size_t(i)] + chunks[i].number_points;
+
+  const QVector<chunk_codec::column_t> vertex_columns = chunk_codec::vertex_columns();
+  const QVector<chunk_codec::column_t> user_data_columns = chunk_codec::user_data_columns(pointcloud.user_data_offset, pointcloud.user_data_types);
+  QVector<chunk_codec::column_t> quantized_user_data_columns;
+  chunk_codec::user_data_columns_for_quantization(pointcloud.user_data_names, pointcloud.user_data_offset, pointcloud.user_data_types, &quantized_user_data_columns);
+
+  const std::streamsize progress_begin = current_progress;
+  const size_t progress_per_row = stride + (load_vertex ? PointCloud::stride : 0);
+  std::atomic<int64_t> num_loaded_bytes(0);
+
+  // Each thread reads a contiguous range of chunks with its own stream
+  parallel_for_ranges(size_t(chunks.length()), [&](size_t, size_t begin, size_t end){
+    std::ifstream stream(input_file, std::ios_base::in | std::ios_base::binary);
+    std::vector<uint8_t> encoded_vertex_data;
+    std::vector<uint8_t> encoded_point_data;
+
+    // Reads the stored data of a chunk directly into the rows or into the buffer for decoding it. Returns the stored data
+    auto read_stored_data = [&stream](const pcvd_format::chunk_description_t& chunk, int64_t offset, uint64_t size, uint8_t* rows, std::vector<uint8_t>* encoded) -> const uint8_t* {
+      uint8_t* target = rows;
+      if(chunk.encoding != pcvd_format::ENCODING::RAW)
+      {
+        encoded->resize(size_t(size));
+        target = encoded->data();
+      }
+
+      stream.seekg(offset);
+      stream.read(reinterpret_cast<char*>(target), std::streamsize(size));
+      return target;
+    };
+
+    for(size_t i=begin; i<end; ++i)
+    {
+      const pcvd_format::chunk_description_t& chunk = chunks[int(i)];
+      uint8_t* vertex_rows = load_vertex ? pointcloud.coordinate_color.data() + first_point[i] * PointCloud::stride : nullptr;
+      uint8_t* user_data_rows = pointcloud.user_data.data() + first_point[i] * stride;
+
+      const uint8_t* vertex_data = load_vertex ? read_stored_data(chunk, chunk.vertex_data_offset, chunk.vertex_data_size, vertex_rows, &encoded_vertex_data) : nullptr;
+      const uint8_t* point_data = read_stored_data(chunk, chunk.point_data_offset, chunk.point_data_size, user_data_rows, &encoded_point_data);
+      if(!stream)
+        throw QString("Incomplete file!");
+
+      if(verify && pcvd_format::chunk_checksum(vertex_data, chunk.vertex_data_size, point_data, chunk.point_data_size) != chunk.checksum)
+        throw QString("Corrupt chunk %0! (checksum mismatch)").arg(i);
+
+      if(chunk.encoding != pcvd_format::ENCODING::RAW)
+      {
+        if(load_vertex && !decode_chunk_data(chunk, vertex_data, size_t(chunk.vertex_data_size), PointCloud::stride, vertex_columns, vertex_columns, vertex_rows))
+          throw QString("Corrupt chunk!");
+        if(!decode_chunk_data(chunk, point_data, size_t(chunk.point_data_size), stride, user_data_columns, quantized_user_data_columns, user_data_rows))
+          throw QString("Corrupt chunk!");
+      }
+
+      handle_loaded_chunk(progress_begin + (num_loaded_bytes += int64_t(chunk.number_points * progress_per_row)));
+    }
+  });
+}
+
+// Reads the stored data of the chunks in parallel and compares it with their checksums without decoding it
+void PcvdImporter::verify_chunks(const QVector<pcvd_format::chunk_description_t>& chunks)
+{
+  const size_t stride = pointcloud.user_data_stride;
+
+  const std::streamsize progress_begin = current_progress;
+  std::atomic<int64_t> num_verified_bytes(0);
+
+  parallel_for_ranges(size_t(chunks.length()), [&](size_t, size_t begin, size_t end){
+    std::ifstream stream(input_file, std::ios_base::in | std::ios_base::binary);
+    std::vector<uint8_t> data;
+
+    for(size_t i=begin; i<end; ++i)
+    {
+      const pcvd_format::chunk_description_t& chunk = chunks[int(i)];
+
+      data.resize(size_t(chunk.vertex_data_size + chunk.point_data_size));
+      stream.seekg(chunk.vertex_data_offset);
+      stream.read(reinterpret_cast<char*>(data.data()), std::streamsize(chunk.vertex_data_size));
+      stream.seekg(chunk.point_data_offset);
+      stream.read(reinterpret_cast<char*>(data.data() + chunk.vertex_data_size), std::streamsize(chunk.point_data_size));
+      if(!stream)
+        throw QString("Incomplete file!");
+
+      if(pcvd_format::chunk_checksum(data.data(), chunk.vertex_data_size, data.data() + chunk.vertex_data_size, chunk.point_data_size) != chunk.checksum)
+        throw QString("Corrupt chunk %0! (checksum mismatch)").arg(i);
+
+      const size_t progress_per_row = stride + (chunk.vertex_data_size != 0 ? PointCloud::stride : 0);
+      handle_loaded_chunk(progress_begin + (num_verified_bytes += int64_t(chunk.number_points * progress_per_row)));
+    }
+  });
+}
+
+// Compares the chunks of the sections loaded (or mapped) as a whole with their checksums on all cores.
+// The sections start with the data of the first chunk. Without vertex data, vertex_section is nullptr.
+void PcvdImporter::verify_loaded_chunks(const QVector<pcvd_format::chunk_description_t>& chunks, const uint8_t* vertex_section, const uint8_t* point_section)
+{
+  const size_t stride = pointcloud.user_data_stride;
+  const pcvd_format::chunk_description_t& first_chunk = chunks.first();
+
+  const std::streamsize progress_begin = current_progress;
+  std::atomic<int64_t> num_verified_bytes(0);
+
+  parallel_for_ranges(size_t(chunks.length()), [&](size_t, size_t begin, size_t end){
+    for(size_t i=begin; i<end; ++i)
+    {
+      const pcvd_format::chunk_description_t& chunk = chunks[int(i)];
+      const uint8_t* vertex_data = vertex_section != nullptr ? vertex_section + (chunk.vertex_data_offset - first_chunk.vertex_data_offset) : nullptr;
+      const uint8_t* point_data = point_section + (chunk.point_data_offset - first_chunk.point_data_offset);
+
+      if(pcvd_format::chunk_checksum(vertex_data, chunk.vertex_data_size, point_data, chunk.point_data_size) != chunk.checksum)
+        throw QString("Corrupt chunk %0! (checksum mismatch)").arg(i);
+
+      const size_t progress_per_row = stride + (vertex_section != nullptr ? PointCloud::stride : 0);
+      handle_loaded_chunk(progress_begin + (num_verified_bytes += int64_t(chunk.number_points * progress_per_row)));
+    }
+  });
+}
+
+// Streams the chunks block by block through the sampler instead of loading them completely.
+// When cropping, the chunks outside of the crop box are skipped.
+// Without stored vertices, the vertices are decoded from the user data.
+// Encoded chunks can only be decoded as a whole and verified chunks can only be verified as a whole,
+// so they are read completely before streaming their blocks.
+void PcvdImporter::read_sampled_points(const QVector<pcvd_format::chunk_description_t>& chunks, bool has_vertices, bool verify)
+{
+  const size_t num_points = pointcloud.num_points;
+  const size_t stride = pointcloud.user_data_stride;
+
+  std::ifstream stream(input_file, std::ios_base::in | std::ios_base::binary);
+
+  const VertexDecoder decoder(pointcloud);
+  PointSampler sampler(sampling, pointcloud, num_points);
+
+  const size_t rows_per_block = glm::max<size_t>(1, (size_t(1) << 24) / stride);
+  std::vector<uint8_t> user_data(rows_per_block * stride);
+  std::vector<PointCloud::vertex_t> vertices(rows_per_block);
+  std::memset(static_cast<void*>(vertices.data()), 0xff, vertices.size() * sizeof(PointCloud::vertex_t));
+  aabb_t aabb = aabb_t::invalid();
+
+  const QVector<chunk_codec::column_t> vertex_columns = chunk_codec::vertex_columns();
+  const QVector<chunk_codec::column_t> user_data_columns = chunk_codec::user_data_columns(pointcloud.user_data_offset, pointcloud.user_data_types);
+  QVector<chunk_codec::column_t> quantized_user_data_columns;
+  chunk_codec::user_data_columns_for_quantization(pointcloud.user_data_names, pointcloud.user_data_offset, pointcloud.user_data_types, &quantized_user_data_columns);
+  std::vector<uint8_t> stored_user_data;
+  std::vector<uint8_t> stored_vertices;
+  std::vector<uint8_t> decoded_user_data;
+  std::vector<uint8_t> decoded_vertices;
+
+  auto read_stored_data = [&stream](int64_t offset, uint64_t size, std::vector<uint8_t>* data) {
+    data->resize(size_t(size));
+    stream.seekg(offset);
+    stream.read(reinterpret_cast<char*>(data->data()), std::streamsize(size));
+    if(!stream)
       throw QString("Incomplete file!");
-    handle_loaded_chunk(current_progress += sizeof(pcvd_format::shader_description_t));
+  };
 
-    text_data.resize(shader_description.used_properties_length);
-    read(text_data.data(), shader_description.used_properties_length);
-    pointcloud.shader.used_properties = QString::fromUtf8(text_data).split('\n').toSet();
+  auto decode_rows = [](const pcvd_format::chunk_description_t& chunk, const std::vector<uint8_t>& stored, size_t row_stride, const QVector<chunk_codec::column_t>& columns, const QVector<chunk_codec::column_t>& quantized_columns, std::vector<uint8_t>* rows) -> const uint8_t* {
+    rows->resize(chunk.number_points * row_stride);
+    if(!decode_chunk_data(chunk, stored.data(), stored.size(), row_stride, columns, quantized_columns, rows->data()))
+      throw QString("Corrupt chunk!");
+    return rows->data();
+  };
 
-    text_data.resize(shader_description.coordinate_expression_length);
-    read(text_data.data(), shader_description.coordinate_expression_length);
-    pointcloud.shader.coordinate_expression = QString::fromUtf8(text_data);
+  const std::streamsize progress_begin = current_progress;
+  std::streamsize num_processed_bytes = 0;
+  const size_t progress_per_row = stride + (has_vertices ? sizeof(PointCloud::vertex_t) : 0);
 
-    text_data.resize(shader_description.color_expression_length);
-    read(text_data.data(), shader_description.color_expression_length);
-    pointcloud.shader.color_expression = QString::fromUtf8(text_data);
+  for(int chunk_index=0; chunk_index<chunks.length(); ++chunk_index)
+  {
+    const pcvd_format::chunk_description_t& chunk = chunks[chunk_index];
+    const size_t num_chunk_points = chunk.number_points;
 
-    text_data.resize(shader_description.node_data_length);
-    read(text_data.data(), shader_description.node_data_length);
-    pointcloud.shader.node_data = QString::fromUtf8(text_data);
+    if(sampling.crop && !chunk.aabb.intersects(sampling.crop_aabb))
+    {
+      handle_loaded_chunk(progress_begin + (num_processed_bytes += std::streamsize(num_chunk_points * progress_per_row)));
+      continue;
+    }
+
+    // The rows of chunks read as a whole are taken from memory, all other rows are read block by block
+    const uint8_t* chunk_user_data = nullptr;
+    const uint8_t* chunk_vertices = nullptr;
+
+    const bool raw = chunk.encoding == pcvd_format::ENCODING::RAW;
+    if(!raw || verify)
+    {
+      read_stored_data(chunk.point_data_offset, chunk.point_data_size, &stored_user_data);
+      if(has_vertices)
+        read_stored_data(chunk.vertex_data_offset, chunk.vertex_data_size, &stored_vertices);
+
+      if(verify && pcvd_format::chunk_checksum(stored_vertices.data(), chunk.vertex_data_size, stored_user_data.data(), chunk.point_data_size) != chunk.checksum)
+        throw QString("Corrupt chunk %0! (checksum mismatch)").arg(chunk_index);
+
+      if(raw)
+      {
+        chunk_user_data = stored_user_data.data();
+        chunk_vertices = has_vertices ? stored_vertices.data() : nullptr;
+      }else
+      {
+        chunk_user_data = decode_rows(chunk, stored_user_data, stride, user_data_columns, quantized_user_data_columns, &decoded_user_data);
+        chunk_vertices = has_vertices ? decode_rows(chunk, stored_vertices, sizeof(PointCloud::vertex_t), vertex_columns, vertex_columns, &decoded_vertices) : nullptr;
+      }
+    }
+
+    for(size_t first_row=0; first_row<num_chunk_points; first_row+=rows_per_block)
+    {
+      const size_t num_rows = glm::min(rows_per_block, num_chunk_points-first_row);
+
+      if(chunk_user_data == nullptr)
+      {
+        stream.seekg(chunk.point_data_offset + int64_t(first_row * stride));
+        stream.read(reinterpret_cast<char*>(user_data.data()), std::streamsize(num_rows * stride));
+        if(!stream)
+          throw QString("Incomplete file!");
+      }else
+      {
+        std::memcpy(user_data.data(), chunk_user_data + first_row * stride, num_rows * stride);
+      }
+
+      if(has_vertices && chunk_vertices == nullptr)
+      {
+        stream.seekg(chunk.vertex_data_offset + int64_t(first_row * sizeof(PointCloud::vertex_t)));
+        stream.read(reinterpret_cast<char*>(vertices.data()), std::streamsize(num_rows * sizeof(PointCloud::vertex_t)));
+        if(!stream)
+          throw QString("Incomplete file!");
+      }else if(has_vertices)
+      {
+        std::memcpy(static_cast<void*>(vertices.data()), chunk_vertices + first_row * sizeof(PointCloud::vertex_t), num_rows * sizeof(PointCloud::vertex_t));
+      }else
+      {
+        decoder.decode(user_data.data(), vertices.data(), num_rows, &aabb);
+      }
+
+      sampler.add_points(user_data.data(), vertices.data(), num_rows);
+
+      handle_loaded_chunk(progress_begin + (num_processed_bytes += std::streamsize(num_rows * progress_per_row)));
+    }
+  }
+
+  sampler.finish();
+}
+
+// The name, type and offset within a row of each property. Throws an error for corrupt field descriptions
+void parse_field_descriptions(const pcvd_format::header_t& header, const QVector<pcvd_format::field_description_t>& field_descriptions, const std::string& joined_field_names, QVector<QString>* field_names, QVector<data_type::base_type_t>* field_types, QVector<size_t>* field_data_offset)
+{
+  field_names->clear();
+  field_types->clear();
+  field_data_offset->clear();
+  uint16_t fields_total_stride = 0;
+  uint16_t fields_total_name_length = 0;
+  for(int i=0; i<header.number_fields; ++i)
+  {
+    const uint16_t begin_name = fields_total_name_length;
+    const uint16_t end_name = begin_name + field_descriptions[i].name_length;
+
+    if(begin_name == end_name)
+      throw QString("Corrupt property! (empty name)");
+    if(end_name > joined_field_names.length())
+      throw QString("Corrupt property! (buffer overflow)");
+
+    const data_type::base_type_t base_type = field_descriptions[i].type;
+    const QString name = QString::fromStdString(std::string(joined_field_names.data() + begin_name, joined_field_names.data() + end_name));
+
+    if(!data_type::is_valid(base_type))
+      throw QString("Corrupt property! (invalid type)");
+
+    *field_names << name;
+    *field_types << base_type;
+    *field_data_offset << fields_total_stride;
+
+    fields_total_stride += data_type::size_of_type(base_type);
+    fields_total_name_length += field_descriptions[i].name_length;
+  }
+
+  if(fields_total_stride != header.point_data_stride)
+    throw QString("Corrupt header! (point data stride mismatch)");
+  if(fields_total_name_length != header.field_names_total_size)
+    throw QString("Corrupt header! (field names length mismatch)");
+}
+
+QVector<pcvd_format::chunk_description_t> read_chunk_table(std::istream& stream, const pcvd_format::header_t& header, const pcvd_format::chunks_header_t& chunks_header, bool has_vertex_data, bool has_checksums, int64_t file_size)
+{
+  QVector<pcvd_format::chunk_description_t> chunks(int(chunks_header.number_chunks));
+
+  const std::streamsize chunk_table_size = std::streamsize(chunks_header.number_chunks * sizeof(pcvd_format::chunk_description_t));
+  stream.read(reinterpret_cast<char*>(chunks.data()), chunk_table_size);
+  if(!stream)
+    throw QString("Incomplete file!");
+
+  auto is_within_file = [file_size](int64_t offset, uint64_t size) {
+    return offset >= 0 && offset <= file_size && size <= uint64_t(file_size - offset);
+  };
+
+  uint64_t num_points = 0;
+  for(const pcvd_format::chunk_description_t& chunk : chunks)
+  {
+    const bool raw = chunk.encoding == pcvd_format::ENCODING::RAW;
+    if(uint32_t(chunk.encoding) > uint32_t(pcvd_format::ENCODING::QUANTIZED_DELTA_BIT_PACKING))
+      throw QString("Corrupt chunk table! (unknown encoding)");
+    if(!has_checksums && chunk.checksum != 0)
+      throw QString("Corrupt chunk table! (checksum without checksum flag)");
+    if(chunk.number_points == 0 || chunk.number_points > chunks_header.points_per_chunk)
+      throw QString("Corrupt chunk table! (number of points)");
+    if(raw && chunk.vertex_data_size != (has_vertex_data ? uint64_t(chunk.number_points) * sizeof(PointCloud::vertex_t) : 0))
+      throw QString("Corrupt chunk table! (vertex data size)");
+    if(raw && chunk.point_data_size != uint64_t(chunk.number_points) * header.point_data_stride)
+      throw QString("Corrupt chunk table! (point data size)");
+    if(!raw && ((chunk.vertex_data_size != 0) != has_vertex_data || chunk.point_data_size == 0))
+      throw QString("Corrupt chunk table! (encoded data size)");
+    if((has_vertex_data && !is_within_file(chunk.vertex_data_offset, chunk.vertex_data_size)) || !is_within_file(chunk.point_data_offset, chunk.point_data_size))
+      throw QString("Incomplete file!");
+
+    num_points += chunk.number_points;
   }
 
+  if(num_points != header.number_points)
+    throw QString("Corrupt chunk table! (total number of points)");
+
+  return chunks;
+}
+
+// Describes the sections of files before version 3 as chunks stored directly after each other
+QVector<pcvd_format::chunk_description_t> chunks_of_sections(const pcvd_format::header_t& header, int64_t vertex_data_offset, int64_t point_data_offset)
+{
+  const bool has_vertex_data = header.flags & 0b10;
+  const uint64_t points_per_chunk = uint64_t(1) << 30;
+
+  QVector<pcvd_format::chunk_description_t> chunks;
+  for(uint64_t first_point=0; first_point<header.number_points; first_point+=points_per_chunk)
+  {
+    pcvd_format::chunk_description_t chunk;
+    chunk.number_points = uint32_t(glm::min(points_per_chunk, header.number_points - first_point));
+    chunk.vertex_data_offset = vertex_data_offset + int64_t(first_point * sizeof(PointCloud::vertex_t));
+    chunk.point_data_offset = point_data_offset + int64_t(first_point * header.point_data_stride);
+    chunk.vertex_data_size = has_vertex_data ? uint64_t(chunk.number_points) * sizeof(PointCloud::vertex_t) : 0;
+    chunk.point_data_size = uint64_t(chunk.number_points) * header.point_data_stride;
+    chunk.encoding = pcvd_format::ENCODING::RAW;
+    chunk.aabb = header.aabb;
+    chunk.checksum = 0;
+    chunks << chunk;
+  }
+
+  return chunks;
+}
+
+// Encoded chunks are never contiguous, as they can't be read as a whole section
+bool are_contiguous(const QVector<pcvd_format::chunk_description_t>& chunks)
+{
+  for(const pcvd_format::chunk_description_t& chunk : chunks)
+    if(chunk.encoding != pcvd_format::ENCODING::RAW)
+      return false;
+
+  for(int i=1; i<chunks.length(); ++i)
+  {
+    const pcvd_format::chunk_description_t& previous = chunks[i-1];
+    if(chunks[i].vertex_data_offset != previous.vertex_data_offset + int64_t(previous.vertex_data_size) && previous.vertex_data_size != 0)
+      return false;
+    if(chunks[i].point_data_offset != previous.point_data_offset + int64_t(previous.point_data_size))
+      return false;
+  }
+
+  return true;
+}
+
+// Decodes the vertex data or the point data of a chunk, which isn't RAW. The quantized columns are empty, if the rows have no coordinates to quantize.
+bool decode_chunk_data(const pcvd_format::chunk_description_t& chunk, const uint8_t* encoded, size_t encoded_size, size_t stride, const QVector<chunk_codec::column_t>& columns, const QVector<chunk_codec::column_t>& quantized_columns, uint8_t* rows)
+{
+  const bool quantized = chunk.encoding == pcvd_format::ENCODING::QUANTIZED || chunk.encoding == pcvd_format::ENCODING::QUANTIZED_DELTA_BIT_PACKING;
+  const bool bit_packing = chunk.encoding == pcvd_format::ENCODING::DELTA_BIT_PACKING || chunk.encoding == pcvd_format::ENCODING::QUANTIZED_DELTA_BIT_PACKING;
+
+  if(quantized && !quantized_columns.isEmpty())
+    return chunk_codec::dequantize(encoded, encoded_size, stride, chunk.number_points, quantized_columns, bit_packing, rows);
+  if(bit_packing)
+    return chunk_codec::decode(encoded, encoded_size, stride, chunk.number_points, columns, rows);
+
+  if(encoded_size != chunk.number_points * stride)
+    return false;
+  std::memcpy(rows, encoded, encoded_size);
   return true;
 }
@@ -3,22 +3,83 @@
 
 #include <pointcloud/importer/abstract_importer.hpp>
 #include <pointcloud/buffer.hpp>
+#include <pointcloud/pcvd_file_format.hpp>
 
 #include <QVector>
 
+#include <functional>
+
 /**
-Implementation for loading ply files
+Implementation for loading pcvd files
+
+By default, the vertices, the user data and the kd-tree are not copied into
+memory, but mapped directly from the file (see Buffer::map_file). This makes
+opening even huge files nearly instant, as only the accessed pages are loaded.
+
+Alternatively the sections can be read with a single stream or with many
+parallel reads (see ParallelFileReader), which is faster for loading the
+whole file from a cold cache on fast drives.
+
+Files, whose chunks are not stored directly after each other, are read chunk by
+chunk on all cores instead. This includes compressed and quantized files, whose
+chunks are decoded by the thread reading them (see chunk_codec.hpp). When sampling with a
+crop box, the chunks whose aabb doesn't intersect the crop box are skipped.
+
+If the file stores checksums, each chunk is verified by the thread reading it,
+before decoding it. Therefore verified files are read chunk by chunk instead of
+section by section, unless the sections are mapped. Mapped sections (and the
+rows of deferred columns) are hashed on all cores right after mapping them,
+which reads their pages once, and their points are only published for
+rendering after passing. When sampling, each chunk which isn't skipped by the
+crop box is read as a whole and verified before sampling its points. With
+verify_only (the --verify argument), the chunks are only read and verified
+without loading the point cloud.
 */
 class PcvdImporter final : public AbstractPointCloudImporter
 {
 public:
+  enum class read_mode_t
+  {
+    MEMORY_MAPPING, // falls back to STREAM for sections, which can't be mapped
+    STREAM,
+    PARALLEL_READ, // falls back to STREAM, if not supported by the platform
+  };
+  typedef read_mode_t READ_MODE;
+
+  read_mode_t read_mode = READ_MODE::MEMORY_MAPPING;
+
+  // Only load the columns of the user data used by the stored shader (and x/y/z/red/green/blue).
+  // All other columns are left in the file as PointCloud::deferred_columns.
+  bool load_used_properties_only = false;
+
+  // Throws an error for chunks, whose data doesn't match their checksum
+  bool verify_checksums = true;
+
+  // Verifies the checksums of all chunks without loading the point cloud. Fails for files without checksums
+  bool verify_only = false;
+
+  // Set while importing: how the file is stored, so it can be written again the same way (see compact_pcvd_file)
+  uint16_t file_flags = 0; // see pcvd_format::header_t::flags
+  size_t file_points_per_chunk = 0; // zero for files before version 3
+  bool has_encoded_chunks = false; // any chunk is compressed or quantized
+  bool has_compressed_chunks = false; // any chunk is bit-packed
+  float64_t quantization_precision = 0; // of the first quantized chunk, zero without quantized chunks
+
   PcvdImporter(const std::string& input_file);
 
+  bool read_format(size_t* num_points) override;
+
 protected:
   bool import_implementation() override;
 
 private:
   std::streamsize current_progress = 0;
+
+  void read_chunks(const QVector<pcvd_format::chunk_description_t>& chunks, bool load_vertex, bool verify);
+  void verify_chunks(const QVector<pcvd_format::chunk_description_t>& chunks);
+  void verify_loaded_chunks(const QVector<pcvd_format::chunk_description_t>& chunks, const uint8_t* vertex_section, const uint8_t* point_section);
+  void read_sampled_points(const QVector<pcvd_format::chunk_description_t>& chunks, bool has_vertices, bool verify);
+  void read_columns(const std::function<void(uint8_t* target, std::streamsize num_bytes)>& read_rows, const uint8_t* mapped_rows, const QVector<int>& columns, const QVector<size_t>& file_offsets, const QVector<data_type::base_type_t>& types, size_t file_stride);
 };
 
 #endif // POINTCLOUD_WORKERS_IMPORTER_PCVD_HPP_
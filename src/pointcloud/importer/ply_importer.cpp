@@ -1,7 +1,11 @@
 #include <pointcloud/importer/ply_importer.hpp>
+#include <pointcloud/importer/vertex_decoder.hpp>
+#include <pointcloud/importer/ascii_value_parser.hpp>
+#include <pointcloud/importer/decompressing_stream.hpp>
 #include <pointcloud/convert_values.hpp>
 #include <core_library/print.hpp>
 #include <core_library/types.hpp>
+#include <core_library/parallel.hpp>
 
 #include <glm/gtx/io.hpp>
 
@@ -10,9 +14,15 @@
 #include <QAbstractEventDispatcher>
 
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
 
 typedef pcl::io::ply::ply_parser ply_parser;
 
+void check_decompression(const std::istream& stream);
+
 PlyImporter::PlyImporter(const std::string& input_file)
   : AbstractPointCloudImporter(input_file)
 {
@@ -20,6 +30,520 @@ PlyImporter::PlyImporter(const std::string& input_file)
 
 bool PlyImporter::import_implementation()
 {
+  current_progress = 0;
+
+  ply_format::header_t header;
+  if(!ply_format::read_header(input_file, &header, [this](std::size_t line, const std::string& message){print_error(format_parse_message("Error while parsing ply file", line, message));}))
+    return false;
+
+  const int vertex_element_index = header.index_of_element("vertex");
+
+  if(can_import_binary_vertices(header, vertex_element_index))
+    return import_binary_vertices(header, vertex_element_index);
+  else if(can_import_ascii_vertices(header, vertex_element_index))
+    return import_ascii_vertices(header, vertex_element_index);
+
+  // The ply_parser callbacks write directly into the complete point cloud, so the sample can only be taken afterwards
+  if(!import_with_callbacks())
+    return false;
+  if(sampling.is_active())
+    PointSampler::sample_loaded_pointcloud(pointcloud, sampling);
+  return true;
+}
+
+std::string PlyImporter::format_parse_message(const char* type, std::size_t line, const std::string& message) const
+{
+  return QString("%0 %1 in line %2:%3")
+      .arg(type)
+      .arg(QFileInfo(QString::fromStdString(input_file)).fileName())
+      .arg(line)
+      .arg(QString::fromStdString(message))
+      .toStdString();
+}
+
+bool PlyImporter::can_import_binary_vertices(const ply_format::header_t& header, int vertex_element_index) const
+{
+  if(vertex_element_index < 0)
+    return false;
+
+  const ply_format::element_t& vertex_element = header.elements[size_t(vertex_element_index)];
+
+  if(vertex_element.properties.empty() || vertex_element.has_list_properties())
+    return false;
+
+  if(header.binary_offset_of_element(vertex_element_index) < 0)
+    return false;
+
+  return header.format == ply_format::format_t::BINARY_LITTLE_ENDIAN || header.format == ply_format::format_t::BINARY_BIG_ENDIAN;
+}
+
+bool PlyImporter::read_format(size_t* num_points)
+{
+  ply_format::header_t header;
+  if(!ply_format::read_header(input_file, &header, [this](std::size_t line, const std::string& message){print_error(format_parse_message("Error while parsing ply file", line, message));}))
+    return false;
+
+  // Files parsed with the callbacks only get their format while being parsed
+  const int vertex_element_index = header.index_of_element("vertex");
+  if(!can_import_binary_vertices(header, vertex_element_index) && !can_import_ascii_vertices(header, vertex_element_index))
+    return false;
+
+  const ply_format::element_t& vertex_element = header.elements[size_t(vertex_element_index)];
+  prepare_format(vertex_element);
+  *num_points = vertex_element.count;
+
+  // The demoted types may depend on the values
+  return !projector || !projector->needs_value_ranges();
+}
+
+// Allocates the point cloud for the scalar properties of the vertex element.
+// If the projection demotes properties to types with a smaller range, their values are scanned first.
+void PlyImporter::prepare_pointcloud(const ply_format::header_t& header, int vertex_element_index)
+{
+  const ply_format::element_t& vertex_element = header.elements[size_t(vertex_element_index)];
+  const size_t num_points = vertex_element.count;
+
+  prepare_format(vertex_element);
+
+  Q_ASSERT(num_points < std::numeric_limits<int64_t>::max() / 2);
+  total_progress = int64_t(num_points);
+
+  if(projector && projector->needs_value_ranges())
+  {
+    total_progress = 2 * int64_t(num_points);
+    projector->keep_types_of_values_out_of_range(scan_value_ranges(header, vertex_element_index));
+    if(projector->is_identity())
+      projector.reset();
+
+    if(projector)
+      pointcloud.set_user_data_format(projector->stride, projector->names, projector->offsets, projector->types);
+    else
+      pointcloud.set_user_data_format(vertex_data_stride, property_names, property_offsets, property_types);
+    current_progress = int64_t(num_points);
+  }
+
+  // When sampling, the PointSampler allocates only the memory for the selected points
+  if(!sampling.is_active())
+    pointcloud.resize(num_points);
+}
+
+// The range of the values of the columns demoted to types with a smaller range
+PropertyProjection::value_ranges_t PlyImporter::scan_value_ranges(const ply_format::header_t& header, int vertex_element_index)
+{
+  const size_t num_points = header.elements[size_t(vertex_element_index)].count;
+
+  PropertyProjection::value_ranges_t ranges;
+  std::vector<uint8_t> file_rows;
+
+  if(header.format != ply_format::format_t::ASCII)
+  {
+    std::unique_ptr<std::istream> stream_ptr = DecompressingStream::open(input_file);
+    std::istream& stream = *stream_ptr;
+    stream.seekg(header.binary_offset_of_element(vertex_element_index));
+    if(!stream)
+      throw QString("Incomplete file!");
+
+    const size_t points_per_block = glm::max<size_t>(1, (size_t(1) << 24) / vertex_data_stride);
+    const bool swap_bytes = (header.format == ply_format::format_t::BINARY_BIG_ENDIAN) != (Q_BYTE_ORDER == Q_BIG_ENDIAN);
+    file_rows.resize(glm::min(points_per_block, num_points) * vertex_data_stride);
+
+    for(size_t first_point=0; first_point<num_points; first_point+=points_per_block)
+    {
+      const size_t block_size = glm::min(points_per_block, num_points-first_point);
+      const std::streamsize num_bytes = std::streamsize(block_size * vertex_data_stride);
+
+      stream.read(reinterpret_cast<char*>(file_rows.data()), num_bytes);
+      check_decompression(stream);
+      if(stream.gcount() != num_bytes)
+        throw QString("Incomplete file!");
+
+      if(swap_bytes)
+        swap_byte_order_of_rows(file_rows.data(), block_size);
+
+      projector->scan_value_ranges(file_rows.data(), block_size, &ranges);
+      handle_loaded_chunk(int64_t(first_point + block_size));
+    }
+
+    return ranges;
+  }
+
+  std::vector<PropertyProjection::value_ranges_t> chunk_ranges(num_worker_threads());
+
+  parse_ascii_vertices(header, vertex_element_index, [&](size_t, size_t num_block_points) {
+    if(file_rows.size() < num_block_points * vertex_data_stride)
+      file_rows.resize(num_block_points * vertex_data_stride);
+    return file_rows.data();
+  }, [&](size_t chunk, size_t first_row, size_t num_rows) {
+    projector->scan_value_ranges(file_rows.data() + first_row*vertex_data_stride, num_rows, &chunk_ranges[chunk]);
+  }, [&](size_t first_point, size_t num_block_points) {
+    handle_loaded_chunk(int64_t(first_point + num_block_points));
+  });
+
+  for(const PropertyProjection::value_ranges_t& ranges_of_chunk : chunk_ranges)
+  {
+    if(ranges.isEmpty())
+      ranges = ranges_of_chunk;
+    else
+      for(int i=0; i<ranges_of_chunk.length(); ++i)
+        ranges[i].extend(ranges_of_chunk[i]);
+  }
+
+  return ranges;
+}
+
+// The layout of the scalar properties of the given vertex element within the file and within the user data
+void PlyImporter::prepare_format(const ply_format::element_t& vertex_element)
+{
+  vertex_data_stride = 0;
+  property_names.clear();
+  property_offsets.clear();
+  property_types.clear();
+  for(const ply_format::property_t& property : vertex_element.properties)
+  {
+    property_names.append(QString::fromStdString(property.name));
+    property_offsets.append(vertex_data_stride);
+    property_types.append(property.type);
+    vertex_data_stride += data_type::size_of_type(property.type);
+  }
+
+  projector.reset();
+  if(projection.is_active())
+  {
+    projector.reset(new PropertyProjection(projection, vertex_data_stride, property_names, property_offsets, property_types));
+    if(projector->is_identity())
+      projector.reset();
+  }
+
+  pointcloud.aabb = aabb_t::invalid();
+  if(projector)
+    pointcloud.set_user_data_format(projector->stride, projector->names, projector->offsets, projector->types);
+  else
+    pointcloud.set_user_data_format(vertex_data_stride, property_names, property_offsets, property_types);
+}
+
+bool PlyImporter::can_import_ascii_vertices(const ply_format::header_t& header, int vertex_element_index) const
+{
+  if(vertex_element_index < 0)
+    return false;
+
+  const ply_format::element_t& vertex_element = header.elements[size_t(vertex_element_index)];
+
+  if(vertex_element.properties.empty() || vertex_element.has_list_properties())
+    return false;
+
+  return header.format == ply_format::format_t::ASCII && header.body_offset >= 0;
+}
+
+// Reads the vertex element block by block directly into the user data and decodes the coordinates and colors from there.
+// If the byte order of the file differs from the machine, the values of each block are swapped in place first.
+// With a projection, the blocks are read into a temporary buffer and projected into the user data.
+bool PlyImporter::import_binary_vertices(const ply_format::header_t& header, int vertex_element_index)
+{
+  const size_t num_points = header.elements[size_t(vertex_element_index)].count;
+
+  prepare_pointcloud(header, vertex_element_index);
+
+  std::unique_ptr<std::istream> stream_ptr = DecompressingStream::open(input_file);
+  std::istream& stream = *stream_ptr;
+  stream.seekg(header.binary_offset_of_element(vertex_element_index));
+  if(!stream)
+    throw QString("Incomplete file!");
+
+  const VertexDecoder decoder(vertex_data_stride, property_names, property_offsets, property_types);
+  const size_t points_per_block = glm::max<size_t>(1, (size_t(1) << 24) / vertex_data_stride);
+
+  const bool big_endian_file = header.format == ply_format::format_t::BINARY_BIG_ENDIAN;
+  const bool swap_bytes = big_endian_file != (Q_BYTE_ORDER == Q_BIG_ENDIAN);
+
+  const size_t user_data_stride = pointcloud.user_data_stride;
+  uint8_t* user_data = pointcloud.user_data.data();
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(pointcloud.coordinate_color.data());
+
+  std::vector<uint8_t> file_rows;
+  if(projector)
+    file_rows.resize(points_per_block * vertex_data_stride);
+
+  // When sampling, each block is decoded into a temporary buffer and passed to the sampler
+  std::unique_ptr<PointSampler> sampler;
+  std::vector<uint8_t> sampled_user_data;
+  std::vector<PointCloud::vertex_t> sampled_vertices;
+  if(sampling.is_active())
+  {
+    sampler.reset(new PointSampler(sampling, pointcloud, num_points));
+    sampled_user_data.resize(points_per_block * user_data_stride);
+    sampled_vertices.resize(points_per_block);
+    std::memset(static_cast<void*>(sampled_vertices.data()), 0xff, sampled_vertices.size() * sizeof(PointCloud::vertex_t));
+  }
+
+  for(size_t first_point=0; first_point<num_points; first_point+=points_per_block)
+  {
+    const size_t block_size = glm::min(points_per_block, num_points-first_point);
+    const std::streamsize num_bytes = std::streamsize(block_size * vertex_data_stride);
+    uint8_t* block = sampler ? sampled_user_data.data() : user_data + first_point * user_data_stride;
+    uint8_t* block_rows = projector ? file_rows.data() : block;
+    PointCloud::vertex_t* block_vertices = sampler ? sampled_vertices.data() : vertices + first_point;
+
+    stream.read(reinterpret_cast<char*>(block_rows), num_bytes);
+    check_decompression(stream);
+    if(stream.gcount() != num_bytes)
+      throw QString("Incomplete file!");
+
+    if(swap_bytes)
+      swap_byte_order_of_rows(block_rows, block_size);
+
+    decoder.decode(block_rows, block_vertices, block_size, &pointcloud.aabb);
+
+    if(projector)
+      projector->project(block_rows, block_size, block);
+
+    if(sampler)
+      sampler->add_points(block, block_vertices, block_size);
+    else
+      publish_available_points(first_point + block_size);
+    handle_loaded_chunk(current_progress += int64_t(block_size));
+  }
+
+  if(sampler)
+    sampler->finish();
+
+  return true;
+}
+
+// Swaps the byte order of the values of the given rows (with the layout of the file) in place
+void PlyImporter::swap_byte_order_of_rows(uint8_t* rows, size_t num_rows) const
+{
+  // If all properties have the same size, the rows are just one contiguous array of values
+  size_t common_value_size = data_type::size_of_type(property_types.first());
+  for(data_type::base_type_t type : property_types)
+    if(data_type::size_of_type(type) != common_value_size)
+      common_value_size = 0;
+
+  if(common_value_size != 0)
+  {
+    swap_byte_order(rows, common_value_size, common_value_size, num_rows * vertex_data_stride / common_value_size);
+    return;
+  }
+
+  for(int i=0; i<property_types.length(); ++i)
+  {
+    const size_t value_size = data_type::size_of_type(property_types[i]);
+    swap_byte_order(rows + property_offsets[i], value_size, vertex_data_stride, num_rows);
+  }
+}
+
+// Parses the vertex element of an ascii file into the rows of the user data and decodes the vertices (see parse_ascii_vertices).
+// With a projection, the chunks are parsed into a temporary buffer and projected into the user data.
+bool PlyImporter::import_ascii_vertices(const ply_format::header_t& header, int vertex_element_index)
+{
+  const size_t num_points = header.elements[size_t(vertex_element_index)].count;
+
+  prepare_pointcloud(header, vertex_element_index);
+
+  const VertexDecoder decoder(vertex_data_stride, property_names, property_offsets, property_types);
+
+  const size_t user_data_stride = pointcloud.user_data_stride;
+  uint8_t* user_data = pointcloud.user_data.data();
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(pointcloud.coordinate_color.data());
+
+  std::vector<uint8_t> file_rows;
+
+  // When sampling, each block is parsed into a temporary buffer and passed to the sampler
+  std::unique_ptr<PointSampler> sampler;
+  std::vector<uint8_t> sampled_user_data;
+  std::vector<PointCloud::vertex_t> sampled_vertices;
+  if(sampling.is_active())
+    sampler.reset(new PointSampler(sampling, pointcloud, num_points));
+
+  std::vector<aabb_t> chunk_aabb(num_worker_threads());
+
+  // the rows, the points of the current block are parsed into
+  uint8_t* block_user_data = nullptr;
+  uint8_t* block_rows = nullptr;
+  PointCloud::vertex_t* block_vertices = nullptr;
+
+  parse_ascii_vertices(header, vertex_element_index, [&](size_t first_point, size_t num_block_points) {
+    if(!sampler)
+    {
+      block_user_data = user_data + first_point*user_data_stride;
+      block_vertices = vertices + first_point;
+    }else
+    {
+      if(sampled_vertices.size() < num_block_points)
+      {
+        sampled_user_data.resize(num_block_points * user_data_stride);
+        sampled_vertices.resize(num_block_points);
+        std::memset(static_cast<void*>(sampled_vertices.data()), 0xff, sampled_vertices.size() * sizeof(PointCloud::vertex_t));
+      }
+      block_user_data = sampled_user_data.data();
+      block_vertices = sampled_vertices.data();
+    }
+
+    // the rows with the layout of the file
+    if(projector && file_rows.size() < num_block_points * vertex_data_stride)
+      file_rows.resize(num_block_points * vertex_data_stride);
+    block_rows = projector ? file_rows.data() : block_user_data;
+    return block_rows;
+  }, [&](size_t chunk, size_t first_row, size_t num_rows) {
+    chunk_aabb[chunk] = aabb_t::invalid();
+    decoder.decode(block_rows + first_row*vertex_data_stride, block_vertices + first_row, num_rows, &chunk_aabb[chunk]);
+
+    if(projector)
+      projector->project(block_rows + first_row*vertex_data_stride, num_rows, block_user_data + first_row*user_data_stride);
+  }, [&](size_t first_point, size_t num_block_points) {
+    for(const aabb_t& aabb : chunk_aabb)
+    {
+      pointcloud.aabb.min_point = glm::min(pointcloud.aabb.min_point, aabb.min_point);
+      pointcloud.aabb.max_point = glm::max(pointcloud.aabb.max_point, aabb.max_point);
+    }
+
+    if(sampler)
+      sampler->add_points(block_user_data, block_vertices, num_block_points);
+    else
+      publish_available_points(first_point + num_block_points);
+    handle_loaded_chunk(current_progress + int64_t(first_point + num_block_points));
+  });
+
+  if(sampler)
+    sampler->finish();
+
+  return true;
+}
+
+/*
+Parses the vertex element of ascii files on all cores.
+
+Each element is stored in its own line, so the body is read in large blocks, which
+are split into newline aligned chunks, one for each thread. The rows of each chunk
+are counted first to know the index of its first vertex (blank lines are skipped). Then all chunks are parsed
+in parallel directly into their rows returned by rows_of_block for the block.
+
+handle_chunk is called by the thread of the chunk after parsing its rows (with the
+index of the chunk and of its first row within the block), handle_block after
+parsing all chunks of the block.
+*/
+void PlyImporter::parse_ascii_vertices(const ply_format::header_t& header,
+                                       int vertex_element_index,
+                                       std::function<uint8_t*(size_t first_point, size_t num_block_points)> rows_of_block,
+                                       std::function<void(size_t chunk, size_t first_row, size_t num_rows)> handle_chunk,
+                                       std::function<void(size_t first_point, size_t num_block_points)> handle_block)
+{
+  const size_t num_points = header.elements[size_t(vertex_element_index)].count;
+
+  std::unique_ptr<std::istream> stream_ptr = DecompressingStream::open(input_file);
+  std::istream& stream = *stream_ptr;
+  stream.seekg(header.body_offset);
+
+  // skip the lines of the elements stored before the vertices
+  for(int i=0; i<vertex_element_index; ++i)
+    for(size_t j=0; j<header.elements[size_t(i)].count && stream; ++j)
+      stream.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+  if(!stream)
+    throw QString("Incomplete file!");
+
+  const size_t num_threads = num_worker_threads();
+  const int64_t body_size = QFileInfo(QString::fromStdString(input_file)).size() - header.body_offset;
+  const size_t block_size = size_t(glm::clamp<int64_t>(body_size, 4096, int64_t(1) << 26));
+
+  std::vector<char> block(block_size);
+  std::vector<const char*> chunk_begin(num_threads+1);
+  std::vector<size_t> chunk_first_point(num_threads+1);
+
+  size_t num_loaded_points = 0;
+  size_t num_remaining_bytes = 0;
+
+  while(num_loaded_points < num_points)
+  {
+    if(num_remaining_bytes == block.size())
+      block.resize(block.size() * 2);
+
+    stream.read(block.data() + num_remaining_bytes, std::streamsize(block.size() - num_remaining_bytes));
+    check_decompression(stream);
+    const size_t num_bytes = num_remaining_bytes + size_t(stream.gcount());
+    const bool end_of_file = num_bytes < block.size();
+
+    const char* const block_begin = block.data();
+    const char* block_end = block_begin + num_bytes;
+
+    // Only process complete lines. The incomplete last line will be processed together with the next block
+    if(!end_of_file)
+    {
+      while(block_end!=block_begin && block_end[-1]!='\n')
+        --block_end;
+      if(block_end == block_begin)
+      {
+        num_remaining_bytes = num_bytes;
+        continue;
+      }
+    }else if(block_end == block_begin)
+    {
+      throw QString("Incomplete file!");
+    }
+
+    // split the block into newline aligned chunks
+    chunk_begin[0] = block_begin;
+    chunk_begin[num_threads] = block_end;
+    for(size_t i=1; i<num_threads; ++i)
+    {
+      const char* c = glm::max(chunk_begin[i-1], block_begin + (block_end-block_begin) * ptrdiff_t(i) / ptrdiff_t(num_threads));
+      while(c!=block_end && c!=block_begin && c[-1]!='\n')
+        ++c;
+      chunk_begin[i] = c;
+    }
+
+    // count the rows of each chunk (blank lines are skipped)
+    parallel_for_ranges(num_threads, num_threads, [&](size_t, size_t begin, size_t end){
+      for(size_t i=begin; i<end; ++i)
+        chunk_first_point[i+1] = ascii_values::count_rows(chunk_begin[i], chunk_begin[i+1]);
+    });
+
+    chunk_first_point[0] = num_loaded_points;
+    for(size_t i=0; i<num_threads; ++i)
+      chunk_first_point[i+1] = glm::min(num_points, chunk_first_point[i] + chunk_first_point[i+1]);
+
+    const size_t num_block_points = chunk_first_point[num_threads] - num_loaded_points;
+    uint8_t* block_rows = rows_of_block(num_loaded_points, num_block_points);
+
+    // parse the lines of each chunk into the precomputed rows
+    parallel_for_ranges(num_threads, num_threads, [&](size_t, size_t begin, size_t end){
+      for(size_t i=begin; i<end; ++i)
+      {
+        const char* line_begin = chunk_begin[i];
+        for(size_t point_index=chunk_first_point[i]; point_index<chunk_first_point[i+1];)
+        {
+          const char* line_end = std::find(line_begin, chunk_begin[i+1], '\n');
+
+          if(!ascii_values::is_blank_line(line_begin, line_end))
+          {
+            if(Q_UNLIKELY(!ascii_values::parse_row(line_begin, line_end, property_types, block_rows + (point_index-num_loaded_points)*vertex_data_stride)))
+              throw QString("Invalid vertex %0").arg(point_index);
+            ++point_index;
+          }
+
+          line_begin = line_end==chunk_begin[i+1] ? line_end : line_end+1;
+        }
+
+        handle_chunk(i, chunk_first_point[i] - num_loaded_points, chunk_first_point[i+1] - chunk_first_point[i]);
+      }
+    });
+
+    if(end_of_file && chunk_first_point[num_threads] < num_points)
+      throw QString("Incomplete file!");
+
+    handle_block(num_loaded_points, num_block_points);
+
+    num_loaded_points = chunk_first_point[num_threads];
+
+    num_remaining_bytes = size_t(block_begin + num_bytes - block_end);
+    std::memmove(block.data(), block_end, num_remaining_bytes);
+  }
+}
+
+bool PlyImporter::import_with_callbacks()
+{
+  // The callbacks store the projected values directly, so the layout of the file isn't needed
+  projector.reset();
+
   current_progress = 0;
   vertex_data_stride = 0;
   property_names.clear();
@@ -29,19 +553,11 @@ bool PlyImporter::import_implementation()
   ply_parser parser;
 
   // initialze logging
-  auto format_message = [this](const char* type, std::size_t line, const std::string& message) -> std::string {
-    return QString("%0 %1 in line %2:%3")
-        .arg(type)
-        .arg(QFileInfo(QString::fromStdString(input_file)).fileName())
-        .arg(line)
-        .arg(QString::fromStdString(message))
-        .toStdString();
-  };
-  parser.error_callback([format_message](std::size_t line, const std::string& message){print_error(format_message("Error while parsing ply file", line, message));});
+  parser.error_callback([this](std::size_t line, const std::string& message){print_error(format_parse_message("Error while parsing ply file", line, message));});
 
   // == you may want to add those logging functions back in if you are debugging: ==
-//  parser.warning_callback([format_message](std::size_t line, const std::string& message){println_error(format_message("Warning for ply file", line, message));});
-//  parser.info_callback([format_message](std::size_t line, const std::string& message){println(format_message("Info: ", line, message));});
+//  parser.warning_callback([this](std::size_t line, const std::string& message){println_error(format_parse_message("Warning for ply file", line, message));});
+//  parser.info_callback([this](std::size_t line, const std::string& message){println(format_parse_message("Info: ", line, message));});
 
   PointCloud::vertex_t* new_vertex_x = nullptr;
   PointCloud::vertex_t* new_vertex_y = nullptr;
@@ -101,7 +617,10 @@ bool PlyImporter::import_implementation()
   });
 
   // Actually parse the file
-  if(Q_UNLIKELY(!parser.parse(input_file)))
+  std::unique_ptr<std::istream> stream = DecompressingStream::open(input_file);
+  const bool parsed = parser.parse(*stream);
+  check_decompression(*stream);
+  if(Q_UNLIKELY(!parsed))
     return false;
 
   return true;
@@ -122,15 +641,41 @@ typename ply_parser::scalar_property_definition_callback_type<value_type>::type
     if(current_element_name != "vertex")
       return ply_parser::scalar_property_callback_type<uint8_t>::type();
 
-    const size_t offset = vertex_data_stride;
-    property_names.append(QString::fromStdString(property_name));
-    property_offsets.append(offset);
-    property_types.append(data_type::base_type_of<value_type>::value());
-    vertex_data_stride += sizeof(value_type);
-    auto data_handler = [all_data](value_type value) {
-      write_value_to_buffer(*all_data, value);
-      *all_data += sizeof(value_type);
-    };
+    const QString name = QString::fromStdString(property_name);
+    const data_type::base_type_t file_type = data_type::base_type_of<value_type>::value();
+
+    // The values can't be scanned before parsing them with the callbacks, so only demotions keeping all values are applied
+    data_type::base_type_t type = projection.type_of(name, file_type);
+    if(PropertyProjection::needs_value_range(name, file_type, type))
+      type = file_type;
+
+    std::function<void(value_type)> data_handler;
+    if(!projection.keeps(name))
+    {
+      data_handler = [](value_type) {};
+    }else if(type == file_type)
+    {
+      data_handler = [all_data](value_type value) {
+        write_value_to_buffer(*all_data, value);
+        *all_data += sizeof(value_type);
+      };
+    }else
+    {
+      const PropertyProjection::convert_function_t convert = PropertyProjection::converter(name, file_type, type);
+      const size_t size = data_type::size_of_type(type);
+      data_handler = [all_data, convert, size](value_type value) {
+        convert(reinterpret_cast<const uint8_t*>(&value), 0, *all_data, 0, 1);
+        *all_data += size;
+      };
+    }
+
+    if(projection.keeps(name))
+    {
+      property_names.append(name);
+      property_offsets.append(vertex_data_stride);
+      property_types.append(type);
+      vertex_data_stride += data_type::size_of_type(type);
+    }
 
     if(property_name == "red")
       return [new_vertex_r, data_handler](value_type value){data_handler(value);convert_component<value_type, uint8_t>::convert_normalized(&value, &((*new_vertex_r)++)->color.r);};
@@ -180,3 +725,11 @@ typename ply_parser::scalar_property_definition_callback_type<value_type>::type
     return data_handler;
   };
 };
+
+// A corrupt compressed file just ends early, so the data read so far is only valid, if the decompression didn't fail
+void check_decompression(const std::istream& stream)
+{
+  const DecompressingStream* decompressing_stream = dynamic_cast<const DecompressingStream*>(&stream);
+  if(decompressing_stream != nullptr && decompressing_stream->has_error())
+    throw QString("Couldn't decompress the file!");
+}
@@ -2,31 +2,78 @@
 #define POINTCLOUD_WORKERS_IMPORTER_PLY_HPP_
 
 #include <pointcloud/importer/abstract_importer.hpp>
+#include <pointcloud/importer/property_projection.hpp>
 #include <pointcloud/buffer.hpp>
+#include <pointcloud/ply_file_format.hpp>
 
 #include <pcl/io/ply/ply_parser.h>
 
 #include <QVector>
 
+#include <functional>
+#include <memory>
+
 /**
 Implementation for loading ply files
+
+Binary files whose vertex element consists only of scalar properties are
+decoded blockwise directly into the user data. Ascii files with such a vertex
+element are parsed in parallel, one chunk of lines per thread. All other files
+are parsed with the callbacks of the ply_parser.
+
+When sampling, the blocks are passed through the PointSampler instead of being
+stored, so only the selected points are kept in memory. Files parsed with the
+callbacks are sampled only after loading them completely.
+
+If a projection is given, the dropped properties are never stored and the
+demoted ones are stored with their smaller type (see PropertyProjection). If a
+type with a smaller range is requested, the vertex element is scanned once
+before loading it. Files parsed with the callbacks can't be scanned, so they
+only apply demotions keeping the range of the values.
 */
 class PlyImporter final : public AbstractPointCloudImporter
 {
 public:
   PlyImporter(const std::string& input_file);
 
+  // Only import some of the properties, or with smaller types
+  PropertyProjection::settings_t projection;
+
+  bool read_format(size_t* num_points) override;
+
 protected:
   bool import_implementation() override;
 
 private:
   int64_t current_progress;
 
+  std::string format_parse_message(const char* type, std::size_t line, const std::string& message) const;
+
+  void prepare_pointcloud(const ply_format::header_t& header, int vertex_element_index);
+  void prepare_format(const ply_format::element_t& vertex_element);
+  PropertyProjection::value_ranges_t scan_value_ranges(const ply_format::header_t& header, int vertex_element_index);
+
+  bool can_import_binary_vertices(const ply_format::header_t& header, int vertex_element_index) const;
+  bool import_binary_vertices(const ply_format::header_t& header, int vertex_element_index);
+  bool can_import_ascii_vertices(const ply_format::header_t& header, int vertex_element_index) const;
+  bool import_ascii_vertices(const ply_format::header_t& header, int vertex_element_index);
+  void parse_ascii_vertices(const ply_format::header_t& header,
+                            int vertex_element_index,
+                            std::function<uint8_t*(size_t first_point, size_t num_block_points)> rows_of_block,
+                            std::function<void(size_t chunk, size_t first_row, size_t num_rows)> handle_chunk,
+                            std::function<void(size_t first_point, size_t num_block_points)> handle_block);
+  void swap_byte_order_of_rows(uint8_t* rows, size_t num_rows) const;
+  bool import_with_callbacks();
+
+  // the layout of the vertex element within the file (when parsing with the callbacks, the projected layout)
   size_t vertex_data_stride;
   QVector<QString> property_names;
   QVector<size_t> property_offsets;
   QVector<data_type::base_type_t> property_types;
 
+  // null, if the rows of the file are stored as they are
+  std::unique_ptr<PropertyProjection> projector;
+
   template<typename value_type>
   typename pcl::io::ply::ply_parser::scalar_property_definition_callback_type<value_type>::type property_callback_handler(PointCloud::vertex_t** new_vertex_x,
                                                                                                                           PointCloud::vertex_t** new_vertex_y,
@@ -0,0 +1,127 @@
+#include <pointcloud/importer/point_sampler.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+bool PointSampler::settings_t::is_active() const
+{
+  return every_nth_point > 1 || max_num_points > 0 || crop;
+}
+
+PointSampler::PointSampler(const settings_t& settings, PointCloud& pointcloud, size_t num_input_points)
+  : settings(settings),
+    pointcloud(pointcloud)
+{
+  Q_ASSERT(settings.every_nth_point >= 1);
+
+  const size_t num_expected_points = (num_input_points + settings.every_nth_point - 1) / settings.every_nth_point;
+
+  // Without cropping, the number of selected points is known in advance. Otherwise start small and grow on demand
+  if(settings.max_num_points > 0)
+    reserve(glm::min(settings.max_num_points, num_expected_points));
+  else if(!settings.crop)
+    reserve(num_expected_points);
+  else
+    reserve(glm::min<size_t>(num_expected_points, 1 << 16));
+}
+
+void PointSampler::add_points(const uint8_t* user_data, const PointCloud::vertex_t* vertices, size_t num_points)
+{
+  const size_t stride = pointcloud.user_data_stride;
+
+  for(size_t i=0; i<num_points; ++i)
+  {
+    if(settings.crop && !settings.crop_aabb.contains(vertices[i].coordinate, 0.f))
+      continue;
+
+    if(num_cropped_points++ % settings.every_nth_point == 0)
+      add_candidate(user_data + i*stride, vertices[i]);
+  }
+}
+
+void PointSampler::finish()
+{
+  pointcloud.num_points = num_selected_points;
+  pointcloud.is_valid = true;
+
+  pointcloud.aabb = aabb_t::invalid();
+  for(const PointCloud::vertex_t& vertex : pointcloud)
+    pointcloud.aabb |= vertex.coordinate;
+}
+
+void PointSampler::sample_loaded_pointcloud(PointCloud& pointcloud, const settings_t& settings)
+{
+  PointCloud sample;
+  sample.set_user_data_format(pointcloud.user_data_stride, pointcloud.user_data_names, pointcloud.user_data_offset, pointcloud.user_data_types);
+  sample.shader = pointcloud.shader;
+
+  PointSampler sampler(settings, sample, pointcloud.num_points);
+  sampler.add_points(pointcloud.user_data.data(), pointcloud.begin(), pointcloud.num_points);
+  sampler.finish();
+
+  pointcloud = std::move(sample);
+}
+
+void PointSampler::add_candidate(const uint8_t* row, const PointCloud::vertex_t& vertex)
+{
+  const size_t budget = settings.max_num_points;
+
+  if(budget == 0)
+  {
+    if(num_selected_points == capacity)
+      reserve(glm::max<size_t>(1, capacity*2));
+    store(num_selected_points++, row, vertex);
+  }else if(num_candidates < budget)
+  {
+    store(num_selected_points++, row, vertex);
+    if(num_selected_points == budget)
+    {
+      reservoir_weight = std::exp(std::log(random_value()) / double(budget));
+      next_replaced_candidate = num_candidates;
+      skip_candidates();
+    }
+  }else if(num_candidates == next_replaced_candidate)
+  {
+    store(std::uniform_int_distribution<size_t>(0, budget-1)(random_engine), row, vertex);
+    reservoir_weight *= std::exp(std::log(random_value()) / double(budget));
+    skip_candidates();
+  }
+
+  ++num_candidates;
+}
+
+void PointSampler::store(size_t index, const uint8_t* row, const PointCloud::vertex_t& vertex)
+{
+  Q_ASSERT(index < capacity);
+
+  const size_t stride = pointcloud.user_data_stride;
+
+  if(stride > 0)
+    std::memcpy(pointcloud.user_data.data() + index*stride, row, stride);
+  write_value_to_buffer<PointCloud::vertex_t>(pointcloud.coordinate_color.data() + index*PointCloud::stride, vertex);
+}
+
+void PointSampler::reserve(size_t num_points)
+{
+  capacity = num_points;
+  pointcloud.user_data.resize(num_points * pointcloud.user_data_stride);
+  pointcloud.coordinate_color.resize(num_points * PointCloud::stride);
+}
+
+// Algorithm L: the number of candidates to skip until the next one replaces a random point of the reservoir is geometrically distributed
+void PointSampler::skip_candidates()
+{
+  const double num_skipped = std::floor(std::log(random_value()) / std::log1p(-reservoir_weight));
+
+  if(!(num_skipped < double(std::numeric_limits<size_t>::max() - next_replaced_candidate - 1)))
+    next_replaced_candidate = std::numeric_limits<size_t>::max();
+  else
+    next_replaced_candidate += size_t(num_skipped) + 1;
+}
+
+// uniform random value within (0, 1]
+double PointSampler::random_value()
+{
+  return 1. - std::generate_canonical<double, 53>(random_engine);
+}
@@ -0,0 +1,67 @@
+#ifndef POINTCLOUD_IMPORTER_POINT_SAMPLER_HPP_
+#define POINTCLOUD_IMPORTER_POINT_SAMPLER_HPP_
+
+#include <pointcloud/pointcloud.hpp>
+
+#include <random>
+
+/**
+Selects a subset of the points while an importer streams them in, for taking a
+quick look at huge files.
+
+The points are first cropped to the given aabb, then every nth of the remaining
+points is kept. If a budget is given, a uniform random sample of at most that
+many of those points is kept using reservoir sampling (Algorithm L), so the
+selection never needs more memory than the budget.
+
+The selected points are written directly into the user data and vertices of the
+target point cloud, whose user data format must already be set.
+*/
+class PointSampler final
+{
+public:
+  struct settings_t
+  {
+    size_t every_nth_point = 1;
+    size_t max_num_points = 0; // no budget, if 0
+    bool crop = false;
+    aabb_t crop_aabb = aabb_t::invalid();
+
+    bool is_active() const;
+  };
+
+  PointSampler(const settings_t& settings, PointCloud& pointcloud, size_t num_input_points);
+
+  PointSampler(const PointSampler&) = delete;
+  PointSampler& operator=(const PointSampler&) = delete;
+
+  // The rows of the user data must have the user data format of the target point cloud
+  void add_points(const uint8_t* user_data, const PointCloud::vertex_t* vertices, size_t num_points);
+
+  // Sets num_points, aabb and is_valid of the target point cloud
+  void finish();
+
+  // Replaces an already loaded point cloud by the sample of its points
+  static void sample_loaded_pointcloud(PointCloud& pointcloud, const settings_t& settings);
+
+private:
+  const settings_t settings;
+  PointCloud& pointcloud;
+
+  size_t capacity = 0;
+  size_t num_selected_points = 0;
+  size_t num_cropped_points = 0;
+  size_t num_candidates = 0;
+
+  std::mt19937_64 random_engine;
+  double reservoir_weight = 0;
+  size_t next_replaced_candidate = 0;
+
+  void add_candidate(const uint8_t* row, const PointCloud::vertex_t& vertex);
+  void store(size_t index, const uint8_t* row, const PointCloud::vertex_t& vertex);
+  void reserve(size_t num_points);
+  void skip_candidates();
+  double random_value();
+};
+
+#endif // POINTCLOUD_IMPORTER_POINT_SAMPLER_HPP_
@@ -0,0 +1,356 @@
+#include <pointcloud/importer/property_projection.hpp>
+#include <pointcloud/convert_values.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+typedef data_type::BASE_TYPE BASE_TYPE;
+
+namespace {
+
+template<typename t_out>
+t_out clamped(float64_t value)
+{
+  if(value != value)
+    return std::numeric_limits<t_out>::is_integer ? t_out(0) : t_out(value);
+  if(!std::numeric_limits<t_out>::is_integer && std::isinf(value))
+    return t_out(value);
+  value = std::max(float64_t(std::numeric_limits<t_out>::lowest()), std::min(float64_t(std::numeric_limits<t_out>::max()), value));
+  return std::numeric_limits<t_out>::is_integer ? t_out(std::llround(value)) : t_out(value);
+}
+
+template<typename t_in, typename t_out>
+void convert_column(const uint8_t* source, size_t source_stride, uint8_t* target, size_t target_stride, size_t num_values)
+{
+  for(size_t i=0; i<num_values; ++i)
+  {
+    if(std::is_same<t_in, t_out>::value)
+    {
+      std::memcpy(target + i*target_stride, source + i*source_stride, sizeof(t_out));
+      continue;
+    }
+
+    t_in value;
+    std::memcpy(&value, source + i*source_stride, sizeof(t_in));
+    const t_out result = clamped<t_out>(float64_t(value));
+    std::memcpy(target + i*target_stride, &result, sizeof(t_out));
+  }
+}
+
+// Maps the range of uint16 to the range of uint8 like the colors of the vertices (rounded to the nearest value)
+void rescale_color_column(const uint8_t* source, size_t source_stride, uint8_t* target, size_t target_stride, size_t num_values)
+{
+  convert_components<uint16_t, uint8_t>::convert_normalized(source, source_stride, target, target_stride, num_values);
+}
+
+template<typename t_in>
+void scan_column(const uint8_t* source, size_t source_stride, size_t num_values, PropertyProjection::value_range_t* range)
+{
+  float64_t min = range->min;
+  float64_t max = range->max;
+
+  // std::min and std::max keep the first argument, if the second one is NaN
+  for(size_t i=0; i<num_values; ++i)
+  {
+    t_in value;
+    std::memcpy(&value, source + i*source_stride, sizeof(t_in));
+    min = std::min(min, float64_t(value));
+    max = std::max(max, float64_t(value));
+  }
+
+  range->min = min;
+  range->max = max;
+}
+
+template<typename t>
+PropertyProjection::value_range_t range_of_type()
+{
+  PropertyProjection::value_range_t range;
+  range.min = float64_t(std::numeric_limits<t>::lowest());
+  range.max = float64_t(std::numeric_limits<t>::max());
+  return range;
+}
+
+PropertyProjection::value_range_t range_of_type(data_type::base_type_t type)
+{
+  switch(type)
+  {
+  case BASE_TYPE::INT8:
+    return range_of_type<int8_t>();
+  case BASE_TYPE::INT16:
+    return range_of_type<int16_t>();
+  case BASE_TYPE::INT32:
+    return range_of_type<int32_t>();
+  case BASE_TYPE::UINT8:
+    return range_of_type<uint8_t>();
+  case BASE_TYPE::UINT16:
+    return range_of_type<uint16_t>();
+  case BASE_TYPE::UINT32:
+    return range_of_type<uint32_t>();
+  case BASE_TYPE::FLOAT32:
+    return range_of_type<float32_t>();
+  case BASE_TYPE::FLOAT64:
+    return range_of_type<float64_t>();
+  }
+
+  Q_UNREACHABLE();
+  return PropertyProjection::value_range_t();
+}
+
+bool is_integer(data_type::base_type_t type)
+{
+  return type != BASE_TYPE::FLOAT32 && type != BASE_TYPE::FLOAT64;
+}
+
+// Whether all values of the range are representable by the type (after rounding them to the nearest integer)
+bool represents_range(data_type::base_type_t type, const PropertyProjection::value_range_t& range)
+{
+  const PropertyProjection::value_range_t range_of_target = range_of_type(type);
+  if(is_integer(type))
+    return range.min > range_of_target.min - 0.5 && range.max < range_of_target.max + 0.5;
+  return range.min >= range_of_target.min && range.max <= range_of_target.max;
+}
+
+PropertyProjection::scan_function_t scanner(data_type::base_type_t type)
+{
+  switch(type)
+  {
+  case BASE_TYPE::INT8:
+    return &scan_column<int8_t>;
+  case BASE_TYPE::INT16:
+    return &scan_column<int16_t>;
+  case BASE_TYPE::INT32:
+    return &scan_column<int32_t>;
+  case BASE_TYPE::UINT8:
+    return &scan_column<uint8_t>;
+  case BASE_TYPE::UINT16:
+    return &scan_column<uint16_t>;
+  case BASE_TYPE::UINT32:
+    return &scan_column<uint32_t>;
+  case BASE_TYPE::FLOAT32:
+    return &scan_column<float32_t>;
+  case BASE_TYPE::FLOAT64:
+    return &scan_column<float64_t>;
+  }
+
+  Q_UNREACHABLE();
+  return nullptr;
+}
+
+template<typename t_in>
+PropertyProjection::convert_function_t converter_from(data_type::base_type_t target_type)
+{
+  switch(target_type)
+  {
+  case BASE_TYPE::INT8:
+    return &convert_column<t_in, int8_t>;
+  case BASE_TYPE::INT16:
+    return &convert_column<t_in, int16_t>;
+  case BASE_TYPE::INT32:
+    return &convert_column<t_in, int32_t>;
+  case BASE_TYPE::UINT8:
+    return &convert_column<t_in, uint8_t>;
+  case BASE_TYPE::UINT16:
+    return &convert_column<t_in, uint16_t>;
+  case BASE_TYPE::UINT32:
+    return &convert_column<t_in, uint32_t>;
+  case BASE_TYPE::FLOAT32:
+    return &convert_column<t_in, float32_t>;
+  case BASE_TYPE::FLOAT64:
+    return &convert_column<t_in, float64_t>;
+  }
+
+  Q_UNREACHABLE();
+  return nullptr;
+}
+
+} // namespace
+
+bool PropertyProjection::settings_t::is_active() const
+{
+  return !dropped_properties.isEmpty() || !demoted_types.isEmpty() || demote_float64;
+}
+
+bool PropertyProjection::settings_t::keeps(const QString& name) const
+{
+  return is_always_kept(name) || !dropped_properties.contains(name);
+}
+
+data_type::base_type_t PropertyProjection::settings_t::type_of(const QString& name, data_type::base_type_t type) const
+{
+  if(demoted_types.contains(name))
+    return demoted_types.value(name);
+  if(demote_float64 && type == BASE_TYPE::FLOAT64)
+    return BASE_TYPE::FLOAT32;
+  return type;
+}
+
+void PropertyProjection::value_range_t::extend(const value_range_t& other)
+{
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+}
+
+PropertyProjection::PropertyProjection(const settings_t& settings, size_t source_stride, const QVector<QString>& source_names, const QVector<size_t>& source_offsets, const QVector<data_type::base_type_t>& source_types)
+  : source_stride(source_stride)
+{
+  for(int i=0; i<source_names.length(); ++i)
+  {
+    if(!settings.keeps(source_names[i]))
+    {
+      drops_columns = true;
+      continue;
+    }
+
+    column_t column;
+    column.source_offset = source_offsets[i];
+    column.source_type = source_types[i];
+    columns.append(column);
+
+    names.append(source_names[i]);
+    types.append(settings.type_of(source_names[i], source_types[i]));
+  }
+
+  update_layout();
+}
+
+// Places the projected columns one after another and chooses their conversions
+void PropertyProjection::update_layout()
+{
+  stride = 0;
+  offsets.clear();
+  identity = !drops_columns;
+
+  for(int i=0; i<columns.length(); ++i)
+  {
+    column_t& column = columns[i];
+    column.target_offset = stride;
+    column.convert = converter(names[i], column.source_type, types[i]);
+    column.scan = needs_value_range(names[i], column.source_type, types[i]) ? scanner(column.source_type) : nullptr;
+
+    identity = identity && types[i] == column.source_type && column.source_offset == column.target_offset;
+
+    offsets.append(stride);
+    stride += data_type::size_of_type(types[i]);
+  }
+
+  identity = identity && stride == source_stride;
+}
+
+bool PropertyProjection::is_identity() const
+{
+  return identity;
+}
+
+void PropertyProjection::project(const uint8_t* source_rows, size_t num_points, uint8_t* target_rows) const
+{
+  // Small tiles keep the rows in the cache while converting the columns one after another
+  const size_t tile_size = 1024;
+
+  for(size_t first_point=0; first_point<num_points; first_point+=tile_size)
+  {
+    const size_t num_tile_points = std::min(tile_size, num_points-first_point);
+    const uint8_t* source = source_rows + first_point*source_stride;
+    uint8_t* target = target_rows + first_point*stride;
+
+    for(const column_t& column : columns)
+      column.convert(source + column.source_offset, source_stride, target + column.target_offset, stride, num_tile_points);
+  }
+}
+
+bool PropertyProjection::needs_value_ranges() const
+{
+  for(const column_t& column : columns)
+    if(column.scan != nullptr)
+      return true;
+  return false;
+}
+
+void PropertyProjection::scan_value_ranges(const uint8_t* source_rows, size_t num_points, value_ranges_t* ranges) const
+{
+  if(ranges->length() != columns.length())
+    ranges->resize(columns.length());
+
+  for(int i=0; i<columns.length(); ++i)
+    if(columns[i].scan != nullptr)
+      columns[i].scan(source_rows + columns[i].source_offset, source_stride, num_points, &(*ranges)[i]);
+}
+
+void PropertyProjection::keep_types_of_values_out_of_range(const value_ranges_t& ranges)
+{
+  Q_ASSERT(ranges.length() == columns.length());
+
+  for(int i=0; i<columns.length(); ++i)
+    if(columns[i].scan != nullptr && !represents_range(types[i], ranges[i]))
+      types[i] = columns[i].source_type;
+
+  update_layout();
+}
+
+bool PropertyProjection::is_always_kept(const QString& name)
+{
+  return name=="x" || name=="y" || name=="z" || name=="red" || name=="green" || name=="blue";
+}
+
+PropertyProjection::convert_function_t PropertyProjection::converter(data_type::base_type_t source_type, data_type::base_type_t target_type)
+{
+  switch(source_type)
+  {
+  case BASE_TYPE::INT8:
+    return converter_from<int8_t>(target_type);
+  case BASE_TYPE::INT16:
+    return converter_from<int16_t>(target_type);
+  case BASE_TYPE::INT32:
+    return converter_from<int32_t>(target_type);
+  case BASE_TYPE::UINT8:
+    return converter_from<uint8_t>(target_type);
+  case BASE_TYPE::UINT16:
+    return converter_from<uint16_t>(target_type);
+  case BASE_TYPE::UINT32:
+    return converter_from<uint32_t>(target_type);
+  case BASE_TYPE::FLOAT32:
+    return converter_from<float32_t>(target_type);
+  case BASE_TYPE::FLOAT64:
+    return converter_from<float64_t>(target_type);
+  }
+
+  Q_UNREACHABLE();
+  return nullptr;
+}
+
+PropertyProjection::convert_function_t PropertyProjection::converter(const QString& name, data_type::base_type_t source_type, data_type::base_type_t target_type)
+{
+  const bool is_color = name=="red" || name=="green" || name=="blue";
+  if(is_color && source_type == BASE_TYPE::UINT16 && target_type == BASE_TYPE::UINT8)
+    return &rescale_color_column;
+  return converter(source_type, target_type);
+}
+
+bool PropertyProjection::needs_value_range(const QString& name, data_type::base_type_t source_type, data_type::base_type_t target_type)
+{
+  // Finite values beyond the range of float32 are clamped to its largest value, which doesn't justify reading the file twice
+  if(source_type == target_type || !is_integer(target_type) || converter(name, source_type, target_type) == &rescale_color_column)
+    return false;
+  return !represents_range(target_type, range_of_type(source_type));
+}
+
+bool PropertyProjection::parse_type(QString name, data_type::base_type_t* type)
+{
+  name = name.trimmed().toLower();
+  if(!name.endsWith("_t"))
+    name += "_t";
+
+  for(data_type::base_type_t candidate : {BASE_TYPE::INT8, BASE_TYPE::INT16, BASE_TYPE::INT32, BASE_TYPE::UINT8, BASE_TYPE::UINT16, BASE_TYPE::UINT32, BASE_TYPE::FLOAT32, BASE_TYPE::FLOAT64})
+  {
+    if(data_type::toString(candidate) == name)
+    {
+      *type = candidate;
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,115 @@
+#ifndef POINTCLOUD_IMPORTER_PROPERTY_PROJECTION_HPP_
+#define POINTCLOUD_IMPORTER_PROPERTY_PROJECTION_HPP_
+
+#include <pointcloud/buffer.hpp>
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include <limits>
+
+/**
+Drops properties and demotes their types while an importer streams the rows of
+a file in, so the user data is allocated with the smaller stride right away.
+
+The importer reads the rows with the layout of the file into a temporary block,
+decodes the vertices from there with the full precision and then projects the
+block into the user data. Floating point values are rounded to the nearest
+integer, when demoted to an integer type. Colors demoted from uint16 to uint8
+are rescaled to the range of uint8 instead.
+
+If a property is demoted to an integer type not representing the whole range
+of its type in the file, the importer scans the values first (see
+needs_value_ranges). Properties with values out of the range of their demoted
+type keep the type of the file, so a demotion never changes a value beyond
+rounding. Without scanning, values out of the range of a demoted type are
+clamped. Demoting float64 to float32 never needs a scan: finite values beyond
+the range of float32 are clamped to its largest value, infinities and NaN are
+kept.
+
+The coordinates and colors are always kept (but may be demoted), because the
+exporters write them from the user data.
+*/
+class PropertyProjection final
+{
+public:
+  struct settings_t
+  {
+    QSet<QString> dropped_properties;
+    QHash<QString, data_type::base_type_t> demoted_types;
+    bool demote_float64 = false; // stores all float64 properties as float32, unless given in demoted_types
+
+    bool is_active() const;
+
+    bool keeps(const QString& name) const;
+    data_type::base_type_t type_of(const QString& name, data_type::base_type_t type) const;
+  };
+
+  typedef void (*convert_function_t)(const uint8_t* source, size_t source_stride, uint8_t* target, size_t target_stride, size_t num_values);
+
+  // The smallest and the largest value of a column (NaN values are ignored)
+  struct value_range_t
+  {
+    float64_t min = std::numeric_limits<float64_t>::infinity();
+    float64_t max = -std::numeric_limits<float64_t>::infinity();
+
+    void extend(const value_range_t& other);
+  };
+  typedef QVector<value_range_t> value_ranges_t; // one for each projected column
+  typedef void (*scan_function_t)(const uint8_t* source, size_t source_stride, size_t num_values, value_range_t* range);
+
+  PropertyProjection(const settings_t& settings, size_t source_stride, const QVector<QString>& source_names, const QVector<size_t>& source_offsets, const QVector<data_type::base_type_t>& source_types);
+
+  // The user data format of the projected rows
+  size_t stride = 0;
+  QVector<QString> names;
+  QVector<size_t> offsets;
+  QVector<data_type::base_type_t> types;
+
+  // True, if the projected rows are the same as the source rows
+  bool is_identity() const;
+
+  void project(const uint8_t* source_rows, size_t num_points, uint8_t* target_rows) const;
+
+  // True, if a property is demoted to an integer type with a smaller range, so the values must be scanned before projecting them
+  bool needs_value_ranges() const;
+  // Extends the ranges of the columns demoted to a type with a smaller range by the values of the given source rows
+  void scan_value_ranges(const uint8_t* source_rows, size_t num_points, value_ranges_t* ranges) const;
+  // Keeps the type of the file for the columns with values out of the range of their demoted type
+  void keep_types_of_values_out_of_range(const value_ranges_t& ranges);
+
+  // Converts a column of values, rounding to the nearest integer and clamping the values not representable by the target type
+  static convert_function_t converter(data_type::base_type_t source_type, data_type::base_type_t target_type);
+  // Like converter, but rescales the colors demoted from uint16 to uint8
+  static convert_function_t converter(const QString& name, data_type::base_type_t source_type, data_type::base_type_t target_type);
+
+  // True, if the target is an integer type, which can't represent the whole range of the source type (and the values aren't rescaled)
+  static bool needs_value_range(const QString& name, data_type::base_type_t source_type, data_type::base_type_t target_type);
+
+  // The coordinates and colors
+  static bool is_always_kept(const QString& name);
+
+  // Accepts the names of toString with or without the "_t" suffix, for example "float32"
+  static bool parse_type(QString name, data_type::base_type_t* type);
+
+private:
+  struct column_t
+  {
+    size_t source_offset;
+    size_t target_offset;
+    data_type::base_type_t source_type;
+    convert_function_t convert;
+    scan_function_t scan; // null, if the values don't need to be scanned
+  };
+
+  size_t source_stride;
+  QVector<column_t> columns;
+  bool drops_columns = false;
+  bool identity = true;
+
+  void update_layout();
+};
+
+#endif // POINTCLOUD_IMPORTER_PROPERTY_PROJECTION_HPP_
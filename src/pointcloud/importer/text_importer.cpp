@@ -0,0 +1,431 @@
+#include <pointcloud/importer/text_importer.hpp>
+#include <pointcloud/importer/vertex_decoder.hpp>
+#include <pointcloud/importer/ascii_value_parser.hpp>
+#include <core_library/parallel.hpp>
+
+#include <QFileInfo>
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+template<typename function_t>
+void for_each_row(const char* begin, const char* end, const function_t& function);
+bool is_row(const char* begin, const char* end);
+template<typename function_t>
+void for_each_value(const char* begin, const char* end, char delimiter, const function_t& function);
+std::vector<std::string> split_values(const char* begin, const char* end, char delimiter);
+bool is_number(const char* begin, const char* end);
+bool is_integer(const char* begin, const char* end);
+int num_significant_digits(const char* begin, const char* end);
+QVector<QString> default_column_names(size_t num_columns);
+QString normalized_column_name(std::string name);
+
+TextImporter::TextImporter(const std::string& input_file)
+  : AbstractPointCloudImporter(input_file)
+{
+}
+
+bool TextImporter::import_implementation()
+{
+  const int64_t file_size = QFileInfo(QString::fromStdString(input_file)).size();
+
+  // The whole file is mapped into memory, so the chunks can be parsed without copying them
+  Buffer content;
+  if(!content.map_file(QString::fromStdString(input_file), 0, size_t(file_size)))
+  {
+    content.resize(size_t(file_size));
+    std::ifstream stream(input_file, std::ios_base::in | std::ios_base::binary);
+    stream.read(reinterpret_cast<char*>(content.data()), std::streamsize(file_size));
+    if(stream.gcount() != std::streamsize(file_size))
+      throw QString("Couldn't read the file!");
+  }
+
+  const char* const begin = reinterpret_cast<const char*>(content.data());
+  const char* const end = begin + file_size;
+  const char* const body_begin = detect_format(begin, end);
+
+  // split the body into newline aligned chunks
+  const size_t chunk_size = size_t(1) << 21;
+  std::vector<chunk_t> chunks;
+  for(const char* chunk_begin=body_begin; chunk_begin!=end;)
+  {
+    const char* chunk_end = size_t(end-chunk_begin) > chunk_size ? chunk_begin+chunk_size : end;
+    if(chunk_end != end)
+    {
+      const char* newline = static_cast<const char*>(std::memchr(chunk_end, '\n', size_t(end-chunk_end)));
+      chunk_end = newline==nullptr ? end : newline+1;
+    }
+    chunks.push_back(chunk_t{chunk_begin, chunk_end, 0, 0, aabb_t::invalid(), std::vector<column_statistics_t>(size_t(property_names.size())), 0});
+    chunk_begin = chunk_end;
+  }
+
+  // count the rows of all chunks in parallel to know the number of points and the first row of each chunk.
+  // The values are scanned at the same time, so the types of the columns can be chosen from all rows
+  parallel_for_ranges(chunks.size(), [this, &chunks](size_t, size_t first, size_t last){
+    for(size_t i=first; i<last; ++i)
+      scan_rows(&chunks[i]);
+  });
+
+  size_t num_points = 0;
+  std::vector<column_statistics_t> columns(size_t(property_names.size()));
+  for(chunk_t& chunk : chunks)
+  {
+    if(chunk.first_invalid_row != chunk.num_rows)
+      throw QString("Invalid row %0").arg(num_points + chunk.first_invalid_row + 1);
+
+    chunk.first_row = num_points;
+    num_points += chunk.num_rows;
+    for(size_t j=0; j<columns.size(); ++j)
+      columns[j].extend(chunk.columns[j]);
+  }
+
+  set_column_types(columns);
+
+  Q_ASSERT(num_points < std::numeric_limits<int64_t>::max());
+  total_progress = int64_t(num_points);
+
+  // When sampling, each group of chunks is parsed into a temporary buffer and passed to the sampler
+  std::unique_ptr<PointSampler> sampler;
+  std::vector<uint8_t> sampled_user_data;
+  std::vector<PointCloud::vertex_t> sampled_vertices;
+  if(sampling.is_active())
+    sampler.reset(new PointSampler(sampling, pointcloud, num_points));
+  else
+    pointcloud.resize(num_points);
+
+  const VertexDecoder decoder(pointcloud);
+  const size_t num_threads = num_worker_threads();
+  const size_t chunks_per_group = num_threads * 4;
+
+  for(size_t first_chunk=0; first_chunk<chunks.size(); first_chunk+=chunks_per_group)
+  {
+    const size_t end_chunk = glm::min(chunks.size(), first_chunk+chunks_per_group);
+    const size_t first_row = chunks[first_chunk].first_row;
+    const size_t num_group_rows = chunks[end_chunk-1].first_row + chunks[end_chunk-1].num_rows - first_row;
+
+    // the rows, the points of this group are parsed into
+    uint8_t* user_data;
+    PointCloud::vertex_t* vertices;
+    if(!sampler)
+    {
+      user_data = pointcloud.user_data.data() + first_row*vertex_data_stride;
+      vertices = reinterpret_cast<PointCloud::vertex_t*>(pointcloud.coordinate_color.data()) + first_row;
+    }else
+    {
+      if(sampled_vertices.size() < num_group_rows)
+      {
+        sampled_user_data.resize(num_group_rows * vertex_data_stride);
+        sampled_vertices.resize(num_group_rows);
+        std::memset(static_cast<void*>(sampled_vertices.data()), 0xff, sampled_vertices.size() * sizeof(PointCloud::vertex_t));
+      }
+      user_data = sampled_user_data.data();
+      vertices = sampled_vertices.data();
+    }
+
+    parallel_for_ranges(end_chunk-first_chunk, num_threads, [&](size_t, size_t first, size_t last){
+      for(size_t i=first_chunk+first; i<first_chunk+last; ++i)
+      {
+        chunk_t& chunk = chunks[i];
+        const size_t row = chunk.first_row - first_row;
+        parse_rows(chunk.begin, chunk.end, chunk.first_row, user_data + row*vertex_data_stride);
+        decoder.decode(user_data + row*vertex_data_stride, vertices + row, chunk.num_rows, &chunk.aabb);
+      }
+    });
+
+    for(size_t i=first_chunk; i<end_chunk; ++i)
+    {
+      pointcloud.aabb.min_point = glm::min(pointcloud.aabb.min_point, chunks[i].aabb.min_point);
+      pointcloud.aabb.max_point = glm::max(pointcloud.aabb.max_point, chunks[i].aabb.max_point);
+    }
+
+    if(sampler)
+      sampler->add_points(user_data, vertices, num_group_rows);
+    else
+      publish_available_points(first_row + num_group_rows);
+    handle_loaded_chunk(int64_t(first_row + num_group_rows));
+  }
+
+  if(sampler)
+    sampler->finish();
+
+  return true;
+}
+
+/*
+Detects the delimiter and the column names from the first lines.
+
+Returns the beginning of the first row containing a point.
+*/
+const char* TextImporter::detect_format(const char* begin, const char* end)
+{
+  // collect the first two lines, which tell whether there's a header or the number of points
+  std::vector<std::pair<const char*, const char*>> lines;
+  for(const char* line_begin=begin; line_begin!=end && lines.size()<2;)
+  {
+    const char* line_end = static_cast<const char*>(std::memchr(line_begin, '\n', size_t(end-line_begin)));
+    if(line_end == nullptr)
+      line_end = end;
+    if(is_row(line_begin, line_end))
+      lines.push_back(std::make_pair(line_begin, line_end));
+    line_begin = line_end==end ? end : line_end+1;
+  }
+
+  if(lines.empty())
+    throw QString("The file doesn't contain any points!");
+
+  const std::string first_line(lines[0].first, lines[0].second);
+  if(first_line.find(',') != std::string::npos)
+    delimiter = ',';
+  else if(first_line.find(';') != std::string::npos)
+    delimiter = ';';
+  else
+    delimiter = ' ';
+
+  const std::vector<std::string> first_values = split_values(lines[0].first, lines[0].second, delimiter);
+  const bool has_header = !std::all_of(first_values.begin(), first_values.end(), [](const std::string& value){return is_number(value.data(), value.data()+value.size());});
+
+  size_t first_data_line = 0;
+  if(has_header)
+    first_data_line = 1;
+  else if(first_values.size() == 1 && lines.size() > 1) // pts files start with the number of points
+    first_data_line = 1;
+
+  if(first_data_line >= lines.size())
+    throw QString("The file doesn't contain any points!");
+
+  const size_t num_columns = split_values(lines[first_data_line].first, lines[first_data_line].second, delimiter).size();
+  if(num_columns < 3)
+    throw QString("Expected at least three columns (x, y, z)!");
+
+  property_names.clear();
+  if(has_header)
+  {
+    if(first_values.size() != num_columns)
+      throw QString("The header has %0 columns, but the first row %1!").arg(first_values.size()).arg(num_columns);
+    for(const std::string& name : first_values)
+      property_names.append(normalized_column_name(name));
+  }else
+  {
+    property_names = default_column_names(num_columns);
+  }
+
+  return lines[first_data_line].first;
+}
+
+// Chooses the smallest types, which represent the values of all rows, and sets the format of the user data
+void TextImporter::set_column_types(const std::vector<column_statistics_t>& columns)
+{
+  vertex_data_stride = 0;
+  property_types.clear();
+  QVector<size_t> property_offsets;
+  for(size_t j=0; j<columns.size(); ++j)
+  {
+    const column_statistics_t& column = columns[j];
+    const QString& name = property_names[int(j)];
+    data_type::base_type_t type;
+
+    if(name == "red" || name == "green" || name == "blue")
+    {
+      if(column.all_integers && column.min_value >= 0 && column.max_value <= 255)
+        type = data_type::BASE_TYPE::UINT8;
+      else if(column.all_integers && column.min_value >= 0 && column.max_value <= 65535)
+        type = data_type::BASE_TYPE::UINT16;
+      else
+        type = data_type::BASE_TYPE::FLOAT32;
+    }else
+    {
+      // floats store about seven significant decimal digits
+      type = column.max_significant_digits > 7 ? data_type::BASE_TYPE::FLOAT64 : data_type::BASE_TYPE::FLOAT32;
+    }
+
+    property_types.append(type);
+    property_offsets.append(vertex_data_stride);
+    vertex_data_stride += data_type::size_of_type(type);
+  }
+
+  pointcloud.aabb = aabb_t::invalid();
+  pointcloud.set_user_data_format(vertex_data_stride, property_names, property_offsets, property_types);
+}
+
+void TextImporter::column_statistics_t::extend(const column_statistics_t& other)
+{
+  all_integers = all_integers && other.all_integers;
+  min_value = glm::min(min_value, other.min_value);
+  max_value = glm::max(max_value, other.max_value);
+  max_significant_digits = glm::max(max_significant_digits, other.max_significant_digits);
+}
+
+// Counts the rows of the chunk and collects the statistics of their columns
+void TextImporter::scan_rows(chunk_t* chunk) const
+{
+  size_t num_rows = 0;
+  size_t first_invalid_row = std::numeric_limits<size_t>::max();
+  for_each_row(chunk->begin, chunk->end, [&](const char* line_begin, const char* line_end){
+    if(!scan_row(line_begin, line_end, &chunk->columns) && first_invalid_row == std::numeric_limits<size_t>::max())
+      first_invalid_row = num_rows;
+    ++num_rows;
+  });
+
+  chunk->num_rows = num_rows;
+  chunk->first_invalid_row = glm::min(first_invalid_row, num_rows);
+}
+
+// Adds the values of the row to the statistics of the columns. Returns false, if the row doesn't have one number per column
+bool TextImporter::scan_row(const char* begin, const char* end, std::vector<column_statistics_t>* columns) const
+{
+  size_t num_values = 0;
+  bool valid = true;
+  for_each_value(begin, end, delimiter, [&](const char* value_begin, const char* value_end){
+    float64_t value;
+    if(!valid || num_values == columns->size() || ascii_values::parse_value(value_begin, value_end, data_type::BASE_TYPE::FLOAT64, reinterpret_cast<uint8_t*>(&value)) != value_end)
+    {
+      valid = false;
+      return;
+    }
+
+    column_statistics_t& column = (*columns)[num_values++];
+    column.all_integers = column.all_integers && is_integer(value_begin, value_end);
+    column.min_value = glm::min(column.min_value, value);
+    column.max_value = glm::max(column.max_value, value);
+    column.max_significant_digits = glm::max(column.max_significant_digits, num_significant_digits(value_begin, value_end));
+  });
+
+  return valid && num_values == columns->size();
+}
+
+void TextImporter::parse_rows(const char* begin, const char* end, size_t first_row, uint8_t* user_data) const
+{
+  size_t row = 0;
+  for_each_row(begin, end, [&](const char* line_begin, const char* line_end){
+    if(Q_UNLIKELY(!ascii_values::parse_row(line_begin, line_end, delimiter, property_types, user_data + row*vertex_data_stride)))
+      throw QString("Invalid row %0").arg(first_row + row + 1);
+    ++row;
+  });
+}
+
+// Calls function(line_begin, line_end) for each line, which is neither empty nor a comment
+template<typename function_t>
+void for_each_row(const char* begin, const char* end, const function_t& function)
+{
+  while(begin != end)
+  {
+    const char* line_end = static_cast<const char*>(std::memchr(begin, '\n', size_t(end-begin)));
+    if(line_end == nullptr)
+      line_end = end;
+
+    if(is_row(begin, line_end))
+      function(begin, line_end);
+
+    begin = line_end==end ? end : line_end+1;
+  }
+}
+
+bool is_row(const char* begin, const char* end)
+{
+  while(begin!=end && (*begin==' ' || *begin=='\t'))
+    ++begin;
+  return begin!=end && *begin!='\r' && *begin!='#';
+}
+
+// Calls function(value_begin, value_end) for each value of the row without spaces and quotes around it
+template<typename function_t>
+void for_each_value(const char* begin, const char* end, char delimiter, const function_t& function)
+{
+  auto is_space = [delimiter](char c){return c==' ' || c=='\t' || c=='\r' || c=='"' || (delimiter==' ' && c==delimiter);};
+
+  while(begin != end)
+  {
+    const char* value_end = delimiter==' ' ? std::find_if(begin, end, is_space) : std::find(begin, end, delimiter);
+
+    const char* value_begin = begin;
+    begin = value_end==end ? end : value_end+1;
+
+    // trim spaces and quotes
+    while(value_begin!=value_end && is_space(*value_begin))
+      ++value_begin;
+    while(value_end!=value_begin && is_space(value_end[-1]))
+      --value_end;
+
+    // With whitespace as delimiter, multiple spaces separate two values. Otherwise only a trailing delimiter is ignored
+    if(value_begin!=value_end || (delimiter!=' ' && begin!=end))
+      function(value_begin, value_end);
+  }
+}
+
+std::vector<std::string> split_values(const char* begin, const char* end, char delimiter)
+{
+  std::vector<std::string> values;
+  for_each_value(begin, end, delimiter, [&values](const char* value_begin, const char* value_end){
+    values.push_back(std::string(value_begin, value_end));
+  });
+  return values;
+}
+
+bool is_number(const char* begin, const char* end)
+{
+  uint8_t buffer[sizeof(float64_t)];
+  return ascii_values::parse_value(begin, end, data_type::BASE_TYPE::FLOAT64, buffer) == end;
+}
+
+bool is_integer(const char* begin, const char* end)
+{
+  if(begin!=end && (*begin=='-' || *begin=='+'))
+    ++begin;
+  return begin!=end && std::all_of(begin, end, [](char c){return c>='0' && c<='9';});
+}
+
+int num_significant_digits(const char* begin, const char* end)
+{
+  int num_digits = 0;
+  for(; begin!=end; ++begin)
+  {
+    const char c = *begin;
+    if(c=='e' || c=='E')
+      break;
+    if((c>='1' && c<='9') || (c=='0' && num_digits>0))
+      ++num_digits;
+  }
+  return num_digits;
+}
+
+// Names x, y, z, [intensity,] [red, green, blue], column_<i>...
+QVector<QString> default_column_names(size_t num_columns)
+{
+  QVector<QString> names;
+  names.append("x");
+  names.append("y");
+  names.append("z");
+
+  if(num_columns == 4 || num_columns == 7)
+    names.append("intensity");
+  if(num_columns >= 6)
+  {
+    names.append("red");
+    names.append("green");
+    names.append("blue");
+  }
+
+  while(size_t(names.size()) < num_columns)
+    names.append(QString("column_%0").arg(names.size()));
+
+  return names;
+}
+
+QString normalized_column_name(std::string name)
+{
+  // CloudCompare prefixes the header with //
+  if(name.compare(0, 2, "//") == 0)
+    name.erase(0, 2);
+
+  QString normalized = QString::fromStdString(name).trimmed().toLower();
+
+  if(normalized == "r")
+    return "red";
+  if(normalized == "g")
+    return "green";
+  if(normalized == "b")
+    return "blue";
+  return normalized;
+}
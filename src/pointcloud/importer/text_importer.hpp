@@ -0,0 +1,69 @@
+#ifndef POINTCLOUD_WORKERS_IMPORTER_TEXT_HPP_
+#define POINTCLOUD_WORKERS_IMPORTER_TEXT_HPP_
+
+#include <pointcloud/importer/abstract_importer.hpp>
+
+#include <QVector>
+
+#include <limits>
+#include <vector>
+
+/**
+Implementation for loading point clouds stored as text with one point per line
+(xyz, csv, txt and pts files)
+
+The delimiter (whitespace, ',' or ';') and an optional header row with the
+column names are detected from the first lines. Without header, the columns
+are named x/y/z followed by intensity and/or red/green/blue, depending on the
+number of columns.
+
+The file is mapped into memory and split into newline aligned chunks. The rows
+of all chunks are counted in parallel first, so the point cloud can be
+allocated once and each chunk can be parsed concurrently into its own rows.
+The same pass collects the range and the precision of the values of each
+column, so the types of the columns fit all rows and not only the first ones.
+*/
+class TextImporter final : public AbstractPointCloudImporter
+{
+public:
+  TextImporter(const std::string& input_file);
+
+protected:
+  bool import_implementation() override;
+
+private:
+  // What the type of a column has to represent
+  struct column_statistics_t
+  {
+    bool all_integers = true;
+    float64_t min_value = std::numeric_limits<float64_t>::infinity();
+    float64_t max_value = -std::numeric_limits<float64_t>::infinity();
+    int max_significant_digits = 0;
+
+    void extend(const column_statistics_t& other);
+  };
+
+  struct chunk_t
+  {
+    const char* begin;
+    const char* end;
+    size_t num_rows;
+    size_t first_row;
+    aabb_t aabb;
+    std::vector<column_statistics_t> columns;
+    size_t first_invalid_row; // relative to the chunk, num_rows if all rows are valid
+  };
+
+  char delimiter = ' ';
+  size_t vertex_data_stride = 0;
+  QVector<QString> property_names;
+  QVector<data_type::base_type_t> property_types;
+
+  const char* detect_format(const char* begin, const char* end);
+  void set_column_types(const std::vector<column_statistics_t>& columns);
+  void scan_rows(chunk_t* chunk) const;
+  bool scan_row(const char* begin, const char* end, std::vector<column_statistics_t>* columns) const;
+  void parse_rows(const char* begin, const char* end, size_t first_row, uint8_t* user_data) const;
+};
+
+#endif // POINTCLOUD_WORKERS_IMPORTER_TEXT_HPP_
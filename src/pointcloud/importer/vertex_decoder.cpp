@@ -0,0 +1,196 @@
+#include <pointcloud/importer/vertex_decoder.hpp>
+#include <pointcloud/convert_values.hpp>
+
+typedef data_type::BASE_TYPE BASE_TYPE;
+
+template<typename t_out>
+VertexDecoder::convert_function_t normalized_converter(data_type::base_type_t type);
+
+VertexDecoder::VertexDecoder(size_t user_data_stride, const QVector<QString>& user_data_names, const QVector<size_t>& user_data_offset, const QVector<data_type::base_type_t>& user_data_types)
+  : user_data_stride(user_data_stride)
+{
+  const char* coordinate_names[3] = {"x", "y", "z"};
+  const char* color_names[3] = {"red", "green", "blue"};
+
+  for(int i=0; i<user_data_names.length(); ++i)
+  {
+    for(int d=0; d<3; ++d)
+    {
+      component_t component;
+      component.available = true;
+      component.offset = user_data_offset[i];
+      component.type = user_data_types[i];
+
+      if(user_data_names[i] == coordinate_names[d])
+      {
+        component.convert = normalized_converter<float32_t>(component.type);
+        coordinate[d] = component;
+      }else if(user_data_names[i] == color_names[d])
+      {
+        component.convert = normalized_converter<uint8_t>(component.type);
+        color[d] = component;
+      }
+    }
+  }
+
+  auto all_available_with_type = [](const component_t* components, data_type::base_type_t type) {
+    return components[0].available && components[1].available && components[2].available
+        && components[0].type==type && components[1].type==type && components[2].type==type;
+  };
+  const bool no_colors = !color[0].available && !color[1].available && !color[2].available;
+
+  layout = layout_t::GENERIC;
+
+  if(all_available_with_type(coordinate, BASE_TYPE::FLOAT32))
+  {
+    if(no_colors)
+      layout = layout_t::FLOAT32_COORDINATES;
+    else if(all_available_with_type(color, BASE_TYPE::UINT8))
+      layout = layout_t::FLOAT32_COORDINATES_UINT8_COLORS;
+    else if(all_available_with_type(color, BASE_TYPE::UINT16))
+      layout = layout_t::FLOAT32_COORDINATES_UINT16_COLORS;
+    else if(all_available_with_type(color, BASE_TYPE::FLOAT32))
+      layout = layout_t::FLOAT32_COORDINATES_FLOAT32_COLORS;
+  }else if(all_available_with_type(coordinate, BASE_TYPE::FLOAT64))
+  {
+    if(no_colors)
+      layout = layout_t::FLOAT64_COORDINATES;
+    else if(all_available_with_type(color, BASE_TYPE::UINT8))
+      layout = layout_t::FLOAT64_COORDINATES_UINT8_COLORS;
+    else if(all_available_with_type(color, BASE_TYPE::UINT16))
+      layout = layout_t::FLOAT64_COORDINATES_UINT16_COLORS;
+    else if(all_available_with_type(color, BASE_TYPE::FLOAT32))
+      layout = layout_t::FLOAT64_COORDINATES_FLOAT32_COLORS;
+  }
+}
+
+VertexDecoder::VertexDecoder(const PointCloud& pointcloud)
+  : VertexDecoder(pointcloud.user_data_stride, pointcloud.user_data_names, pointcloud.user_data_offset, pointcloud.user_data_types)
+{
+}
+
+void VertexDecoder::decode(const uint8_t* user_data, PointCloud::vertex_t* vertices, size_t num_points, aabb_t* aabb) const
+{
+  switch(layout)
+  {
+  case layout_t::GENERIC:
+    decode_generic(user_data, vertices, num_points, aabb);
+    return;
+  case layout_t::FLOAT32_COORDINATES:
+    decode_layout<float32_t, uint8_t, false>(user_data, vertices, num_points, aabb);
+    return;
+  case layout_t::FLOAT32_COORDINATES_UINT8_COLORS:
+    decode_layout<float32_t, uint8_t, true>(user_data, vertices, num_points, aabb);
+    return;
+  case layout_t::FLOAT32_COORDINATES_UINT16_COLORS:
+    decode_layout<float32_t, uint16_t, true>(user_data, vertices, num_points, aabb);
+    return;
+  case layout_t::FLOAT32_COORDINATES_FLOAT32_COLORS:
+    decode_layout<float32_t, float32_t, true>(user_data, vertices, num_points, aabb);
+    return;
+  case layout_t::FLOAT64_COORDINATES:
+    decode_layout<float64_t, uint8_t, false>(user_data, vertices, num_points, aabb);
+    return;
+  case layout_t::FLOAT64_COORDINATES_UINT8_COLORS:
+    decode_layout<float64_t, uint8_t, true>(user_data, vertices, num_points, aabb);
+    return;
+  case layout_t::FLOAT64_COORDINATES_UINT16_COLORS:
+    decode_layout<float64_t, uint16_t, true>(user_data, vertices, num_points, aabb);
+    return;
+  case layout_t::FLOAT64_COORDINATES_FLOAT32_COLORS:
+    decode_layout<float64_t, float32_t, true>(user_data, vertices, num_points, aabb);
+    return;
+  }
+
+  Q_UNREACHABLE();
+}
+
+template<typename coordinate_t, typename color_t, bool has_colors>
+void VertexDecoder::decode_layout(const uint8_t* user_data, PointCloud::vertex_t* vertices, size_t num_points, aabb_t* aabb) const
+{
+  // The components are converted column by column with the batch conversions. The points are
+  // processed in small tiles, so the rows are still in the cache when the next column is converted.
+  const size_t tile_size = 1024;
+
+  glm::vec3 min_point = aabb->min_point;
+  glm::vec3 max_point = aabb->max_point;
+
+  for(size_t first_point=0; first_point<num_points; first_point+=tile_size)
+  {
+    const size_t num_tile_points = glm::min(tile_size, num_points-first_point);
+    const uint8_t* rows = user_data + first_point * user_data_stride;
+    PointCloud::vertex_t* tile_vertices = vertices + first_point;
+
+    for(int d=0; d<3; ++d)
+      convert_components<coordinate_t, float32_t>::convert_normalized(rows + coordinate[d].offset, user_data_stride, &tile_vertices->coordinate[d], PointCloud::stride, num_tile_points);
+
+    if(has_colors)
+      for(int d=0; d<3; ++d)
+        convert_components<color_t, uint8_t>::convert_normalized(rows + color[d].offset, user_data_stride, &tile_vertices->color[d], PointCloud::stride, num_tile_points);
+
+    for(size_t i=0; i<num_tile_points; ++i)
+    {
+      const glm::vec3 coordinate = tile_vertices[i].coordinate;
+      max_point = glm::max(coordinate, max_point);
+      min_point = glm::min(coordinate, min_point);
+    }
+  }
+
+  aabb->min_point = min_point;
+  aabb->max_point = max_point;
+}
+
+void VertexDecoder::decode_generic(const uint8_t* user_data, PointCloud::vertex_t* vertices, size_t num_points, aabb_t* aabb) const
+{
+  for(size_t i=0; i<num_points; ++i)
+  {
+    const uint8_t* row = user_data + i * user_data_stride;
+    PointCloud::vertex_t& vertex = vertices[i];
+
+    for(int d=0; d<3; ++d)
+    {
+      if(!coordinate[d].available)
+        continue;
+
+      float32_t value;
+      coordinate[d].convert(row + coordinate[d].offset, &value);
+      vertex.coordinate[d] = value;
+
+      aabb->max_point[d] = glm::max(value, aabb->max_point[d]);
+      aabb->min_point[d] = glm::min(value, aabb->min_point[d]);
+    }
+
+    for(int d=0; d<3; ++d)
+    {
+      if(color[d].available)
+        color[d].convert(row + color[d].offset, &vertex.color[d]);
+    }
+  }
+}
+
+template<typename t_out>
+VertexDecoder::convert_function_t normalized_converter(data_type::base_type_t type)
+{
+  switch(type)
+  {
+  case BASE_TYPE::INT8:
+    return &convert_component<int8_t, t_out>::convert_normalized;
+  case BASE_TYPE::INT16:
+    return &convert_component<int16_t, t_out>::convert_normalized;
+  case BASE_TYPE::INT32:
+    return &convert_component<int32_t, t_out>::convert_normalized;
+  case BASE_TYPE::UINT8:
+    return &convert_component<uint8_t, t_out>::convert_normalized;
+  case BASE_TYPE::UINT16:
+    return &convert_component<uint16_t, t_out>::convert_normalized;
+  case BASE_TYPE::UINT32:
+    return &convert_component<uint32_t, t_out>::convert_normalized;
+  case BASE_TYPE::FLOAT32:
+    return &convert_component<float32_t, t_out>::convert_normalized;
+  case BASE_TYPE::FLOAT64:
+    return &convert_component<float64_t, t_out>::convert_normalized;
+  }
+
+  Q_UNREACHABLE();
+  return nullptr;
+}
@@ -0,0 +1,59 @@
+#ifndef POINTCLOUD_IMPORTER_VERTEX_DECODER_HPP_
+#define POINTCLOUD_IMPORTER_VERTEX_DECODER_HPP_
+
+#include <pointcloud/pointcloud.hpp>
+
+/**
+Fixed plan for filling the coordinates and colors of the vertices from the
+x/y/z/red/green/blue properties stored in the user data.
+
+The plan is built once per file layout. Common layouts (float or double
+coordinates with uchar, ushort or float colors) are decoded column by column
+with the batch conversions of convert_values.hpp, all other layouts by a generic
+loop converting component by component.
+*/
+class VertexDecoder final
+{
+public:
+  typedef void (*convert_function_t)(const void* source, void* target);
+
+  VertexDecoder(size_t user_data_stride, const QVector<QString>& user_data_names, const QVector<size_t>& user_data_offset, const QVector<data_type::base_type_t>& user_data_types);
+  explicit VertexDecoder(const PointCloud& pointcloud);
+
+  // Fills the vertices and grows the aabb by the decoded coordinates.
+  // Vertex components not provided by the user data are left untouched.
+  void decode(const uint8_t* user_data, PointCloud::vertex_t* vertices, size_t num_points, aabb_t* aabb) const;
+
+private:
+  enum class layout_t
+  {
+    GENERIC,
+    FLOAT32_COORDINATES,
+    FLOAT32_COORDINATES_UINT8_COLORS,
+    FLOAT32_COORDINATES_UINT16_COLORS,
+    FLOAT32_COORDINATES_FLOAT32_COLORS,
+    FLOAT64_COORDINATES,
+    FLOAT64_COORDINATES_UINT8_COLORS,
+    FLOAT64_COORDINATES_UINT16_COLORS,
+    FLOAT64_COORDINATES_FLOAT32_COLORS,
+  };
+
+  struct component_t
+  {
+    bool available = false;
+    size_t offset = 0;
+    data_type::base_type_t type = data_type::BASE_TYPE::FLOAT32;
+    convert_function_t convert = nullptr;
+  };
+
+  size_t user_data_stride;
+  component_t coordinate[3];
+  component_t color[3];
+  layout_t layout;
+
+  template<typename coordinate_t, typename color_t, bool has_colors>
+  void decode_layout(const uint8_t* user_data, PointCloud::vertex_t* vertices, size_t num_points, aabb_t* aabb) const;
+  void decode_generic(const uint8_t* user_data, PointCloud::vertex_t* vertices, size_t num_points, aabb_t* aabb) const;
+};
+
+#endif // POINTCLOUD_IMPORTER_VERTEX_DECODER_HPP_
@@ -13,9 +13,35 @@ KDTreeIndex::~KDTreeIndex()
 {
 }
 
+KDTreeIndex::KDTreeIndex(KDTreeIndex&& other)
+  : total_aabb(other.total_aabb),
+    tree_buffer(std::move(other.tree_buffer)),
+    tree_size(other.tree_size)
+{
+  other.tree_size = 0;
+}
+
+KDTreeIndex& KDTreeIndex::operator=(KDTreeIndex&& other)
+{
+  total_aabb = other.total_aabb;
+  tree_buffer = std::move(other.tree_buffer);
+  tree_size = other.tree_size;
+  other.tree_size = 0;
+  return *this;
+}
+
+KDTreeIndex KDTreeIndex::snapshot() const
+{
+  KDTreeIndex snapshot;
+  snapshot.total_aabb = total_aabb;
+  snapshot.tree_buffer = tree_buffer.snapshot();
+  snapshot.tree_size = tree_size;
+  return snapshot;
+}
+
 KDTreeIndex::point_index_t KDTreeIndex::pick_point(cone_t cone, const uint8_t* coordinates, uint stride, KDTreeIndex::point_index_t fallback) const
 {
-  if(tree.empty())
+  if(tree_size == 0)
     return fallback;
 
   point_index_t best_point = fallback;
@@ -28,7 +54,7 @@ KDTreeIndex::point_index_t KDTreeIndex::pick_point(cone_t cone, const uint8_t* c
   };
 
   Stack<stack_entry_t> stack;
-  stack.reserve(tree.size());
+  stack.reserve(tree_size);
 
   stack.push(stack_entry_t{whole_tree(), total_aabb});
 
@@ -47,7 +73,7 @@ KDTreeIndex::point_index_t KDTreeIndex::pick_point(cone_t cone, const uint8_t* c
     if(!ray_for_intersection_test.intersects_aabb(current.aabb, &near_distance, &far_distance) || near_distance>distance_of_best_point)
       continue;
 
-    point_index_t current_point = tree[current.subtree.root()];
+    point_index_t current_point = tree()[current.subtree.root()];
     glm::vec3 current_coordinate = coordinate_for_index(current_point, coordinates, stride);
 
     Q_ASSERT(current.aabb.contains(current_coordinate));
@@ -90,7 +116,7 @@ KDTreeIndex::point_index_t KDTreeIndex::pick_point(cone_t cone, const uint8_t* c
 
 size_t KDTreeIndex::root_point() const
 {
-  return range_t{0, this->tree.size()}.median();
+  return range_t{0, this->tree_size}.median();
 }
 
 bool KDTreeIndex::has_children(size_t point) const
@@ -152,7 +178,8 @@ glm::vec3 KDTreeIndex::point_coordinate(size_t point, const uint8_t* coordinates
 
 void KDTreeIndex::clear()
 {
-  tree.clear();
+  tree_buffer.clear();
+  tree_size = 0;
 }
 
 void KDTreeIndex::build(aabb_t total_aabb, const uint8_t* coordinates, size_t num_points, uint stride, std::function<bool(size_t, size_t)> feedback)
@@ -161,12 +188,11 @@ void KDTreeIndex::build(aabb_t total_aabb, const uint8_t* coordinates, size_t nu
     return component_for_index(point_index, dimension, coordinates, stride);
   };
 
-  tree.resize(num_points);
-  this->total_aabb = total_aabb;
+  point_index_t* entries = alloc_for_loading(num_points, total_aabb);
 
   // Fill the array with the coordinates in original order
   for(size_t i=0; i<num_points; ++i)
-    tree[i] = point_index_t(i);
+    entries[i] = point_index_t(i);
 
   Stack<subtree_t> stack;
   stack.reserve(num_points/2);
@@ -188,8 +214,8 @@ void KDTreeIndex::build(aabb_t total_aabb, const uint8_t* coordinates, size_t nu
     num_processed_points++;
 
     boost::sort::block_indirect_sort(
-          tree.data()+current_tree.range.begin,
-          tree.data()+current_tree.range.end,
+          entries+current_tree.range.begin,
+          entries+current_tree.range.end,
           [dimension, coordinate_for_index](point_index_t a, point_index_t b){return coordinate_for_index(a, dimension) < coordinate_for_index(b, dimension);});
 
     const subtree_t left_subtree = current_tree.left_subtree();
@@ -209,7 +235,7 @@ void KDTreeIndex::build(aabb_t total_aabb, const uint8_t* coordinates, size_t nu
       reset_feedback_countdown();
       if(!feedback(num_processed_points, num_points))
       {
-        tree.clear();
+        clear();
         return;
       }
     }else
@@ -225,19 +251,45 @@ void KDTreeIndex::build(aabb_t total_aabb, const uint8_t* coordinates, size_t nu
 
 bool KDTreeIndex::is_initialized() const
 {
-  return !tree.empty();
+  return tree_size != 0;
 }
 
 const KDTreeIndex::point_index_t* KDTreeIndex::data() const
 {
-  return tree.data();
+  return tree();
 }
 
 KDTreeIndex::point_index_t* KDTreeIndex::alloc_for_loading(size_t num_points, aabb_t total_aabb)
 {
   this->total_aabb = total_aabb;
-  tree.resize(num_points);
-  return tree.data();
+  tree_buffer.resize(num_points * sizeof(point_index_t));
+  tree_size = num_points;
+  return tree();
+}
+
+// Uses the kd-tree stored within a pcvd file without copying it. The offset must be aligned to point_index_t.
+bool KDTreeIndex::map_for_loading(const QString& filename, int64_t offset, size_t num_points, aabb_t total_aabb)
+{
+  Q_ASSERT(offset % int64_t(alignof(point_index_t)) == 0);
+
+  clear();
+
+  if(!tree_buffer.map_file(filename, offset, num_points * sizeof(point_index_t)))
+    return false;
+
+  this->total_aabb = total_aabb;
+  tree_size = num_points;
+  return true;
+}
+
+KDTreeIndex::point_index_t* KDTreeIndex::tree()
+{
+  return reinterpret_cast<point_index_t*>(tree_buffer.data());
+}
+
+const KDTreeIndex::point_index_t* KDTreeIndex::tree() const
+{
+  return reinterpret_cast<const point_index_t*>(tree_buffer.data());
 }
 
 KDTreeIndex::subtree_t KDTreeIndex::traverse_kd_tree_to_point(size_t point, std::function<void(subtree_t)> visitor) const
@@ -261,7 +313,7 @@ KDTreeIndex::subtree_t KDTreeIndex::traverse_kd_tree_to_point(size_t point, std:
 
 KDTreeIndex::subtree_t KDTreeIndex::whole_tree() const
 {
-  return subtree_t{range_t{0, this->tree.size()}, 0};
+  return subtree_t{range_t{0, this->tree_size}, 0};
 }
 
 void KDTreeIndex::validate_tree(const uint8_t* coordinates, size_t num_points, uint stride)
@@ -332,7 +384,7 @@ float KDTreeIndex::component_for_index(point_index_t point_index, uint8_t dimens
 
 float KDTreeIndex::component_for_index(size_t entry_index, uint8_t dimension, const uint8_t* coordinates, uint stride) const
 {
-  return component_for_index(tree[entry_index], dimension, coordinates, stride);
+  return component_for_index(tree()[entry_index], dimension, coordinates, stride);
 }
 
 glm::vec3 KDTreeIndex::coordinate_for_index(point_index_t point_index, const uint8_t* coordinates, uint stride)
@@ -344,7 +396,7 @@ glm::vec3 KDTreeIndex::coordinate_for_index(point_index_t point_index, const uin
 
 glm::vec3 KDTreeIndex::coordinate_for_index(size_t entry_index, const uint8_t* coordinates, uint stride) const
 {
-  return coordinate_for_index(tree[entry_index], coordinates, stride);
+  return coordinate_for_index(tree()[entry_index], coordinates, stride);
 }
 
 bool KDTreeIndex::range_t::is_empty() const
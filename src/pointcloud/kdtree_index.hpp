@@ -2,6 +2,7 @@
 #define POINTCLOUD_KDTREE_INDEX_HPP
 
 #include <core_library/types.hpp>
+#include <pointcloud/buffer.hpp>
 #include <geometry/aabb.hpp>
 #include <geometry/cone.hpp>
 #include <glm/glm.hpp>
@@ -22,6 +23,8 @@ public:
 
   KDTreeIndex();
   ~KDTreeIndex();
+  KDTreeIndex(KDTreeIndex&& other);
+  KDTreeIndex& operator=(KDTreeIndex&& other);
 
   point_index_t pick_point(cone_t cone, const uint8_t* coordinates, uint stride, point_index_t fallback=POINT_INDEX::INVALID) const;
 
@@ -34,12 +37,16 @@ public:
 
   void clear();
 
+  // Shares the tree with this index (see Buffer::snapshot)
+  KDTreeIndex snapshot() const;
+
   void build(aabb_t total_aabb, const uint8_t* coordinates, size_t num_points, uint stride, std::function<bool(size_t, size_t)> feedback);
 
   bool is_initialized() const;
 
   const point_index_t* data() const;
   point_index_t* alloc_for_loading(size_t num_points, aabb_t total_aabb);
+  bool map_for_loading(const QString& filename, int64_t offset, size_t num_points, aabb_t total_aabb);
 
 private:
   struct range_t
@@ -77,7 +84,11 @@ private:
   };
 
   aabb_t total_aabb;
-  std::vector<point_index_t> tree;
+  Buffer tree_buffer; // array of point_index_t[tree_size]. Either allocated or mapped from a pcvd file
+  size_t tree_size = 0;
+
+  point_index_t* tree();
+  const point_index_t* tree() const;
 
   subtree_t traverse_kd_tree_to_point(size_t point, std::function<void(subtree_t inner_subtree)> visitor) const;
   subtree_t whole_tree() const;
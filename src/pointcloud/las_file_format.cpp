@@ -0,0 +1,204 @@
+#include <pointcloud/las_file_format.hpp>
+
+#include <fstream>
+#include <cstring>
+
+namespace las_format {
+
+typedef field_t::KIND KIND;
+typedef data_type::BASE_TYPE BASE_TYPE;
+
+template<typename T>
+T read_header_value(const uint8_t* header_data, size_t offset);
+void add_wave_packet_fields(std::vector<field_t>* fields, size_t offset);
+
+bool read_header(const std::string& filename, header_t* header, const error_callback_t& error_callback)
+{
+  // The public header block has a size of 227 bytes up to version 1.2, 235 bytes in version 1.3 and 375 bytes in version 1.4
+  const size_t max_header_size = 375;
+  uint8_t data[max_header_size] = {};
+
+  std::ifstream stream(filename, std::ios_base::in | std::ios_base::binary);
+  stream.read(reinterpret_cast<char*>(data), std::streamsize(max_header_size));
+  const size_t num_read_bytes = size_t(stream.gcount());
+
+  if(num_read_bytes < 227 || std::memcmp(data, "LASF", 4) != 0)
+  {
+    error_callback("not a las file");
+    return false;
+  }
+
+  header->version_major = read_header_value<uint8_t>(data, 24);
+  header->version_minor = read_header_value<uint8_t>(data, 25);
+  const size_t header_size = read_header_value<uint16_t>(data, 94);
+  header->point_data_offset = read_header_value<uint32_t>(data, 96);
+  header->point_data_format = read_header_value<uint8_t>(data, 104);
+  header->point_record_length = read_header_value<uint16_t>(data, 105);
+  header->num_points = read_header_value<uint32_t>(data, 107);
+
+  for(int axis=0; axis<3; ++axis)
+  {
+    header->scale[axis] = read_header_value<float64_t>(data, 131 + size_t(axis)*8);
+    header->offset[axis] = read_header_value<float64_t>(data, 155 + size_t(axis)*8);
+    header->max_point[axis] = read_header_value<float64_t>(data, 179 + size_t(axis)*16);
+    header->min_point[axis] = read_header_value<float64_t>(data, 187 + size_t(axis)*16);
+  }
+
+  // Since version 1.4 the number of points is stored as uint64. The legacy uint32 count is zero for formats 6 to 10 or more than 2^32-1 points
+  if(header->version_major == 1 && header->version_minor >= 4 && header_size >= max_header_size && num_read_bytes >= max_header_size)
+  {
+    const uint64_t num_points = read_header_value<uint64_t>(data, 247);
+    if(num_points != 0)
+      header->num_points = size_t(num_points);
+  }
+
+  // The upper two bits of the format are set by laszip for compressed files
+  if(header->point_data_format & 0xc0)
+  {
+    error_callback("compressed (laz) files are not supported");
+    return false;
+  }
+
+  const size_t standard_length = standard_record_length(header->point_data_format);
+  if(standard_length == 0)
+  {
+    error_callback("unsupported point data record format " + std::to_string(int(header->point_data_format)));
+    return false;
+  }
+  if(header->point_record_length < standard_length)
+  {
+    error_callback("point data records too small for format " + std::to_string(int(header->point_data_format)));
+    return false;
+  }
+  if(header->point_data_offset < int64_t(header_size))
+  {
+    error_callback("invalid offset of the point data");
+    return false;
+  }
+
+  return true;
+}
+
+size_t standard_record_length(uint8_t point_data_format)
+{
+  const size_t lengths[] = {20, 28, 26, 34, 57, 63, 30, 36, 38, 59, 67};
+
+  if(point_data_format >= sizeof(lengths)/sizeof(lengths[0]))
+    return 0;
+  return lengths[point_data_format];
+}
+
+std::vector<field_t> fields_of_point_data_format(uint8_t point_data_format)
+{
+  Q_ASSERT(standard_record_length(point_data_format) != 0);
+
+  std::vector<field_t> fields = {
+    {"x", KIND::COORDINATE, BASE_TYPE::FLOAT64, 0, 0, 0, 0},
+    {"y", KIND::COORDINATE, BASE_TYPE::FLOAT64, 4, 0, 0, 1},
+    {"z", KIND::COORDINATE, BASE_TYPE::FLOAT64, 8, 0, 0, 2},
+    {"intensity", KIND::VALUE, BASE_TYPE::UINT16, 12, 0, 0, 0},
+  };
+
+  if(point_data_format <= 5)
+  {
+    fields.insert(fields.end(), {
+      {"return_number", KIND::BITS, BASE_TYPE::UINT8, 14, 0, 0x7, 0},
+      {"number_of_returns", KIND::BITS, BASE_TYPE::UINT8, 14, 3, 0x7, 0},
+      {"scan_direction_flag", KIND::BITS, BASE_TYPE::UINT8, 14, 6, 0x1, 0},
+      {"edge_of_flight_line", KIND::BITS, BASE_TYPE::UINT8, 14, 7, 0x1, 0},
+      {"classification", KIND::BITS, BASE_TYPE::UINT8, 15, 0, 0x1f, 0},
+      {"synthetic", KIND::BITS, BASE_TYPE::UINT8, 15, 5, 0x1, 0},
+      {"key_point", KIND::BITS, BASE_TYPE::UINT8, 15, 6, 0x1, 0},
+      {"withheld", KIND::BITS, BASE_TYPE::UINT8, 15, 7, 0x1, 0},
+      {"scan_angle_rank", KIND::VALUE, BASE_TYPE::INT8, 16, 0, 0, 0},
+      {"user_data", KIND::VALUE, BASE_TYPE::UINT8, 17, 0, 0, 0},
+      {"point_source_id", KIND::VALUE, BASE_TYPE::UINT16, 18, 0, 0, 0},
+    });
+
+    if(point_data_format != 0 && point_data_format != 2)
+      fields.push_back({"gps_time", KIND::VALUE, BASE_TYPE::FLOAT64, 20, 0, 0, 0});
+    if(point_data_format == 4)
+      add_wave_packet_fields(&fields, 28);
+    if(point_data_format == 5)
+      add_wave_packet_fields(&fields, 34);
+  }else
+  {
+    fields.insert(fields.end(), {
+      {"return_number", KIND::BITS, BASE_TYPE::UINT8, 14, 0, 0xf, 0},
+      {"number_of_returns", KIND::BITS, BASE_TYPE::UINT8, 14, 4, 0xf, 0},
+      {"synthetic", KIND::BITS, BASE_TYPE::UINT8, 15, 0, 0x1, 0},
+      {"key_point", KIND::BITS, BASE_TYPE::UINT8, 15, 1, 0x1, 0},
+      {"withheld", KIND::BITS, BASE_TYPE::UINT8, 15, 2, 0x1, 0},
+      {"overlap", KIND::BITS, BASE_TYPE::UINT8, 15, 3, 0x1, 0},
+      {"scanner_channel", KIND::BITS, BASE_TYPE::UINT8, 15, 4, 0x3, 0},
+      {"scan_direction_flag", KIND::BITS, BASE_TYPE::UINT8, 15, 6, 0x1, 0},
+      {"edge_of_flight_line", KIND::BITS, BASE_TYPE::UINT8, 15, 7, 0x1, 0},
+      {"classification", KIND::VALUE, BASE_TYPE::UINT8, 16, 0, 0, 0},
+      {"user_data", KIND::VALUE, BASE_TYPE::UINT8, 17, 0, 0, 0},
+      {"scan_angle", KIND::VALUE, BASE_TYPE::INT16, 18, 0, 0, 0},
+      {"point_source_id", KIND::VALUE, BASE_TYPE::UINT16, 20, 0, 0, 0},
+      {"gps_time", KIND::VALUE, BASE_TYPE::FLOAT64, 22, 0, 0, 0},
+    });
+
+    if(point_data_format == 9)
+      add_wave_packet_fields(&fields, 30);
+  }
+
+  const int64_t colors = color_offset(point_data_format);
+  if(colors >= 0)
+  {
+    fields.insert(fields.end(), {
+      {"red", KIND::VALUE, BASE_TYPE::UINT16, size_t(colors), 0, 0, 0},
+      {"green", KIND::VALUE, BASE_TYPE::UINT16, size_t(colors)+2, 0, 0, 0},
+      {"blue", KIND::VALUE, BASE_TYPE::UINT16, size_t(colors)+4, 0, 0, 0},
+    });
+  }
+
+  if(point_data_format == 8 || point_data_format == 10)
+    fields.push_back({"nir", KIND::VALUE, BASE_TYPE::UINT16, 36, 0, 0, 0});
+  if(point_data_format == 10)
+    add_wave_packet_fields(&fields, 38);
+
+  return fields;
+}
+
+int64_t color_offset(uint8_t point_data_format)
+{
+  switch(point_data_format)
+  {
+  case 2:
+    return 20;
+  case 3:
+  case 5:
+    return 28;
+  case 7:
+  case 8:
+  case 10:
+    return 30;
+  default:
+    return -1;
+  }
+}
+
+void add_wave_packet_fields(std::vector<field_t>* fields, size_t offset)
+{
+  fields->insert(fields->end(), {
+    {"wave_packet_descriptor_index", KIND::VALUE, BASE_TYPE::UINT8, offset, 0, 0, 0},
+    {"waveform_data_offset", KIND::UINT64, BASE_TYPE::FLOAT64, offset+1, 0, 0, 0},
+    {"waveform_packet_size", KIND::VALUE, BASE_TYPE::UINT32, offset+9, 0, 0, 0},
+    {"return_point_waveform_location", KIND::VALUE, BASE_TYPE::FLOAT32, offset+13, 0, 0, 0},
+    {"x_t", KIND::VALUE, BASE_TYPE::FLOAT32, offset+17, 0, 0, 0},
+    {"y_t", KIND::VALUE, BASE_TYPE::FLOAT32, offset+21, 0, 0, 0},
+    {"z_t", KIND::VALUE, BASE_TYPE::FLOAT32, offset+25, 0, 0, 0},
+  });
+}
+
+template<typename T>
+T read_header_value(const uint8_t* header_data, size_t offset)
+{
+  T value;
+  std::memcpy(&value, header_data + offset, sizeof(T));
+  return value;
+}
+
+} // namespace las_format
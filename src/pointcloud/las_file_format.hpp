@@ -0,0 +1,78 @@
+#ifndef POINTCLOUD_LAS_FILE_FORMAT_HPP_
+#define POINTCLOUD_LAS_FILE_FORMAT_HPP_
+
+#include <pointcloud/buffer.hpp>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace las_format {
+
+/*
+Description of the public header block of a las file (versions 1.0 to 1.4) and
+of the point data record formats 0 to 10.
+
+All points are stored in fixed size records directly after the header and the
+variable length records. The coordinates are stored as integers, which have to
+be scaled and offset by the values given in the header.
+*/
+
+struct header_t
+{
+  uint8_t version_major;
+  uint8_t version_minor;
+  int64_t point_data_offset;
+  uint8_t point_data_format;
+  size_t point_record_length; // can be larger than the standard record length, if extra bytes are stored
+  size_t num_points;
+  glm::dvec3 scale;
+  glm::dvec3 offset;
+  glm::dvec3 min_point;
+  glm::dvec3 max_point;
+};
+
+/*
+Field of a point data record.
+
+The values of bit fields are shifted and masked into an uint8. The
+coordinates are converted to float64 by applying the scale and offset, so
+each value of the user data is the world space position.
+*/
+struct field_t
+{
+  enum class kind_t
+  {
+    VALUE, // copied as is
+    BITS, // (byte >> bit_shift) & bit_mask
+    COORDINATE, // int32 * scale[axis] + offset[axis] stored as float64
+    UINT64, // stored as float64, as the user data doesn't support 64 bit integers
+  };
+  typedef kind_t KIND;
+
+  std::string name;
+  kind_t kind;
+  data_type::base_type_t type; // type of the value within the user data
+  size_t offset; // offset within the record
+  uint8_t bit_shift;
+  uint8_t bit_mask;
+  int axis;
+};
+
+typedef std::function<void(const std::string& message)> error_callback_t;
+
+bool read_header(const std::string& filename, header_t* header, const error_callback_t& error_callback);
+
+// Size of the point data records without extra bytes. Returns 0 for unknown formats
+size_t standard_record_length(uint8_t point_data_format);
+
+std::vector<field_t> fields_of_point_data_format(uint8_t point_data_format);
+
+// offset of the red/green/blue values (uint16) within the record, or -1 if the format doesn't store colors
+int64_t color_offset(uint8_t point_data_format);
+
+} // namespace las_format
+
+#endif // POINTCLOUD_LAS_FILE_FORMAT_HPP_
@@ -0,0 +1,288 @@
+#include <pointcloud/pcd_file_format.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace pcd_format {
+
+bool base_type_of_field(char type, size_t size, data_type::base_type_t* base_type);
+
+size_t field_t::size() const
+{
+  return data_type::size_of_type(type) * count;
+}
+
+size_t header_t::stride() const
+{
+  return offset_of_field(fields.size());
+}
+
+size_t header_t::offset_of_field(size_t field_index) const
+{
+  Q_ASSERT(field_index <= fields.size());
+
+  size_t offset = 0;
+  for(size_t i=0; i<field_index; ++i)
+    offset += fields[i].size();
+  return offset;
+}
+
+bool read_header(const std::string& filename, header_t* header, const error_callback_t& error_callback)
+{
+  std::ifstream stream(filename, std::ios_base::in | std::ios_base::binary);
+
+  std::vector<std::string> names;
+  std::vector<size_t> sizes;
+  std::vector<char> types;
+  std::vector<size_t> counts;
+  size_t width = 0;
+  size_t height = 1;
+  bool found_points = false;
+  bool found_data = false;
+
+  header->num_points = 0;
+
+  std::string line;
+  size_t line_number = 0;
+
+  auto fail = [&error_callback, &line_number](const std::string& message) {
+    error_callback(line_number, message);
+    return false;
+  };
+
+  while(!found_data && std::getline(stream, line, '\n'))
+  {
+    ++line_number;
+
+    std::istringstream line_stream(line);
+    line_stream.imbue(std::locale::classic());
+
+    std::string keyword;
+    if(!(line_stream >> keyword) || keyword[0] == '#')
+      continue;
+
+    std::vector<std::string> values;
+    for(std::string value; line_stream >> value;)
+      values.push_back(value);
+
+    // parses all values of the current line as unsigned integers
+    auto read_sizes = [&values](std::vector<size_t>* sizes) {
+      sizes->clear();
+      for(const std::string& value : values)
+      {
+        std::istringstream value_stream(value);
+        size_t size;
+        if(!(value_stream >> size) || !value_stream.eof())
+          return false;
+        sizes->push_back(size);
+      }
+      return true;
+    };
+    std::vector<size_t> numbers;
+
+    if(keyword == "VERSION" || keyword == "VIEWPOINT")
+    {
+      continue;
+    }else if(keyword == "FIELDS")
+    {
+      names = values;
+    }else if(keyword == "SIZE")
+    {
+      if(!read_sizes(&sizes))
+        return fail("invalid SIZE");
+    }else if(keyword == "TYPE")
+    {
+      types.clear();
+      for(const std::string& value : values)
+      {
+        if(value.size() != 1)
+          return fail("invalid TYPE");
+        types.push_back(value[0]);
+      }
+    }else if(keyword == "COUNT")
+    {
+      if(!read_sizes(&counts))
+        return fail("invalid COUNT");
+    }else if(keyword == "WIDTH" || keyword == "HEIGHT" || keyword == "POINTS")
+    {
+      if(!read_sizes(&numbers) || numbers.size() != 1)
+        return fail("invalid " + keyword);
+      if(keyword == "WIDTH")
+        width = numbers[0];
+      else if(keyword == "HEIGHT")
+        height = numbers[0];
+      else
+        header->num_points = numbers[0];
+      found_points = found_points || keyword == "POINTS";
+    }else if(keyword == "DATA")
+    {
+      if(values.size() != 1)
+        return fail("invalid DATA");
+      else if(values[0] == "ascii")
+        header->data = data_t::ASCII;
+      else if(values[0] == "binary")
+        header->data = data_t::BINARY;
+      else if(values[0] == "binary_compressed")
+        header->data = data_t::BINARY_COMPRESSED;
+      else
+        return fail("unknown DATA " + values[0]);
+      found_data = true;
+    }else
+    {
+      return fail("unknown keyword " + keyword);
+    }
+  }
+
+  if(!found_data)
+    return fail("missing DATA");
+
+  header->body_offset = int64_t(stream.tellg());
+
+  // Files written before COUNT and POINTS were introduced store a single value per field and width*height points
+  if(counts.empty())
+    counts.resize(names.size(), 1);
+  if(!found_points)
+    header->num_points = width * height;
+
+  if(names.empty() || sizes.size() != names.size() || types.size() != names.size() || counts.size() != names.size())
+    return fail("the number of FIELDS, SIZE, TYPE and COUNT values differ");
+
+  header->fields.clear();
+  for(size_t i=0; i<names.size(); ++i)
+  {
+    field_t field;
+    field.name = names[i];
+    field.count = counts[i];
+    if(!base_type_of_field(types[i], sizes[i], &field.type))
+      return fail("unsupported type of field " + field.name);
+    if(field.count == 0)
+      return fail("invalid count of field " + field.name);
+    header->fields.push_back(field);
+  }
+
+  return header->body_offset >= 0;
+}
+
+bool base_type_of_field(char type, size_t size, data_type::base_type_t* base_type)
+{
+  switch(type)
+  {
+  case 'I':
+    if(size == 1)
+      *base_type = data_type::BASE_TYPE::INT8;
+    else if(size == 2)
+      *base_type = data_type::BASE_TYPE::INT16;
+    else if(size == 4)
+      *base_type = data_type::BASE_TYPE::INT32;
+    else
+      return false;
+    return true;
+  case 'U':
+    if(size == 1)
+      *base_type = data_type::BASE_TYPE::UINT8;
+    else if(size == 2)
+      *base_type = data_type::BASE_TYPE::UINT16;
+    else if(size == 4)
+      *base_type = data_type::BASE_TYPE::UINT32;
+    else
+      return false;
+    return true;
+  case 'F':
+    if(size == 4)
+      *base_type = data_type::BASE_TYPE::FLOAT32;
+    else if(size == 8)
+      *base_type = data_type::BASE_TYPE::FLOAT64;
+    else
+      return false;
+    return true;
+  default:
+    return false;
+  }
+}
+
+/*
+Each LZF block starts with a control byte. Values below 32 are followed by
+control+1 literal bytes. Otherwise the upper three bits store the length of a
+back reference (with 7 meaning that an additional length byte follows) and the
+lower five bits together with the next byte store its distance.
+*/
+bool decompress_lzf(const uint8_t* input, size_t input_size, size_t output_size, size_t window_size, const lzf_output_callback_t& handle_output)
+{
+  // longest output of a single block (a back reference of 7+255+2 bytes)
+  const size_t max_block_size = 264;
+
+  const uint8_t* const input_end = input + input_size;
+
+  std::vector<uint8_t> window(std::max(window_size, 2 * (lzf_max_distance + max_block_size)));
+  uint8_t* const window_begin = window.data();
+  uint8_t* const window_end = window_begin + window.size();
+
+  uint8_t* output = window_begin;
+  uint8_t* first_pending = window_begin; // the first byte not passed to handle_output yet
+  size_t num_handled_bytes = 0;
+
+  auto flush = [&]() {
+    if(output == first_pending)
+      return;
+    handle_output(first_pending, num_handled_bytes, size_t(output-first_pending));
+    num_handled_bytes += size_t(output-first_pending);
+    first_pending = output;
+  };
+
+  while(input != input_end)
+  {
+    // When the window is full, keep only the bytes back references may still refer to
+    if(size_t(window_end-output) < max_block_size)
+    {
+      flush();
+      const size_t num_kept_bytes = std::min(lzf_max_distance, size_t(output-window_begin));
+      std::memmove(window_begin, output-num_kept_bytes, num_kept_bytes);
+      output = window_begin + num_kept_bytes;
+      first_pending = output;
+    }
+
+    const size_t num_remaining_bytes = output_size - num_handled_bytes - size_t(output-first_pending);
+    const size_t control = *input++;
+
+    if(control < 32)
+    {
+      const size_t length = control + 1;
+      if(Q_UNLIKELY(num_remaining_bytes < length || size_t(input_end-input) < length))
+        return false;
+
+      std::memcpy(output, input, length);
+      output += length;
+      input += length;
+    }else
+    {
+      size_t length = control >> 5;
+      if(length == 7)
+      {
+        if(Q_UNLIKELY(input == input_end))
+          return false;
+        length += *input++;
+      }
+      length += 2;
+
+      if(Q_UNLIKELY(input == input_end))
+        return false;
+      const size_t distance = ((control & 0x1f) << 8) + *input++ + 1;
+
+      if(Q_UNLIKELY(num_remaining_bytes < length || size_t(output-window_begin) < distance))
+        return false;
+
+      // The reference may overlap the output, so copy byte by byte
+      const uint8_t* reference = output - distance;
+      for(size_t i=0; i<length; ++i)
+        *output++ = *reference++;
+    }
+  }
+
+  flush();
+
+  return num_handled_bytes == output_size;
+}
+
+} // namespace pcd_format
@@ -0,0 +1,67 @@
+#ifndef POINTCLOUD_PCD_FILE_FORMAT_HPP_
+#define POINTCLOUD_PCD_FILE_FORMAT_HPP_
+
+#include <pointcloud/buffer.hpp>
+
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace pcd_format {
+
+/*
+Description of the header of a pcd file (the file format of the point cloud library).
+
+Binary bodies store the points row by row. The body of binary_compressed files
+consists of the compressed and uncompressed size (both uint32) followed by the
+LZF compressed fields stored column by column.
+*/
+
+enum class data_t
+{
+  ASCII,
+  BINARY,
+  BINARY_COMPRESSED,
+};
+
+struct field_t
+{
+  std::string name;
+  data_type::base_type_t type;
+  size_t count; // number of values of this field per point
+
+  // number of bytes of all values of this field of a single point
+  size_t size() const;
+};
+
+struct header_t
+{
+  data_t data;
+  std::vector<field_t> fields;
+  size_t num_points;
+  int64_t body_offset; // number of bytes before the first point (the header including the DATA line)
+
+  // number of bytes of a single binary point
+  size_t stride() const;
+
+  // offset of the given field within a binary point
+  size_t offset_of_field(size_t field_index) const;
+};
+
+typedef std::function<void(size_t line, const std::string& message)> error_callback_t;
+
+bool read_header(const std::string& filename, header_t* header, const error_callback_t& error_callback);
+
+// Back references of LZF reach at most this many bytes back
+const size_t lzf_max_distance = size_t(1) << 13;
+
+// Receives the decompressed bytes [first, first+size) stored at data. The (up to lzf_max_distance) bytes decompressed before are still readable before data.
+typedef std::function<void(const uint8_t* data, size_t first, size_t size)> lzf_output_callback_t;
+
+// Decompresses data compressed with LZF piece by piece through a window of window_size bytes, so the whole output never has to be stored at once.
+// Returns false, if the input is corrupt or doesn't decompress to exactly output_size bytes.
+bool decompress_lzf(const uint8_t* input, size_t input_size, size_t output_size, size_t window_size, const lzf_output_callback_t& handle_output);
+
+} // namespace pcd_format
+
+#endif // POINTCLOUD_PCD_FILE_FORMAT_HPP_
@@ -1,9 +1,13 @@
+#ifndef POINTCLOUD_PCVD_FILE_FORMAT_HPP_
+#define POINTCLOUD_PCVD_FILE_FORMAT_HPP_
+
 #include <pointcloud/pointcloud.hpp>
+#include <core_library/checksum.hpp>
 
 namespace pcvd_format {
 
 /*
-The file format consists out of the following sections (plain binary data without any padding in between):
+In file version 1, the file format consists out of the following sections (plain binary data without any padding in between):
 
   HEADER                    // Just header_t from below
   FIELD_DESCRIPTION         // an array of field_description_t[header.number_fields]
@@ -13,8 +17,61 @@ The file format consists out of the following sections (plain binary data withou
   KD_TREE                   // optional - existant if and only if `(flags & 0b1)!=0`. array uint64_t[header.number_points]
   SHADER                    // optional - existant if and only if `(flags & 0b100)!=0`. Consists out of the shader_description_t and the following string data (utf8)
   UNKNOWN_DATA              // optional, only allowed if and only if `(flags&0xf8)!=0`)
+
+Since file version 2: If `(flags & 0b1000)!=0`, the sections POINT_CLOUD_VERTEX_DATA, POINT_CLOUD_DATA and KD_TREE start
+at a multiple of section_alignment bytes (see section_offset). The gap to the preceding section is filled with zeros. This
+allows to map these sections directly into memory. Without this flag, the sections follow each other without padding like
+in version 1. As 0b1000 is a known flag now, UNKNOWN_DATA is only allowed if `(flags&0xf0)!=0`.
+
+Since file version 3, the points are stored in chunks of at most chunks_header.points_per_chunk points. The chunk table
+lists the position and the aabb of each chunk, so readers can skip the chunks outside of a region of interest and read
+the chunks in parallel:
+
+  HEADER
+  CHUNKS_HEADER             // chunks_header_t from below
+  FIELD_DESCRIPTION
+  FIELD_NAMES
+  ORIGIN                    // optional - existant if and only if `(flags & 0b100000)!=0`. Just origin_t from below
+  SHADER                    // optional - existant if and only if `(flags & 0b100)!=0`. Stored here instead of at the end
+  CHUNK_DATA                // the vertex data and point data of the chunks at the offsets given by the chunk table
+  KD_TREE                   // optional - existant if and only if `(flags & 0b1)!=0`. At chunks_header.kd_tree_offset
+  CHUNK_TABLE               // array chunk_description_t[chunks_header.number_chunks] at chunks_header.chunk_table_offset
+
+The points of the point cloud are the points of the chunks in the order of the chunk table. Readers must only rely on the
+offsets stored in the chunk table and in the chunks header, as the sections may be separated by padding or unused bytes.
+With `(flags & 0b1000)!=0`, the PcvdExporter stores the RAW vertex data of all chunks in one aligned block, followed by
+the point data of all chunks in one aligned block and the aligned KD_TREE, so the file can still be mapped like a file of
+version 2. Encoded chunks are written back to back without padding, only the KD_TREE following them is aligned. The
+SHADER and the CHUNK_TABLE are never padded.
+
+Appending points writes the new chunks after the old chunk table, followed by a new CHUNK_TABLE listing the old and the
+new chunks. The chunks header is updated to point to the new table; the old table stays in the file as unused bytes, and
+the kd tree is dropped (its flag cleared), as it doesn't cover the new points.
+
+Chunks with an encoding other than RAW store their vertex data and point data encoded (for example compressed). Then
+vertex_data_size and point_data_size are the number of encoded bytes. Such files can't be mapped.
+
+Since file version 3: If `(flags & 0b10000)!=0`, each chunk description stores the chunk_checksum of the bytes stored for
+the chunk (after encoding), so readers can detect corrupt chunks without decoding them.
+
+Since file version 3: If `(flags & 0b100000)!=0`, the ORIGIN stores the world space position, the coordinates of the
+vertex data are relative to (see PointCloud::origin). It's only stored, if the origin isn't zero, so other files stay
+readable by older readers of version 3.
+
+In file version 3, the flags 0b10000 and 0b100000 are known as well, so UNKNOWN_DATA is only allowed if `(flags&0xc0)!=0`.
 */
 
+constexpr int64_t section_alignment = 4096;
+
+// Returns the offset of a section following directly at the given offset
+inline int64_t section_offset(int64_t offset, uint16_t flags)
+{
+  if(flags & 0b1000)
+    return (offset + section_alignment - 1) / section_alignment * section_alignment;
+  else
+    return offset;
+}
+
 struct header_t
 {
   static constexpr uint32_t expected_macic_number() {
@@ -23,7 +80,7 @@ struct header_t
 
   uint32_t magic_number; // must be `expected_macic_number()`
 
-  uint16_t file_version_number; // the file version (must be 1)
+  uint16_t file_version_number; // the file version (must be 1, 2 or 3)
   uint16_t downwards_compatibility_version_number; // up to which file version is this file downwards compatible
 
   uint64_t number_points; // total number of points
@@ -32,7 +89,7 @@ struct header_t
   uint16_t number_fields; // total number of fields
   uint16_t field_names_total_size; // must be equal to the sum of all field_description_t::name_length
 
-  uint16_t flags; // 0b1: contains kdtree, 0b10: contains vertex_data other bits must be zero if file_version_number==0. 0b100: contains the shader
+  uint16_t flags; // 0b1: contains kdtree, 0b10: contains vertex_data other bits must be zero if file_version_number==0. 0b100: contains the shader. 0b1000: aligned sections (file_version_number>=2). 0b10000: chunks with checksums (file_version_number>=3). 0b100000: contains the origin (file_version_number>=3)
 
   aabb_t aabb;
 
@@ -41,6 +98,48 @@ struct header_t
   uint32_t reserved; // ignored. Must be zero, if file_version_number<=1
 };
 
+// Directly follows the header_t since file version 3
+struct chunks_header_t
+{
+  uint64_t number_chunks;
+  uint64_t points_per_chunk; // maximum number of points of a chunk
+  int64_t chunk_table_offset;
+  int64_t kd_tree_offset; // only used if the file contains the kd tree
+};
+
+enum class encoding_t : uint32_t
+{
+  RAW = 0, // the vertex data and point data are stored as they are
+  DELTA_BIT_PACKING = 1, // the vertex data and point data are encoded separately by chunk_codec::encode
+  QUANTIZED = 2, // the coordinates of the vertex data and the x/y/z properties of the point data are quantized by chunk_codec::quantize. Point data without float x/y/z properties is stored RAW
+  QUANTIZED_DELTA_BIT_PACKING = 3, // like QUANTIZED, but the quantized rows are bit-packed. Point data without float x/y/z properties is stored like DELTA_BIT_PACKING
+};
+typedef encoding_t ENCODING;
+
+struct chunk_description_t
+{
+  int64_t vertex_data_offset; // only used if the file contains vertex data. array of vertex_t[number_points]
+  int64_t point_data_offset; // array of point_data_stride * number_points bytes
+  uint64_t vertex_data_size; // number of bytes stored at vertex_data_offset. Zero, if the file contains no vertex data
+  uint64_t point_data_size; // number of bytes stored at point_data_offset
+  uint32_t number_points; // at least one
+  encoding_t encoding;
+  aabb_t aabb; // of the coordinates of the vertices
+  uint64_t checksum; // chunk_checksum of the stored bytes, if the file contains checksums. Otherwise must be zero
+};
+
+// Checksum over the bytes stored for a chunk (vertex data followed by the point data)
+inline uint64_t chunk_checksum(const uint8_t* vertex_data, uint64_t vertex_data_size, const uint8_t* point_data, uint64_t point_data_size)
+{
+  return checksum64(point_data, size_t(point_data_size), checksum64(vertex_data, size_t(vertex_data_size)));
+}
+
+// The world space position, the coordinates of the vertex data are relative to
+struct origin_t
+{
+  float64_t x, y, z;
+};
+
 struct field_description_t
 {
   uint8_t name_length;
@@ -56,3 +155,5 @@ struct shader_description_t
 };
 
 } // namespace pcvd_format
+
+#endif // POINTCLOUD_PCVD_FILE_FORMAT_HPP_
@@ -0,0 +1,177 @@
+#include <pointcloud/ply_file_format.hpp>
+#include <pointcloud/importer/decompressing_stream.hpp>
+
+#include <pcl/io/ply/ply_parser.h>
+
+typedef pcl::io::ply::ply_parser ply_parser;
+
+namespace ply_format {
+
+template<typename value_type>
+void register_scalar_property(ply_parser::scalar_property_definition_callbacks_type& callbacks, header_t* header);
+template<typename size_type>
+void register_list_properties(ply_parser::list_property_definition_callbacks_type& callbacks, header_t* header);
+int64_t find_body_offset(const std::string& filename);
+
+bool element_t::has_list_properties() const
+{
+  for(const property_t& property : properties)
+    if(property.is_list)
+      return true;
+  return false;
+}
+
+size_t element_t::stride() const
+{
+  Q_ASSERT(!has_list_properties());
+
+  size_t stride = 0;
+  for(const property_t& property : properties)
+    stride += data_type::size_of_type(property.type);
+  return stride;
+}
+
+int header_t::index_of_element(const std::string& name) const
+{
+  for(size_t i=0; i<elements.size(); ++i)
+    if(elements[i].name == name)
+      return int(i);
+  return -1;
+}
+
+int64_t header_t::binary_offset_of_element(int element_index) const
+{
+  Q_ASSERT(element_index>=0 && size_t(element_index)<elements.size());
+
+  if(format == format_t::ASCII || body_offset < 0)
+    return -1;
+
+  int64_t offset = body_offset;
+  for(int i=0; i<element_index; ++i)
+  {
+    if(elements[size_t(i)].has_list_properties())
+      return -1;
+    offset += int64_t(elements[size_t(i)].count * elements[size_t(i)].stride());
+  }
+
+  return offset;
+}
+
+bool read_header(const std::string& filename, header_t* header, const error_callback_t& error_callback)
+{
+  ply_parser parser;
+
+  bool found_format = false;
+  header->elements.clear();
+  header->body_offset = -1;
+
+  parser.error_callback(error_callback);
+
+  parser.format_callback([header, &found_format](pcl::io::ply::format_type format, const std::string&){
+    found_format = true;
+    switch(format)
+    {
+    case pcl::io::ply::ascii_format:
+      header->format = format_t::ASCII;
+      break;
+    case pcl::io::ply::binary_little_endian_format:
+      header->format = format_t::BINARY_LITTLE_ENDIAN;
+      break;
+    case pcl::io::ply::binary_big_endian_format:
+      header->format = format_t::BINARY_BIG_ENDIAN;
+      break;
+    default:
+      found_format = false;
+    }
+  });
+
+  parser.element_definition_callback([header](const std::string& name, std::size_t count){
+    header->elements.push_back(element_t{name, count, std::vector<property_t>()});
+    return ply_parser::element_callbacks_type();
+  });
+
+  ply_parser::scalar_property_definition_callbacks_type scalar_property_callbacks;
+  register_scalar_property<uint8_t>(scalar_property_callbacks, header);
+  register_scalar_property<uint16_t>(scalar_property_callbacks, header);
+  register_scalar_property<uint32_t>(scalar_property_callbacks, header);
+  register_scalar_property<int8_t>(scalar_property_callbacks, header);
+  register_scalar_property<int16_t>(scalar_property_callbacks, header);
+  register_scalar_property<int32_t>(scalar_property_callbacks, header);
+  register_scalar_property<float32_t>(scalar_property_callbacks, header);
+  register_scalar_property<float64_t>(scalar_property_callbacks, header);
+  parser.scalar_property_definition_callbacks(scalar_property_callbacks);
+
+  ply_parser::list_property_definition_callbacks_type list_property_callbacks;
+  register_list_properties<uint8_t>(list_property_callbacks, header);
+  register_list_properties<uint16_t>(list_property_callbacks, header);
+  register_list_properties<uint32_t>(list_property_callbacks, header);
+  parser.list_property_definition_callbacks(list_property_callbacks);
+
+  // Returning false stops the parser right after the header
+  parser.end_header_callback([](){return false;});
+
+  std::unique_ptr<std::istream> stream = DecompressingStream::open(filename);
+  if(!parser.parse(*stream) || !found_format)
+    return false;
+
+  header->body_offset = find_body_offset(filename);
+
+  return header->body_offset >= 0;
+}
+
+template<typename value_type>
+void register_scalar_property(ply_parser::scalar_property_definition_callbacks_type& callbacks, header_t* header)
+{
+  ply_parser::at<value_type>(callbacks) = [header](const std::string&, const std::string& property_name) {
+    Q_ASSERT(!header->elements.empty());
+    header->elements.back().properties.push_back(property_t{property_name, data_type::base_type_of<value_type>::value(), false});
+    return typename ply_parser::scalar_property_callback_type<value_type>::type();
+  };
+}
+
+template<typename size_type, typename value_type>
+void register_list_property(ply_parser::list_property_definition_callbacks_type& callbacks, header_t* header)
+{
+  typedef ply_parser::list_property_definition_callback_type<size_type, value_type> callback_type;
+
+  ply_parser::at<size_type, value_type>(callbacks) = [header](const std::string&, const std::string& property_name) {
+    Q_ASSERT(!header->elements.empty());
+    header->elements.back().properties.push_back(property_t{property_name, data_type::base_type_of<value_type>::value(), true});
+    return boost::tuple<typename callback_type::list_property_begin_callback_type,
+                        typename callback_type::list_property_element_callback_type,
+                        typename callback_type::list_property_end_callback_type>();
+  };
+}
+
+template<typename size_type>
+void register_list_properties(ply_parser::list_property_definition_callbacks_type& callbacks, header_t* header)
+{
+  register_list_property<size_type, uint8_t>(callbacks, header);
+  register_list_property<size_type, uint16_t>(callbacks, header);
+  register_list_property<size_type, uint32_t>(callbacks, header);
+  register_list_property<size_type, int8_t>(callbacks, header);
+  register_list_property<size_type, int16_t>(callbacks, header);
+  register_list_property<size_type, int32_t>(callbacks, header);
+  register_list_property<size_type, float32_t>(callbacks, header);
+  register_list_property<size_type, float64_t>(callbacks, header);
+}
+
+// The ply_parser doesn't tell, where the header ends, so search for the end_header line
+int64_t find_body_offset(const std::string& filename)
+{
+  std::unique_ptr<std::istream> stream = DecompressingStream::open(filename);
+
+  std::string line;
+  while(std::getline(*stream, line, '\n'))
+  {
+    const size_t begin = line.find_first_not_of(" \t\r");
+    const size_t end = line.find_last_not_of(" \t\r");
+
+    if(begin != std::string::npos && line.compare(begin, end+1-begin, "end_header") == 0)
+      return int64_t(stream->tellg());
+  }
+
+  return -1;
+}
+
+} // namespace ply_format
@@ -0,0 +1,65 @@
+#ifndef POINTCLOUD_PLY_FILE_FORMAT_HPP_
+#define POINTCLOUD_PLY_FILE_FORMAT_HPP_
+
+#include <pointcloud/buffer.hpp>
+
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace ply_format {
+
+/*
+Description of the header of a ply file.
+
+The header is read with the ply_parser, but the body is not touched. This allows
+the importers to choose a specialized way for decoding the body depending on the
+layout of the elements.
+*/
+
+enum class format_t
+{
+  ASCII,
+  BINARY_LITTLE_ENDIAN,
+  BINARY_BIG_ENDIAN,
+};
+
+struct property_t
+{
+  std::string name;
+  data_type::base_type_t type; // for lists the type of the list entries
+  bool is_list;
+};
+
+struct element_t
+{
+  std::string name;
+  size_t count;
+  std::vector<property_t> properties;
+
+  bool has_list_properties() const;
+
+  // number of bytes of a single binary element. Only valid for elements without list properties
+  size_t stride() const;
+};
+
+struct header_t
+{
+  format_t format;
+  std::vector<element_t> elements;
+  int64_t body_offset; // number of bytes before the first element (the header including the end_header line)
+
+  // returns -1 if there's no element with the given name
+  int index_of_element(const std::string& name) const;
+
+  // returns the offset of the given element within the file, or -1 if the offset can't be known without parsing the preceding elements
+  int64_t binary_offset_of_element(int element_index) const;
+};
+
+typedef std::function<void(size_t line, const std::string& message)> error_callback_t;
+
+bool read_header(const std::string& filename, header_t* header, const error_callback_t& error_callback);
+
+} // namespace ply_format
+
+#endif // POINTCLOUD_PLY_FILE_FORMAT_HPP_
@@ -1,6 +1,8 @@
 #include <pointcloud/pointcloud.hpp>
 #include <core_library/print.hpp>
+#include <core_library/parallel.hpp>
 #include <cstring>
+#include <fstream>
 
 #include <core_library/types.hpp>
 
@@ -10,8 +12,11 @@
 
 typedef data_type::BASE_TYPE BASE_TYPE;
 
+QVariant value_to_variant(data_type::base_type_t type, const uint8_t* data);
+
 PointCloud::PointCloud()
 {
+  origin = glm::dvec3(0);
   is_valid = false;
 }
 
@@ -19,40 +24,57 @@ PointCloud::PointCloud(PointCloud&& other) = default;
 
 PointCloud& PointCloud::operator=(PointCloud&& other) = default;
 
+PointCloud PointCloud::snapshot() const
+{
+  PointCloud snapshot;
+
+  snapshot.coordinate_color = coordinate_color.snapshot();
+  snapshot.user_data = user_data.snapshot();
+  snapshot.kdtree_index = kdtree_index.snapshot();
+  snapshot.shader = shader;
+  snapshot.aabb = aabb;
+  snapshot.origin = origin;
+  snapshot.num_points = num_points;
+  snapshot.is_valid = is_valid;
+
+  snapshot.user_data_stride = user_data_stride;
+  snapshot.user_data_names = user_data_names;
+  snapshot.user_data_offset = user_data_offset;
+  snapshot.user_data_types = user_data_types;
+  snapshot.deferred_columns = deferred_columns;
+
+  return snapshot;
+}
+
 PointCloud::UserData PointCloud::all_values_of_point(size_t point_index) const
 {
   const int n = user_data_names.length();
 
+  QVector<QString> names = user_data_names;
   QVector<QVariant> values;
-  values.reserve(n);
+  values.reserve(n + deferred_columns.names.length());
 
   const uint8_t* data = user_data.data() + user_data_stride * point_index;
 
   for(int i=0; i<n; ++i)
+    values << value_to_variant(user_data_types[i], data + user_data_offset[i]);
+
+  // The values of the deferred columns are read directly from the file
+  if(!deferred_columns.is_empty())
   {
-    QVariant value;
-    switch(user_data_types[i])
+    std::vector<uint8_t> row(deferred_columns.stride);
+
+    if(deferred_columns.read_row(point_index, row.data()))
     {
-    case BASE_TYPE::UINT8:
-    case BASE_TYPE::UINT16:
-    case BASE_TYPE::UINT32:
-      value = qulonglong(data_type::read_value_from_buffer<uint64_t>(user_data_types[i], data + user_data_offset[i]));
-      break;
-    case BASE_TYPE::INT8:
-    case BASE_TYPE::INT16:
-    case BASE_TYPE::INT32:
-      value = qlonglong(data_type::read_value_from_buffer<int64_t>(user_data_types[i], data + user_data_offset[i]));
-      break;
-    case BASE_TYPE::FLOAT32:
-    case BASE_TYPE::FLOAT64:
-      value = double(data_type::read_value_from_buffer<float64_t>(user_data_types[i], data + user_data_offset[i]));
-      break;
+      for(int i=0; i<deferred_columns.names.length(); ++i)
+      {
+        names << deferred_columns.names[i];
+        values << value_to_variant(deferred_columns.types[i], row.data() + deferred_columns.offset[i]);
+      }
     }
-
-    values << value;
   }
 
-  return UserData{user_data_names, values};
+  return UserData{names, values};
 }
 
 PointCloud::vertex_t PointCloud::vertex(size_t point_index) const
@@ -79,11 +101,13 @@ void PointCloud::clear()
 
   aabb.min_point = glm::vec3(std::numeric_limits<float>::max());
   aabb.max_point = glm::vec3(-std::numeric_limits<float>::max());
+  origin = glm::dvec3(0);
 
   user_data_stride = 0;
   user_data_names.clear();
   user_data_offset.clear();
   user_data_types.clear();
+  deferred_columns = DeferredColumns();
 }
 
 void PointCloud::resize(size_t num_points)
@@ -106,9 +130,103 @@ void PointCloud::set_user_data_format(size_t user_data_stride, QVector<QString>
   this->user_data_types = user_data_types;
 }
 
+bool PointCloud::load_deferred_columns(const QSet<QString>& names, std::function<bool(size_t, size_t)> feedback)
+{
+  QVector<int> columns_to_load;
+  for(int i=0; i<deferred_columns.names.length(); ++i)
+    if(names.contains(deferred_columns.names[i]))
+      columns_to_load << i;
+
+  if(columns_to_load.isEmpty())
+    return true;
+
+  // The new columns are appended to the already loaded ones
+  size_t new_stride = user_data_stride;
+  QVector<QString> new_names = user_data_names;
+  QVector<size_t> new_offset = user_data_offset;
+  QVector<data_type::base_type_t> new_types = user_data_types;
+  for(int column : columns_to_load)
+  {
+    new_names << deferred_columns.names[column];
+    new_offset << new_stride;
+    new_types << deferred_columns.types[column];
+    new_stride += data_type::size_of_type(deferred_columns.types[column]);
+  }
+
+  // With the mapping of the rows, only the pages are read, not copied through a stream.
+  // Without a mapping, the rows are read through a stream block by block.
+  const std::shared_ptr<const Buffer> section = deferred_columns.rows;
+  const bool mapped = section != nullptr;
+
+  std::ifstream stream;
+  if(!mapped)
+  {
+    stream.open(deferred_columns.filename, std::ios_base::in | std::ios_base::binary);
+    stream.seekg(deferred_columns.data_offset);
+    if(!stream)
+      return false;
+  }
+
+  Buffer new_user_data;
+  new_user_data.resize(num_points * new_stride);
+
+  const size_t rows_per_block = glm::max<size_t>(1, (size_t(1) << 24) / deferred_columns.stride);
+  std::vector<uint8_t> block(mapped ? 0 : rows_per_block * deferred_columns.stride);
+
+  const uint8_t* loaded_rows = user_data.const_data();
+  uint8_t* target_rows = new_user_data.data();
+
+  for(size_t first_row=0; first_row<num_points; first_row+=rows_per_block)
+  {
+    const size_t num_rows = glm::min(rows_per_block, num_points-first_row);
+
+    const uint8_t* source_rows = mapped ? section->const_data() + first_row * deferred_columns.stride : nullptr;
+    if(!mapped)
+    {
+      stream.read(reinterpret_cast<char*>(block.data()), std::streamsize(num_rows * deferred_columns.stride));
+      if(!stream)
+        return false;
+      source_rows = block.data();
+    }
+
+    // Gathers the loaded columns and the new columns of each row on all cores
+    parallel_for_ranges(num_rows, [&](size_t, size_t begin, size_t end){
+      for(size_t i=begin; i<end; ++i)
+      {
+        const uint8_t* source_row = source_rows + i * deferred_columns.stride;
+        uint8_t* target_row = target_rows + (first_row+i) * new_stride;
+
+        if(user_data_stride > 0)
+          std::memcpy(target_row, loaded_rows + (first_row+i) * user_data_stride, user_data_stride);
+
+        for(int j=0; j<columns_to_load.length(); ++j)
+        {
+          const int column = columns_to_load[j];
+          std::memcpy(target_row + new_offset[user_data_names.length()+j], source_row + deferred_columns.offset[column], data_type::size_of_type(deferred_columns.types[column]));
+        }
+      }
+    });
+
+    if(!feedback(first_row+num_rows, num_points))
+      return false;
+  }
+
+  user_data = std::move(new_user_data);
+  set_user_data_format(new_stride, new_names, new_offset, new_types);
+
+  for(int i=columns_to_load.length()-1; i>=0; --i)
+  {
+    deferred_columns.names.removeAt(columns_to_load[i]);
+    deferred_columns.offset.removeAt(columns_to_load[i]);
+    deferred_columns.types.removeAt(columns_to_load[i]);
+  }
+
+  return true;
+}
+
 void PointCloud::build_kd_tree(std::function<bool(size_t, size_t)> feedback)
 {
-  kdtree_index.build(aabb, coordinate_color.data(), num_points, stride, feedback);
+  kdtree_index.build(aabb, coordinate_color.const_data(), num_points, stride, feedback);
 }
 
 bool PointCloud::can_build_kdtree() const
@@ -121,6 +239,75 @@ bool PointCloud::has_build_kdtree() const
   return this->num_points>0 && kdtree_index.is_initialized();
 }
 
+QVariant value_to_variant(data_type::base_type_t type, const uint8_t* data)
+{
+  switch(type)
+  {
+  case BASE_TYPE::UINT8:
+  case BASE_TYPE::UINT16:
+  case BASE_TYPE::UINT32:
+    return qulonglong(data_type::read_value_from_buffer<uint64_t>(type, data));
+  case BASE_TYPE::INT8:
+  case BASE_TYPE::INT16:
+  case BASE_TYPE::INT32:
+    return qlonglong(data_type::read_value_from_buffer<int64_t>(type, data));
+  case BASE_TYPE::FLOAT32:
+  case BASE_TYPE::FLOAT64:
+    return double(data_type::read_value_from_buffer<float64_t>(type, data));
+  }
+
+  Q_UNREACHABLE();
+  return QVariant();
+}
+
+// ==== PointCloud::DeferredColumns ====
+
+bool PointCloud::DeferredColumns::is_empty() const
+{
+  return names.isEmpty();
+}
+
+bool PointCloud::DeferredColumns::contains_any(const QSet<QString>& names) const
+{
+  for(const QString& name : this->names)
+    if(names.contains(name))
+      return true;
+  return false;
+}
+
+bool PointCloud::DeferredColumns::open(size_t num_points)
+{
+  rows.reset();
+  stream.reset();
+
+  std::shared_ptr<Buffer> mapping = std::make_shared<Buffer>();
+  if(mapping->map_file(QString::fromStdString(filename), data_offset, num_points * stride))
+  {
+    rows = mapping;
+    return true;
+  }
+
+  stream = std::make_shared<std::ifstream>(filename, std::ios_base::in | std::ios_base::binary);
+  return bool(*stream);
+}
+
+bool PointCloud::DeferredColumns::read_row(size_t point_index, uint8_t* row) const
+{
+  if(rows != nullptr)
+  {
+    std::memcpy(row, rows->const_data() + point_index * stride, stride);
+    return true;
+  }
+
+  if(stream == nullptr)
+    return false;
+
+  stream->clear();
+  stream->seekg(data_offset + int64_t(point_index * stride));
+  stream->read(reinterpret_cast<char*>(row), std::streamsize(stride));
+  return bool(*stream);
+}
+
 QDebug operator<<(QDebug debug, const PointCloud::UserData& userData)
 {
   debug.nospace() << "/==== UserData ====\\\n";
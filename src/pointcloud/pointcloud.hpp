@@ -10,6 +10,9 @@
 #include <QVariant>
 #include <QSet>
 
+#include <iosfwd>
+#include <memory>
+
 /*
 Stores the whole point cloud consisting out of the
 - coordinate_color -- coordinates and colors
@@ -39,6 +42,34 @@ public:
     QVector<QVariant> values;
   };
 
+  /*
+  Columns of the user data, which are still only stored within the file they were imported from (see
+  PcvdImporter::load_used_properties_only). They are not part of user_data and user_data_names until they
+  are loaded with load_deferred_columns.
+
+  The rows are mapped once by open() and the mapping is shared by all copies, so neither picking a point
+  nor loading columns opens the file again. If the rows can't be mapped, a stream kept open reads them.
+  */
+  struct DeferredColumns
+  {
+    std::string filename;
+    int64_t data_offset = 0; // position of the first row within the file
+    size_t stride = 0; // size of a row within the file
+    QVector<QString> names;
+    QVector<size_t> offset; // offset of the column within a row of the file
+    QVector<data_type::base_type_t> types;
+
+    std::shared_ptr<const Buffer> rows; // nullptr, if the rows couldn't be mapped
+    std::shared_ptr<std::ifstream> stream; // only opened, if the rows couldn't be mapped
+
+    bool is_empty() const;
+    bool contains_any(const QSet<QString>& names) const;
+
+    // Maps the rows of the given number of points or opens the stream, if they can't be mapped
+    bool open(size_t num_points);
+    bool read_row(size_t point_index, uint8_t* row) const;
+  };
+
   struct Shader
   {
     QSet<QString> used_properties;
@@ -56,6 +87,7 @@ public:
   KDTreeIndex kdtree_index;
   Shader shader;
   aabb_t aabb;
+  glm::dvec3 origin; // world space position, the coordinates of the vertices are relative to (see LasImporter)
   size_t num_points;
   bool is_valid;
 
@@ -63,11 +95,16 @@ public:
   QVector<QString> user_data_names;
   QVector<size_t> user_data_offset;
   QVector<data_type::base_type_t> user_data_types;
+  DeferredColumns deferred_columns;
 
   PointCloud();
   PointCloud(PointCloud&& other);
   PointCloud& operator=(PointCloud&& other);
 
+  // A consistent copy of the point cloud sharing the buffers with this one, until either of them is changed (see Buffer::snapshot).
+  // Allows working on the point cloud in a background thread, while the user keeps changing it.
+  PointCloud snapshot() const;
+
   constexpr static const size_t stride = sizeof(vertex_t);
   static_assert(stride == sizeof(vertex_t), "size mismatch");
 
@@ -82,6 +119,10 @@ public:
 
   void set_user_data_format(size_t user_data_stride, QVector<QString> user_data_names, QVector<size_t> user_data_offset, QVector<data_type::base_type_t> user_data_types);
 
+  // Appends the given deferred columns to the user data. Returns false, if canceled by the feedback function or if the file couldn't be read
+  // The rows are gathered on all cores from the mapping of the deferred columns (or read through a stream, if they aren't mapped)
+  bool load_deferred_columns(const QSet<QString>& names, std::function<bool(size_t, size_t)> feedback);
+
   void build_kd_tree(std::function<bool(size_t, size_t)> feedback);
   bool can_build_kdtree() const;
   bool has_build_kdtree() const;
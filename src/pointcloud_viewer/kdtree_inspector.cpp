@@ -65,7 +65,11 @@ void KdTreeInspector::build_kdtree()
 
   this->setCanBuildKdTree(false);
 
-  ::build_kdtree(window, this->point_cloud.data());
+  // The point cloud might be unloaded while building the kd-tree in the background
+  QSharedPointer<PointCloud> point_cloud = this->point_cloud;
+  ::build_kdtree(window, point_cloud);
+  if(this->point_cloud != point_cloud)
+    return;
 
   this->setCanBuildKdTree(this->point_cloud->can_build_kdtree());
   this->setHasKdTreeAvailable(this->point_cloud->has_build_kdtree());
@@ -160,8 +164,8 @@ void KdTreeInspector::update_kd_tree_inspection()
     return;
   }
 
-  glm::vec3 point = point_cloud->kdtree_index.point_coordinate(kd_tree_inspection_current_point, point_cloud->coordinate_color.data(), PointCloud::stride);
-  std::pair<aabb_t, aabb_t> aabbs = point_cloud->kdtree_index.aabbs_split_by(kd_tree_inspection_current_point, point_cloud->coordinate_color.data(), PointCloud::stride);
+  glm::vec3 point = point_cloud->kdtree_index.point_coordinate(kd_tree_inspection_current_point, point_cloud->coordinate_color.const_data(), PointCloud::stride);
+  std::pair<aabb_t, aabb_t> aabbs = point_cloud->kdtree_index.aabbs_split_by(kd_tree_inspection_current_point, point_cloud->coordinate_color.const_data(), PointCloud::stride);
 
   if(!this->_left_selected)
     aabbs = std::make_pair(aabbs.second, aabbs.first);
@@ -1,6 +1,8 @@
 #include <core_library/print.hpp>
 #include <pointcloud_viewer/mainwindow.hpp>
+#include <pointcloud_viewer/workers/load_deferred_columns_dialog.hpp>
 
+#include <QMenuBar>
 #include <QMessageBox>
 
 MainWindow::MainWindow()
@@ -62,6 +64,19 @@ bool MainWindow::apply_point_shader(PointCloud::Shader new_shader, bool coordina
   if(!needs_being_rebuilt_for_the_first_time && !had_some_changes)
     return false;
 
+  // Properties left in the file by the importer are loaded on demand
+  if(!load_deferred_columns(this, this->pointcloud.data(), new_shader.used_properties))
+  {
+    QMessageBox::warning(this, "Shader Not Applied", "Can't apply the shader without loading the properties it uses from the file.");
+    this->pointcloud->shader = old_shader;
+    if(!needs_being_rebuilt_for_the_first_time)
+      return false;
+
+    // The points have never been computed, so they are computed with a shader using only loaded properties
+    new_shader = autogenerated_shader;
+    this->pointcloud->shader = new_shader;
+  }
+
   const QSet<QString> properties_provided_by_pointcloud = this->pointcloud->user_data_names.toList().toSet();
   const QSet<QString> properties_requested_by_shader = new_shader.used_properties;
   QStringList properties_requested_by_shader_but_not_provided_by_pointcloud = (properties_requested_by_shader - properties_provided_by_pointcloud).toList();
@@ -93,3 +108,23 @@ bool MainWindow::apply_point_shader(PointCloud::Shader new_shader, bool coordina
 
   return true;
 }
+
+void MainWindow::begin_working_on_snapshot()
+{
+  if(num_workers_on_snapshot++ > 0)
+    return;
+
+  setAcceptDrops(false);
+  working_on_snapshot_changed(true);
+}
+
+void MainWindow::end_working_on_snapshot()
+{
+  Q_ASSERT(num_workers_on_snapshot > 0);
+
+  if(--num_workers_on_snapshot > 0)
+    return;
+
+  setAcceptDrops(true);
+  working_on_snapshot_changed(false);
+}
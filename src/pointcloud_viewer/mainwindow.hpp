@@ -12,6 +12,8 @@
 #include <pointcloud_viewer/point_shader_editor.hpp>
 #include <pointcloud_viewer/flythrough/flythrough.hpp>
 #include <pointcloud_viewer/workers/offline_renderer.hpp>
+#include <pointcloud/importer/point_sampler.hpp>
+#include <pointcloud/importer/property_projection.hpp>
 
 class KeypointList;
 
@@ -27,9 +29,15 @@ public:
 
   bool apply_point_shader(PointCloud::Shader new_shader, bool coordinates_changed, bool colors_changed);
 
+  // While a worker thread reads a snapshot of the point cloud, the shader can still be changed (see Buffer::snapshot).
+  // Only importing, unloading and exporting point clouds is disabled until all workers are finished.
+  void begin_working_on_snapshot();
+  void end_working_on_snapshot();
+
 signals:
   void pointcloud_imported(QSharedPointer<PointCloud> point_cloud);
   void pointcloud_unloaded();
+  void working_on_snapshot_changed(bool working_on_snapshot);
 
 private:
   Viewport viewport;
@@ -51,6 +59,8 @@ private:
   QDockWidget* initDataInspectionDock();
 
   void importPointcloudLayer();
+  void importPointcloudPreview();
+  void importPointcloudProperties();
   void exportPointcloud();
   void openAboutDialog();
 
@@ -71,8 +81,9 @@ protected:
 private:
   QSharedPointer<PointCloud> pointcloud;
   PointCloud::Shader loadedShader;
+  int num_workers_on_snapshot = 0;
 
-  void import_pointcloud(QString filepath);
+  void import_pointcloud(QStringList filepaths, PointSampler::settings_t sampling = PointSampler::settings_t(), PropertyProjection::settings_t projection = PropertyProjection::settings_t());
   void export_pointcloud(QString filepath, QString selectedFilter);
 };
 
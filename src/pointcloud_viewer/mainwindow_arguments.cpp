@@ -1,5 +1,9 @@
 #include <pointcloud_viewer/mainwindow.hpp>
 #include <pointcloud_viewer/workers/import_pointcloud.hpp>
+#include <pointcloud_viewer/workers/load_deferred_columns_dialog.hpp>
+#include <pointcloud/importer/pcvd_importer.hpp>
+#include <pointcloud/exporter/pcvd_compaction.hpp>
+#include <pointcloud/exporter/pcvd_exporter.hpp>
 
 #include <QApplication>
 #include <QSharedPointer>
@@ -14,6 +18,13 @@ void MainWindow::handleApplicationArguments()
     this->noninteractive = true;
   };
 
+  // set by the arguments given before "--data"
+  PointSampler::settings_t sampling;
+  PropertyProjection::settings_t projection;
+
+  // set by the arguments given before "--compact"
+  bool rebuild_kd_tree = false;
+
   for(int argument_index=1; argument_index<arguments.length(); ++argument_index)
   {
     const QString argument = arguments[argument_index];
@@ -32,7 +43,7 @@ void MainWindow::handleApplicationArguments()
 
       const QString path = arguments[argument_index];
 
-      QSharedPointer<PointCloud> point_cloud = import_point_cloud(this, path);
+      QSharedPointer<PointCloud> point_cloud = import_point_cloud(this, path, nullptr, sampling, projection);
 
       if(Q_UNLIKELY(!point_cloud->is_valid))
       {
@@ -41,6 +52,163 @@ void MainWindow::handleApplicationArguments()
       }
 
       pointcloud_imported(point_cloud);
+    }else if(argument == "--verify")
+    {
+      if(argument_index+1 == arguments.length())
+      {
+        qDebug() << "Missing argument after \"--verify\"";
+        std::exit(-1);
+      }
+      argument_index++;
+
+      const QString path = arguments[argument_index];
+
+      // Only compares the chunks with their checksums, the importer prints the reason of a failure
+      PcvdImporter importer(path.toStdString());
+      importer.verify_only = true;
+      importer.import();
+
+      if(importer.state != AbstractPointCloudImporter::SUCCEEDED)
+      {
+        qDebug() << "Verifying" << path << "failed";
+        std::exit(-1);
+      }
+      qDebug() << "Verified" << path;
+      std::exit(0);
+    }else if(argument == "--rebuild-kd-tree")
+    {
+      rebuild_kd_tree = true;
+    }else if(argument == "--compact")
+    {
+      if(argument_index+1 == arguments.length())
+      {
+        qDebug() << "Missing argument after \"--compact\"";
+        std::exit(-1);
+      }
+      argument_index++;
+
+      const QString path = arguments[argument_index];
+
+      if(!compact_pcvd_file(path.toStdString(), rebuild_kd_tree))
+      {
+        qDebug() << "Compacting" << path << "failed";
+        std::exit(-1);
+      }
+      qDebug() << "Compacted" << path;
+      std::exit(0);
+    }else if(argument == "--append")
+    {
+      if(argument_index+1 == arguments.length())
+      {
+        qDebug() << "Missing argument after \"--append\"";
+        std::exit(-1);
+      }
+      argument_index++;
+
+      const QString path = arguments[argument_index];
+
+      if(pointcloud.isNull() || !pointcloud->is_valid)
+      {
+        qDebug() << "No pointcloud to append to" << path << "(\"--data\" must be given before \"--append\")";
+        std::exit(-1);
+      }
+
+      // The appended points must have all properties of the file
+      if(!load_deferred_columns(this, pointcloud.data(), pointcloud->deferred_columns.names.toList().toSet()))
+        std::exit(-1);
+
+      PcvdExporter exporter(path.toStdString(), *pointcloud);
+      exporter.append = true;
+      exporter.export_now();
+
+      if(exporter.state != AbstractPointCloudExporter::SUCCEEDED)
+      {
+        qDebug() << "Appending to" << path << "failed";
+        std::exit(-1);
+      }
+      qDebug() << "Appended to" << path;
+      std::exit(0);
+    }else if(argument == "--every-nth-point" || argument == "--max-points")
+    {
+      if(argument_index+1 == arguments.length())
+      {
+        qDebug() << "Missing argument after" << argument;
+        std::exit(-1);
+      }
+      argument_index++;
+
+      const QString parameter = arguments[argument_index];
+
+      bool ok;
+      const qulonglong value = parameter.toULongLong(&ok);
+
+      if(!ok || (argument == "--every-nth-point" && value == 0))
+      {
+        qDebug() << "Invalid value" << parameter << "after" << argument;
+        std::exit(-1);
+      }
+
+      if(argument == "--every-nth-point")
+        sampling.every_nth_point = size_t(value);
+      else
+        sampling.max_num_points = size_t(value);
+    }else if(argument == "--crop")
+    {
+      if(argument_index+1 == arguments.length())
+      {
+        qDebug() << "Missing argument after \"--crop\"";
+        std::exit(-1);
+      }
+      argument_index++;
+
+      const QString parameter = arguments[argument_index];
+      const QStringList values = parameter.split(',');
+
+      bool ok = values.length() == 6;
+      glm::vec3 bounds[2];
+      for(int i=0; i<values.length() && ok; ++i)
+        bounds[i/3][i%3] = values[i].toFloat(&ok);
+
+      if(!ok)
+      {
+        qDebug() << "Invalid value" << parameter << "after \"--crop\"";
+        std::exit(-1);
+      }
+
+      sampling.crop = true;
+      sampling.crop_aabb.min_point = glm::min(bounds[0], bounds[1]);
+      sampling.crop_aabb.max_point = glm::max(bounds[0], bounds[1]);
+    }else if(argument == "--drop-properties" || argument == "--property-types")
+    {
+      if(argument_index+1 == arguments.length())
+      {
+        qDebug() << "Missing argument after" << argument;
+        std::exit(-1);
+      }
+      argument_index++;
+
+      const QString parameter = arguments[argument_index];
+
+      for(const QString& value : parameter.split(',', QString::SkipEmptyParts))
+      {
+        if(argument == "--drop-properties")
+        {
+          projection.dropped_properties << value.trimmed();
+          continue;
+        }
+
+        const QStringList name_and_type = value.split(':');
+        data_type::base_type_t type;
+        if(name_and_type.length() != 2 || !PropertyProjection::parse_type(name_and_type[1], &type))
+        {
+          qDebug() << "Invalid value" << parameter << "after" << argument;
+          std::exit(-1);
+        }
+        projection.demoted_types[name_and_type[0].trimmed()] = type;
+      }
+    }else if(argument == "--float64-as-float32")
+    {
+      projection.demote_float64 = true;
     }else if(argument == "--camera-path")
     {
       if(argument_index+1 == arguments.length())
@@ -96,6 +264,28 @@ void MainWindow::handleApplicationArguments()
                   "                     don't require manual input)                                \n"
                   "\n"
                   "--data <FILE>        Pointcloud file to load                                    \n"
+                  "--verify <FILE>      Verify the checksums of a pcvd file without loading it and \n"
+                  "                     exit                                                       \n"
+                  "--compact <FILE>     Rewrite a pcvd file, which points were appended to, in one \n"
+                  "                     piece and exit                                             \n"
+                  "--rebuild-kd-tree    Build the kd-tree when compacting (must be given before     \n"
+                  "                     --compact)                                                 \n"
+                  "--append <FILE>      Append the pointcloud loaded by --data to a pcvd file with \n"
+                  "                     the same properties (or create it) and exit                \n"
+                  "\n"
+                  "Preview options (must be given before --data):\n"
+                  "--every-nth-point <INTEGER>  Load only every nth point                          \n"
+                  "--max-points <INTEGER>  Load a random sample of at most this many points        \n"
+                  "--crop <MINX,MINY,MINZ,MAXX,MAXY,MAXZ>  Load only the points within the box     \n"
+                  "\n"
+                  "Property options for ply files (must be given before --data):\n"
+                  "--drop-properties <NAME,...>  Don't load these properties (except coordinates    \n"
+                  "                     and colors)                                                \n"
+                  "--property-types <NAME:TYPE,...>  Store these properties with the given type,    \n"
+                  "                     for example intensity:uint8. Properties with values out of \n"
+                  "                     the range of the type keep their type                      \n"
+                  "--float64-as-float32 Store all float64 properties as float32                    \n"
+                  "\n"
                   "--camera-path <FILE> The path of the camera                                     \n"
                   "\n"
                   "--output_dir <DIR>   Where to save the rendered image files                     \n"
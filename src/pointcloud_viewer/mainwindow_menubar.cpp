@@ -1,6 +1,8 @@
 #include <pointcloud_viewer/mainwindow.hpp>
 #include <pointcloud_viewer/workers/import_pointcloud.hpp>
+#include <pointcloud_viewer/workers/import_cache.hpp>
 #include <pointcloud_viewer/workers/export_pointcloud.hpp>
+#include <pointcloud_viewer/workers/load_deferred_columns_dialog.hpp>
 #include <pointcloud_viewer/visualizations.hpp>
 #include <pointcloud_viewer/version_text.hpp>
 #include <pointcloud_viewer/usability_scheme.hpp>
@@ -8,9 +10,11 @@
 #include <pointcloud/exporter/abstract_exporter.hpp>
 
 #include <QMenuBar>
+#include <QActionGroup>
 #include <QMimeData>
 #include <QFileDialog>
 #include <QApplication>
+#include <QSettings>
 
 void MainWindow::initMenuBar()
 {
@@ -21,11 +25,26 @@ void MainWindow::initMenuBar()
   // ======== Project ==================================================================================================
   QMenu* menu_project = menuBar->addMenu("&Project");
   QAction* import_pointcloud_layers = menu_project->addAction("&Import Pointcloud");
+  QAction* import_pointcloud_preview = menu_project->addAction("Import &Preview");
+  QAction* import_pointcloud_properties = menu_project->addAction("Import Selected P&roperties");
   QAction* export_pointcloud = menu_project->addAction("&Save Pointcloud");
+  menu_project->addSeparator();
+  QAction* load_used_properties_only = menu_project->addAction("Load &Used Properties Only");
+  QAction* cache_imported_pointclouds = menu_project->addAction("&Cache Imported Pointclouds");
+  QMenu* menu_pcvd_read_mode = menu_project->addMenu("Load Pcvd Files &By");
+  QAction* pcvd_read_mode_mapping = menu_pcvd_read_mode->addAction("&Mapping into Memory");
+  QAction* pcvd_read_mode_stream = menu_pcvd_read_mode->addAction("&Streaming");
+  QAction* pcvd_read_mode_parallel = menu_pcvd_read_mode->addAction("&Parallel Reads");
 
   import_pointcloud_layers->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_I));
   connect(import_pointcloud_layers, &QAction::triggered, this, &MainWindow::importPointcloudLayer);
 
+  import_pointcloud_preview->setToolTip("Import only a subsampled or cropped part of the pointcloud");
+  connect(import_pointcloud_preview, &QAction::triggered, this, &MainWindow::importPointcloudPreview);
+
+  import_pointcloud_properties->setToolTip("Import a ply file without some of its properties or with smaller types");
+  connect(import_pointcloud_properties, &QAction::triggered, this, &MainWindow::importPointcloudProperties);
+
   export_pointcloud->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_S));
   export_pointcloud->setEnabled(false);
   connect(export_pointcloud, &QAction::triggered, this, &MainWindow::exportPointcloud);
@@ -36,6 +55,50 @@ void MainWindow::initMenuBar()
     export_pointcloud->setEnabled(true);
   });
 
+  // Workers on a snapshot run nested event loops, which must not import, unload or export another point cloud
+  connect(this, &MainWindow::working_on_snapshot_changed, [this, import_pointcloud_layers, import_pointcloud_preview, import_pointcloud_properties, export_pointcloud](bool working_on_snapshot){
+    import_pointcloud_layers->setEnabled(!working_on_snapshot);
+    import_pointcloud_preview->setEnabled(!working_on_snapshot);
+    import_pointcloud_properties->setEnabled(!working_on_snapshot);
+    export_pointcloud->setEnabled(!working_on_snapshot && pointcloud != nullptr);
+  });
+
+  load_used_properties_only->setCheckable(true);
+  load_used_properties_only->setChecked(QSettings().value("Import/loadUsedPropertiesOnly", false).toBool());
+  load_used_properties_only->setToolTip("Leave the properties of pcvd files not used by the stored shader in the file until they are needed");
+  connect(load_used_properties_only, &QAction::toggled, [](bool checked){
+    QSettings settings;
+    settings.setValue("Import/loadUsedPropertiesOnly", checked);
+  });
+
+  cache_imported_pointclouds->setCheckable(true);
+  cache_imported_pointclouds->setChecked(is_import_cache_enabled());
+  cache_imported_pointclouds->setToolTip("Store imported pointclouds together with their kd-tree as pcvd files in a cache directory, so importing them again is much faster");
+  connect(cache_imported_pointclouds, &QAction::toggled, [](bool checked){
+    set_import_cache_enabled(checked);
+  });
+
+  // Only one of the read modes can be chosen
+  QActionGroup* pcvd_read_modes = new QActionGroup(menu_pcvd_read_mode);
+  const QString pcvd_read_mode = QSettings().value("Import/pcvdReadMode", "mapping").toString();
+  auto init_pcvd_read_mode = [this, pcvd_read_modes, pcvd_read_mode](QAction* action, QString value, QString tooltip){
+    action->setCheckable(true);
+    action->setChecked(value == pcvd_read_mode);
+    action->setToolTip(tooltip);
+    pcvd_read_modes->addAction(action);
+    connect(action, &QAction::toggled, [value](bool checked){
+      if(!checked)
+        return;
+      QSettings settings;
+      settings.setValue("Import/pcvdReadMode", value);
+    });
+  };
+  init_pcvd_read_mode(pcvd_read_mode_mapping, "mapping", "Map the sections of pcvd files into memory, so opening them is nearly instant and only the accessed pages are loaded");
+  init_pcvd_read_mode(pcvd_read_mode_stream, "stream", "Read pcvd files completely with a single stream");
+  init_pcvd_read_mode(pcvd_read_mode_parallel, "parallel", "Read pcvd files completely with many parallel reads, which is faster on fast drives");
+  if(pcvd_read_modes->checkedAction() == nullptr)
+    pcvd_read_mode_mapping->setChecked(true);
+
   // ======== Flythrough ===============================================================================================
   QMenu* menu_flythrough = menuBar->addMenu("&Flythrough");
   QAction* action_flythrough_export_path = menu_flythrough->addAction("&Export Path");
@@ -148,13 +211,16 @@ void MainWindow::initMenuBar()
 void MainWindow::dropEvent(QDropEvent *ev)
 {
   QList<QUrl> urls = ev->mimeData()->urls();
+  QStringList files_to_import;
   foreach (QUrl url, urls) {
     const QString file_to_import = url.path();
-    if(file_to_import.isEmpty())
-      return;
-    import_pointcloud(file_to_import);
-    return;
+    if(!file_to_import.isEmpty())
+      files_to_import << file_to_import;
   }
+
+  if(files_to_import.isEmpty())
+    return;
+  import_pointcloud(files_to_import);
 }
 
 void MainWindow::dragEnterEvent(QDragEnterEvent *ev)
@@ -167,20 +233,51 @@ void MainWindow::closeEvent(QCloseEvent*)
   QApplication::quit();
 }
 
-void MainWindow::import_pointcloud(QString filepath)
+void MainWindow::import_pointcloud(QStringList filepaths, PointSampler::settings_t sampling, PropertyProjection::settings_t projection)
 {
   pointcloud_unloaded();
 
-  QSharedPointer<PointCloud> pointcloud = import_point_cloud(this, filepath);
+  // The window stays responsive while importing, so make sure no other import is started in the meantime
+  menuBar()->setEnabled(false);
+  setAcceptDrops(false);
+
+  // Several files are merged into a single point cloud
+  QSharedPointer<PointCloud> pointcloud = filepaths.length() > 1
+      ? import_point_clouds(this, filepaths, sampling)
+      : import_point_cloud(this, filepaths.first(), [this](const PointCloud& pointcloud, size_t num_available_points){
+    viewport.load_available_points(pointcloud, num_available_points);
+    viewport.navigation.handle_new_point_cloud();
+  }, sampling, projection);
+
+  menuBar()->setEnabled(true);
+  setAcceptDrops(true);
 
   if(pointcloud && pointcloud->is_valid && pointcloud->num_points>0)
+  {
     pointcloud_imported(pointcloud);
+
+    // The cache is only useful for complete point clouds. It's written in the background
+    if(filepaths.length() == 1 && !sampling.is_active() && !projection.is_active() && find_import_cache_file(filepaths.first()).isEmpty())
+      store_import_cache_file(filepaths.first(), *pointcloud);
+  }else
+  {
+    pointcloud_unloaded();
+  }
 }
 
 void MainWindow::export_pointcloud(QString filepath, QString selectedFilter)
 {
   if(pointcloud && pointcloud->is_valid && pointcloud->num_points>0)
+  {
+    // The exported file should contain all properties
+    if(!load_deferred_columns(this, pointcloud.data(), pointcloud->deferred_columns.names.toList().toSet()))
+      return;
+
+    // The window stays responsive while exporting, so make sure no other import or export is started in the meantime
+    begin_working_on_snapshot();
     export_point_cloud(this, filepath, *pointcloud, selectedFilter);
+    end_working_on_snapshot();
+  }
 }
 
 void MainWindow::exportCameraPath()
@@ -218,16 +315,50 @@ void MainWindow::importCameraPath()
 #include <QScrollBar>
 
 void MainWindow::importPointcloudLayer()
+{
+  QStringList files_to_import = QFileDialog::getOpenFileNames(this,
+                                                              "Select pointclouds to import",
+                                                              ".",
+                                                              AbstractPointCloudImporter::allSupportedFiletypes());
+
+  if(files_to_import.isEmpty())
+    return;
+
+  import_pointcloud(files_to_import);
+}
+
+void MainWindow::importPointcloudPreview()
+{
+  PointSampler::settings_t sampling;
+  if(!ask_for_preview_settings(this, &sampling))
+    return;
+
+  QStringList files_to_import = QFileDialog::getOpenFileNames(this,
+                                                              "Select pointclouds to preview",
+                                                              ".",
+                                                              AbstractPointCloudImporter::allSupportedFiletypes());
+
+  if(files_to_import.isEmpty())
+    return;
+
+  import_pointcloud(files_to_import, sampling);
+}
+
+void MainWindow::importPointcloudProperties()
 {
   QString file_to_import = QFileDialog::getOpenFileName(this,
                                                          "Select pointcloud to import",
                                                          ".",
-                                                         AbstractPointCloudImporter::allSupportedFiletypes());
+                                                         "PLY (*.ply *.ply.gz *.ply.zst)");
 
   if(file_to_import.isEmpty())
     return;
 
-  import_pointcloud(file_to_import);
+  PropertyProjection::settings_t projection;
+  if(!ask_for_property_projection(this, file_to_import, &projection))
+    return;
+
+  import_pointcloud(QStringList() << file_to_import, PointSampler::settings_t(), projection);
 }
 
 void MainWindow::exportPointcloud()
@@ -244,7 +244,35 @@ PointCloud::Shader PointShaderEditor::autogenerate(const PointCloud* pointcloud)
 
       QtNodes::Node& coordinates_node = flowScene->createNode(std::move(model));
       set_node_position(coordinates_node, QPointF(0., 0.25));
-      flowScene->createConnection(outputNode, 0, coordinates_node, 0);
+
+      // The vertices are relative to the origin of the point cloud (for example of las files). The origin is subtracted in double precision.
+      if(pointcloud->origin != glm::dvec3(0))
+      {
+        // A double literal needs a fraction or an exponent besides its suffix
+        auto double_literal = [](double value) {
+          QString literal = QString::number(value, 'g', 17);
+          if(!literal.contains('.') && !literal.contains('e'))
+            literal += ".0";
+          return literal + "lf";
+        };
+
+        std::unique_ptr<ValueNode> origin_model = std::make_unique<ValueNode>();
+        origin_model->set_value("dvec3(" + double_literal(pointcloud->origin.x) + ", " + double_literal(pointcloud->origin.y) + ", " + double_literal(pointcloud->origin.z) + ")", VALUE_TYPE::DVEC3);
+        QtNodes::Node& origin_node = flowScene->createNode(std::move(origin_model));
+        set_node_position(origin_node, QPointF(0., 0.));
+
+        std::unique_ptr<MathOperatorNode> subtract_model = std::make_unique<MathOperatorNode>();
+        subtract_model->set_operator("-");
+        QtNodes::Node& subtract_node = flowScene->createNode(std::move(subtract_model));
+        set_node_position(subtract_node, QPointF(0.5, 0.25));
+
+        flowScene->createConnection(subtract_node, 0, coordinates_node, 0);
+        flowScene->createConnection(subtract_node, 1, origin_node, 0);
+        flowScene->createConnection(outputNode, 0, subtract_node, 0);
+      }else
+      {
+        flowScene->createConnection(outputNode, 0, coordinates_node, 0);
+      }
     }
   }
 
@@ -321,6 +349,7 @@ std::shared_ptr<QtNodes::DataModelRegistry> PointShaderEditor::qt_nodes_model_re
   }else
   {
     supportedPropertyNames << currentPointcloud->user_data_names.toList();
+    supportedPropertyNames << currentPointcloud->deferred_columns.names.toList();
 
     for(QString expected_property : currentPointcloud->shader.used_properties)
       if(!supportedPropertyNames.contains(expected_property))
@@ -331,6 +360,8 @@ std::shared_ptr<QtNodes::DataModelRegistry> PointShaderEditor::qt_nodes_model_re
 
     for(int i=0; i<currentPointcloud->user_data_names.length(); ++i)
       base_type_for_name[currentPointcloud->user_data_names[i]] = currentPointcloud->user_data_types[i];
+    for(int i=0; i<currentPointcloud->deferred_columns.names.length(); ++i)
+      base_type_for_name[currentPointcloud->deferred_columns.names[i]] = currentPointcloud->deferred_columns.types[i];
   }
 
   if(supportedPropertyNames.isEmpty() && missingPropertyNames.isEmpty())
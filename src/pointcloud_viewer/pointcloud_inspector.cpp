@@ -66,10 +66,12 @@ void PointCloudInspector::pick_point(glm::ivec2 pixel)
                         &viewport);
     msg_box.setModal(true);
 
+    // The point cloud might be unloaded while building the kd-tree in the background
+    QSharedPointer<PointCloud> point_cloud = this->point_cloud;
     if(msg_box.exec() == QMessageBox::Yes)
-      ::build_kdtree(&viewport, this->point_cloud.data());
+      ::build_kdtree(&viewport, point_cloud);
 
-    if(!point_cloud->has_build_kdtree())
+    if(this->point_cloud != point_cloud || !point_cloud->has_build_kdtree())
       return;
   }
 
@@ -87,7 +89,7 @@ void PointCloudInspector::pick_point(glm::ivec2 pixel)
 
   viewport.visualization().set_picked_cone(cone);
 
-  KDTreeIndex::point_index_t point = point_cloud->kdtree_index.pick_point(cone, point_cloud->coordinate_color.data(), PointCloud::stride);
+  KDTreeIndex::point_index_t point = point_cloud->kdtree_index.pick_point(cone, point_cloud->coordinate_color.const_data(), PointCloud::stride);
 
   setSelectedPoint(point);
 }
@@ -57,6 +57,7 @@ void Viewport::unload_all_point_clouds()
 {
   point_renderer->clear_buffer();
   _aabb = aabb_t::invalid();
+  num_progressively_loaded_points = 0;
   this->point_cloud.clear();
 
   this->update();
@@ -67,14 +68,40 @@ void Viewport::load_point_cloud(QSharedPointer<PointCloud> point_cloud)
   this->point_cloud = point_cloud;
 
   _aabb = point_cloud->aabb;
+  num_progressively_loaded_points = 0;
 
   this->makeCurrent();
-  point_renderer->load_points(point_cloud->coordinate_color.data(), GLsizei(point_cloud->num_points));
+  point_renderer->load_points(point_cloud->coordinate_color.const_data(), GLsizei(point_cloud->num_points));
   this->doneCurrent();
 
   this->update();
 }
 
+void Viewport::load_available_points(const PointCloud& point_cloud, size_t num_available_points)
+{
+  Q_ASSERT(num_available_points <= point_cloud.num_points);
+
+  if(num_available_points <= num_progressively_loaded_points)
+    return;
+
+  const size_t first_point = num_progressively_loaded_points;
+  const size_t num_new_points = num_available_points - first_point;
+
+  this->makeCurrent();
+  if(first_point == 0)
+    point_renderer->allocate_points(GLsizei(point_cloud.num_points));
+  point_renderer->load_point_range(point_cloud.coordinate_color.data() + first_point * PointCloud::stride, GLsizei(first_point), GLsizei(num_new_points));
+  this->doneCurrent();
+
+  const PointCloud::vertex_t* vertices = point_cloud.begin();
+  for(size_t i=first_point; i<num_available_points; ++i)
+    _aabb |= vertices[i].coordinate;
+
+  num_progressively_loaded_points = num_available_points;
+
+  this->update();
+}
+
 bool Viewport::reapply_point_shader(bool coordinates_were_changed)
 {
   this->makeCurrent();
@@ -86,7 +113,7 @@ bool Viewport::reapply_point_shader(bool coordinates_were_changed)
     return false;
   }
 
-  point_renderer->load_points(point_cloud->coordinate_color.data(), GLsizei(point_cloud->num_points));
+  point_renderer->load_points(point_cloud->coordinate_color.const_data(), GLsizei(point_cloud->num_points));
 
   if(coordinates_were_changed)
   {
@@ -36,6 +36,10 @@ public:
   void unload_all_point_clouds();
   void load_point_cloud(QSharedPointer<PointCloud> point_cloud);
 
+  // Shows the first num_available_points points of a point cloud, which is still being imported.
+  // The point cloud must not be reallocated until load_point_cloud or unload_all_point_clouds is called.
+  void load_available_points(const PointCloud& point_cloud, size_t num_available_points);
+
   // Only MainWindow::apply_point_shader is allowed to call this function
   bool reapply_point_shader(bool reapply_point_shader);
 
@@ -83,6 +87,7 @@ private:
 
   aabb_t _aabb = aabb_t::invalid();
   QSharedPointer<PointCloud> point_cloud;
+  size_t num_progressively_loaded_points = 0;
   size_t next_handle = 0;
   int m_backgroundColor = 0;
   int m_pointSize = 1;
@@ -1,11 +1,15 @@
 #include <pointcloud_viewer/workers/export_pointcloud.hpp>
+#include <pointcloud_viewer/workers/progress_polling.hpp>
 #include <pointcloud_viewer/mainwindow.hpp>
 #include <pointcloud/exporter/abstract_exporter.hpp>
+#include <pointcloud/exporter/pcvd_exporter.hpp>
 #include <core_library/print.hpp>
 #include <core_library/types.hpp>
 
 #include <QDebug>
 #include <QFileInfo>
+#include <QInputDialog>
+#include <QSettings>
 #include <QThread>
 #include <QMessageBox>
 #include <QCoreApplication>
@@ -24,12 +28,28 @@ bool export_point_cloud(QWidget* parent, QString filepath, const PointCloud& poi
 
   QString suffix = file.suffix();
 
-  QSharedPointer<AbstractPointCloudExporter> exporter = AbstractPointCloudExporter::exporterForSuffix(selectedFilter, filepath_std, pointcloud);
+  // The exporter works on a snapshot, so the user can keep navigating and changing the shader while exporting
+  const PointCloud snapshot = pointcloud.snapshot();
+
+  QSharedPointer<AbstractPointCloudExporter> exporter = AbstractPointCloudExporter::exporterForSuffix(selectedFilter, filepath_std, snapshot);
 
   Q_ASSERT(exporter != nullptr);
 
+  // The precision of quantized coordinates is chosen by the user
+  PcvdExporter* pcvd_exporter = dynamic_cast<PcvdExporter*>(exporter.data());
+  if(pcvd_exporter != nullptr && pcvd_exporter->quantization_precision > 0)
+  {
+    bool ok = false;
+    const double precision = QInputDialog::getDouble(parent, "Quantized Export", "Precision of the coordinates:", pcvd_exporter->quantization_precision, 1.e-9, 1.e9, 9, &ok);
+    if(!ok)
+      return false;
+
+    pcvd_exporter->quantization_precision = precision;
+    QSettings().setValue("Export/quantizationPrecision", precision);
+  }
+
   QProgressDialog progressDialog(QString("Exporting Pointcloud \n<%1>").arg(file.fileName()), "&Abort", 0, AbstractPointCloudExporter::progress_max(), parent);
-  progressDialog.setWindowModality(Qt::ApplicationModal);
+  progressDialog.setWindowModality(Qt::NonModal);
 
   progressDialog.show();
 
@@ -38,9 +58,8 @@ bool export_point_cloud(QWidget* parent, QString filepath, const PointCloud& poi
 
   bool waiting = true;
 
-  QObject::connect(exporter.data(), &AbstractPointCloudExporter::update_progress, &progressDialog, &QProgressDialog::setValue);
   QObject::connect(exporter.data(), &AbstractPointCloudExporter::finished, &thread, &QThread::quit);
-  QObject::connect(&progressDialog, &QProgressDialog::canceled, exporter.data(), &AbstractPointCloudExporter::cancel);
+  poll_progress(&progressDialog, &exporter->progress);
   QObject::connect(&thread, &QThread::started, exporter.data(), &AbstractPointCloudExporter::export_now);
   QObject::connect(&thread, &QThread::finished, [&waiting](){waiting=false;});
 
@@ -0,0 +1,186 @@
+#include <pointcloud_viewer/workers/import_cache.hpp>
+#include <pointcloud/exporter/pcvd_exporter.hpp>
+#include <core_library/print.hpp>
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+// The cache files, which are written in the background right now
+QSet<QString> files_being_stored;
+
+QDir cache_directory()
+{
+  QSettings settings;
+  const QString default_directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/imported_pointclouds";
+
+  return QDir(settings.value("Import/Cache/directory", default_directory).toString());
+}
+
+// The signature of the file is part of the name, so modifying the file invalidates the cache
+QString cache_file_name(const QFileInfo& file)
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+
+  hash.addData(file.absoluteFilePath().toUtf8());
+  hash.addData(QByteArray::number(file.size()));
+  hash.addData(QByteArray::number(file.lastModified().toMSecsSinceEpoch()));
+
+  return QString::fromLatin1(hash.result().toHex()) + ".pcvd";
+}
+
+QString last_used_key(const QFileInfo& cache_file)
+{
+  return QString("Import/Cache/lastUsed/%0").arg(cache_file.completeBaseName());
+}
+
+void mark_as_used(const QFileInfo& cache_file)
+{
+  QSettings settings;
+  settings.setValue(last_used_key(cache_file), QDateTime::currentDateTimeUtc());
+}
+
+QDateTime last_used(const QSettings& settings, const QFileInfo& cache_file)
+{
+  return settings.value(last_used_key(cache_file), cache_file.lastModified().toUTC()).toDateTime();
+}
+
+// Removes the least recently used files until the limits given by the settings are met
+void evict_least_recently_used(const QDir& directory, const QString& keep)
+{
+  QSettings settings;
+
+  const qint64 max_size = settings.value("Import/Cache/maxSizeMB", 16384).toLongLong() * 1024 * 1024;
+  const int max_num_files = settings.value("Import/Cache/maxNumFiles", 32).toInt();
+
+  QFileInfoList cache_files = directory.entryInfoList(QStringList{"*.pcvd"}, QDir::Files);
+
+  std::sort(cache_files.begin(), cache_files.end(), [&settings](const QFileInfo& a, const QFileInfo& b){
+    return last_used(settings, a) < last_used(settings, b);
+  });
+
+  qint64 total_size = 0;
+  for(const QFileInfo& cache_file : cache_files)
+    total_size += cache_file.size();
+  int num_files = cache_files.length();
+
+  for(const QFileInfo& cache_file : cache_files)
+  {
+    if(total_size <= max_size && num_files <= max_num_files)
+      break;
+    if(cache_file.absoluteFilePath() == keep)
+      continue;
+
+    remove_import_cache_file(cache_file.absoluteFilePath());
+    total_size -= cache_file.size();
+    num_files--;
+  }
+}
+
+} // anonymous namespace
+
+bool is_import_cache_enabled()
+{
+  return QSettings().value("Import/Cache/enabled", false).toBool();
+}
+
+void set_import_cache_enabled(bool enabled)
+{
+  QSettings settings;
+  settings.setValue("Import/Cache/enabled", enabled);
+}
+
+QString find_import_cache_file(QString filepath)
+{
+  if(!is_import_cache_enabled())
+    return QString();
+
+  QFileInfo cache_file(cache_directory().absoluteFilePath(cache_file_name(QFileInfo(filepath))));
+
+  if(!cache_file.exists())
+    return QString();
+
+  mark_as_used(cache_file);
+
+  return cache_file.absoluteFilePath();
+}
+
+void remove_import_cache_file(QString cache_file)
+{
+  QFile::remove(cache_file);
+
+  QSettings settings;
+  settings.remove(last_used_key(QFileInfo(cache_file)));
+}
+
+bool store_import_cache_file(QString filepath, const PointCloud& pointcloud)
+{
+  QFileInfo file(filepath);
+
+  // pcvd files are already fast to load
+  if(!is_import_cache_enabled() || file.suffix().toLower() == "pcvd")
+    return false;
+  if(!pointcloud.is_valid || pointcloud.num_points == 0 || !pointcloud.deferred_columns.names.isEmpty())
+    return false;
+
+  QDir directory = cache_directory();
+  if(!directory.mkpath("."))
+  {
+    println_error("Couldn't create the import cache directory ", directory.absolutePath().toStdString());
+    return false;
+  }
+
+  const QString cache_file = directory.absoluteFilePath(cache_file_name(file));
+  if(QFileInfo(cache_file).exists() || files_being_stored.contains(cache_file))
+    return false;
+  files_being_stored.insert(cache_file);
+
+  // The exporter works on a snapshot, so the user can keep working with the point cloud.
+  // It writes a sibling file first and renames it, so an aborted export never leaves a truncated cache file behind.
+  std::shared_ptr<PointCloud> snapshot = std::make_shared<PointCloud>(pointcloud.snapshot());
+  std::shared_ptr<PcvdExporter> exporter = std::make_shared<PcvdExporter>(cache_file.toStdString(), *snapshot);
+
+  QThread* thread = new QThread;
+  exporter->moveToThread(thread);
+
+  QObject::connect(exporter.get(), &AbstractPointCloudExporter::finished, thread, &QThread::quit);
+  QObject::connect(thread, &QThread::started, exporter.get(), &AbstractPointCloudExporter::export_now);
+
+  // Quitting the application cancels the export
+  QObject::connect(qApp, &QCoreApplication::aboutToQuit, thread, [thread, exporter](){
+    exporter->progress.cancel();
+    thread->wait();
+  });
+
+  QObject::connect(thread, &QThread::finished, qApp, [thread, exporter, snapshot, cache_file, directory](){
+    files_being_stored.remove(cache_file);
+
+    if(exporter->state == AbstractPointCloudExporter::SUCCEEDED)
+    {
+      mark_as_used(QFileInfo(cache_file));
+      evict_least_recently_used(directory, cache_file);
+    }else if(exporter->state != AbstractPointCloudExporter::CANCELED)
+    {
+      println_error("Couldn't write the import cache file ", cache_file.toStdString());
+    }
+
+    // Releases the exporter and the snapshot held by this connection
+    thread->deleteLater();
+  });
+
+  thread->start(QThread::LowPriority);
+
+  return true;
+}
@@ -0,0 +1,38 @@
+#ifndef POINTCLOUDVIEWER_WORKERS_IMPORTCACHE_HPP_
+#define POINTCLOUDVIEWER_WORKERS_IMPORTCACHE_HPP_
+
+#include <pointcloud/pointcloud.hpp>
+#include <QObject>
+
+/**
+Cache for imported point clouds.
+
+Imported files can be stored as pcvd files (including the vertex data and the kd-tree, if it was
+already built) in a cache directory, so importing the same file again skips the slow parsing. The
+name of a cached file is derived from the absolute path, the size and the modification time of the
+imported file, so a modified file is never loaded from a stale cache.
+
+The cache files are written in the background from a snapshot of the point cloud and are loaded
+completely instead of being mapped, so evicting a cache file never affects a loaded point cloud.
+
+Configured with the QSettings
+- "Import/Cache/enabled"
+- "Import/Cache/directory"
+- "Import/Cache/maxSizeMB" and "Import/Cache/maxNumFiles": if exceeded, the least recently used
+  cache files are removed
+*/
+
+bool is_import_cache_enabled();
+void set_import_cache_enabled(bool enabled);
+
+// Returns the cache file for the given file or an empty string, if it's not cached
+QString find_import_cache_file(QString filepath);
+
+// Removes the given cache file, for example because it's corrupt
+void remove_import_cache_file(QString cache_file);
+
+// Starts storing the point cloud imported from the given file in the cache in the background.
+// Returns false if caching is disabled, the file is already cached (or being cached) or the cache directory couldn't be created.
+bool store_import_cache_file(QString filepath, const PointCloud& pointcloud);
+
+#endif // POINTCLOUDVIEWER_WORKERS_IMPORTCACHE_HPP_
@@ -1,6 +1,12 @@
 #include <pointcloud_viewer/workers/import_pointcloud.hpp>
+#include <pointcloud_viewer/workers/import_cache.hpp>
+#include <pointcloud_viewer/workers/progress_polling.hpp>
 #include <pointcloud_viewer/mainwindow.hpp>
 #include <pointcloud/importer/abstract_importer.hpp>
+#include <pointcloud/importer/pcvd_importer.hpp>
+#include <pointcloud/importer/multi_file_importer.hpp>
+#include <pointcloud/importer/ply_importer.hpp>
+#include <pointcloud/ply_file_format.hpp>
 #include <core_library/print.hpp>
 #include <core_library/types.hpp>
 
@@ -10,43 +16,31 @@
 #include <QMessageBox>
 #include <QCoreApplication>
 #include <QProgressDialog>
+#include <QSettings>
 #include <QAbstractEventDispatcher>
+#include <QComboBox>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QGroupBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QSpinBox>
+#include <QTableWidget>
+#include <QVBoxLayout>
 
 #include <fstream>
+#include <limits>
 
 QSharedPointer<PointCloud> failed(){return QSharedPointer<PointCloud>(new PointCloud);}
 
 
-QSharedPointer<PointCloud> import_point_cloud(QWidget* parent, QString filepath)
+// Runs the importer on its own thread while showing a progress dialog
+AbstractPointCloudImporter::state_t run_importer(QWidget* parent, AbstractPointCloudImporter* importer, QString label, std::function<void(const PointCloud& pointcloud, size_t num_available_points)> handle_available_points)
 {
-  QFileInfo file(filepath);
-
-  if(!file.exists())
-  {
-    QMessageBox::warning(parent, "Not existing file", QString("The given file <%0> does not exist!").arg(filepath));
-    return failed();
-  }
-
-  const std::string filepath_std = file.absoluteFilePath().toStdString();
-
-  if(!file.isReadable())
-  {
-    QMessageBox::warning(parent, "Can't existing file", QString("Could not open the file <%0> for reading.").arg(filepath));
-    return failed();
-  }
-
-  const QString suffix = file.suffix();
-
-  QSharedPointer<AbstractPointCloudImporter> importer = AbstractPointCloudImporter::importerForSuffix(suffix, filepath_std);
-
-  if(!importer)
-  {
-    QMessageBox::warning(parent, "Unexpected file format", QString("Unexpected file format '%0'.").arg(suffix));
-    return failed();
-  }
-
-  QProgressDialog progressDialog(QString("Importing Pointcloud \n<%1>").arg(file.fileName()), "&Abort", 0, AbstractPointCloudImporter::progress_max(), parent);
-  progressDialog.setWindowModality(Qt::ApplicationModal);
+  QProgressDialog progressDialog(label, "&Abort", 0, AbstractPointCloudImporter::progress_max(), parent);
+  progressDialog.setWindowModality(handle_available_points ? Qt::NonModal : Qt::ApplicationModal);
 
   progressDialog.show();
 
@@ -55,18 +49,34 @@ QSharedPointer<PointCloud> import_point_cloud(QWidget* parent, QString filepath)
 
   bool waiting = true;
 
-  QObject::connect(importer.data(), &AbstractPointCloudImporter::update_progress, &progressDialog, &QProgressDialog::setValue);
-  QObject::connect(importer.data(), &AbstractPointCloudImporter::finished, &thread, &QThread::quit);
-  QObject::connect(&progressDialog, &QProgressDialog::canceled, importer.data(), &AbstractPointCloudImporter::cancel);
-  QObject::connect(&thread, &QThread::started, importer.data(), &AbstractPointCloudImporter::import);
+  QObject::connect(importer, &AbstractPointCloudImporter::finished, &thread, &QThread::quit);
+  QObject::connect(&thread, &QThread::started, importer, &AbstractPointCloudImporter::import);
   QObject::connect(&thread, &QThread::finished, [&waiting](){waiting=false;});
 
+  // The newly loaded points are shown whenever the progress is polled
+  size_t num_shown_points = 0;
+  poll_progress(&progressDialog, &importer->progress, [importer, &waiting, &handle_available_points, &num_shown_points](){
+    const size_t num_available_points = importer->num_available_points();
+    if(handle_available_points && waiting && num_available_points > num_shown_points)
+    {
+      handle_available_points(importer->pointcloud, num_available_points);
+      num_shown_points = num_available_points;
+    }
+  });
+
 
   thread.start();
 
   while(waiting)
     QCoreApplication::processEvents(QEventLoop::EventLoopExec | QEventLoop::DialogExec | QEventLoop::WaitForMoreEvents);
 
+  progressDialog.hide();
+
+  return importer->state;
+}
+
+QSharedPointer<PointCloud> imported_point_cloud(QWidget* parent, AbstractPointCloudImporter* importer, QString filename)
+{
   switch(importer->state)
   {
   case AbstractPointCloudImporter::CANCELED:
@@ -77,16 +87,306 @@ QSharedPointer<PointCloud> import_point_cloud(QWidget* parent, QString filepath)
     QMessageBox::warning(parent, "Unknown Error", QString("Internal error"));
     return failed();
   case AbstractPointCloudImporter::INVALID_FILE:
-    QMessageBox::warning(parent, "Import Error", QString("Couldn't import the corrupt file <%0>.").arg(file.fileName()));
+    QMessageBox::warning(parent, "Import Error", QString("Couldn't import the corrupt file <%0>.").arg(filename));
     return failed();
   case AbstractPointCloudImporter::RUNTIME_ERROR:
-    QMessageBox::warning(parent, "Import Error", QString("Couldn't import the file <%0>. Probably an io error or invalid file.").arg(file.fileName()));
+    QMessageBox::warning(parent, "Import Error", QString("Couldn't import the file <%0>. Probably an io error or invalid file.").arg(filename));
     return failed();
   case AbstractPointCloudImporter::SUCCEEDED:
     return QSharedPointer<PointCloud>(new PointCloud(std::move(importer->pointcloud)));
   }
 
-  progressDialog.hide();
-
   return failed();
 }
+
+bool check_readable(QWidget* parent, const QFileInfo& file, QString filepath)
+{
+  if(!file.exists())
+  {
+    QMessageBox::warning(parent, "Not existing file", QString("The given file <%0> does not exist!").arg(filepath));
+    return false;
+  }
+
+  if(!file.isReadable())
+  {
+    QMessageBox::warning(parent, "Can't existing file", QString("Could not open the file <%0> for reading.").arg(filepath));
+    return false;
+  }
+
+  return true;
+}
+
+QSharedPointer<PointCloud> import_point_cloud(QWidget* parent, QString filepath, std::function<void(const PointCloud& pointcloud, size_t num_available_points)> handle_available_points, PointSampler::settings_t sampling, PropertyProjection::settings_t projection)
+{
+  QFileInfo file(filepath);
+
+  if(!check_readable(parent, file, filepath))
+    return failed();
+
+  const std::string filepath_std = file.absoluteFilePath().toStdString();
+
+  const QString suffix = file.suffix();
+
+  // If the file was imported before, the cached pcvd file is loaded instead. It contains all properties, so it's not used for projections.
+  const QString cache_file = projection.is_active() ? QString() : find_import_cache_file(filepath);
+
+  QSharedPointer<AbstractPointCloudImporter> importer = cache_file.isEmpty()
+      ? AbstractPointCloudImporter::importerForSuffix(suffix, filepath_std)
+      : QSharedPointer<AbstractPointCloudImporter>(new PcvdImporter(cache_file.toStdString()));
+
+  if(!importer)
+  {
+    QMessageBox::warning(parent, "Unexpected file format", QString("Unexpected file format '%0'.").arg(suffix));
+    return failed();
+  }
+
+  importer->sampling = sampling;
+
+  // Cached files are always loaded completely, so the point cloud doesn't depend on the cache file staying around
+  QSharedPointer<PcvdImporter> pcvd_importer = importer.objectCast<PcvdImporter>();
+  if(pcvd_importer && cache_file.isEmpty())
+  {
+    QSettings settings;
+    pcvd_importer->load_used_properties_only = settings.value("Import/loadUsedPropertiesOnly", false).toBool();
+  }
+
+  // How the sections of pcvd files are loaded (see PcvdImporter::read_mode).
+  // Cached files are read instead of mapped, as the cache may remove them while the point cloud is still loaded.
+  if(pcvd_importer && !cache_file.isEmpty())
+  {
+    pcvd_importer->read_mode = PcvdImporter::READ_MODE::PARALLEL_READ;
+  }else if(pcvd_importer)
+  {
+    const QString read_mode = QSettings().value("Import/pcvdReadMode", "mapping").toString();
+    if(read_mode == "stream")
+      pcvd_importer->read_mode = PcvdImporter::READ_MODE::STREAM;
+    else if(read_mode == "parallel")
+      pcvd_importer->read_mode = PcvdImporter::READ_MODE::PARALLEL_READ;
+    else
+      pcvd_importer->read_mode = PcvdImporter::READ_MODE::MEMORY_MAPPING;
+  }
+
+  QSharedPointer<PlyImporter> ply_importer = importer.objectCast<PlyImporter>();
+  if(ply_importer)
+    ply_importer->projection = projection;
+
+  const AbstractPointCloudImporter::state_t state = run_importer(parent, importer.data(), QString("Importing Pointcloud \n<%1>").arg(file.fileName()), handle_available_points);
+
+  // A corrupt cache file is not worth an error message, just import the original file
+  if(!cache_file.isEmpty() && (state == AbstractPointCloudImporter::INVALID_FILE || state == AbstractPointCloudImporter::RUNTIME_ERROR))
+  {
+    println_error("Couldn't load the import cache file ", cache_file.toStdString());
+    remove_import_cache_file(cache_file);
+    return import_point_cloud(parent, filepath, handle_available_points, sampling, projection);
+  }
+
+  return imported_point_cloud(parent, importer.data(), file.fileName());
+}
+
+QSharedPointer<PointCloud> import_point_clouds(QWidget* parent, QStringList filepaths, PointSampler::settings_t sampling)
+{
+  for(const QString& filepath : filepaths)
+    if(!check_readable(parent, QFileInfo(filepath), filepath))
+      return failed();
+
+  MultiFileImporter importer(filepaths);
+  importer.sampling = sampling;
+
+  run_importer(parent, &importer, QString("Importing %0 Pointclouds").arg(filepaths.length()), nullptr);
+
+  // Which of the files failed isn't known here, so all are listed
+  QStringList filenames;
+  for(const QString& filepath : filepaths)
+    filenames << QFileInfo(filepath).fileName();
+
+  return imported_point_cloud(parent, &importer, filenames.join(", "));
+}
+
+bool ask_for_preview_settings(QWidget* parent, PointSampler::settings_t* settings)
+{
+  QSettings storedSettings;
+
+  QDialog dialog(parent);
+
+  dialog.setWindowModality(Qt::ApplicationModal);
+  dialog.setWindowTitle("Import Preview");
+
+  QFormLayout* form = new QFormLayout;
+
+  QSpinBox* every_nth_point = new QSpinBox;
+  every_nth_point->setRange(1, std::numeric_limits<int>::max());
+  every_nth_point->setValue(storedSettings.value("Import/Preview/everyNthPoint", 100).toInt());
+  every_nth_point->setToolTip("Keep only every nth point (of the points within the crop box)");
+  form->addRow("Every &Nth Point", every_nth_point);
+
+  QSpinBox* max_num_points = new QSpinBox;
+  max_num_points->setRange(0, std::numeric_limits<int>::max());
+  max_num_points->setSingleStep(1000000);
+  max_num_points->setSpecialValueText("Unlimited");
+  max_num_points->setValue(storedSettings.value("Import/Preview/maxNumPoints", 10000000).toInt());
+  max_num_points->setToolTip("Keep a random sample of at most this many points");
+  form->addRow("Point &Budget", max_num_points);
+
+  QGroupBox* crop = new QGroupBox("&Crop");
+  crop->setCheckable(true);
+  crop->setChecked(storedSettings.value("Import/Preview/crop", false).toBool());
+  QFormLayout* crop_form = new QFormLayout;
+  crop->setLayout(crop_form);
+
+  QDoubleSpinBox* crop_bounds[2][3];
+  const char* bound_names[2] = {"Min", "Max"};
+  const char* dimension_names[3] = {"X", "Y", "Z"};
+  for(int bound=0; bound<2; ++bound)
+  {
+    QHBoxLayout* hbox = new QHBoxLayout;
+    for(int d=0; d<3; ++d)
+    {
+      const QString key = QString("Import/Preview/crop%0%1").arg(bound_names[bound]).arg(dimension_names[d]);
+
+      QDoubleSpinBox* value = new QDoubleSpinBox;
+      value->setRange(-1.e9, 1.e9);
+      value->setDecimals(3);
+      value->setPrefix(QString("%0: ").arg(dimension_names[d]));
+      value->setValue(storedSettings.value(key, bound==0 ? -1. : 1.).toDouble());
+      hbox->addWidget(value, 1);
+      crop_bounds[bound][d] = value;
+    }
+    crop_form->addRow(bound_names[bound], hbox);
+  }
+
+  QDialogButtonBox* buttons = new QDialogButtonBox;
+  buttons->addButton(QDialogButtonBox::Ok);
+  buttons->addButton(QDialogButtonBox::Cancel);
+
+  QObject::connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+  QObject::connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+  QVBoxLayout* root = new QVBoxLayout;
+  dialog.setLayout(root);
+  root->addLayout(form);
+  root->addWidget(crop);
+  root->addWidget(buttons);
+
+  if(dialog.exec() != QDialog::Accepted)
+    return false;
+
+  settings->every_nth_point = size_t(every_nth_point->value());
+  settings->max_num_points = size_t(max_num_points->value());
+  settings->crop = crop->isChecked();
+  for(int d=0; d<3; ++d)
+  {
+    settings->crop_aabb.min_point[d] = float(glm::min(crop_bounds[0][d]->value(), crop_bounds[1][d]->value()));
+    settings->crop_aabb.max_point[d] = float(glm::max(crop_bounds[0][d]->value(), crop_bounds[1][d]->value()));
+  }
+
+  storedSettings.setValue("Import/Preview/everyNthPoint", every_nth_point->value());
+  storedSettings.setValue("Import/Preview/maxNumPoints", max_num_points->value());
+  storedSettings.setValue("Import/Preview/crop", crop->isChecked());
+  for(int bound=0; bound<2; ++bound)
+    for(int d=0; d<3; ++d)
+      storedSettings.setValue(QString("Import/Preview/crop%0%1").arg(bound_names[bound]).arg(dimension_names[d]), crop_bounds[bound][d]->value());
+
+  return true;
+}
+
+// The given type and the smaller types of the same kind
+QVector<data_type::base_type_t> demotable_types(data_type::base_type_t type)
+{
+  typedef data_type::BASE_TYPE BASE_TYPE;
+
+  switch(type)
+  {
+  case BASE_TYPE::INT8:
+  case BASE_TYPE::UINT8:
+  case BASE_TYPE::FLOAT32:
+    return {type};
+  case BASE_TYPE::INT16:
+    return {BASE_TYPE::INT16, BASE_TYPE::INT8};
+  case BASE_TYPE::INT32:
+    return {BASE_TYPE::INT32, BASE_TYPE::INT16, BASE_TYPE::INT8};
+  case BASE_TYPE::UINT16:
+    return {BASE_TYPE::UINT16, BASE_TYPE::UINT8};
+  case BASE_TYPE::UINT32:
+    return {BASE_TYPE::UINT32, BASE_TYPE::UINT16, BASE_TYPE::UINT8};
+  case BASE_TYPE::FLOAT64:
+    return {BASE_TYPE::FLOAT64, BASE_TYPE::FLOAT32};
+  }
+
+  Q_UNREACHABLE();
+  return {type};
+}
+
+bool ask_for_property_projection(QWidget* parent, QString filepath, PropertyProjection::settings_t* settings)
+{
+  ply_format::header_t header;
+  const bool valid_header = ply_format::read_header(filepath.toStdString(), &header, [](std::size_t line, const std::string& message){println_error("Error while parsing ply header in line ", line, ": ", message);});
+  const int vertex_element_index = valid_header ? header.index_of_element("vertex") : -1;
+
+  if(vertex_element_index < 0)
+  {
+    QMessageBox::warning(parent, "Import Error", QString("Couldn't read the vertex properties of the file <%0>.").arg(QFileInfo(filepath).fileName()));
+    return false;
+  }
+
+  QVector<ply_format::property_t> properties;
+  for(const ply_format::property_t& property : header.elements[size_t(vertex_element_index)].properties)
+    if(!property.is_list)
+      properties << property;
+
+  QDialog dialog(parent);
+
+  dialog.setWindowModality(Qt::ApplicationModal);
+  dialog.setWindowTitle("Import Properties");
+
+  QTableWidget* table = new QTableWidget(properties.length(), 2);
+  table->setHorizontalHeaderLabels(QStringList() << "Property" << "Stored Type");
+  table->horizontalHeader()->setStretchLastSection(true);
+  table->verticalHeader()->setVisible(false);
+
+  QVector<QComboBox*> type_boxes;
+  for(int i=0; i<properties.length(); ++i)
+  {
+    const QString name = QString::fromStdString(properties[i].name);
+
+    QTableWidgetItem* item = new QTableWidgetItem(name);
+    item->setFlags(PropertyProjection::is_always_kept(name) ? Qt::ItemIsEnabled : Qt::ItemIsEnabled | Qt::ItemIsUserCheckable);
+    item->setCheckState(Qt::Checked);
+    table->setItem(i, 0, item);
+
+    QComboBox* type_box = new QComboBox;
+    for(data_type::base_type_t type : demotable_types(properties[i].type))
+      type_box->addItem(data_type::toString(type), int(type));
+    table->setCellWidget(i, 1, type_box);
+    type_boxes << type_box;
+  }
+
+  QDialogButtonBox* buttons = new QDialogButtonBox;
+  buttons->addButton(QDialogButtonBox::Ok);
+  buttons->addButton(QDialogButtonBox::Cancel);
+
+  QObject::connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+  QObject::connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+  QVBoxLayout* root = new QVBoxLayout;
+  dialog.setLayout(root);
+  root->addWidget(new QLabel("Unchecked properties are not imported. Properties with values not fitting into a smaller type keep their type."));
+  root->addWidget(table);
+  root->addWidget(buttons);
+
+  if(dialog.exec() != QDialog::Accepted)
+    return false;
+
+  *settings = PropertyProjection::settings_t();
+  for(int i=0; i<properties.length(); ++i)
+  {
+    const QString name = QString::fromStdString(properties[i].name);
+    const data_type::base_type_t type = data_type::base_type_t(type_boxes[i]->currentData().toInt());
+
+    if(table->item(i, 0)->checkState() != Qt::Checked)
+      settings->dropped_properties << name;
+    else if(type != properties[i].type)
+      settings->demoted_types[name] = type;
+  }
+
+  return true;
+}
@@ -2,11 +2,47 @@
 #define POINTCLOUDVIEWER_WORKERS_IMPORTPOINTCLOUD_HPP_
 
 #include <pointcloud/pointcloud.hpp>
+#include <pointcloud/importer/point_sampler.hpp>
+#include <pointcloud/importer/property_projection.hpp>
 #include <QObject>
 
+#include <functional>
+
 /**
 The function responsible for import point clouds.
+
+If handle_available_points is given, it's called on the gui thread whenever the importer
+finished loading more points, so the point cloud can be shown while it's still loading.
+The progress dialog isn't modal in this case, so the user can navigate during the import.
+
+If sampling is active, only a sample of the points is imported (see PointSampler).
+
+If the projection is active, ply files are imported without the dropped properties
+and with the demoted types (see PropertyProjection). Other formats ignore it.
+
+If the import cache is enabled and the file was cached before, the cached pcvd file is loaded instead
+(see import_cache.hpp), unless a projection is active.
+*/
+QSharedPointer<PointCloud> import_point_cloud(QWidget* parent, QString file, std::function<void(const PointCloud& pointcloud, size_t num_available_points)> handle_available_points = nullptr, PointSampler::settings_t sampling = PointSampler::settings_t(), PropertyProjection::settings_t projection = PropertyProjection::settings_t());
+
+/**
+Imports several files concurrently and merges them into a single point cloud (see MultiFileImporter).
+
+The merged point cloud is only available after all files were imported, so it's not shown while loading.
+*/
+QSharedPointer<PointCloud> import_point_clouds(QWidget* parent, QStringList files, PointSampler::settings_t sampling = PointSampler::settings_t());
+
+/**
+Asks the user how to sample the points of a preview import.
+The last used settings are remembered. Returns false, if the user canceled.
+*/
+bool ask_for_preview_settings(QWidget* parent, PointSampler::settings_t* settings);
+
+/**
+Lists the vertex properties of the given ply file and asks the user which ones to import
+and which types to store them with. Returns false, if the user canceled or the header
+couldn't be read.
 */
-QSharedPointer<PointCloud> import_point_cloud(QWidget* parent, QString file);
+bool ask_for_property_projection(QWidget* parent, QString filepath, PropertyProjection::settings_t* settings);
 
 #endif // POINTCLOUDVIEWER_WORKERS_IMPORTPOINTCLOUD_HPP_
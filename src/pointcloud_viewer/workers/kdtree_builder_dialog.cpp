@@ -1,4 +1,6 @@
 #include <pointcloud_viewer/workers/kdtree_builder_dialog.hpp>
+#include <pointcloud_viewer/workers/progress_polling.hpp>
+#include <pointcloud_viewer/mainwindow.hpp>
 #include <core_library/print.hpp>
 
 #include <QProgressDialog>
@@ -7,30 +9,44 @@
 
 using namespace implementation;
 
-void build_kdtree(QWidget* parent, PointCloud* pointCloud)
+void build_kdtree(QWidget* parent, QSharedPointer<PointCloud> pointCloud)
 {
   Q_ASSERT(pointCloud->can_build_kdtree());
 
+  PointCloud snapshot = pointCloud->snapshot();
+
   QThread thread;
   thread.setObjectName("build_kdtree");
-  KdTreeBuilder builder(*pointCloud);
+  KdTreeBuilder builder(snapshot);
 
   builder.moveToThread(&thread);
 
-  QProgressDialog progressDialog(QString("Building KD-Tree"), "&Abort", 0, int(builder.max_progress), parent);
-  progressDialog.setWindowModality(Qt::ApplicationModal);
+  // The dialog isn't modal, the user can keep navigating while building the kd-tree
+  QProgressDialog progressDialog(QString("Building KD-Tree"), "&Abort", 0, Progress::max_value(), parent);
+  progressDialog.setWindowModality(Qt::NonModal);
 
-  QObject::connect(&progressDialog, &QProgressDialog::canceled, &builder, &KdTreeBuilder::abort, Qt::DirectConnection);
+  poll_progress(&progressDialog, &builder.progress);
   QObject::connect(&thread, &QThread::started, &builder, &KdTreeBuilder::build);
   QObject::connect(&builder, &KdTreeBuilder::finished, &thread, &QThread::quit, Qt::QueuedConnection);
   QObject::connect(&builder, &KdTreeBuilder::finished, &progressDialog, &QProgressDialog::accept, Qt::QueuedConnection);
-  QObject::connect(&builder, &KdTreeBuilder::progress, &progressDialog, &QProgressDialog::setValue);
+
+  // No other point cloud may be imported or exported by the nested event loop
+  MainWindow* mainWindow = qobject_cast<MainWindow*>(parent->window());
+  if(mainWindow != nullptr)
+    mainWindow->begin_working_on_snapshot();
 
   thread.start();
-  progressDialog.exec();
+  progressDialog.show();
 
   while(!thread.wait(10))
     QCoreApplication::processEvents(QEventLoop::EventLoopExec | QEventLoop::DialogExec | QEventLoop::WaitForMoreEvents);
+
+  if(mainWindow != nullptr)
+    mainWindow->end_working_on_snapshot();
+
+  // The shader might have changed the vertices in the meantime (see Buffer::revision). Changing only the user data keeps the tree valid
+  if(snapshot.has_build_kdtree() && !builder.progress.is_canceled() && pointCloud->coordinate_color.revision() == snapshot.coordinate_color.revision() && !pointCloud->has_build_kdtree())
+    pointCloud->kdtree_index = std::move(snapshot.kdtree_index);
 }
 
 
@@ -44,18 +60,11 @@ KdTreeBuilder::KdTreeBuilder(PointCloud& pointCloud)
 void KdTreeBuilder::build()
 {
   pointCloud.build_kd_tree([this](size_t done, size_t total) -> bool{
-    size_t progress = (done*max_progress)/total;
-//    println("done: ", done, "  total: ", total, "  progress", progress);
-    this->progress(int(progress));
-    return !_is_aborted;
+    progress.set(int64_t(done), int64_t(total));
+    return !progress.is_canceled();
   });
 
   return finished();
 }
 
-void KdTreeBuilder::abort()
-{
-  _is_aborted = true;
-}
-
 } // namespace implementation
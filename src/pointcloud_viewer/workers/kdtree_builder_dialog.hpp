@@ -2,9 +2,14 @@
 #define POINTCLOUDVIEWER_WORKERS_KDTREE_BUILDER_DIALOG_H
 
 #include <pointcloud/pointcloud.hpp>
+#include <core_library/progress.hpp>
 #include <QObject>
+#include <QSharedPointer>
 
-void build_kdtree(QWidget* parent, PointCloud* pointCloud);
+// Builds the kd-tree of a snapshot of the point cloud, so the user can keep navigating in the meantime.
+// Importing and exporting are disabled while building it (see MainWindow::begin_working_on_snapshot).
+// The tree is only kept, if the vertices weren't changed in the meantime.
+void build_kdtree(QWidget* parent, QSharedPointer<PointCloud> pointCloud);
 
 namespace implementation {
 
@@ -13,20 +18,15 @@ class KdTreeBuilder : public QObject
   Q_OBJECT
 public:
   PointCloud& pointCloud;
-  const size_t max_progress = 65535;
+  Progress progress;
 
   KdTreeBuilder(PointCloud& pointCloud);
 
 public slots:
   void build();
-  void abort();
 
 signals:
-  void progress(int);
   void finished();
-
-private:
- volatile bool _is_aborted = false;
 };
 
 } // implementation
@@ -0,0 +1,61 @@
+#include <pointcloud_viewer/workers/load_deferred_columns_dialog.hpp>
+#include <pointcloud_viewer/workers/progress_polling.hpp>
+
+#include <QProgressDialog>
+#include <QCoreApplication>
+#include <QMessageBox>
+#include <QThread>
+
+using namespace implementation;
+
+bool load_deferred_columns(QWidget* parent, PointCloud* pointCloud, QSet<QString> names)
+{
+  if(!pointCloud->deferred_columns.contains_any(names))
+    return true;
+
+  QThread thread;
+  thread.setObjectName("load_deferred_columns");
+  DeferredColumnsLoader loader(*pointCloud, names);
+
+  loader.moveToThread(&thread);
+
+  QProgressDialog progressDialog(QString("Loading Properties"), "&Abort", 0, Progress::max_value(), parent);
+  progressDialog.setWindowModality(Qt::ApplicationModal);
+
+  poll_progress(&progressDialog, &loader.progress);
+  QObject::connect(&thread, &QThread::started, &loader, &DeferredColumnsLoader::load);
+  QObject::connect(&loader, &DeferredColumnsLoader::finished, &thread, &QThread::quit, Qt::QueuedConnection);
+  QObject::connect(&loader, &DeferredColumnsLoader::finished, &progressDialog, &QProgressDialog::accept, Qt::QueuedConnection);
+
+  thread.start();
+  progressDialog.exec();
+
+  while(!thread.wait(10))
+    QCoreApplication::processEvents(QEventLoop::EventLoopExec | QEventLoop::DialogExec | QEventLoop::WaitForMoreEvents);
+
+  if(!loader.succeeded && !progressDialog.wasCanceled())
+    QMessageBox::warning(parent, "Import Error", QString("Couldn't load the properties from the file <%0>.").arg(QString::fromStdString(pointCloud->deferred_columns.filename)));
+
+  return loader.succeeded;
+}
+
+
+namespace implementation {
+
+DeferredColumnsLoader::DeferredColumnsLoader(PointCloud& pointCloud, QSet<QString> names)
+  : pointCloud(pointCloud),
+    names(names)
+{
+}
+
+void DeferredColumnsLoader::load()
+{
+  succeeded = pointCloud.load_deferred_columns(names, [this](size_t done, size_t total) -> bool{
+    progress.set(int64_t(done), int64_t(total));
+    return !progress.is_canceled();
+  });
+
+  return finished();
+}
+
+} // namespace implementation
@@ -0,0 +1,37 @@
+#ifndef POINTCLOUDVIEWER_WORKERS_LOAD_DEFERRED_COLUMNS_DIALOG_HPP_
+#define POINTCLOUDVIEWER_WORKERS_LOAD_DEFERRED_COLUMNS_DIALOG_HPP_
+
+#include <pointcloud/pointcloud.hpp>
+#include <core_library/progress.hpp>
+#include <QObject>
+
+/**
+Loads the given deferred columns of the point cloud from its file (showing a progress dialog).
+
+Returns false, if the user aborted or the file couldn't be read.
+*/
+bool load_deferred_columns(QWidget* parent, PointCloud* pointCloud, QSet<QString> names);
+
+namespace implementation {
+
+class DeferredColumnsLoader : public QObject
+{
+  Q_OBJECT
+public:
+  PointCloud& pointCloud;
+  const QSet<QString> names;
+  Progress progress;
+  bool succeeded = false;
+
+  DeferredColumnsLoader(PointCloud& pointCloud, QSet<QString> names);
+
+public slots:
+  void load();
+
+signals:
+  void finished();
+};
+
+} // implementation
+
+#endif // POINTCLOUDVIEWER_WORKERS_LOAD_DEFERRED_COLUMNS_DIALOG_HPP_
@@ -0,0 +1,22 @@
+#include <pointcloud_viewer/workers/progress_polling.hpp>
+
+#include <QProgressDialog>
+#include <QTimer>
+
+void poll_progress(QProgressDialog* progressDialog, Progress* progress, std::function<void()> on_poll)
+{
+  // owned by the dialog, so it stops polling as soon as the dialog is destroyed
+  QTimer* timer = new QTimer(progressDialog);
+  timer->setInterval(33);
+
+  QObject::connect(timer, &QTimer::timeout, progressDialog, [progressDialog, progress, on_poll](){
+    progressDialog->setValue(progress->value());
+    if(on_poll)
+      on_poll();
+  });
+  QObject::connect(progressDialog, &QProgressDialog::canceled, progressDialog, [progress](){
+    progress->cancel();
+  });
+
+  timer->start();
+}
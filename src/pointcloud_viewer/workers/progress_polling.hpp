@@ -0,0 +1,18 @@
+#ifndef POINTCLOUDVIEWER_WORKERS_PROGRESSPOLLING_HPP_
+#define POINTCLOUDVIEWER_WORKERS_PROGRESSPOLLING_HPP_
+
+#include <core_library/progress.hpp>
+
+#include <functional>
+
+class QProgressDialog;
+
+/**
+Shows the progress of a worker thread in the dialog by polling it with a timer.
+Canceling the dialog cancels the worker.
+
+If given, on_poll is called on the gui thread with each timer tick.
+*/
+void poll_progress(QProgressDialog* progressDialog, Progress* progress, std::function<void()> on_poll = nullptr);
+
+#endif // POINTCLOUDVIEWER_WORKERS_PROGRESSPOLLING_HPP_
@@ -139,7 +139,7 @@ bool remap_points(const std::string& vertex_shader, const QVector<uint>& binding
 
   auto remap_block = [&output_buffer, &shader_object, &input_buffer, &pointCloud, attribute_stride](GLintptr first_index, GLintptr num_vertices)
   {
-    input_buffer.Set(pointCloud->user_data.data() + first_index * attribute_stride, 0, num_vertices * attribute_stride);
+    input_buffer.Set(pointCloud->user_data.const_data() + first_index * attribute_stride, 0, num_vertices * attribute_stride);
 
     glMemoryBarrier(GL_ALL_BARRIER_BITS);
 
@@ -154,7 +154,8 @@ bool remap_points(const std::string& vertex_shader, const QVector<uint>& binding
 
     glMemoryBarrier(GL_ALL_BARRIER_BITS);
 
-    output_buffer.Get(pointCloud->coordinate_color.data() + first_index * vertex_stride, 0, num_vertices * vertex_stride);
+    // Only the chunks of the block are copied, if a snapshot of the point cloud is still used by a worker
+    output_buffer.Get(pointCloud->coordinate_color.overwrite(size_t(first_index * vertex_stride), size_t(num_vertices * vertex_stride)), 0, num_vertices * vertex_stride);
 
     glMemoryBarrier(GL_ALL_BARRIER_BITS);
   };
@@ -164,6 +165,9 @@ bool remap_points(const std::string& vertex_shader, const QVector<uint>& binding
     remap_block(i, glm::min<GLintptr>(i+points_per_block, num_points) - i);
   }
 
+  // The blocks overwrote all chunks, so the buffer can be read again
+  Q_ASSERT(pointCloud->coordinate_color.is_complete());
+
 
   for(int i=0; i<bindings.length(); ++i)
   {
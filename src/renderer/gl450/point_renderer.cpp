@@ -59,6 +59,7 @@ void PointRenderer::clear_buffer()
   gl::Buffer buffer;
   this->vertex_position_buffer = std::move(buffer);
   this->num_vertices = 0;
+  this->num_allocated_vertices = 0;
 }
 
 void PointRenderer::load_points(const uint8_t* point_data, GLsizei num_points)
@@ -69,6 +70,7 @@ void PointRenderer::load_points(const uint8_t* point_data, GLsizei num_points)
 
   this->vertex_position_buffer = std::move(buffer);
   this->num_vertices = num_points;
+  this->num_allocated_vertices = num_points;
 
 #if 0
   const vertex_t* vertices = reinterpret_cast<const vertex_t*>(point_data);
@@ -77,6 +79,28 @@ void PointRenderer::load_points(const uint8_t* point_data, GLsizei num_points)
 #endif
 }
 
+void PointRenderer::allocate_points(GLsizei num_points)
+{
+  clear_buffer();
+
+  gl::Buffer buffer(GLsizeiptr(num_points) * STRIDE, gl::Buffer::UsageFlag::SUB_DATA_UPDATE, nullptr);
+
+  this->vertex_position_buffer = std::move(buffer);
+  this->num_vertices = 0;
+  this->num_allocated_vertices = num_points;
+}
+
+void PointRenderer::load_point_range(const uint8_t* point_data, GLsizei first_point, GLsizei num_points)
+{
+  Q_ASSERT(first_point >= 0 && num_points >= 0);
+  Q_ASSERT(first_point + num_points <= num_allocated_vertices);
+
+  vertex_position_buffer.Set(point_data, GLsizeiptr(first_point) * STRIDE, GLsizeiptr(num_points) * STRIDE);
+
+  // Only the points up to the last uploaded range are rendered
+  this->num_vertices = glm::max(this->num_vertices, first_point + num_points);
+}
+
 void PointRenderer::load_test(GLsizei num_vertices)
 {
   gl::Buffer buffer(GLsizeiptr(num_vertices) * STRIDE, gl::Buffer::UsageFlag::MAP_WRITE, nullptr);
@@ -94,6 +118,7 @@ void PointRenderer::load_test(GLsizei num_vertices)
 
   this->vertex_position_buffer = std::move(buffer);
   this->num_vertices = num_vertices;
+  this->num_allocated_vertices = num_vertices;
 }
 
 void PointRenderer::render_points()
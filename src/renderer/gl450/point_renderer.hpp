@@ -25,6 +25,11 @@ public:
 
   void clear_buffer();
   void load_points(const uint8_t* point_data, GLsizei num_points);
+
+  // Allocates the buffer for num_points points without rendering any of them yet.
+  // The points are then uploaded range by range with load_point_range.
+  void allocate_points(GLsizei num_points);
+  void load_point_range(const uint8_t* point_data, GLsizei first_point, GLsizei num_points);
   void load_test(GLsizei num_vertices=512);
 
   void render_points();
@@ -34,6 +39,7 @@ private:
   gl::Buffer vertex_position_buffer;
   gl::VertexArrayObject vertex_array_object;
   GLsizei num_vertices = 0;
+  GLsizei num_allocated_vertices = 0;
 };
 
 } //namespace gl450
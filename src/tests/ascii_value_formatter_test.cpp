@@ -0,0 +1,290 @@
+#include <pointcloud/exporter/ascii_value_formatter.hpp>
+#include <pointcloud/exporter/ply_exporter.hpp>
+#include <pointcloud/exporter/text_exporter.hpp>
+#include <pointcloud/importer/ascii_value_parser.hpp>
+#include <pointcloud/importer/ply_importer.hpp>
+#include <pointcloud/importer/text_importer.hpp>
+#include <tests/test_helpers.hpp>
+#include <core_library/print.hpp>
+
+#include <QTemporaryDir>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+/*
+Checks the number formatter of the ascii exporters: floating point numbers are
+written with the fewest digits parsing back to the same value, the rows written
+on all cores are the same as formatting them one after another, and ascii ply
+and xyz exports import to the exported values.
+*/
+
+typedef data_type::BASE_TYPE BASE_TYPE;
+
+template<typename T>
+std::string formatted(T value);
+template<typename T>
+bool is_shortest_round_trip(T value, const std::string& text);
+int count_significant_digits(const std::string& text);
+void make_random_points(PointCloud* pointcloud, size_t num_points);
+bool same_user_data(const PointCloud& a, const PointCloud& b);
+
+void test_float_formatting()
+{
+  expect(formatted(0.1) == "0.1" && formatted(1.0) == "1" && formatted(-2.5) == "-2.5" && formatted(123456.0) == "123456", "float64 without exponent");
+  expect(formatted(0.000001) == "0.000001" && formatted(1e-7) == "1e-7" && formatted(1e21) == "1e+21" && formatted(1.5e300) == "1.5e+300", "float64 with and without exponent");
+  expect(formatted(5e-324) == "5e-324" && formatted(std::numeric_limits<float64_t>::max()) == "1.7976931348623157e+308", "float64 extremes");
+  expect(formatted(0.0) == "0" && formatted(-0.0) == "-0", "float64 zeros");
+  expect(formatted(0.1f) == "0.1" && formatted(3.14159f) == "3.14159" && formatted(16777216.f) == "16777216" && formatted(1e38f) == "1e+38" && formatted(1e-7f) == "1e-7", "float32");
+  expect(formatted(std::numeric_limits<float32_t>::quiet_NaN()) == "nan" && formatted(-std::numeric_limits<float64_t>::infinity()) == "-inf", "nan and inf");
+
+  // every 1009th float32, which covers all exponents and subnormals
+  size_t num_mismatches = 0;
+  for(uint64_t bits=0; bits<(uint64_t(1) << 32); bits+=1009)
+  {
+    float32_t value;
+    const uint32_t bits32 = uint32_t(bits);
+    std::memcpy(&value, &bits32, sizeof(float32_t));
+    if(!std::isnan(value) && !is_shortest_round_trip(value, formatted(value)) && num_mismatches++ < 10)
+      println_error("float32 ", bits32, ": ", formatted(value));
+  }
+  expect(num_mismatches == 0, format("float32: ", num_mismatches, " values aren't written with the fewest digits parsing back to them"));
+
+  num_mismatches = 0;
+  std::mt19937_64 random(3);
+  for(size_t i=0; i<500000; ++i)
+  {
+    uint64_t bits = random();
+    float64_t value;
+    std::memcpy(&value, &bits, sizeof(float64_t));
+    if(i%2 == 0)
+      value = std::uniform_real_distribution<float64_t>(-1000, 1000)(random); // typical coordinates
+    if(!std::isnan(value) && !is_shortest_round_trip(value, formatted(value)) && num_mismatches++ < 10)
+      println_error("float64 ", bits, ": ", formatted(value));
+  }
+  expect(num_mismatches == 0, format("float64: ", num_mismatches, " values aren't written with the fewest digits parsing back to them"));
+}
+
+void test_integer_formatting()
+{
+  char text[ascii_values::max_value_length];
+
+  for(int32_t value : {0, -1, 9, 10, 99, 100, -100, 12345, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()})
+    expect(std::string(text, ascii_values::format_integer(text, value)) == std::to_string(value), format("int32 ", value));
+  for(uint32_t value : {0u, 7u, 10u, 1000000000u, std::numeric_limits<uint32_t>::max()})
+    expect(std::string(text, ascii_values::format_integer(text, value)) == std::to_string(value), format("uint32 ", value));
+
+  std::mt19937_64 random(5);
+  bool same_text = true;
+  for(size_t i=0; i<100000; ++i)
+  {
+    const int32_t value = int32_t(random()) >> (random() % 32);
+    same_text = same_text && std::string(text, ascii_values::format_integer(text, value)) == std::to_string(value);
+  }
+  expect(same_text, "random integers");
+
+  // the small types are written like the 32 bit ones
+  const int8_t int8 = -128;
+  const uint8_t uint8 = 255;
+  const int16_t int16 = -32768;
+  const uint16_t uint16 = 65535;
+  expect(std::string(text, ascii_values::format_value(text, BASE_TYPE::INT8, reinterpret_cast<const uint8_t*>(&int8))) == "-128"
+      && std::string(text, ascii_values::format_value(text, BASE_TYPE::UINT8, &uint8)) == "255"
+      && std::string(text, ascii_values::format_value(text, BASE_TYPE::INT16, reinterpret_cast<const uint8_t*>(&int16))) == "-32768"
+      && std::string(text, ascii_values::format_value(text, BASE_TYPE::UINT16, reinterpret_cast<const uint8_t*>(&uint16))) == "65535", "format_value of the small integer types");
+}
+
+void test_write_rows()
+{
+  PointCloud pointcloud;
+  make_random_points(&pointcloud, 2);
+  uint8_t* row = pointcloud.user_data.data();
+  for(size_t i=0; i<2; ++i, row+=pointcloud.user_data_stride)
+  {
+    write_value_to_buffer<float32_t>(row, i==0 ? 0.1f : -1e-7f);
+    write_value_to_buffer<float32_t>(row + 4, 2.f);
+    write_value_to_buffer<float32_t>(row + 8, 1e30f);
+    write_value_to_buffer<float64_t>(row + 12, i==0 ? 0.3 : 1.0/3.0);
+    write_value_to_buffer<int32_t>(row + 20, i==0 ? -42 : 0);
+    write_value_to_buffer<uint16_t>(row + 24, 65535);
+  }
+
+  std::ostringstream stream;
+  ascii_values::write_rows(stream, pointcloud, ',', [](size_t){});
+  expect(stream.str() == "0.1,2,1e+30,0.3,-42,65535\n-1e-7,2,1e+30,0.3333333333333333,0,65535\n", "rows separated by a delimiter: \"" + stream.str() + "\"");
+
+  // many blocks written on all cores are the same as formatting the rows one after another
+  make_random_points(&pointcloud, 300000);
+
+  std::string expected_text;
+  char text[ascii_values::max_value_length];
+  row = pointcloud.user_data.data();
+  for(size_t i=0; i<pointcloud.num_points; ++i, row+=pointcloud.user_data_stride)
+  {
+    for(int k=0; k<pointcloud.user_data_types.length(); ++k)
+    {
+      if(k != 0)
+        expected_text += ' ';
+      expected_text.append(text, ascii_values::format_value(text, pointcloud.user_data_types[k], row + pointcloud.user_data_offset[k]));
+    }
+    expected_text += '\n';
+  }
+
+  size_t last_num_written_rows = 0;
+  bool increasing_progress = true;
+  std::ostringstream parallel_stream;
+  ascii_values::write_rows(parallel_stream, pointcloud, ' ', [&](size_t num_written_rows){
+    increasing_progress = increasing_progress && num_written_rows > last_num_written_rows && num_written_rows <= pointcloud.num_points;
+    last_num_written_rows = num_written_rows;
+  });
+  expect(parallel_stream.str() == expected_text, "rows written on all cores");
+  expect(increasing_progress && last_num_written_rows == pointcloud.num_points, "progress of the written rows");
+}
+
+void test_export_and_import(const QTemporaryDir& directory)
+{
+  PointCloud pointcloud;
+  make_random_points(&pointcloud, 300000);
+
+  const std::string ply_filename = (directory.path() + "/ascii.ply").toStdString();
+  PlyExporter ply_exporter(ply_filename, pointcloud);
+  ply_exporter.export_now();
+  expect(ply_exporter.state == AbstractPointCloudExporter::SUCCEEDED, "ascii ply: export");
+
+  PlyImporter ply_importer(ply_filename);
+  ply_importer.import();
+  expect(ply_importer.state == AbstractPointCloudImporter::SUCCEEDED, "ascii ply: import");
+  expect(same_user_data(pointcloud, ply_importer.pointcloud), "ascii ply: imported values");
+
+  // The xyz importer guesses the types of the columns, so only the coordinates and the values written with more than seven digits are compared
+  const std::string xyz_filename = (directory.path() + "/ascii.xyz").toStdString();
+  TextExporter text_exporter(xyz_filename, pointcloud);
+  text_exporter.export_now();
+  expect(text_exporter.state == AbstractPointCloudExporter::SUCCEEDED, "xyz: export");
+
+  TextImporter text_importer(xyz_filename);
+  text_importer.import();
+  const PointCloud& imported = text_importer.pointcloud;
+  expect(text_importer.state == AbstractPointCloudImporter::SUCCEEDED, "xyz: import");
+  expect(imported.num_points == pointcloud.num_points && imported.user_data_names == pointcloud.user_data_names, "xyz: points and columns");
+  if(imported.num_points != pointcloud.num_points || imported.user_data_names != pointcloud.user_data_names)
+    return;
+
+  expect(imported.user_data_types[3] == BASE_TYPE::FLOAT64, "xyz: type of the time");
+
+  bool same_values = true;
+  for(size_t i=0; same_values && i<pointcloud.num_points; ++i)
+  {
+    const uint8_t* row = pointcloud.user_data.const_data() + i*pointcloud.user_data_stride;
+    const uint8_t* imported_row = imported.user_data.const_data() + i*imported.user_data_stride;
+    same_values = imported.vertex(i).coordinate == pointcloud.vertex(i).coordinate
+               && std::memcmp(imported_row + imported.user_data_offset[3], row + 12, sizeof(float64_t)) == 0;
+  }
+  expect(same_values, "xyz: imported values");
+}
+
+int main()
+{
+  QTemporaryDir directory;
+  if(!directory.isValid())
+  {
+    println_error("Couldn't create a temporary directory");
+    return -1;
+  }
+
+  test_float_formatting();
+  test_integer_formatting();
+  test_write_rows();
+  test_export_and_import(directory);
+
+  return test_result();
+}
+
+template<typename T>
+std::string formatted(T value)
+{
+  char text[ascii_values::max_value_length];
+  return std::string(text, ascii_values::format_float(text, value));
+}
+
+// The text parses back to the value (with the parser of the importers and with strtod) and no shorter text does
+template<typename T>
+bool is_shortest_round_trip(T value, const std::string& text)
+{
+  const bool is_float32 = std::is_same<T, float32_t>::value;
+  const data_type::base_type_t type = is_float32 ? BASE_TYPE::FLOAT32 : BASE_TYPE::FLOAT64;
+
+  T parsed_value;
+  if(text.size() > ascii_values::max_value_length
+     || ascii_values::parse_value(text.data(), text.data()+text.size(), type, reinterpret_cast<uint8_t*>(&parsed_value)) != text.data()+text.size()
+     || std::memcmp(&parsed_value, &value, sizeof(T)) != 0
+     || (is_float32 ? T(std::strtof(text.c_str(), nullptr)) : T(std::strtod(text.c_str(), nullptr))) != value)
+    return false;
+
+  const int num_digits = count_significant_digits(text);
+  if(num_digits <= 1 || std::isinf(value))
+    return true;
+
+  char shorter_text[64];
+  std::snprintf(shorter_text, sizeof(shorter_text), "%.*g", num_digits-1, float64_t(value));
+  return is_float32 ? std::strtof(shorter_text, nullptr) != value : std::strtod(shorter_text, nullptr) != value;
+}
+
+int count_significant_digits(const std::string& text)
+{
+  std::string digits;
+  for(char c : text.substr(0, text.find('e')))
+    if(c >= '0' && c <= '9')
+      digits += c;
+
+  const size_t first = digits.find_first_not_of('0');
+  if(first == std::string::npos)
+    return 1;
+  const size_t last = digits.find_last_not_of('0');
+  return int(last - first + 1);
+}
+
+// Random coordinates (stored as x, y and z) and values of a float64, an int32 and a uint16 property
+void make_random_points(PointCloud* pointcloud, size_t num_points)
+{
+  pointcloud->set_user_data_format(26, {"x", "y", "z", "time", "label", "intensity"}, {0, 4, 8, 12, 20, 24}, {BASE_TYPE::FLOAT32, BASE_TYPE::FLOAT32, BASE_TYPE::FLOAT32, BASE_TYPE::FLOAT64, BASE_TYPE::INT32, BASE_TYPE::UINT16});
+  pointcloud->resize(num_points);
+  pointcloud->aabb = aabb_t::invalid();
+
+  std::mt19937_64 random(9);
+  std::uniform_real_distribution<float32_t> coordinate(-500, 500);
+  std::uniform_real_distribution<float64_t> time(1e8, 1e9);
+
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(pointcloud->coordinate_color.data());
+  uint8_t* row = pointcloud->user_data.data();
+  for(size_t i=0; i<num_points; ++i, row+=26)
+  {
+    vertices[i].coordinate = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+    vertices[i].color = glm::u8vec3(255, 255, 255);
+
+    std::memcpy(row, &vertices[i].coordinate, 12);
+    write_value_to_buffer<float64_t>(row + 12, time(random));
+    write_value_to_buffer<int32_t>(row + 20, int32_t(random()));
+    write_value_to_buffer<uint16_t>(row + 24, uint16_t(random()));
+
+    pointcloud->aabb |= vertices[i].coordinate;
+  }
+
+  pointcloud->is_valid = true;
+}
+
+bool same_user_data(const PointCloud& a, const PointCloud& b)
+{
+  return a.num_points == b.num_points
+      && a.user_data_stride == b.user_data_stride
+      && a.user_data_names == b.user_data_names
+      && a.user_data_types == b.user_data_types
+      && std::memcmp(a.user_data.const_data(), b.user_data.const_data(), a.num_points * a.user_data_stride) == 0;
+}
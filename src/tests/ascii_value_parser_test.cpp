@@ -0,0 +1,266 @@
+#include <pointcloud/importer/ascii_value_parser.hpp>
+#include <pointcloud/importer/ply_importer.hpp>
+#include <tests/test_helpers.hpp>
+#include <core_library/print.hpp>
+
+#include <QTemporaryDir>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <vector>
+
+/*
+Checks the locale independent number parser of ascii files against the
+correctly rounded results of strtof/strtod (including decimals next to the
+halfway point between two floats), the rows and blank lines of ascii bodies and
+the parallel import of ascii ply files.
+*/
+
+typedef data_type::BASE_TYPE BASE_TYPE;
+
+bool parses_like_strtof(const std::string& text);
+bool parses_like_strtod(const std::string& text);
+template<typename T>
+bool parses_to(const std::string& text, data_type::base_type_t type, T expected_value);
+bool is_rejected(const std::string& text, data_type::base_type_t type);
+std::string random_decimal(std::mt19937_64& random, int max_digits, int min_exponent, int max_exponent);
+
+void test_float_parsing()
+{
+  for(const char* text : {"0", "-0", "1", "0.1", "-2.5", "3.14159", "1e-7", "1.5E+20", "+42.", ".5", "16777217", "3.4028235e38", "1.17549435e-38", "1e-40", "0.3", "123456789012345678901234"})
+  {
+    expect(parses_like_strtof(text), format("float32 \"", text, "\""));
+    expect(parses_like_strtod(text), format("float64 \"", text, "\""));
+  }
+  expect(parses_like_strtod("5e-324") && parses_like_strtod("1.7976931348623157e308"), "float64 extremes");
+
+  // The halfway points between 1 and its neighbours round to even. The nearest double of the other decimals is a halfway point, but they lie next to it
+  expect(parses_to("1.000000059604644775390625", BASE_TYPE::FLOAT32, 1.f), "float32 halfway point rounds down to even");
+  expect(parses_to("1.000000178813934326171875", BASE_TYPE::FLOAT32, 1.f + std::ldexp(1.f, -22)), "float32 halfway point rounds up to even");
+  for(const char* text : {"8.267385005950927", "8.507587909698487", "1.0000000596046447753906251", "1.000000178813934326171874999999"})
+    expect(parses_like_strtof(text), format("float32 next to a halfway point \"", text, "\""));
+
+  std::mt19937_64 random(7);
+  size_t num_mismatches = 0;
+  for(size_t i=0; i<200000; ++i)
+  {
+    const std::string float_text = random_decimal(random, 10, -44, 37);
+    const std::string double_text = random_decimal(random, 20, -300, 307);
+    if(!parses_like_strtof(float_text) && num_mismatches++ < 10)
+      println_error("float32 \"", float_text, "\"");
+    if(!parses_like_strtod(double_text) && num_mismatches++ < 10)
+      println_error("float64 \"", double_text, "\"");
+  }
+  expect(num_mismatches == 0, format("random decimals: ", num_mismatches, " values rounded differently than by strtof/strtod"));
+
+  for(const char* text : {"nan", "-NaN", "inf", "-Infinity"})
+  {
+    float64_t value = 0;
+    const char* end = text + std::strlen(text);
+    const bool valid = ascii_values::parse_value(text, end, BASE_TYPE::FLOAT64, reinterpret_cast<uint8_t*>(&value)) == end;
+    expect(valid && (std::isnan(value) || std::isinf(value)) && std::signbit(value) == (text[0]=='-'), format("float64 \"", text, "\""));
+  }
+
+  for(const char* text : {"", "-", "1.5x", "e5", "1e", "1,5", "0x10"})
+    expect(is_rejected(text, BASE_TYPE::FLOAT32), format("float32 \"", text, "\" is invalid"));
+}
+
+void test_integer_parsing()
+{
+  expect(parses_to<int8_t>("-128", BASE_TYPE::INT8, -128) && parses_to<int8_t>("127", BASE_TYPE::INT8, 127), "int8 range");
+  expect(parses_to<uint8_t>("255", BASE_TYPE::UINT8, 255) && parses_to<uint8_t>("+0", BASE_TYPE::UINT8, 0), "uint8 range");
+  expect(parses_to<int16_t>("-32768", BASE_TYPE::INT16, -32768) && parses_to<uint16_t>("65535", BASE_TYPE::UINT16, 65535), "16 bit ranges");
+  expect(parses_to<int32_t>("-2147483648", BASE_TYPE::INT32, std::numeric_limits<int32_t>::min()) && parses_to<uint32_t>("4294967295", BASE_TYPE::UINT32, 4294967295u), "32 bit ranges");
+  expect(parses_to<uint32_t>("  0000000000000042", BASE_TYPE::UINT32, 42), "leading spaces and zeros");
+
+  expect(is_rejected("-129", BASE_TYPE::INT8) && is_rejected("256", BASE_TYPE::UINT8) && is_rejected("-1", BASE_TYPE::UINT16), "values out of range");
+  expect(is_rejected("2147483648", BASE_TYPE::INT32) && is_rejected("4294967296", BASE_TYPE::UINT32) && is_rejected("99999999999999999999999", BASE_TYPE::UINT32), "values out of the 32 bit range");
+  expect(is_rejected("1.5", BASE_TYPE::INT32) && is_rejected("1e3", BASE_TYPE::INT32) && is_rejected("12a", BASE_TYPE::UINT8) && is_rejected("", BASE_TYPE::INT16) && is_rejected("+", BASE_TYPE::INT16), "invalid integers");
+}
+
+void test_rows()
+{
+  const QVector<data_type::base_type_t> types = {BASE_TYPE::FLOAT32, BASE_TYPE::INT16, BASE_TYPE::UINT8};
+
+  struct row_t
+  {
+    float32_t a;
+    int16_t b;
+    uint8_t c;
+  };
+  auto parse = [&types](const std::string& line, char delimiter, row_t* row) {
+    uint8_t packed[7];
+    if(!ascii_values::parse_row(line.data(), line.data()+line.size(), delimiter, types, packed))
+      return false;
+    row->a = read_value_from_buffer<float32_t>(packed);
+    row->b = read_value_from_buffer<int16_t>(packed+4);
+    row->c = read_value_from_buffer<uint8_t>(packed+6);
+    return true;
+  };
+
+  row_t row;
+  expect(parse("1.5 -7 200", ' ', &row) && row.a == 1.5f && row.b == -7 && row.c == 200, "row separated by a space");
+  expect(parse("\t 1.5 \t-7   200 \r", ' ', &row) && row.a == 1.5f && row.b == -7 && row.c == 200, "row separated by tabs and spaces");
+  expect(parse("1.5,-7,200", ',', &row) && parse("1.5; -7 ;200\r", ';', &row) && row.c == 200, "rows separated by a delimiter");
+  expect(!parse("1.5 -7", ' ', &row) && !parse("1.5 -7 200 3", ' ', &row) && !parse("1.5,-7", ',', &row) && !parse("1.5,-7,200,3", ',', &row), "rows with other numbers of values");
+  expect(!parse("1.5 -7 256", ' ', &row) && !parse("1.5,,200", ',', &row) && !parse("", ' ', &row), "invalid rows");
+
+  const std::string body = "1 2 3\n\n4 5 6\r\n   \t\n7 8 9\n\r\n10 11 12";
+  expect(ascii_values::count_rows(body.data(), body.data()+body.size()) == 4, "count rows without the blank lines");
+  expect(ascii_values::count_rows(body.data(), body.data()) == 0, "count rows of an empty body");
+
+  for(const char* line : {"", " ", "\t\r", "\r"})
+    expect(ascii_values::is_blank_line(line, line+std::strlen(line)), format("\"", line, "\" is blank"));
+  expect(!ascii_values::is_blank_line(" 0 ", " 0 "+3), "\" 0 \" isn't blank");
+}
+
+// Enough rows to be parsed by several threads, with blank lines and windows line endings in between
+void test_ply_import(const QTemporaryDir& directory)
+{
+  const std::string filename = (directory.path() + "/ascii.ply").toStdString();
+  const size_t num_points = 300000;
+
+  std::mt19937_64 random(11);
+  std::vector<float32_t> expected_coordinates(num_points * 3);
+  std::vector<float64_t> expected_times(num_points);
+  std::vector<int32_t> expected_labels(num_points);
+  {
+    std::ofstream stream(filename, std::ios::binary);
+    stream << "ply\nformat ascii 1.0\nelement vertex " << num_points << "\nproperty float x\nproperty float y\nproperty float z\nproperty double time\nproperty int label\nend_header\n";
+
+    char line[256];
+    for(size_t i=0; i<num_points; ++i)
+    {
+      const std::string x = random_decimal(random, 9, -3, 3);
+      const std::string y = random_decimal(random, 9, -3, 3);
+      const std::string z = random_decimal(random, 9, -3, 3);
+      const std::string time = random_decimal(random, 17, -5, 5);
+      const int32_t label = int32_t(random());
+
+      expected_coordinates[i*3] = std::strtof(x.c_str(), nullptr);
+      expected_coordinates[i*3+1] = std::strtof(y.c_str(), nullptr);
+      expected_coordinates[i*3+2] = std::strtof(z.c_str(), nullptr);
+      expected_times[i] = std::strtod(time.c_str(), nullptr);
+      expected_labels[i] = label;
+
+      std::snprintf(line, sizeof(line), "%s %s\t%s %s %d%s", x.c_str(), y.c_str(), z.c_str(), time.c_str(), int(label), i%3==0 ? "\r\n" : "\n");
+      stream << line;
+      if(i%1000 == 0)
+        stream << (i%2000 == 0 ? "\n" : "  \t\r\n");
+    }
+  }
+
+  PlyImporter importer(filename);
+  importer.import();
+  expect(importer.state == AbstractPointCloudImporter::SUCCEEDED, "ascii ply: import");
+
+  const PointCloud& pointcloud = importer.pointcloud;
+  expect(pointcloud.num_points == num_points && pointcloud.user_data_stride == 24, format("ascii ply: ", pointcloud.num_points, " points"));
+  if(pointcloud.num_points != num_points || pointcloud.user_data_stride != 24)
+    return;
+
+  bool same_values = true;
+  for(size_t i=0; same_values && i<num_points; ++i)
+  {
+    const uint8_t* row = pointcloud.user_data.const_data() + i*24;
+    const glm::vec3 coordinate = pointcloud.vertex(i).coordinate;
+    same_values = std::memcmp(row, &expected_coordinates[i*3], 12) == 0
+               && read_value_from_buffer<float64_t>(row + 12) == expected_times[i]
+               && read_value_from_buffer<int32_t>(row + 20) == expected_labels[i]
+               && coordinate == glm::vec3(expected_coordinates[i*3], expected_coordinates[i*3+1], expected_coordinates[i*3+2]);
+  }
+  expect(same_values, "ascii ply: parsed values");
+
+  // a body with fewer rows than the header announces
+  {
+    std::ofstream stream(filename, std::ios::binary);
+    stream << "ply\nformat ascii 1.0\nelement vertex 3\nproperty float x\nproperty float y\nproperty float z\nend_header\n1 2 3\n\n4 5 6\n\n";
+  }
+  PlyImporter truncated_importer(filename);
+  truncated_importer.import();
+  expect(truncated_importer.state != AbstractPointCloudImporter::SUCCEEDED, "ascii ply: missing rows");
+}
+
+int main()
+{
+  QTemporaryDir directory;
+  if(!directory.isValid())
+  {
+    println_error("Couldn't create a temporary directory");
+    return -1;
+  }
+
+  test_float_parsing();
+  test_integer_parsing();
+  test_rows();
+  test_ply_import(directory);
+
+  return test_result();
+}
+
+bool parses_like_strtof(const std::string& text)
+{
+  const float32_t expected_value = std::strtof(text.c_str(), nullptr);
+
+  float32_t value;
+  const char* end = text.data() + text.size();
+  return ascii_values::parse_value(text.data(), end, BASE_TYPE::FLOAT32, reinterpret_cast<uint8_t*>(&value)) == end
+      && std::memcmp(&value, &expected_value, sizeof(float32_t)) == 0;
+}
+
+bool parses_like_strtod(const std::string& text)
+{
+  const float64_t expected_value = std::strtod(text.c_str(), nullptr);
+
+  float64_t value;
+  const char* end = text.data() + text.size();
+  return ascii_values::parse_value(text.data(), end, BASE_TYPE::FLOAT64, reinterpret_cast<uint8_t*>(&value)) == end
+      && std::memcmp(&value, &expected_value, sizeof(float64_t)) == 0;
+}
+
+template<typename T>
+bool parses_to(const std::string& text, data_type::base_type_t type, T expected_value)
+{
+  T value;
+  const char* end = text.data() + text.size();
+  return ascii_values::parse_value(text.data(), end, type, reinterpret_cast<uint8_t*>(&value)) == end
+      && std::memcmp(&value, &expected_value, sizeof(T)) == 0;
+}
+
+bool is_rejected(const std::string& text, data_type::base_type_t type)
+{
+  uint8_t value[8];
+  return ascii_values::parse_value(text.data(), text.data() + text.size(), type, value) == nullptr;
+}
+
+// A decimal like "-1234.5678e-9" with up to max_digits significant digits, sometimes written with leading zeros, trailing zeros or without exponent
+std::string random_decimal(std::mt19937_64& random, int max_digits, int min_exponent, int max_exponent)
+{
+  const int num_digits = 1 + int(random() % uint64_t(max_digits));
+  const int exponent = min_exponent + int(random() % uint64_t(max_exponent - min_exponent + 1));
+
+  std::string digits;
+  for(int i=0; i<num_digits; ++i)
+    digits += char('0' + random() % 10);
+  if(digits[0] == '0')
+    digits[0] = '1';
+
+  std::string text = random() % 2 ? "-" : "";
+  switch(random() % 3)
+  {
+  case 0:
+    text += digits.substr(0, 1) + "." + digits.substr(1) + "e" + std::to_string(exponent);
+    break;
+  case 1:
+    text += "0." + std::string(size_t(random() % 4), '0') + digits;
+    break;
+  default:
+    text += digits + std::string(size_t(random() % 4), '0');
+  }
+  return text;
+}
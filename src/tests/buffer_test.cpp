@@ -0,0 +1,212 @@
+#include <pointcloud/buffer.hpp>
+#include <tests/test_helpers.hpp>
+
+#include <QTemporaryDir>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+/*
+Checks the copy-on-write of buffers: changing a buffer shared with a snapshot
+copies only the chunks overlapping the changed range, while the snapshot keeps
+the old content, also for overwritten ranges, memset, resize and mapped files.
+The remaining chunks of a partial copy are only copied by the non-const data(),
+and every non-const access changes the revision.
+*/
+
+const size_t chunk_size = Buffer::copy_chunk_size;
+const size_t buffer_size = chunk_size * 5 / 2;
+
+std::vector<uint8_t> make_pattern(size_t size, uint8_t seed);
+void fill(Buffer* buffer, const std::vector<uint8_t>& content);
+bool has_content(const Buffer& buffer, const std::vector<uint8_t>& content);
+
+
+void test_ranged_writes()
+{
+  const std::vector<uint8_t> old_content = make_pattern(buffer_size, 1);
+
+  Buffer buffer;
+  fill(&buffer, old_content);
+  const Buffer snapshot = buffer.snapshot();
+
+  // a write in the middle of the second chunk
+  std::vector<uint8_t> new_content = old_content;
+  const size_t offset = chunk_size + 1000;
+  std::memset(buffer.data(offset, 100), 0xab, 100);
+  std::memset(new_content.data() + offset, 0xab, 100);
+
+  expect(!buffer.shares_data_with(snapshot), "the written buffer gets a memory of its own");
+  expect(!buffer.is_complete(), "a ranged write copies only some chunks");
+  expect(has_content(snapshot, old_content), "the snapshot keeps the old content after a ranged write");
+
+  // overwriting the whole first chunk and a part of the last one
+  const size_t overwrite_offset = chunk_size * 2 + 10;
+  std::memset(buffer.overwrite(0, chunk_size), 0x12, chunk_size);
+  std::memset(new_content.data(), 0x12, chunk_size);
+  std::memset(buffer.overwrite(overwrite_offset, 20), 0x34, 20);
+  std::memset(new_content.data() + overwrite_offset, 0x34, 20);
+
+  expect(has_content(snapshot, old_content), "the snapshot keeps the old content after overwriting");
+
+  buffer.data();
+  expect(buffer.is_complete(), "the non-const data() copies the remaining chunks");
+  expect(has_content(buffer, new_content), "partially overwritten chunks keep the bytes outside of the range");
+}
+
+void test_snapshot_of_partial_copy()
+{
+  const std::vector<uint8_t> old_content = make_pattern(buffer_size, 2);
+
+  Buffer buffer;
+  fill(&buffer, old_content);
+  const Buffer first_snapshot = buffer.snapshot();
+
+  std::vector<uint8_t> new_content = old_content;
+  std::memset(buffer.data(10, 10), 0x56, 10);
+  std::memset(new_content.data() + 10, 0x56, 10);
+
+  // the second snapshot sees the written and the copied remaining chunks
+  buffer.data();
+  const Buffer second_snapshot = buffer.snapshot();
+  expect(has_content(second_snapshot, new_content), "snapshot of a partially copied buffer");
+
+  std::memset(buffer.data(chunk_size * 2, 10), 0x78, 10);
+  expect(has_content(first_snapshot, old_content), "the first snapshot keeps its content");
+  expect(has_content(second_snapshot, new_content), "the second snapshot keeps its content");
+
+  std::memset(new_content.data() + chunk_size * 2, 0x78, 10);
+  buffer.data();
+  expect(has_content(buffer, new_content), "the buffer contains both writes");
+}
+
+void test_whole_buffer_changes()
+{
+  const std::vector<uint8_t> old_content = make_pattern(buffer_size, 3);
+
+  {
+    Buffer buffer;
+    fill(&buffer, old_content);
+    const Buffer snapshot = buffer.snapshot();
+
+    buffer.memset(0);
+    expect(has_content(snapshot, old_content), "memset keeps the snapshot");
+    expect(has_content(buffer, std::vector<uint8_t>(buffer_size, 0)), "memset of a shared buffer");
+  }
+
+  {
+    Buffer buffer;
+    fill(&buffer, old_content);
+    const Buffer snapshot = buffer.snapshot();
+
+    buffer.data(0, 1)[0] = 0x9a;
+    buffer.resize(chunk_size + 7);
+
+    std::vector<uint8_t> new_content(old_content.begin(), old_content.begin() + chunk_size + 7);
+    new_content[0] = 0x9a;
+    expect(has_content(snapshot, old_content), "resizing keeps the snapshot");
+    expect(has_content(buffer, new_content), "resizing a partially copied buffer keeps its content");
+  }
+
+  {
+    Buffer buffer;
+    fill(&buffer, old_content);
+    const Buffer snapshot = buffer.snapshot();
+
+    std::vector<uint8_t> new_content = old_content;
+    buffer.data()[buffer_size - 1] = 0xbc;
+    new_content[buffer_size - 1] = 0xbc;
+    expect(has_content(snapshot, old_content), "writing the whole buffer keeps the snapshot");
+    expect(has_content(buffer, new_content), "writing the whole buffer");
+  }
+}
+
+void test_mapped_file(const QTemporaryDir& directory)
+{
+  const QString filename = directory.path() + "/mapped.bin";
+  const std::vector<uint8_t> old_content = make_pattern(buffer_size, 4);
+
+  {
+    std::ofstream file(filename.toStdString(), std::ios::binary);
+    file.write(reinterpret_cast<const char*>(old_content.data()), std::streamsize(buffer_size));
+  }
+
+  Buffer buffer;
+  expect(buffer.map_file(filename, 0, buffer_size), "map the file");
+  const Buffer snapshot = buffer.snapshot();
+
+  std::vector<uint8_t> new_content = old_content;
+  std::memset(buffer.overwrite(chunk_size, chunk_size), 0xde, chunk_size);
+  std::memset(new_content.data() + chunk_size, 0xde, chunk_size);
+
+  expect(snapshot.is_mapped() && !buffer.is_mapped(), "only the snapshot stays mapped");
+  expect(has_content(snapshot, old_content), "the mapped snapshot keeps the content of the file");
+
+  buffer.data();
+  expect(has_content(buffer, new_content), "the written buffer reads the other chunks from the mapping");
+}
+
+void test_revisions()
+{
+  Buffer buffer;
+  buffer.resize(100);
+  const Buffer snapshot = buffer.snapshot();
+  expect(snapshot.revision() == buffer.revision(), "a snapshot has the revision of its buffer");
+
+  size_t revision = buffer.revision();
+  buffer.const_data();
+  expect(buffer.revision() == revision, "reading keeps the revision");
+
+  buffer.data(10, 10);
+  expect(buffer.revision() != revision, "a ranged write changes the revision");
+  revision = buffer.revision();
+  buffer.overwrite(0, 100);
+  expect(buffer.revision() != revision, "overwriting changes the revision");
+  revision = buffer.revision();
+  buffer.memset(0);
+  expect(buffer.revision() != revision, "memset changes the revision");
+
+  // a snapshot moved into an existing buffer keeps its revision, a replaced buffer gets a new one
+  Buffer moved_snapshot;
+  moved_snapshot = buffer.snapshot();
+  expect(moved_snapshot.revision() == buffer.revision(), "moving a snapshot keeps its revision");
+
+  Buffer replacement;
+  replacement.resize(100);
+  revision = buffer.revision();
+  buffer = std::move(replacement);
+  expect(buffer.revision() > revision, "replacing a buffer increases its revision");
+}
+
+int main()
+{
+  QTemporaryDir directory;
+
+  test_ranged_writes();
+  test_snapshot_of_partial_copy();
+  test_whole_buffer_changes();
+  test_mapped_file(directory);
+  test_revisions();
+
+  return test_result();
+}
+
+std::vector<uint8_t> make_pattern(size_t size, uint8_t seed)
+{
+  std::vector<uint8_t> content(size);
+  for(size_t i=0; i<size; ++i)
+    content[i] = uint8_t(i * 31 + i / 4099 + seed);
+  return content;
+}
+
+void fill(Buffer* buffer, const std::vector<uint8_t>& content)
+{
+  buffer->resize(content.size());
+  std::memcpy(buffer->data(), content.data(), content.size());
+}
+
+bool has_content(const Buffer& buffer, const std::vector<uint8_t>& content)
+{
+  return std::memcmp(buffer.const_data(), content.data(), content.size()) == 0;
+}
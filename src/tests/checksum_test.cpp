@@ -0,0 +1,219 @@
+#include <core_library/checksum.hpp>
+#include <core_library/print.hpp>
+#include <pointcloud/exporter/pcvd_exporter.hpp>
+#include <pointcloud/importer/pcvd_importer.hpp>
+#include <pointcloud/pcvd_file_format.hpp>
+#include <tests/test_helpers.hpp>
+
+#include <QTemporaryDir>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+/*
+Checks checksum64 against reference values of XXH64 (computed by the xxhash
+library for the test buffer of its own self test), and that pcvd imports detect
+a corrupt chunk in every read mode, while sampling and when only verifying.
+*/
+
+struct reference_t
+{
+  size_t size;
+  uint64_t seed;
+  uint64_t checksum;
+};
+
+// XXH64 of the first `size` bytes of the test buffer. The sizes cover the tails of 1, 4 and 8 bytes and the 32 byte stripes
+const reference_t references[] = {
+  {0, 0, 0xef46db3751d8e999u},
+  {1, 0, 0xe934a84adb052768u},
+  {3, 0, 0xff7e1959cb50794au},
+  {4, 0, 0x9136a0dca57457eeu},
+  {7, 0, 0x6c83909a9f01ed25u},
+  {8, 0, 0xcdbcf538e71d1348u},
+  {14, 0, 0x8282dcc4994e35c8u},
+  {31, 0, 0x299b39a290e6d783u},
+  {32, 0, 0x18b216492bb44b70u},
+  {33, 0, 0x55c8dc3e578f5b59u},
+  {100, 0, 0x4bfe019cd91d9ea4u},
+  {222, 0, 0xb641ae8cb691c174u},
+  {1000, 0, 0x52bd1358f22e9ef7u},
+  {2048, 0, 0x5940f2752bc04387u},
+  {0, 2654435761u, 0xac75fda2929b17efu},
+  {1, 2654435761u, 0x5014607643a9b4c3u},
+  {3, 2654435761u, 0xaa8584e83660f7d1u},
+  {4, 2654435761u, 0xcaab286bd8e9fdb5u},
+  {7, 2654435761u, 0xf98d03b1ad6f9293u},
+  {8, 2654435761u, 0xfe0c047a5353cdacu},
+  {14, 2654435761u, 0xc3bd6bf63deb6df0u},
+  {31, 2654435761u, 0xda673d5feb5c1d79u},
+  {32, 2654435761u, 0xb3f33bdf93ade409u},
+  {33, 2654435761u, 0xe92c292f64bc3071u},
+  {100, 2654435761u, 0x4853706dc9625caeu},
+  {222, 2654435761u, 0x20cb8ab7ae10c14au},
+  {1000, 2654435761u, 0x72751a2408017e26u},
+  {2048, 2654435761u, 0xaa26f33c2898013bu},
+};
+
+std::vector<uint8_t> make_test_buffer(size_t size);
+int64_t point_data_offset_of_chunk(const std::string& filename, size_t chunk);
+void flip_bit(const std::string& filename, int64_t offset);
+
+
+void test_reference_values()
+{
+  const std::vector<uint8_t> buffer = make_test_buffer(2048);
+
+  for(const reference_t& reference : references)
+  {
+    expect(checksum64(buffer.data(), reference.size, reference.seed) == reference.checksum, format("XXH64 of ", reference.size, " bytes with seed ", reference.seed));
+
+    // the data doesn't need to be aligned
+    for(size_t misalignment=1; misalignment<8; ++misalignment)
+    {
+      std::vector<uint8_t> misaligned(reference.size + misalignment);
+      std::memcpy(misaligned.data() + misalignment, buffer.data(), reference.size);
+      expect(checksum64(misaligned.data() + misalignment, reference.size, reference.seed) == reference.checksum, format("XXH64 of ", reference.size, " bytes with seed ", reference.seed, " at misalignment ", misalignment));
+    }
+  }
+
+  // the checksum of a chunk chains the vertex data and the point data
+  expect(pcvd_format::chunk_checksum(buffer.data(), 100, buffer.data() + 100, 122) == checksum64(buffer.data() + 100, 122, 0x4bfe019cd91d9ea4u), "chunk checksum");
+}
+
+void test_corrupt_file(const QTemporaryDir& directory, bool compress)
+{
+  const std::string filename = (directory.path() + "/checksums.pcvd").toStdString();
+  const std::string description = compress ? "compressed file" : "file";
+
+  PointCloud pointcloud;
+  make_numbered_grid(&pointcloud, 0, 100000, grid_user_data_t::INDEX);
+
+  PcvdExporter exporter(filename, pointcloud);
+  exporter.points_per_chunk = 7000;
+  exporter.compress = compress;
+  exporter.export_now();
+  expect(exporter.state == AbstractPointCloudExporter::SUCCEEDED, description + ": export");
+
+  {
+    PcvdImporter verifier(filename);
+    verifier.verify_only = true;
+    verifier.import();
+    expect(verifier.state == AbstractPointCloudImporter::SUCCEEDED, description + ": verify intact file");
+  }
+
+  flip_bit(filename, point_data_offset_of_chunk(filename, 3) + 10);
+
+  {
+    PcvdImporter verifier(filename);
+    verifier.verify_only = true;
+    verifier.import();
+    expect(verifier.state == AbstractPointCloudImporter::INVALID_FILE, description + ": verify corrupt file");
+  }
+
+  for(PcvdImporter::read_mode_t read_mode : all_read_modes)
+  {
+    PcvdImporter importer(filename);
+    importer.read_mode = read_mode;
+    importer.import();
+    expect(importer.state == AbstractPointCloudImporter::INVALID_FILE, format(description, " (read mode ", int(read_mode), "): import corrupt file"));
+  }
+
+  // the rows of deferred columns are verified, too
+  if(!compress)
+  {
+    PcvdImporter importer(filename);
+    importer.load_used_properties_only = true;
+    importer.import();
+    expect(importer.state == AbstractPointCloudImporter::INVALID_FILE, description + ": import corrupt file with deferred columns");
+  }
+
+  {
+    PcvdImporter importer(filename);
+    importer.sampling.every_nth_point = 3;
+    importer.import();
+    expect(importer.state == AbstractPointCloudImporter::INVALID_FILE, description + ": sample corrupt file");
+  }
+
+  // without verifying, the flipped bit of raw data is loaded as it is
+  if(!compress)
+  {
+    PcvdImporter importer(filename);
+    importer.read_mode = PcvdImporter::READ_MODE::STREAM;
+    importer.verify_checksums = false;
+    importer.import();
+    expect(importer.state == AbstractPointCloudImporter::SUCCEEDED, description + ": import corrupt file without verifying");
+  }
+}
+
+void test_file_without_checksums(const QTemporaryDir& directory)
+{
+  const std::string filename = (directory.path() + "/no_checksums.pcvd").toStdString();
+
+  PointCloud pointcloud;
+  make_numbered_grid(&pointcloud, 0, 10000, grid_user_data_t::INDEX);
+
+  PcvdExporter exporter(filename, pointcloud);
+  exporter.save_checksums = false;
+  exporter.export_now();
+
+  PcvdImporter importer(filename);
+  importer.import();
+  expect(importer.state == AbstractPointCloudImporter::SUCCEEDED, "file without checksums: import");
+
+  PcvdImporter verifier(filename);
+  verifier.verify_only = true;
+  verifier.import();
+  expect(verifier.state == AbstractPointCloudImporter::INVALID_FILE, "file without checksums: can't be verified");
+}
+
+int main()
+{
+  QTemporaryDir directory;
+  if(!directory.isValid())
+  {
+    println_error("Couldn't create a temporary directory");
+    return -1;
+  }
+
+  test_reference_values();
+  test_corrupt_file(directory, false);
+  test_corrupt_file(directory, true);
+  test_file_without_checksums(directory);
+
+  return test_result();
+}
+
+// The same pseudo random bytes as used by the self test of xxhsum
+std::vector<uint8_t> make_test_buffer(size_t size)
+{
+  std::vector<uint8_t> buffer(size);
+
+  uint64_t generator = 2654435761u;
+  for(uint8_t& value : buffer)
+  {
+    value = uint8_t(generator >> 56);
+    generator *= 11400714785074694797u;
+  }
+
+  return buffer;
+}
+
+int64_t point_data_offset_of_chunk(const std::string& filename, size_t chunk)
+{
+  pcvd_file_t file;
+  return read_chunk_table(filename, &file) && chunk < file.chunks.size() ? file.chunks[chunk].point_data_offset : 0;
+}
+
+void flip_bit(const std::string& filename, int64_t offset)
+{
+  std::fstream stream(filename, std::ios::in | std::ios::out | std::ios::binary);
+
+  char value = 0;
+  stream.seekg(offset);
+  stream.read(&value, 1);
+  value ^= 0x10;
+  stream.seekp(offset);
+  stream.write(&value, 1);
+}
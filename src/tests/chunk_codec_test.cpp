@@ -0,0 +1,393 @@
+#include <pointcloud/chunk_codec.hpp>
+#include <pointcloud/exporter/pcvd_exporter.hpp>
+#include <pointcloud/importer/pcvd_importer.hpp>
+#include <pointcloud/pcvd_file_format.hpp>
+#include <tests/test_helpers.hpp>
+#include <core_library/print.hpp>
+
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+/*
+Checks the encodings of pcvd chunks (see chunk_codec.hpp): the round trip of
+rows through the bit-packing for columns of every size and value distribution,
+that truncated or corrupt data is rejected instead of read out of bounds, and
+that compressed pcvd files are imported unchanged. Quantized coordinates must
+not differ by more than half the precision, while all other columns are kept
+exactly.
+*/
+
+enum class values_t
+{
+  RANDOM,
+  ZERO,
+  RAMP,
+  ALTERNATING_EXTREMES,
+};
+
+bool same_points_up_to_precision(const PointCloud& a, const PointCloud& b, float64_t precision);
+std::vector<pcvd_format::encoding_t> encodings_of_chunks(const std::string& filename);
+
+
+// Columns of each size with gaps in between, which the codec must leave unchanged
+const QVector<chunk_codec::column_t> columns = {{0, 1}, {1, 2}, {4, 4}, {8, 8}, {17, 4}, {21, 1}};
+const size_t stride = 24;
+
+// The bytes between the columns are always random
+std::vector<uint8_t> make_rows(size_t num_rows, values_t values, std::mt19937_64& random_engine)
+{
+  std::vector<uint8_t> rows(num_rows * stride);
+  for(uint8_t& value : rows)
+    value = uint8_t(random_engine());
+
+  for(size_t row=0; row<num_rows; ++row)
+    for(int i=0; i<columns.length(); ++i)
+    {
+      uint64_t value = 0;
+      switch(values)
+      {
+      case values_t::RANDOM:
+        value = random_engine();
+        break;
+      case values_t::ZERO:
+        value = 0;
+        break;
+      case values_t::RAMP:
+        value = uint64_t(row * size_t(i+1) / 3);
+        break;
+      case values_t::ALTERNATING_EXTREMES:
+        value = row % 2 == 0 ? 0 : std::numeric_limits<uint64_t>::max();
+        break;
+      }
+
+      // little endian
+      for(size_t byte=0; byte<columns[i].size; ++byte)
+        rows[row*stride + columns[i].offset + byte] = uint8_t(value >> (byte*8));
+    }
+
+  return rows;
+}
+
+void test_round_trip()
+{
+  std::mt19937_64 random_engine(42);
+
+  for(size_t num_rows : {size_t(1), size_t(5), chunk_codec::block_size-1, chunk_codec::block_size, chunk_codec::block_size+1, size_t(1000), size_t(70000)})
+    for(values_t values : {values_t::RANDOM, values_t::ZERO, values_t::RAMP, values_t::ALTERNATING_EXTREMES})
+    {
+      const std::string description = format(num_rows, " rows with values ", int(values));
+      const std::vector<uint8_t> rows = make_rows(num_rows, values, random_engine);
+
+      // the encoded rows are appended
+      std::vector<uint8_t> encoded = {42};
+      chunk_codec::encode(rows.data(), stride, num_rows, columns, &encoded);
+      expect(encoded.size() > chunk_codec::padding_size && encoded.front() == 42, description + ": appending");
+
+      // bytes between the columns keep their value
+      std::vector<uint8_t> decoded(rows.size(), 0);
+      for(size_t row=0; row<num_rows; ++row)
+        for(size_t gap : {size_t(3), size_t(16), size_t(22), size_t(23)})
+          decoded[row*stride + gap] = rows[row*stride + gap];
+
+      const bool decoded_successfully = chunk_codec::decode(encoded.data()+1, encoded.size()-1, stride, num_rows, columns, decoded.data());
+      expect(decoded_successfully && decoded == rows, description + ": round trip");
+
+      // similar neighbors need only a few bits (the columns make up 20 of the 24 bytes of a row)
+      if(values == values_t::ZERO && num_rows >= 1000)
+        expect(encoded.size() < num_rows, format(description, ": ", encoded.size(), " encoded bytes"));
+      if(values == values_t::RAMP && num_rows >= 1000)
+        expect(encoded.size() < num_rows * 3, format(description, ": ", encoded.size(), " encoded bytes"));
+
+      // truncated data must be detected
+      for(size_t truncated_size : {size_t(0), (encoded.size()-1) / 2, encoded.size()-2})
+        expect(!chunk_codec::decode(encoded.data()+1, truncated_size, stride, num_rows, columns, decoded.data()), format(description, ": truncated to ", truncated_size, " bytes"));
+    }
+}
+
+// Corrupt data may decode to wrong rows, but must never be read or written out of bounds
+void test_corrupt_data()
+{
+  std::mt19937_64 random_engine(7);
+
+  for(int i=0; i<2000; ++i)
+  {
+    const size_t num_rows = 1 + random_engine() % 300;
+    const std::vector<uint8_t> rows = make_rows(num_rows, values_t::RAMP, random_engine);
+
+    std::vector<uint8_t> encoded;
+    chunk_codec::encode(rows.data(), stride, num_rows, columns, &encoded);
+    for(int j=0; j<4; ++j)
+      encoded[random_engine() % encoded.size()] = uint8_t(random_engine());
+
+    std::vector<uint8_t> decoded(rows.size());
+    chunk_codec::decode(encoded.data(), encoded.size(), stride, num_rows, columns, decoded.data());
+  }
+}
+
+void test_vertex_and_user_data_columns()
+{
+  PointCloud pointcloud;
+  make_numbered_grid(&pointcloud, 0, 10000, grid_user_data_t::INDEX_COORDINATES_AND_INTENSITY, 0.01f);
+
+  const QVector<chunk_codec::column_t> vertex_columns = chunk_codec::vertex_columns();
+  const QVector<chunk_codec::column_t> user_data_columns = chunk_codec::user_data_columns(pointcloud.user_data_offset, pointcloud.user_data_types);
+  expect(user_data_columns.length() == pointcloud.user_data_names.length(), "user data columns: one column per property");
+
+  std::vector<uint8_t> encoded;
+  chunk_codec::encode(pointcloud.coordinate_color.const_data(), PointCloud::stride, pointcloud.num_points, vertex_columns, &encoded);
+  const size_t vertex_data_size = encoded.size();
+  chunk_codec::encode(pointcloud.user_data.const_data(), pointcloud.user_data_stride, pointcloud.num_points, user_data_columns, &encoded);
+
+  std::vector<uint8_t> vertices(pointcloud.num_points * PointCloud::stride, 0xff);
+  std::vector<uint8_t> user_data(pointcloud.num_points * pointcloud.user_data_stride, 0xff);
+  expect(chunk_codec::decode(encoded.data(), vertex_data_size, PointCloud::stride, pointcloud.num_points, vertex_columns, vertices.data()), "vertex columns: decode");
+  expect(chunk_codec::decode(encoded.data() + vertex_data_size, encoded.size() - vertex_data_size, pointcloud.user_data_stride, pointcloud.num_points, user_data_columns, user_data.data()), "user data columns: decode");
+
+  // the columns cover the whole vertex including its padding
+  expect(std::memcmp(vertices.data(), pointcloud.coordinate_color.const_data(), vertices.size()) == 0, "vertex columns: round trip");
+  expect(std::memcmp(user_data.data(), pointcloud.user_data.const_data(), user_data.size()) == 0, "user data columns: round trip");
+}
+
+// Coordinates within [100, 110] with 1mm precision need 2 bytes per coordinate (1 byte more than the extent in units of the precision)
+void test_quantization()
+{
+  typedef data_type::BASE_TYPE BASE_TYPE;
+
+  const size_t num_rows = 1000;
+  const float64_t precision = 0.001;
+  std::mt19937_64 random_engine(3);
+  std::uniform_real_distribution<float64_t> coordinate(100, 110);
+
+  for(bool float64_coordinates : {false, true})
+  {
+    // x y z, an uint16 intensity and a float64 time
+    const size_t coordinate_size = float64_coordinates ? 8 : 4;
+    const size_t row_stride = 3*coordinate_size + 2 + 8;
+    const QVector<QString> names = {"x", "y", "z", "intensity", "time"};
+    const QVector<size_t> offsets = {0, coordinate_size, 2*coordinate_size, 3*coordinate_size, 3*coordinate_size + 2};
+    const BASE_TYPE coordinate_type = float64_coordinates ? BASE_TYPE::FLOAT64 : BASE_TYPE::FLOAT32;
+    const QVector<data_type::base_type_t> types = {coordinate_type, coordinate_type, coordinate_type, BASE_TYPE::UINT16, BASE_TYPE::FLOAT64};
+
+    QVector<chunk_codec::column_t> quantized_columns;
+    expect(chunk_codec::user_data_columns_for_quantization(names, offsets, types, &quantized_columns) && quantized_columns.length() == 5, "quantization: columns");
+
+    std::vector<uint8_t> rows(num_rows * row_stride);
+    for(size_t i=0; i<num_rows; ++i)
+    {
+      uint8_t* row = rows.data() + i*row_stride;
+      for(size_t axis=0; axis<3; ++axis)
+      {
+        if(float64_coordinates)
+          write_value_to_buffer<float64_t>(row + axis*8, coordinate(random_engine));
+        else
+          write_value_to_buffer<float32_t>(row + axis*4, float32_t(coordinate(random_engine)));
+      }
+      write_value_to_buffer<uint16_t>(row + 3*coordinate_size, uint16_t(random_engine()));
+      write_value_to_buffer<float64_t>(row + 3*coordinate_size + 2, coordinate(random_engine) * 1.e6);
+    }
+
+    for(bool bit_packing : {false, true})
+    {
+      const std::string description = format("quantization (float", coordinate_size*8, ", bit-packing ", bit_packing, ")");
+
+      std::vector<uint8_t> encoded;
+      expect(chunk_codec::quantize(rows.data(), row_stride, num_rows, quantized_columns, precision, bit_packing, &encoded), description + ": quantize");
+      if(encoded.size() < sizeof(chunk_codec::quantization_t))
+        continue;
+
+      chunk_codec::quantization_t quantization;
+      std::memcpy(&quantization, encoded.data(), sizeof(chunk_codec::quantization_t));
+      expect(quantization.precision == precision && quantization.bytes_per_coordinate == (bit_packing ? 4 : 2), format(description, ": ", quantization.bytes_per_coordinate, " bytes per coordinate"));
+      if(!bit_packing)
+        expect(encoded.size() == sizeof(chunk_codec::quantization_t) + num_rows * (3*2 + 2 + 8), format(description, ": ", encoded.size(), " encoded bytes"));
+
+      std::vector<uint8_t> dequantized(rows.size(), 0);
+      expect(chunk_codec::dequantize(encoded.data(), encoded.size(), row_stride, num_rows, quantized_columns, bit_packing, dequantized.data()), description + ": dequantize");
+
+      // half the precision plus the rounding to float32
+      const float64_t max_error = precision * 0.5 + (float64_coordinates ? 1.e-9 : 1.e-5);
+      bool within_precision = true;
+      bool other_columns_unchanged = true;
+      for(size_t i=0; i<num_rows; ++i)
+      {
+        const uint8_t* row = rows.data() + i*row_stride;
+        const uint8_t* dequantized_row = dequantized.data() + i*row_stride;
+        for(size_t axis=0; axis<3; ++axis)
+        {
+          const float64_t original = float64_coordinates ? read_value_from_buffer<float64_t>(row + axis*8) : float64_t(read_value_from_buffer<float32_t>(row + axis*4));
+          const float64_t restored = float64_coordinates ? read_value_from_buffer<float64_t>(dequantized_row + axis*8) : float64_t(read_value_from_buffer<float32_t>(dequantized_row + axis*4));
+          within_precision = within_precision && std::abs(original - restored) <= max_error;
+        }
+        other_columns_unchanged = other_columns_unchanged && std::memcmp(row + 3*coordinate_size, dequantized_row + 3*coordinate_size, 10) == 0;
+      }
+      expect(within_precision, description + ": coordinates within half the precision");
+      expect(other_columns_unchanged, description + ": other columns");
+
+      // truncated data must be detected
+      expect(!chunk_codec::dequantize(encoded.data(), encoded.size()-1, row_stride, num_rows, quantized_columns, bit_packing, dequantized.data()), description + ": truncated");
+      expect(!chunk_codec::dequantize(encoded.data(), sizeof(chunk_codec::quantization_t)-1, row_stride, num_rows, quantized_columns, bit_packing, dequantized.data()), description + ": truncated quantization");
+    }
+
+    // coordinates which can't be quantized are rejected without appending anything
+    std::vector<uint8_t> encoded = {42};
+    std::vector<uint8_t> rows_with_nan = rows;
+    if(float64_coordinates)
+      write_value_to_buffer<float64_t>(rows_with_nan.data() + 500*row_stride + 8, std::numeric_limits<float64_t>::quiet_NaN());
+    else
+      write_value_to_buffer<float32_t>(rows_with_nan.data() + 500*row_stride + 4, std::numeric_limits<float32_t>::quiet_NaN());
+    expect(!chunk_codec::quantize(rows_with_nan.data(), row_stride, num_rows, quantized_columns, precision, false, &encoded) && encoded.size() == 1, format("quantization (float", coordinate_size*8, "): not finite coordinate"));
+    expect(!chunk_codec::quantize(rows.data(), row_stride, num_rows, quantized_columns, 1.e-9, false, &encoded) && encoded.size() == 1, format("quantization (float", coordinate_size*8, "): extent too large for the precision"));
+  }
+}
+
+void test_compressed_file(const QTemporaryDir& directory)
+{
+  PointCloud pointcloud;
+  make_numbered_grid(&pointcloud, 0, 100000, grid_user_data_t::INDEX_COORDINATES_AND_INTENSITY, 0.01f);
+  pointcloud.build_kd_tree([](size_t, size_t){return true;});
+
+  for(bool save_vertex_data : {true, false})
+  {
+    const std::string filename = (directory.path() + "/compressed.pcvd").toStdString();
+    const std::string description = save_vertex_data ? "compressed file" : "compressed file without vertices";
+
+    PcvdExporter exporter(filename, pointcloud);
+    exporter.points_per_chunk = 7000;
+    exporter.compress = true;
+    exporter.save_vertex_data = save_vertex_data;
+    exporter.export_now();
+    expect(exporter.state == AbstractPointCloudExporter::SUCCEEDED, description + ": export");
+
+    const std::vector<pcvd_format::encoding_t> encodings = encodings_of_chunks(filename);
+    expect(encodings.size() == 15 && std::count(encodings.begin(), encodings.end(), pcvd_format::ENCODING::DELTA_BIT_PACKING) == 15, description + ": encoding of the chunks");
+
+    for(PcvdImporter::read_mode_t read_mode : all_read_modes)
+    {
+      PcvdImporter importer(filename);
+      importer.read_mode = read_mode;
+      importer.import();
+
+      const std::string mode_description = format(description, " (read mode ", int(read_mode), ")");
+      expect(importer.state == AbstractPointCloudImporter::SUCCEEDED, mode_description + ": import");
+      expect(importer.has_compressed_chunks, mode_description + ": has compressed chunks");
+      if(save_vertex_data)
+        expect(same_points(pointcloud, importer.pointcloud) && importer.pointcloud.kdtree_index.is_initialized(), mode_description + ": points");
+      else
+        expect(importer.pointcloud.num_points == pointcloud.num_points && std::memcmp(importer.pointcloud.user_data.const_data(), pointcloud.user_data.const_data(), pointcloud.num_points * pointcloud.user_data_stride) == 0, mode_description + ": user data");
+    }
+  }
+}
+
+// Chunks with a coordinate, which isn't finite, are stored without quantization
+void test_quantized_file(const QTemporaryDir& directory)
+{
+  const float64_t precision = 0.001;
+
+  PointCloud pointcloud;
+  make_numbered_grid(&pointcloud, 0, 100000, grid_user_data_t::INDEX_COORDINATES_AND_INTENSITY, 0.01f);
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(pointcloud.coordinate_color.data());
+  vertices[50000].coordinate.y = std::numeric_limits<float32_t>::quiet_NaN();
+  std::memcpy(pointcloud.user_data.data() + 50000*pointcloud.user_data_stride + 4, &vertices[50000].coordinate, 12);
+
+  for(bool compress : {false, true})
+  {
+    const std::string filename = (directory.path() + "/quantized.pcvd").toStdString();
+    const std::string description = compress ? "quantized and compressed file" : "quantized file";
+
+    PcvdExporter exporter(filename, pointcloud);
+    exporter.points_per_chunk = 7000;
+    exporter.compress = compress;
+    exporter.quantization_precision = precision;
+    exporter.export_now();
+    expect(exporter.state == AbstractPointCloudExporter::SUCCEEDED, description + ": export");
+
+    // the point with the NaN coordinate is in the 8th chunk
+    const pcvd_format::encoding_t quantized_encoding = compress ? pcvd_format::ENCODING::QUANTIZED_DELTA_BIT_PACKING : pcvd_format::ENCODING::QUANTIZED;
+    const pcvd_format::encoding_t unquantized_encoding = compress ? pcvd_format::ENCODING::DELTA_BIT_PACKING : pcvd_format::ENCODING::RAW;
+    const std::vector<pcvd_format::encoding_t> encodings = encodings_of_chunks(filename);
+    bool expected_encodings = encodings.size() == 15;
+    for(size_t i=0; expected_encodings && i<encodings.size(); ++i)
+      expected_encodings = encodings[i] == (i == 7 ? unquantized_encoding : quantized_encoding);
+    expect(expected_encodings, description + ": encoding of the chunks");
+
+    for(PcvdImporter::read_mode_t read_mode : all_read_modes)
+    {
+      PcvdImporter importer(filename);
+      importer.read_mode = read_mode;
+      importer.import();
+
+      const std::string mode_description = format(description, " (read mode ", int(read_mode), ")");
+      expect(importer.state == AbstractPointCloudImporter::SUCCEEDED, mode_description + ": import");
+      expect(importer.quantization_precision == precision, mode_description + ": precision");
+      expect(same_points_up_to_precision(pointcloud, importer.pointcloud, precision), mode_description + ": points");
+    }
+  }
+}
+
+int main()
+{
+  QTemporaryDir directory;
+  if(!directory.isValid())
+  {
+    println_error("Couldn't create a temporary directory");
+    return -1;
+  }
+
+  test_round_trip();
+  test_corrupt_data();
+  test_vertex_and_user_data_columns();
+  test_quantization();
+  test_compressed_file(directory);
+  test_quantized_file(directory);
+
+  return test_result();
+}
+
+// The coordinates (vertices and x/y/z of the user data) may differ by half the precision, everything else must be the same
+bool same_points_up_to_precision(const PointCloud& a, const PointCloud& b, float64_t precision)
+{
+  if(a.num_points != b.num_points || a.user_data_stride != b.user_data_stride || a.user_data_names != b.user_data_names)
+    return false;
+
+  const float64_t max_error = precision * 0.5 + 1.e-6;
+  auto same_coordinate = [max_error](float32_t x, float32_t y) {
+    return std::isnan(x) ? std::isnan(y) : std::abs(float64_t(x) - float64_t(y)) <= max_error;
+  };
+
+  for(size_t i=0; i<a.num_points; ++i)
+  {
+    const PointCloud::vertex_t vertex_a = a.vertex(i);
+    const PointCloud::vertex_t vertex_b = b.vertex(i);
+    const uint8_t* row_a = a.user_data.const_data() + i*a.user_data_stride;
+    const uint8_t* row_b = b.user_data.const_data() + i*b.user_data_stride;
+
+    if(vertex_a.color != vertex_b.color)
+      return false;
+    if(std::memcmp(row_a, row_b, 4) != 0 || std::memcmp(row_a + 16, row_b + 16, a.user_data_stride - 16) != 0)
+      return false;
+
+    for(int axis=0; axis<3; ++axis)
+      if(!same_coordinate(vertex_a.coordinate[axis], vertex_b.coordinate[axis]) || !same_coordinate(read_value_from_buffer<float32_t>(row_a + 4 + axis*4), read_value_from_buffer<float32_t>(row_b + 4 + axis*4)))
+        return false;
+  }
+
+  return true;
+}
+
+std::vector<pcvd_format::encoding_t> encodings_of_chunks(const std::string& filename)
+{
+  pcvd_file_t file;
+  if(!read_chunk_table(filename, &file))
+    return {};
+
+  std::vector<pcvd_format::encoding_t> encodings;
+  for(const pcvd_format::chunk_description_t& chunk : file.chunks)
+    encodings.push_back(chunk.encoding);
+  return encodings;
+}
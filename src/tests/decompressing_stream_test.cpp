@@ -0,0 +1,140 @@
+#include <pointcloud/importer/decompressing_stream.hpp>
+#include <tests/test_helpers.hpp>
+#include <core_library/print.hpp>
+
+#include <QTemporaryDir>
+
+#include <zlib.h>
+
+#ifndef ZSTD_SUPPORT
+#define ZSTD_SUPPORT 0
+#endif
+
+#if ZSTD_SUPPORT
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+/*
+Checks decompressing gzip and zstd files: the decompressed content must be
+complete, also when it's larger than the buffers of the stream and ends in the
+middle of one, and truncated files must be reported as failed.
+*/
+
+typedef DecompressingStream::COMPRESSION COMPRESSION;
+
+const size_t buffer_size = DecompressingStream::buffer_size;
+const size_t content_sizes[] = {100, buffer_size * 2, buffer_size * 2 + 12345, buffer_size * 3 - 1};
+
+std::vector<char> make_content(size_t size);
+bool compress(const std::string& filename, COMPRESSION compression, const std::vector<char>& content);
+std::vector<char> decompress(const std::string& filename, COMPRESSION compression, bool* has_error);
+void truncate(const std::string& filename);
+
+
+void test_decompression(const QTemporaryDir& directory, COMPRESSION compression)
+{
+  const std::string suffix = compression == COMPRESSION::GZIP ? ".gz" : ".zst";
+
+  for(size_t content_size : content_sizes)
+  {
+    const std::string filename = (directory.path() + format("/content_", content_size, suffix.c_str()).c_str()).toStdString();
+    const std::string description = format(suffix, " file with ", content_size, " bytes");
+
+    const std::vector<char> content = make_content(content_size);
+    expect(compress(filename, compression, content), description + ": compress");
+
+    bool has_error = true;
+    expect(decompress(filename, compression, &has_error) == content, description + ": decompressed content");
+    expect(!has_error, description + ": no error");
+
+    truncate(filename);
+    decompress(filename, compression, &has_error);
+    expect(has_error, description + ": truncated file fails");
+  }
+}
+
+int main()
+{
+  QTemporaryDir directory;
+
+  test_decompression(directory, COMPRESSION::GZIP);
+  if(DecompressingStream::is_supported(COMPRESSION::ZSTD))
+    test_decompression(directory, COMPRESSION::ZSTD);
+
+  return test_result();
+}
+
+// Compressible, but not a repetition of a short pattern, so the blocks of the compressed files differ in size
+std::vector<char> make_content(size_t size)
+{
+  std::vector<char> content(size);
+  uint32_t state = 12345;
+  for(size_t i=0; i<size; ++i)
+  {
+    state = state * 1103515245u + 12345u;
+    content[i] = char('a' + (state >> 16) % 8);
+  }
+  return content;
+}
+
+bool compress(const std::string& filename, COMPRESSION compression, const std::vector<char>& content)
+{
+  std::vector<char> compressed;
+
+  if(compression == COMPRESSION::GZIP)
+  {
+    gzFile file = gzopen(filename.c_str(), "wb");
+    if(file == nullptr)
+      return false;
+    const bool written = gzwrite(file, content.data(), unsigned(content.size())) == int(content.size());
+    return gzclose(file) == Z_OK && written;
+  }
+
+#if ZSTD_SUPPORT
+  // Two frames, so the blocks of the second frame don't end at multiples of the buffer size
+  const size_t frame_boundaries[] = {0, std::min<size_t>(content.size(), 12345), content.size()};
+  for(size_t i=0; i<2; ++i)
+  {
+    const size_t frame_size = frame_boundaries[i+1] - frame_boundaries[i];
+    const size_t offset = compressed.size();
+    compressed.resize(offset + ZSTD_compressBound(frame_size));
+    const size_t compressed_size = ZSTD_compress(compressed.data() + offset, compressed.size() - offset, content.data() + frame_boundaries[i], frame_size, 3);
+    if(ZSTD_isError(compressed_size))
+      return false;
+    compressed.resize(offset + compressed_size);
+  }
+#else
+  return false;
+#endif
+
+  std::ofstream file(filename, std::ios_base::out | std::ios_base::binary);
+  file.write(compressed.data(), std::streamsize(compressed.size()));
+  return bool(file);
+}
+
+std::vector<char> decompress(const std::string& filename, COMPRESSION compression, bool* has_error)
+{
+  DecompressingStream stream(filename, compression);
+  std::vector<char> content((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+  *has_error = stream.has_error();
+  return content;
+}
+
+// Cuts off the last quarter of the file
+void truncate(const std::string& filename)
+{
+  std::vector<char> bytes;
+  {
+    std::ifstream file(filename, std::ios_base::in | std::ios_base::binary);
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+
+  std::ofstream file(filename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  file.write(bytes.data(), std::streamsize(bytes.size() - bytes.size() / 4));
+}
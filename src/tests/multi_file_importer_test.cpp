@@ -0,0 +1,122 @@
+#include <pointcloud/exporter/pcvd_exporter.hpp>
+#include <pointcloud/exporter/ply_exporter.hpp>
+#include <pointcloud/importer/multi_file_importer.hpp>
+#include <tests/test_helpers.hpp>
+#include <core_library/print.hpp>
+
+#include <QTemporaryDir>
+
+#include <vector>
+
+/*
+Checks merging tiles with different origins: a ply file with absolute
+coordinates and two pcvd files with origins of their own must end up at the
+same world space positions in the merged point cloud, whether the files are
+imported directly into their slices or merged afterwards.
+*/
+
+struct tile_t
+{
+  size_t first_point;
+  size_t end_point;
+  glm::dvec3 origin;
+  const char* suffix;
+};
+
+const tile_t tiles[] = {
+  {0, 3000, glm::dvec3(0), "ply"},
+  {3000, 7000, glm::dvec3(100000, -20000, 30), "pcvd"},
+  {7000, 10000, glm::dvec3(100250, -19900, 35), "pcvd"},
+};
+
+QStringList export_tiles(const QTemporaryDir& directory);
+glm::dvec3 grid_coordinate(uint32_t index);
+
+
+void test_merged_origins(const QStringList& files, bool merge_afterwards)
+{
+  const std::string description = merge_afterwards ? "merged afterwards" : "imported into slices";
+
+  MultiFileImporter importer(files);
+  // sampling without dropping any point merges the files after importing them
+  if(merge_afterwards)
+    importer.sampling.max_num_points = 1000000;
+  importer.import();
+
+  const PointCloud& pointcloud = importer.pointcloud;
+  expect(importer.state == AbstractPointCloudImporter::SUCCEEDED, description + ": import");
+  expect(pointcloud.num_points == 10000, description + ": number of points");
+  expect(pointcloud.origin == tiles[1].origin, description + ": the first origin becomes the merged origin");
+
+  const int index_column = pointcloud.user_data_names.indexOf("index");
+  expect(index_column >= 0, description + ": index column");
+  if(pointcloud.num_points != 10000 || index_column < 0)
+    return;
+
+  bool same_positions = true;
+  bool inside_aabb = true;
+  for(size_t i=0; i<pointcloud.num_points; ++i)
+  {
+    const uint8_t* row = pointcloud.user_data.const_data() + i*pointcloud.user_data_stride + pointcloud.user_data_offset[index_column];
+    const uint32_t index = data_type::read_value_from_buffer<uint32_t>(pointcloud.user_data_types[index_column], row);
+    const glm::vec3 coordinate = pointcloud.vertex(i).coordinate;
+
+    same_positions = same_positions && glm::all(glm::lessThan(glm::abs(glm::dvec3(coordinate) + pointcloud.origin - grid_coordinate(index)), glm::dvec3(1.e-3)));
+    inside_aabb = inside_aabb && pointcloud.aabb.contains(coordinate, 1.e-3f);
+  }
+  expect(same_positions, description + ": world space positions");
+  expect(inside_aabb, description + ": bounding box");
+}
+
+int main()
+{
+  QTemporaryDir directory;
+
+  const QStringList files = export_tiles(directory);
+
+  test_merged_origins(files, false);
+  test_merged_origins(files, true);
+
+  return test_result();
+}
+
+QStringList export_tiles(const QTemporaryDir& directory)
+{
+  QStringList files;
+
+  for(const tile_t& tile : tiles)
+  {
+    PointCloud pointcloud;
+    make_numbered_grid(&pointcloud, tile.first_point, tile.end_point, grid_user_data_t::INDEX);
+
+    // the tile stores its vertices relative to its origin
+    pointcloud.origin = tile.origin;
+    pointcloud.aabb = aabb_t::invalid();
+    PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(pointcloud.coordinate_color.data());
+    for(size_t i=0; i<pointcloud.num_points; ++i)
+    {
+      PointCloud::vertex_t& vertex = vertices[i];
+      vertex.coordinate = glm::vec3(grid_coordinate(uint32_t(tile.first_point + i)) - tile.origin);
+      pointcloud.aabb |= vertex.coordinate;
+    }
+
+    const QString filename = directory.path() + format("/tile_", tile.first_point, ".", tile.suffix).c_str();
+    QSharedPointer<AbstractPointCloudExporter> exporter;
+    if(tile.origin == glm::dvec3(0))
+      exporter.reset(new PlyExporter(filename.toStdString(), pointcloud));
+    else
+      exporter.reset(new PcvdExporter(filename.toStdString(), pointcloud));
+    exporter->export_now();
+    expect(exporter->state == AbstractPointCloudExporter::SUCCEEDED, format("export tile ", tile.first_point));
+
+    files << filename;
+  }
+
+  return files;
+}
+
+// The world space position of the point with the given index, far away from the world space origin
+glm::dvec3 grid_coordinate(uint32_t index)
+{
+  return glm::dvec3(100100, -19950, 32) + glm::dvec3(index % 100, (index / 100) % 100, index / 10000) * 0.5;
+}
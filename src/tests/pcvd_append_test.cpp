@@ -0,0 +1,278 @@
+#include <pointcloud/exporter/pcvd_compaction.hpp>
+#include <pointcloud/exporter/pcvd_exporter.hpp>
+#include <pointcloud/importer/pcvd_importer.hpp>
+#include <pointcloud/pcvd_file_format.hpp>
+#include <tests/test_helpers.hpp>
+#include <core_library/print.hpp>
+
+#include <QTemporaryDir>
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+/*
+Checks appending to pcvd files: points exported in several parts with append
+must be imported like the points exported at once, before and after compacting
+the file. Compacting must keep the settings (and the origin) the file was
+stored with, and appending must reject files it can't extend without touching
+them.
+*/
+
+
+
+enum class compression_t
+{
+  NONE,
+  ALL_PARTS,
+  EVERY_OTHER_PART,
+};
+
+// The parts are not multiples of points_per_chunk, so each part ends with a smaller chunk
+const size_t part_boundaries[] = {0, 30000, 30001, 77777, 100000};
+
+void test_append_and_compact(const QTemporaryDir& directory, compression_t compression)
+{
+  const std::string filename = (directory.path() + format("/append_", int(compression), ".pcvd").c_str()).toStdString();
+  const std::string description = format("append (compression ", int(compression), ")");
+
+  PointCloud all_points;
+  make_numbered_grid(&all_points, 0, 100000, grid_user_data_t::INDEX_AND_COORDINATES);
+
+  // appending to a file, which doesn't exist yet, creates it
+  for(size_t i=0; i+1<sizeof(part_boundaries)/sizeof(size_t); ++i)
+  {
+    PointCloud part;
+    make_numbered_grid(&part, part_boundaries[i], part_boundaries[i+1], grid_user_data_t::INDEX_AND_COORDINATES);
+    if(i == 0)
+      part.build_kd_tree([](size_t, size_t){return true;});
+
+    PcvdExporter exporter(filename, part);
+    exporter.append = true;
+    exporter.points_per_chunk = i == 0 ? 7000 : 3000; // the file keeps the points per chunk of the first part
+    exporter.compress = compression == compression_t::ALL_PARTS || (compression == compression_t::EVERY_OTHER_PART && i%2 == 1);
+    exporter.export_now();
+    expect(exporter.state == AbstractPointCloudExporter::SUCCEEDED, format(description, ": export part ", i));
+  }
+
+  pcvd_file_t file;
+  expect(read_chunk_table(filename, &file), description + ": read chunk table");
+  expect(file.header.number_points == 100000 && file.chunks_header.points_per_chunk == 7000, description + ": header");
+  expect(file.chunks.size() == 5 + 1 + 7 + 4, format(description, ": ", file.chunks.size(), " chunks"));
+  expect((file.header.flags & 0b1) == 0, description + ": the kd-tree of the first part is dropped");
+
+  for(PcvdImporter::read_mode_t read_mode : all_read_modes)
+  {
+    PcvdImporter importer(filename);
+    importer.read_mode = read_mode;
+    importer.import();
+
+    const std::string mode_description = format(description, " (read mode ", int(read_mode), ")");
+    expect(importer.state == AbstractPointCloudImporter::SUCCEEDED, mode_description + ": import");
+    expect(same_points(all_points, importer.pointcloud) && !importer.pointcloud.has_build_kdtree(), mode_description + ": points");
+  }
+
+  {
+    PcvdImporter verifier(filename);
+    verifier.verify_only = true;
+    verifier.import();
+    expect(verifier.state == AbstractPointCloudImporter::SUCCEEDED, description + ": verify");
+  }
+
+  // compacting stores the chunks like a single export of all points
+  const bool rebuild_kd_tree = compression == compression_t::NONE;
+  expect(compact_pcvd_file(filename, rebuild_kd_tree), description + ": compact");
+
+  expect(read_chunk_table(filename, &file), description + ": read compacted chunk table");
+  expect(file.header.number_points == 100000 && file.chunks_header.points_per_chunk == 7000 && file.chunks.size() == 15, format(description, ": ", file.chunks.size(), " compacted chunks"));
+  if(compression == compression_t::NONE)
+  {
+    bool consecutive = true;
+    for(size_t i=1; i<file.chunks.size(); ++i)
+      consecutive = consecutive && file.chunks[i].vertex_data_offset == file.chunks[i-1].vertex_data_offset + int64_t(file.chunks[i-1].vertex_data_size) && file.chunks[i].point_data_offset == file.chunks[i-1].point_data_offset + int64_t(file.chunks[i-1].point_data_size);
+    expect(consecutive, description + ": compacted chunks are stored in one block per section");
+  }
+
+  for(PcvdImporter::read_mode_t read_mode : all_read_modes)
+  {
+    PcvdImporter importer(filename);
+    importer.read_mode = read_mode;
+    importer.import();
+
+    const std::string mode_description = format(description, " compacted (read mode ", int(read_mode), ")");
+    expect(importer.state == AbstractPointCloudImporter::SUCCEEDED, mode_description + ": import");
+    expect(same_points(all_points, importer.pointcloud) && importer.pointcloud.has_build_kdtree() == rebuild_kd_tree, mode_description + ": points");
+    expect(importer.has_compressed_chunks == (compression != compression_t::NONE), mode_description + ": compression");
+  }
+}
+
+// Compacting rewrites the file like it was stored before. The last part is appended with the default options, which
+// must neither change how the file stores its chunks nor be overwritten by the settings of the file.
+void test_compaction_keeps_settings(const QTemporaryDir& directory)
+{
+  const std::string filename = (directory.path() + "/settings.pcvd").toStdString();
+
+  for(size_t i=0; i<3; ++i)
+  {
+    PointCloud part;
+    make_numbered_grid(&part, i*50000, (i+1)*50000, grid_user_data_t::INDEX_AND_COORDINATES);
+
+    PcvdExporter exporter(filename, part);
+    exporter.append = true;
+    exporter.quantization_precision = 0.01;
+    if(i < 2)
+    {
+      exporter.points_per_chunk = 5000;
+      exporter.save_vertex_data = false;
+      exporter.save_checksums = false;
+      exporter.save_shader = false;
+    }
+    exporter.export_now();
+    expect(exporter.state == AbstractPointCloudExporter::SUCCEEDED, format("settings: export part ", i));
+    if(i == 2)
+      expect(exporter.save_vertex_data && exporter.save_checksums, "settings: the options of the appending exporter are kept");
+  }
+
+  expect(compact_pcvd_file(filename, false), "settings: compact");
+
+  PcvdImporter importer(filename);
+  importer.import();
+  expect(importer.state == AbstractPointCloudImporter::SUCCEEDED, "settings: import");
+  expect((importer.file_flags & 0b10110) == 0, format("settings: flags ", importer.file_flags));
+  expect(importer.file_points_per_chunk == 5000, "settings: points per chunk");
+  expect(importer.quantization_precision == 0.01 && !importer.has_compressed_chunks, "settings: quantized without compression");
+  expect(importer.pointcloud.num_points == 150000, "settings: number of points");
+}
+
+// The origin of the vertices is stored only if it isn't zero and survives appending and compacting
+void test_origin(const QTemporaryDir& directory)
+{
+  const std::string filename = (directory.path() + "/origin.pcvd").toStdString();
+  const glm::dvec3 origin(651000, 5410000, 300.5);
+
+  PointCloud all_points;
+  make_numbered_grid(&all_points, 0, 20000, grid_user_data_t::INDEX_AND_COORDINATES);
+
+  for(size_t i=0; i<2; ++i)
+  {
+    PointCloud part;
+    make_numbered_grid(&part, i*10000, (i+1)*10000, grid_user_data_t::INDEX_AND_COORDINATES);
+    part.origin = origin;
+
+    PcvdExporter exporter(filename, part);
+    exporter.append = true;
+    exporter.export_now();
+    expect(exporter.state == AbstractPointCloudExporter::SUCCEEDED, format("origin: export part ", i));
+  }
+
+  expect(compact_pcvd_file(filename, false), "origin: compact");
+
+  for(PcvdImporter::read_mode_t read_mode : all_read_modes)
+  {
+    PcvdImporter importer(filename);
+    importer.read_mode = read_mode;
+    importer.import();
+    expect(importer.state == AbstractPointCloudImporter::SUCCEEDED && (importer.file_flags & 0b100000) != 0, format("origin (read mode ", int(read_mode), "): import"));
+    expect(importer.pointcloud.origin == origin && same_points(all_points, importer.pointcloud), format("origin (read mode ", int(read_mode), "): points"));
+  }
+
+  // points relative to another origin can't be appended
+  {
+    PointCloud part;
+    make_numbered_grid(&part, 20000, 21000, grid_user_data_t::INDEX_AND_COORDINATES);
+
+    PcvdExporter appender(filename, part);
+    appender.append = true;
+    appender.export_now();
+    expect(appender.state == AbstractPointCloudExporter::RUNTIME_ERROR, "origin: append points relative to another origin");
+  }
+
+  // without origin, the file stays readable by readers not knowing about it
+  {
+    const std::string filename_without_origin = (directory.path() + "/no_origin.pcvd").toStdString();
+    PcvdExporter exporter(filename_without_origin, all_points);
+    exporter.export_now();
+
+    pcvd_file_t file;
+    expect(read_chunk_table(filename_without_origin, &file) && (file.header.flags & 0b100000) == 0, "origin: not stored, if zero");
+  }
+}
+
+void test_rejected_appends(const QTemporaryDir& directory)
+{
+  const std::string filename = (directory.path() + "/rejected.pcvd").toStdString();
+
+  PointCloud first_part;
+  make_numbered_grid(&first_part, 0, 1000, grid_user_data_t::INDEX_AND_COORDINATES);
+  PcvdExporter exporter(filename, first_part);
+  exporter.export_now();
+  expect(exporter.state == AbstractPointCloudExporter::SUCCEEDED, "rejected appends: export");
+
+  // other properties than the file
+  {
+    PointCloud part;
+    make_numbered_grid(&part, 1000, 2000, grid_user_data_t::INDEX_AND_COORDINATES);
+    part.user_data_names[0] = "other_index";
+
+    PcvdExporter appender(filename, part);
+    appender.append = true;
+    appender.export_now();
+    expect(appender.state == AbstractPointCloudExporter::RUNTIME_ERROR, "rejected appends: other properties");
+  }
+
+  PcvdImporter importer(filename);
+  importer.import();
+  expect(importer.state == AbstractPointCloudImporter::SUCCEEDED && same_points(first_part, importer.pointcloud), "rejected appends: the file is unchanged");
+
+  // corrupt chunks headers, which must be rejected before allocating or reading the chunk table
+  struct corruption_t
+  {
+    size_t field_offset;
+    uint64_t value;
+    const char* description;
+  };
+  const corruption_t corruptions[] = {
+    {offsetof(pcvd_format::chunks_header_t, points_per_chunk), 0, "zero points per chunk"},
+    {offsetof(pcvd_format::chunks_header_t, number_chunks), uint64_t(1) << 40, "huge number of chunks"},
+    {offsetof(pcvd_format::chunks_header_t, number_chunks), 1000, "chunk table behind the end of the file"},
+    {offsetof(pcvd_format::chunks_header_t, chunk_table_offset), uint64_t(1) << 40, "chunk table offset behind the end of the file"},
+    {offsetof(pcvd_format::chunks_header_t, chunk_table_offset), 0, "chunk table offset within the header"},
+  };
+  for(const corruption_t& corruption : corruptions)
+  {
+    exporter.export_now();
+    {
+      std::fstream stream(filename, std::ios::in | std::ios::out | std::ios::binary);
+      stream.seekp(std::streamoff(sizeof(pcvd_format::header_t) + corruption.field_offset));
+      stream.write(reinterpret_cast<const char*>(&corruption.value), sizeof(uint64_t));
+    }
+
+    PointCloud part;
+    make_numbered_grid(&part, 1000, 2000, grid_user_data_t::INDEX_AND_COORDINATES);
+
+    PcvdExporter appender(filename, part);
+    appender.append = true;
+    appender.export_now();
+    expect(appender.state == AbstractPointCloudExporter::RUNTIME_ERROR, format("rejected appends: ", corruption.description));
+  }
+}
+
+int main()
+{
+  QTemporaryDir directory;
+  if(!directory.isValid())
+  {
+    println_error("Couldn't create a temporary directory");
+    return -1;
+  }
+
+  test_append_and_compact(directory, compression_t::NONE);
+  test_append_and_compact(directory, compression_t::ALL_PARTS);
+  test_append_and_compact(directory, compression_t::EVERY_OTHER_PART);
+  test_compaction_keeps_settings(directory);
+  test_origin(directory);
+  test_rejected_appends(directory);
+
+  return test_result();
+}
@@ -0,0 +1,179 @@
+#include <pointcloud/exporter/pcvd_exporter.hpp>
+#include <pointcloud/importer/pcvd_importer.hpp>
+#include <pointcloud/importer/point_sampler.hpp>
+#include <pointcloud/pcvd_file_format.hpp>
+#include <tests/test_helpers.hpp>
+#include <core_library/print.hpp>
+
+#include <QTemporaryDir>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+/*
+Checks the chunk table of pcvd files: the number, size, aabb and position of
+the chunks written by the PcvdExporter, and that the PcvdImporter only relies on
+the offsets stored in the chunk table, also when skipping chunks outside of a
+crop box.
+*/
+
+bool write_chunks_in_reverse_order(const std::string& filename);
+
+
+void test_chunk_table(const PointCloud& pointcloud, const std::string& filename)
+{
+  pcvd_file_t file;
+  if(!read_chunk_table(filename, &file))
+  {
+    expect(false, "chunk table: reading the file");
+    return;
+  }
+
+  expect(file.header.file_version_number == 3, "chunk table: file version");
+  expect(file.header.number_points == pointcloud.num_points, "chunk table: number of points");
+  expect(file.chunks_header.points_per_chunk == 7000, "chunk table: points per chunk");
+  expect(file.chunks.size() == (pointcloud.num_points + 6999) / 7000, format("chunk table: number of chunks ", file.chunks.size()));
+
+  std::ifstream stream(filename, std::ios::binary);
+  const PointCloud::vertex_t* vertices = pointcloud.begin();
+  size_t first_point = 0;
+  for(size_t i=0; i<file.chunks.size(); ++i)
+  {
+    const pcvd_format::chunk_description_t& chunk = file.chunks[i];
+    const size_t num_points = glm::min<size_t>(7000, pointcloud.num_points - first_point);
+
+    expect(chunk.number_points == num_points, format("chunk ", i, ": number of points ", chunk.number_points));
+    expect(chunk.encoding == pcvd_format::ENCODING::RAW, format("chunk ", i, ": encoding"));
+    expect(chunk.vertex_data_size == num_points * PointCloud::stride && chunk.point_data_size == num_points * pointcloud.user_data_stride, format("chunk ", i, ": size of the stored data"));
+
+    aabb_t aabb = aabb_t::invalid();
+    for(size_t j=0; j<num_points; ++j)
+      aabb |= vertices[first_point+j].coordinate;
+    expect(chunk.aabb.min_point == aabb.min_point && chunk.aabb.max_point == aabb.max_point, format("chunk ", i, ": aabb"));
+
+    // the stored data must be found at the offsets of the chunk table
+    std::vector<uint8_t> vertex_data(chunk.vertex_data_size);
+    std::vector<uint8_t> point_data(chunk.point_data_size);
+    stream.seekg(chunk.vertex_data_offset);
+    stream.read(reinterpret_cast<char*>(vertex_data.data()), std::streamsize(vertex_data.size()));
+    stream.seekg(chunk.point_data_offset);
+    stream.read(reinterpret_cast<char*>(point_data.data()), std::streamsize(point_data.size()));
+    expect(stream && std::memcmp(vertex_data.data(), vertices + first_point, vertex_data.size()) == 0, format("chunk ", i, ": stored vertex data"));
+    expect(stream && std::memcmp(point_data.data(), pointcloud.user_data.const_data() + first_point*pointcloud.user_data_stride, point_data.size()) == 0, format("chunk ", i, ": stored point data"));
+    expect(chunk.checksum == pcvd_format::chunk_checksum(vertex_data.data(), vertex_data.size(), point_data.data(), point_data.size()), format("chunk ", i, ": checksum"));
+
+    first_point += num_points;
+  }
+
+  // the raw sections and the kd-tree are aligned, so they can be mapped
+  expect((file.header.flags & 0b1000) != 0, "chunk table: aligned flag");
+  expect(!file.chunks.empty() && file.chunks.front().vertex_data_offset % pcvd_format::section_alignment == 0 && file.chunks.front().point_data_offset % pcvd_format::section_alignment == 0, "chunk table: aligned chunk data");
+  expect((file.header.flags & 0b1) != 0 && file.chunks_header.kd_tree_offset % pcvd_format::section_alignment == 0, "chunk table: aligned kd-tree");
+}
+
+void test_import(const PointCloud& pointcloud, const std::string& filename, const std::string& description)
+{
+  for(PcvdImporter::read_mode_t read_mode : all_read_modes)
+  {
+    PcvdImporter importer(filename);
+    importer.read_mode = read_mode;
+    importer.import();
+
+    expect(importer.state == AbstractPointCloudImporter::SUCCEEDED, format(description, " (read mode ", int(read_mode), "): import"));
+    expect(same_points(pointcloud, importer.pointcloud), format(description, " (read mode ", int(read_mode), "): points"));
+  }
+}
+
+// Chunks outside of the crop box are skipped, which must select the same points as sampling all points
+void test_cropped_import(const PointCloud& pointcloud, const std::string& filename, const std::string& description)
+{
+  PointSampler::settings_t sampling;
+  sampling.crop = true;
+  sampling.crop_aabb.min_point = glm::vec3(20, 0, 3);
+  sampling.crop_aabb.max_point = glm::vec3(60, 99, 5);
+  sampling.every_nth_point = 2;
+
+  PointCloud expected_points = pointcloud.snapshot();
+  PointSampler::sample_loaded_pointcloud(expected_points, sampling);
+
+  PcvdImporter importer(filename);
+  importer.sampling = sampling;
+  importer.import();
+
+  expect(importer.state == AbstractPointCloudImporter::SUCCEEDED, format(description, " cropped: import"));
+  expect(expected_points.num_points > 0 && same_points(expected_points, importer.pointcloud), format(description, " cropped: ", importer.pointcloud.num_points, " points instead of ", expected_points.num_points));
+}
+
+int main()
+{
+  QTemporaryDir directory;
+  if(!directory.isValid())
+  {
+    println_error("Couldn't create a temporary directory");
+    return -1;
+  }
+  const std::string filename = (directory.path() + "/chunks.pcvd").toStdString();
+
+  PointCloud pointcloud;
+  make_numbered_grid(&pointcloud, 0, 100000, grid_user_data_t::INDEX_AND_COORDINATES);
+  pointcloud.build_kd_tree([](size_t, size_t){return true;});
+
+  PcvdExporter exporter(filename, pointcloud);
+  exporter.points_per_chunk = 7000;
+  exporter.export_now();
+  expect(exporter.state == AbstractPointCloudExporter::SUCCEEDED, "export");
+
+  test_chunk_table(pointcloud, filename);
+  test_import(pointcloud, filename, "chunked file");
+  test_cropped_import(pointcloud, filename, "chunked file");
+
+  // readers must only rely on the offsets of the chunk table, not on the order of the chunk data
+  expect(write_chunks_in_reverse_order(filename), "reversing the chunk data");
+  test_import(pointcloud, filename, "reversed chunk data");
+  test_cropped_import(pointcloud, filename, "reversed chunk data");
+
+  return test_result();
+}
+
+// Moves the data of the chunks in reverse order behind the end of the file and writes a new chunk table pointing to the copies.
+// The old data is overwritten, so reading it yields wrong points
+bool write_chunks_in_reverse_order(const std::string& filename)
+{
+  pcvd_file_t file;
+  if(!read_chunk_table(filename, &file))
+    return false;
+
+  std::fstream stream(filename, std::ios::in | std::ios::out | std::ios::binary);
+  for(size_t i=file.chunks.size(); i-->0;)
+  {
+    pcvd_format::chunk_description_t& chunk = file.chunks[i];
+
+    std::vector<char> data(chunk.vertex_data_size + chunk.point_data_size);
+    stream.seekg(chunk.vertex_data_offset);
+    stream.read(data.data(), std::streamsize(chunk.vertex_data_size));
+    stream.seekg(chunk.point_data_offset);
+    stream.read(data.data() + chunk.vertex_data_size, std::streamsize(chunk.point_data_size));
+
+    const std::vector<char> garbage(data.size(), char(0xff));
+    stream.seekp(chunk.vertex_data_offset);
+    stream.write(garbage.data(), std::streamsize(chunk.vertex_data_size));
+    stream.seekp(chunk.point_data_offset);
+    stream.write(garbage.data(), std::streamsize(chunk.point_data_size));
+
+    stream.seekp(0, std::ios_base::end);
+    const int64_t offset = int64_t(stream.tellp());
+    stream.write(data.data(), std::streamsize(data.size()));
+
+    chunk.vertex_data_offset = offset;
+    chunk.point_data_offset = offset + int64_t(chunk.vertex_data_size);
+  }
+
+  stream.seekp(0, std::ios_base::end);
+  file.chunks_header.chunk_table_offset = int64_t(stream.tellp());
+  stream.write(reinterpret_cast<const char*>(file.chunks.data()), std::streamsize(file.chunks.size() * sizeof(pcvd_format::chunk_description_t)));
+  stream.seekp(sizeof(pcvd_format::header_t));
+  stream.write(reinterpret_cast<const char*>(&file.chunks_header), sizeof(pcvd_format::chunks_header_t));
+
+  return bool(stream);
+}
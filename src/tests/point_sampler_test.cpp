@@ -0,0 +1,127 @@
+#include <pointcloud/importer/point_sampler.hpp>
+#include <tests/test_helpers.hpp>
+#include <core_library/print.hpp>
+
+#include <set>
+#include <vector>
+
+/*
+Checks the points selected by the PointSampler of the preview import mode:
+every nth point, cropping and the size and uniformity of the reservoir sample
+for a budget. The points of the synthetic point cloud store their index as user
+data, so each selected point can be traced back to the input.
+*/
+
+PointCloud sample_in_blocks(const PointCloud& input, const PointSampler::settings_t& settings, size_t block_size);
+
+void test_every_nth_point()
+{
+  PointCloud pointcloud;
+  make_numbered_grid(&pointcloud, 0, 100000, grid_user_data_t::INDEX);
+
+  PointSampler::settings_t settings;
+  settings.every_nth_point = 7;
+  PointSampler::sample_loaded_pointcloud(pointcloud, settings);
+
+  const std::vector<uint32_t> indices = indices_of_points(pointcloud);
+  expect(indices.size() == (100000 + 6) / 7, "every 7th point: number of points");
+
+  bool every_seventh = true;
+  for(size_t i=0; i<indices.size(); ++i)
+    every_seventh = every_seventh && indices[i] == i*7;
+  expect(every_seventh, "every 7th point: selected points");
+}
+
+void test_crop()
+{
+  PointCloud input;
+  make_numbered_grid(&input, 0, 100000, grid_user_data_t::INDEX);
+
+  PointSampler::settings_t settings;
+  settings.crop = true;
+  settings.crop_aabb.min_point = glm::vec3(10, 20, 2);
+  settings.crop_aabb.max_point = glm::vec3(19.5f, 29.5f, 5);
+
+  std::vector<uint32_t> expected_indices;
+  for(size_t i=0; i<input.num_points; ++i)
+    if(settings.crop_aabb.contains(input.vertex(i).coordinate, 0.f))
+      expected_indices.push_back(uint32_t(i));
+
+  PointCloud cropped = sample_in_blocks(input, settings, 1000);
+  expect(indices_of_points(cropped) == expected_indices, "crop: selected points");
+  expect(cropped.aabb.min_point == glm::vec3(10, 20, 2) && cropped.aabb.max_point == glm::vec3(19, 29, 5), "crop: aabb of the selected points");
+
+  // every nth point counts only the points within the aabb
+  settings.every_nth_point = 3;
+  std::vector<uint32_t> expected_nth_indices;
+  for(size_t i=0; i<expected_indices.size(); i+=3)
+    expected_nth_indices.push_back(expected_indices[i]);
+
+  PointCloud cropped_nth = sample_in_blocks(input, settings, 1000);
+  expect(indices_of_points(cropped_nth) == expected_nth_indices, "crop and every 3rd point: selected points");
+}
+
+void test_budget()
+{
+  const size_t num_points = 1000000;
+  const size_t budget = 10000;
+
+  PointCloud input;
+  make_numbered_grid(&input, 0, num_points, grid_user_data_t::INDEX);
+
+  PointSampler::settings_t settings;
+  settings.max_num_points = budget;
+
+  // the importers feed the sampler block by block, which must not change the size of the sample
+  for(size_t block_size : {size_t(1) << 16, size_t(999), num_points})
+  {
+    const std::vector<uint32_t> indices = indices_of_points(sample_in_blocks(input, settings, block_size));
+    expect(indices.size() == budget, format("budget (blocks of ", block_size, "): number of points ", indices.size()));
+
+    const std::set<uint32_t> distinct_indices(indices.begin(), indices.end());
+    expect(distinct_indices.size() == indices.size(), format("budget (blocks of ", block_size, "): each point is selected at most once"));
+    expect(distinct_indices.empty() || *distinct_indices.rbegin() < num_points, format("budget (blocks of ", block_size, "): selected points exist"));
+
+    // Each tenth of the input should contribute a tenth of the sample. The standard deviation is about 30 points
+    const size_t num_bins = 10;
+    std::vector<size_t> points_per_bin(num_bins, 0);
+    for(uint32_t index : indices)
+      points_per_bin[index * num_bins / num_points]++;
+    for(size_t bin=0; bin<num_bins; ++bin)
+      expect(points_per_bin[bin] > budget/num_bins - 150 && points_per_bin[bin] < budget/num_bins + 150, format("budget (blocks of ", block_size, "): ", points_per_bin[bin], " points of the ", bin, ". tenth of the input"));
+  }
+
+  // a budget larger than the input keeps all points
+  settings.max_num_points = num_points * 2;
+  const std::vector<uint32_t> indices = indices_of_points(sample_in_blocks(input, settings, 4096));
+  bool all_points = indices.size() == num_points;
+  for(size_t i=0; all_points && i<num_points; ++i)
+    all_points = indices[i] == i;
+  expect(all_points, "budget larger than the input: all points in order");
+}
+
+int main()
+{
+  test_every_nth_point();
+  test_crop();
+  test_budget();
+
+  return test_result();
+}
+
+// Streams the points into the sampler like an importer, block by block
+PointCloud sample_in_blocks(const PointCloud& input, const PointSampler::settings_t& settings, size_t block_size)
+{
+  PointCloud sample;
+  sample.set_user_data_format(input.user_data_stride, input.user_data_names, input.user_data_offset, input.user_data_types);
+
+  PointSampler sampler(settings, sample, input.num_points);
+  for(size_t first_point=0; first_point<input.num_points; first_point+=block_size)
+  {
+    const size_t num_block_points = glm::min(block_size, input.num_points - first_point);
+    sampler.add_points(input.user_data.const_data() + first_point*input.user_data_stride, input.begin() + first_point, num_block_points);
+  }
+  sampler.finish();
+
+  return sample;
+}
@@ -0,0 +1,108 @@
+#include <tests/test_helpers.hpp>
+#include <core_library/print.hpp>
+
+#include <cstring>
+#include <fstream>
+
+int num_failures = 0;
+
+const PcvdImporter::read_mode_t all_read_modes[3] = {PcvdImporter::READ_MODE::MEMORY_MAPPING, PcvdImporter::READ_MODE::STREAM, PcvdImporter::READ_MODE::PARALLEL_READ};
+
+void expect(bool condition, const std::string& message)
+{
+  if(!condition)
+  {
+    println_error("FAILED: ", message);
+    ++num_failures;
+  }
+}
+
+int test_result()
+{
+  if(num_failures > 0)
+  {
+    println_error(num_failures, " checks failed");
+    return -1;
+  }
+
+  return 0;
+}
+
+void make_numbered_grid(PointCloud* pointcloud, size_t first_point, size_t end_point, grid_user_data_t user_data, float32_t spacing)
+{
+  typedef data_type::BASE_TYPE BASE_TYPE;
+
+  switch(user_data)
+  {
+  case grid_user_data_t::INDEX:
+    pointcloud->set_user_data_format(4, {"index"}, {0}, {BASE_TYPE::UINT32});
+    break;
+  case grid_user_data_t::INDEX_AND_COORDINATES:
+    pointcloud->set_user_data_format(16, {"index", "x", "y", "z"}, {0, 4, 8, 12}, {BASE_TYPE::UINT32, BASE_TYPE::FLOAT32, BASE_TYPE::FLOAT32, BASE_TYPE::FLOAT32});
+    break;
+  case grid_user_data_t::INDEX_COORDINATES_AND_INTENSITY:
+    pointcloud->set_user_data_format(18, {"index", "x", "y", "z", "intensity"}, {0, 4, 8, 12, 16}, {BASE_TYPE::UINT32, BASE_TYPE::FLOAT32, BASE_TYPE::FLOAT32, BASE_TYPE::FLOAT32, BASE_TYPE::UINT16});
+    break;
+  }
+
+  pointcloud->resize(end_point - first_point);
+  pointcloud->aabb = aabb_t::invalid();
+
+  const size_t stride = pointcloud->user_data_stride;
+  PointCloud::vertex_t* vertices = reinterpret_cast<PointCloud::vertex_t*>(pointcloud->coordinate_color.data());
+  uint8_t* row = pointcloud->user_data.data();
+
+  for(size_t i=first_point; i<end_point; ++i, row+=stride)
+  {
+    PointCloud::vertex_t& vertex = vertices[i - first_point];
+    vertex.coordinate = glm::vec3(i % 100, (i / 100) % 100, i / 10000) * spacing;
+    vertex.color = glm::u8vec3(uint8_t(i), uint8_t(i / 100), 128);
+
+    const uint32_t index = uint32_t(i);
+    std::memcpy(row, &index, 4);
+    if(user_data != grid_user_data_t::INDEX)
+      std::memcpy(row + 4, &vertex.coordinate, 12);
+    if(user_data == grid_user_data_t::INDEX_COORDINATES_AND_INTENSITY)
+    {
+      const uint16_t intensity = uint16_t(i * 7919);
+      std::memcpy(row + 16, &intensity, 2);
+    }
+
+    pointcloud->aabb |= vertex.coordinate;
+  }
+
+  pointcloud->is_valid = true;
+}
+
+std::vector<uint32_t> indices_of_points(const PointCloud& pointcloud)
+{
+  std::vector<uint32_t> indices(pointcloud.num_points);
+  for(size_t i=0; i<pointcloud.num_points; ++i)
+    std::memcpy(&indices[i], pointcloud.user_data.const_data() + i*pointcloud.user_data_stride, 4);
+  return indices;
+}
+
+bool same_points(const PointCloud& a, const PointCloud& b)
+{
+  return a.num_points == b.num_points
+      && a.user_data_stride == b.user_data_stride
+      && a.user_data_names == b.user_data_names
+      && std::memcmp(a.coordinate_color.const_data(), b.coordinate_color.const_data(), a.num_points * PointCloud::stride) == 0
+      && std::memcmp(a.user_data.const_data(), b.user_data.const_data(), a.num_points * a.user_data_stride) == 0;
+}
+
+bool read_chunk_table(const std::string& filename, pcvd_file_t* file)
+{
+  std::ifstream stream(filename, std::ios::binary);
+
+  stream.read(reinterpret_cast<char*>(&file->header), sizeof(pcvd_format::header_t));
+  stream.read(reinterpret_cast<char*>(&file->chunks_header), sizeof(pcvd_format::chunks_header_t));
+  if(!stream || file->header.magic_number != pcvd_format::header_t::expected_macic_number())
+    return false;
+
+  file->chunks.resize(file->chunks_header.number_chunks);
+  stream.seekg(file->chunks_header.chunk_table_offset);
+  stream.read(reinterpret_cast<char*>(file->chunks.data()), std::streamsize(file->chunks.size() * sizeof(pcvd_format::chunk_description_t)));
+
+  return bool(stream);
+}
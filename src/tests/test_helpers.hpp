@@ -0,0 +1,54 @@
+#ifndef TESTS_TEST_HELPERS_HPP_
+#define TESTS_TEST_HELPERS_HPP_
+
+#include <pointcloud/importer/pcvd_importer.hpp>
+#include <pointcloud/pcvd_file_format.hpp>
+#include <pointcloud/pointcloud.hpp>
+
+#include <string>
+#include <vector>
+
+/*
+Scaffolding shared by the tests: counting failed checks, synthetic point clouds
+whose points can be traced back by their index and reading the chunk table of
+pcvd files.
+*/
+
+extern int num_failures;
+
+// Counts and prints the check, if the condition doesn't hold
+void expect(bool condition, const std::string& message);
+
+// Prints the number of failed checks and returns the exit code of the test
+int test_result();
+
+// The user data of the points created by make_numbered_grid
+enum class grid_user_data_t
+{
+  INDEX, // the index of the point (uint32)
+  INDEX_AND_COORDINATES, // the index followed by the coordinates (float32)
+  INDEX_COORDINATES_AND_INTENSITY, // the index and the coordinates followed by an intensity (uint16)
+};
+
+// The points with the indices [first_point, end_point) of a grid with 100x100 points per layer and the given distance between the points.
+// Consecutive points lie next to each other, so consecutive chunks cover consecutive layers.
+void make_numbered_grid(PointCloud* pointcloud, size_t first_point, size_t end_point, grid_user_data_t user_data, float32_t spacing=1.f);
+
+// The indices stored by make_numbered_grid
+std::vector<uint32_t> indices_of_points(const PointCloud& pointcloud);
+
+// The same vertices and user data
+bool same_points(const PointCloud& a, const PointCloud& b);
+
+extern const PcvdImporter::read_mode_t all_read_modes[3];
+
+struct pcvd_file_t
+{
+  pcvd_format::header_t header;
+  pcvd_format::chunks_header_t chunks_header;
+  std::vector<pcvd_format::chunk_description_t> chunks;
+};
+
+bool read_chunk_table(const std::string& filename, pcvd_file_t* file);
+
+#endif // TESTS_TEST_HELPERS_HPP_
@@ -0,0 +1,62 @@
+#include <pointcloud/importer/text_importer.hpp>
+#include <tests/test_helpers.hpp>
+#include <core_library/print.hpp>
+
+#include <QTemporaryDir>
+
+#include <cstring>
+#include <fstream>
+
+/*
+Checks the text importer: the types guessed for the columns of an xyz file
+have to fit values appearing only late in the file.
+*/
+
+typedef data_type::BASE_TYPE BASE_TYPE;
+
+void test_types_of_late_rows(const QTemporaryDir& directory)
+{
+  // the last rows need wider types than all rows before
+  const size_t num_points = 5000;
+  const std::string filename = (directory.path() + "/late_rows.xyz").toStdString();
+  {
+    std::ofstream stream(filename);
+    for(size_t i=0; i<num_points-1; ++i)
+      stream << i << " 0 0 0.5 10 20 30\n";
+    stream << num_points-1 << " 0 0 0.123456789 300 20 30\n";
+  }
+
+  TextImporter importer(filename);
+  importer.import();
+  const PointCloud& imported = importer.pointcloud;
+  expect(importer.state == AbstractPointCloudImporter::SUCCEEDED, "late rows: import");
+  expect(imported.num_points == num_points && imported.user_data_names.size() == 7, "late rows: points and columns");
+  if(imported.num_points != num_points || imported.user_data_names.size() != 7)
+    return;
+
+  expect(imported.user_data_names[3] == "intensity" && imported.user_data_types[3] == BASE_TYPE::FLOAT64, "late rows: type of the intensity");
+  expect(imported.user_data_names[4] == "red" && imported.user_data_types[4] == BASE_TYPE::UINT16, "late rows: type of red");
+  if(imported.user_data_types[3] != BASE_TYPE::FLOAT64 || imported.user_data_types[4] != BASE_TYPE::UINT16)
+    return;
+
+  const uint8_t* last_row = imported.user_data.const_data() + (num_points-1)*imported.user_data_stride;
+  float64_t intensity;
+  uint16_t red;
+  std::memcpy(&intensity, last_row + imported.user_data_offset[3], sizeof(float64_t));
+  std::memcpy(&red, last_row + imported.user_data_offset[4], sizeof(uint16_t));
+  expect(intensity == 0.123456789 && red == 300, "late rows: values of the last row");
+}
+
+int main()
+{
+  QTemporaryDir directory;
+  if(!directory.isValid())
+  {
+    println_error("Couldn't create a temporary directory");
+    return -1;
+  }
+
+  test_types_of_late_rows(directory);
+
+  return test_result();
+}